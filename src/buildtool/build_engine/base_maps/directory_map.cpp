@@ -58,6 +58,5 @@ auto BuildMaps::Base::CreateDirectoryEntriesMap(
         }
         (*setter)(ws_root->ReadDirectory(dir_path));
     };
-    return AsyncMapConsumer<BuildMaps::Base::ModuleName,
-                            FileRoot::DirectoryEntries>{directory_reader, jobs};
+    return DirectoryEntriesMap{directory_reader, jobs};
 }
@@ -22,11 +22,14 @@
 #include "src/buildtool/common/repository_config.hpp"
 #include "src/buildtool/file_system/file_root.hpp"
 #include "src/buildtool/multithreading/async_map_consumer.hpp"
+#include "src/buildtool/multithreading/concurrent_async_map.hpp"
 
 namespace BuildMaps::Base {
 
-using DirectoryEntriesMap =
-    AsyncMapConsumer<ModuleName, FileRoot::DirectoryEntries>;
+using DirectoryEntriesMap = AsyncMapConsumer<
+    ModuleName,
+    FileRoot::DirectoryEntries,
+    ConcurrentAsyncMap<ModuleName, FileRoot::DirectoryEntries>>;
 
 auto CreateDirectoryEntriesMap(
     gsl::not_null<const RepositoryConfig*> const& repo_config,
@@ -48,7 +48,8 @@ class ExpressionFunction {
                        ExpressionPtr expr) noexcept
         : vars_{std::move(vars)},
           imports_{std::move(imports)},
-          expr_{std::move(expr)} {}
+          expr_{std::move(expr)},
+          compiled_{Evaluator::Compile(expr_)} {}
 
     [[nodiscard]] auto Evaluate(
         Configuration const& env,
@@ -98,13 +99,21 @@ class ExpressionFunction {
                     fmt::format("Unknown expression '{}'.", name));
             };
             auto newenv = env.Prune(vars_);
-            return expr_.Evaluate(
-                newenv,
-                FunctionMap::MakePtr(
-                    functions, "CALL_EXPRESSION", imports_caller),
-                logger,
-                annotate_object,
-                note_user_context);
+            auto newfunctions = FunctionMap::MakePtr(
+                functions, "CALL_EXPRESSION", imports_caller);
+            if (compiled_) {
+                return Evaluator::EvaluateExpression(*compiled_,
+                                                     newenv,
+                                                     newfunctions,
+                                                     logger,
+                                                     annotate_object,
+                                                     note_user_context);
+            }
+            return expr_.Evaluate(newenv,
+                                  newfunctions,
+                                  logger,
+                                  annotate_object,
+                                  note_user_context);
         } catch (...) {
             EnsuresAudit(false);  // ensure that the try-block never throws
             return ExpressionPtr{nullptr};
@@ -121,6 +130,7 @@ class ExpressionFunction {
     std::vector<std::string> vars_;
     imports_t imports_;
     ExpressionPtr expr_;
+    Evaluator::CompiledExpressionPtr compiled_;
 };
 
 using ExpressionFunctionPtr = ExpressionFunction::Ptr;
@@ -26,6 +26,7 @@
 
 #include "nlohmann/json.hpp"
 #include "src/buildtool/build_engine/expression/expression.hpp"
+#include "src/buildtool/build_engine/expression/expression_interner.hpp"
 #include "src/buildtool/build_engine/expression/expression_ptr.hpp"
 #include "src/utils/cpp/concepts.hpp"
 #include "src/utils/cpp/gsl.hpp"
@@ -109,7 +110,8 @@ class Configuration {
                 subset.emplace(k, Expression::kNone);
             }
         });
-        return Configuration{Expression::map_t{subset}};
+        return Configuration{ExpressionInterner::Instance().Intern(
+            ExpressionPtr{Expression::map_t{std::move(subset)}})};
     }
 
     [[nodiscard]] auto Prune(ExpressionPtr const& vars) const -> Configuration {
@@ -123,10 +125,11 @@ class Configuration {
                 subset.emplace(key, **v);
             }
             else {
-                subset.emplace(key, ExpressionPtr{Expression::none_t{}});
+                subset.emplace(key, Expression::kNone);
             }
         });
-        return Configuration{Expression::map_t{subset}};
+        return Configuration{ExpressionInterner::Instance().Intern(
+            ExpressionPtr{Expression::map_t{std::move(subset)}})};
     }
 
     template <class T>
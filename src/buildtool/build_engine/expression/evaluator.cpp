@@ -15,19 +15,27 @@
 #include "src/buildtool/build_engine/expression/evaluator.hpp"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <compare>
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
 #include <filesystem>
+#include <initializer_list>
 #include <iterator>
 #include <map>
+#include <mutex>
 #include <optional>
+#include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>  // std::move
+#include <vector>
 
 #include "fmt/core.h"
 #include "nlohmann/json.hpp"
@@ -35,6 +43,7 @@
 #include "src/buildtool/build_engine/expression/expression.hpp"
 #include "src/buildtool/build_engine/expression/function_map.hpp"
 #include "src/buildtool/build_engine/expression/linked_map.hpp"
+#include "src/buildtool/multithreading/atomic_value.hpp"
 #include "src/utils/cpp/path.hpp"
 
 namespace {
@@ -486,6 +495,115 @@ auto EvalArgument(ExpressionPtr const& expr,
     }
 }
 
+/// \brief Bounded table of results of built-in functions that only depend on
+/// the values of their evaluated arguments, keyed by the function name and
+/// the hashes of the argument values. Each shard keeps two generations of
+/// entries; once the current generation is full, it replaces the previous
+/// one, so that entries used since then survive. All lookups are thread-safe.
+class BuiltinMemo final {
+  public:
+    [[nodiscard]] static auto Instance() noexcept -> BuiltinMemo& {
+        static BuiltinMemo instance{};
+        return instance;
+    }
+
+    void Configure(std::size_t max_entries, Statistics* stats) noexcept {
+        for (auto& shard : shards_) {
+            std::unique_lock lock{shard.mutex};
+            shard.current.clear();
+            shard.previous.clear();
+        }
+        generation_size_ =
+            max_entries == 0
+                ? 0
+                : std::max(std::size_t{1}, max_entries / (2 * kShards));
+        stats_ = stats;
+    }
+
+    /// \brief Obtain the result of the named function for the given argument
+    /// values, calling compute on a miss. Failures are not memoized.
+    template <class TCompute>
+    [[nodiscard]] auto Get(std::string_view name,
+                           std::initializer_list<ExpressionPtr> arguments,
+                           TCompute const& compute) -> ExpressionPtr {
+        if (generation_size_ == 0) {
+            return compute();
+        }
+        std::string key{name};
+        key += '\0';
+        for (auto const& argument : arguments) {
+            key += argument->ToHash();
+        }
+        auto& shard = shards_.at(std::hash<std::string>{}(key) % kShards);
+        {
+            std::unique_lock lock{shard.mutex};
+            if (auto it = shard.current.find(key); it != shard.current.end()) {
+                CountHit();
+                return it->second;
+            }
+            if (auto it = shard.previous.find(key);
+                it != shard.previous.end()) {
+                auto value = std::move(it->second);
+                shard.previous.erase(it);
+                Store(&shard, std::move(key), value);
+                CountHit();
+                return value;
+            }
+        }
+        CountMiss();
+        auto value = compute();
+        std::unique_lock lock{shard.mutex};
+        Store(&shard, std::move(key), value);
+        return value;
+    }
+
+  private:
+    static constexpr std::size_t kShards = 64;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, ExpressionPtr> current;
+        std::unordered_map<std::string, ExpressionPtr> previous;
+    };
+
+    std::array<Shard, kShards> shards_;
+    std::size_t generation_size_{};
+    Statistics* stats_{};
+
+    BuiltinMemo() = default;
+
+    void Store(Shard* shard, std::string key, ExpressionPtr const& value) {
+        if (shard->current.size() >= generation_size_) {
+            shard->previous = std::move(shard->current);
+            shard->current.clear();
+        }
+        shard->current.insert_or_assign(std::move(key), value);
+    }
+
+    void CountHit() const noexcept {
+        if (stats_ != nullptr) {
+            stats_->IncrementBuiltinMemoHitsCounter();
+        }
+    }
+
+    void CountMiss() const noexcept {
+        if (stats_ != nullptr) {
+            stats_->IncrementBuiltinMemoMissesCounter();
+        }
+    }
+};
+
+/// \brief Memoize a unary built-in function, whose result only depends on the
+/// value of its argument.
+auto Memoized(std::string name,
+              std::function<ExpressionPtr(ExpressionPtr const&)> f)
+    -> std::function<ExpressionPtr(ExpressionPtr const&)> {
+    return [name = std::move(name), f = std::move(f)](auto const& argument) {
+        return BuiltinMemo::Instance().Get(
+            name, {argument}, [&f, &argument]() { return f(argument); });
+    };
+}
+
 auto UnaryExpr(std::function<ExpressionPtr(ExpressionPtr const&)> const& f)
     -> std::function<ExpressionPtr(SubExprEvaluator&&,
                                    ExpressionPtr const&,
@@ -794,14 +912,19 @@ auto JoinExpr(SubExprEvaluator&& eval,
               Configuration const& env) -> ExpressionPtr {
     auto list = eval(expr->Get("$1", list_t{}), env);
     auto separator = eval(expr->Get("separator", ""s), env);
-    return Join(list, separator->String());
+    return BuiltinMemo::Instance().Get(
+        "join", {list, separator}, [&list, &separator]() {
+            return Join(list, separator->String());
+        });
 }
 
 auto JoinCmdExpr(SubExprEvaluator&& eval,
                  ExpressionPtr const& expr,
                  Configuration const& env) -> ExpressionPtr {
     auto const& list = eval(expr->Get("$1", list_t{}), env);
-    return Join</*kDoQuote=*/true, /*kAllowString=*/false>(list, " ");
+    return BuiltinMemo::Instance().Get("join_cmd", {list}, [&list]() {
+        return Join</*kDoQuote=*/true, /*kAllowString=*/false>(list, " ");
+    });
 }
 
 auto JsonEncodeExpr(SubExprEvaluator&& eval,
@@ -891,13 +1014,12 @@ auto SingletonMapExpr(SubExprEvaluator&& eval,
     return ExpressionPtr{Expression::map_t{key->String(), value}};
 }
 
-auto ToSubdirExpr(SubExprEvaluator&& eval,
-                  ExpressionPtr const& expr,
-                  Configuration const& env) -> ExpressionPtr {
-    auto d = eval(expr["$1"], env);
-    auto s = eval(expr->Get("subdir", "."s), env);
-    auto flat = ValueIsTrue(eval(expr->Get("flat", false), env));
-    std::filesystem::path subdir{s->String()};
+auto ToSubdir(SubExprEvaluator const& eval,
+              ExpressionPtr const& expr,
+              Configuration const& env,
+              ExpressionPtr const& d,
+              std::filesystem::path const& subdir,
+              bool flat) -> ExpressionPtr {
     auto result = Expression::map_t::underlying_map_t{};
     if (flat) {
         for (auto const& el : d->Map()) {
@@ -967,6 +1089,17 @@ auto ToSubdirExpr(SubExprEvaluator&& eval,
     return ExpressionPtr{Expression::map_t{result}};
 }
 
+auto ToSubdirExpr(SubExprEvaluator&& eval,
+                  ExpressionPtr const& expr,
+                  Configuration const& env) -> ExpressionPtr {
+    auto d = eval(expr["$1"], env);
+    auto s = eval(expr->Get("subdir", "."s), env);
+    auto flat = eval(expr->Get("flat", false), env);
+    return BuiltinMemo::Instance().Get("to_subdir", {d, s, flat}, [&]() {
+        return ToSubdir(eval, expr, env, d, s->String(), ValueIsTrue(flat));
+    });
+}
+
 auto FromSubdirExpr(SubExprEvaluator&& eval,
                     ExpressionPtr const& expr,
                     Configuration const& env) -> ExpressionPtr {
@@ -1183,7 +1316,10 @@ auto DisjointUnionExpr(SubExprEvaluator&& eval,
                         argument->ToString())};
     }
     try {
-        return Union</*kDisjoint=*/true>(argument);
+        return BuiltinMemo::Instance().Get(
+            "disjoint_map_union", {argument}, [&argument]() {
+                return Union</*kDisjoint=*/true>(argument);
+            });
     } catch (Evaluator::EvaluationError const& ex) {
         auto msg_expr = expr->Map().Find("msg");
         if (not msg_expr) {
@@ -1301,11 +1437,13 @@ auto const kBuiltInFunctions =
                           {"and", AndExpr},
                           {"or", OrExpr},
                           {"not", UnaryExpr(Not)},
-                          {"++", UnaryExpr(Flatten)},
+                          {"++", UnaryExpr(Memoized("++", Flatten))},
                           {"+", UnaryExpr(Addition)},
                           {"*", UnaryExpr(Multiplication)},
-                          {"nub_right", UnaryExpr(NubRight)},
-                          {"nub_left", UnaryExpr(NubLeft)},
+                          {"nub_right",
+                           UnaryExpr(Memoized("nub_right", NubRight))},
+                          {"nub_left",
+                           UnaryExpr(Memoized("nub_left", NubLeft))},
                           {"range", UnaryExpr(Range)},
                           {"change_ending", ChangeEndingExpr},
                           {"basename", UnaryExpr(BaseName)},
@@ -1315,7 +1453,7 @@ auto const kBuiltInFunctions =
                           {"escape_chars", EscapeCharsExpr},
                           {"keys", UnaryExpr(Keys)},
                           {"enumerate", UnaryExpr(Enumerate)},
-                          {"set", UnaryExpr(Set)},
+                          {"set", UnaryExpr(Memoized("set", Set))},
                           {"reverse", UnaryExpr(Reverse)},
                           {"length", UnaryExpr(Length)},
                           {"values", UnaryExpr(Values)},
@@ -1324,9 +1462,10 @@ auto const kBuiltInFunctions =
                           {"empty_map", EmptyMapExpr},
                           {"singleton_map", SingletonMapExpr},
                           {"disjoint_map_union", DisjointUnionExpr},
-                          {"map_union", UnaryExpr([](auto const& exp) {
+                          {"map_union",
+                           UnaryExpr(Memoized("map_union", [](auto const& exp) {
                                return Union</*kDisjoint=*/false>(exp);
-                           })},
+                           }))},
                           {"to_subdir", ToSubdirExpr},
                           {"from_subdir", FromSubdirExpr},
                           {"foreach", ForeachExpr},
@@ -1336,6 +1475,45 @@ auto const kBuiltInFunctions =
                           {"env", EnvExpr},
                           {"concat_target_name", ConcatTargetNameExpr}});
 
+using Function = FunctionMap::underlying_map_t::mapped_type;
+
+/// \brief Built-in functions whose result only depends on the values of their
+/// arguments and not on the environment, so that calls with arguments that
+/// do not depend on the environment either need to be evaluated only once.
+auto const kPureFunctions = std::unordered_set<std::string>{
+    "'",         "==",          "++",          "+",
+    "*",         "not",         "nub_right",   "nub_left",
+    "range",     "basename",    "join",        "join_cmd",
+    "keys",      "enumerate",   "set",         "reverse",
+    "length",    "values",      "empty_map",   "singleton_map",
+    "map_union", "to_subdir",   "from_subdir", "disjoint_map_union",
+    "lookup",    "escape_chars"};
+
+/// \brief Obtain the function to call for a type, where provider functions
+/// take precedence over the given built-in function.
+auto Resolve(std::string const& type,
+             Function const* builtin,
+             FunctionMapPtr const& providers) -> Function const* {
+    if (providers) {
+        if (auto func = providers->Find(type)) {
+            return *func;
+        }
+    }
+    return builtin;
+}
+
+/// \brief Check if any of the given built-in functions is shadowed by a
+/// provider function.
+auto IsShadowed(std::set<std::string> const& builtins,
+                FunctionMapPtr const& providers) -> bool {
+    return providers and
+           std::any_of(builtins.begin(),
+                       builtins.end(),
+                       [&providers](auto const& name) {
+                           return providers->Find(name).has_value();
+                       });
+}
+
 auto ExtendedErrorMessage(ExpressionPtr const& expr,
                           Configuration const& env,
                           std::exception const& ex) -> std::string {
@@ -1355,6 +1533,149 @@ auto ExtendedErrorMessage(ExpressionPtr const& expr,
 
 }  // namespace
 
+class Evaluator::CompiledExpression final {
+  public:
+    /// \brief How to evaluate a node of the expression.
+    struct Plan {
+        /// \brief Node, if its value is independent of the environment.
+        ExpressionPtr constant{nullptr};
+        /// \brief Built-in functions called to obtain the value of a constant
+        /// node, which must not be used if any of them is shadowed.
+        std::set<std::string> folded;
+        /// \brief Value of a constant node, evaluated when first needed, so
+        /// that parts of the expression never reached are never evaluated.
+        /// Null, if evaluation failed.
+        AtomicValue<ExpressionPtr> value;
+        /// \brief Type and built-in function of a function call.
+        std::string const* type{};
+        Function const* builtin{};
+    };
+
+    explicit CompiledExpression(ExpressionPtr expr) : expr_{std::move(expr)} {
+        std::ignore = CompileNode(expr_);
+    }
+
+    [[nodiscard]] auto Expr() const noexcept -> ExpressionPtr const& {
+        return expr_;
+    }
+
+    [[nodiscard]] auto Find(Expression const& node) const noexcept
+        -> Plan const* {
+        auto it = plans_.find(&node);
+        return it != plans_.end() ? &it->second : nullptr;
+    }
+
+    /// \brief Value of a constant node, evaluated on the first call.
+    /// \returns The value, or nullptr if evaluating the node failed, so that
+    /// the error is reported when evaluating it in the environment.
+    [[nodiscard]] auto Value(Plan const& plan) const -> ExpressionPtr const& {
+        return plan.value.SetOnceAndGet([this, &plan]() -> ExpressionPtr {
+            try {
+                auto const& expr = plan.constant;
+                if (expr->IsList()) {
+                    auto list = Expression::list_t{};
+                    list.reserve(expr->List().size());
+                    for (auto const& el : expr->List()) {
+                        list.emplace_back(
+                            Evaluate(el, Configuration{}, {}, this));
+                    }
+                    return ExpressionPtr{std::move(list)};
+                }
+                return (*plan.builtin)(
+                    [this](auto const& subexpr, auto const& subenv) {
+                        return Evaluate(subexpr, subenv, {}, this);
+                    },
+                    expr,
+                    Configuration{});
+            } catch (...) {
+                return ExpressionPtr{nullptr};
+            }
+        });
+    }
+
+  private:
+    ExpressionPtr expr_;
+    std::unordered_map<Expression const*, Plan> plans_;
+
+    /// \brief Compile a node and the nodes below it, without evaluating them.
+    /// \returns The built-in functions called to obtain the value of the node,
+    /// if its value is independent of the environment.
+    [[nodiscard]] auto CompileNode(ExpressionPtr const& expr)
+        -> std::optional<std::set<std::string>>;
+};
+
+auto Evaluator::CompiledExpression::CompileNode(ExpressionPtr const& expr)
+    -> std::optional<std::set<std::string>> {
+    if (not expr->IsList() and not expr->IsMap()) {
+        return std::set<std::string>{};
+    }
+    if (auto it = plans_.find(&*expr); it != plans_.end()) {
+        if (it->second.constant) {
+            return it->second.folded;
+        }
+        return std::nullopt;
+    }
+
+    Plan plan{};
+    bool independent = true;
+    auto collect = [this, &plan, &independent](ExpressionPtr const& child) {
+        if (auto folded = CompileNode(child)) {
+            plan.folded.merge(*folded);
+        }
+        else {
+            independent = false;
+        }
+    };
+    if (expr->IsList()) {
+        for (auto const& el : expr->List()) {
+            collect(el);
+        }
+        if (independent) {
+            plan.constant = expr;
+        }
+    }
+    else if (auto type = expr->Map().Find("type");
+             type and (**type)->IsString()) {
+        plan.type = &(**type)->String();
+        plan.builtin = kBuiltInFunctions->Find(*plan.type).value_or(nullptr);
+        // the argument of a quote is not evaluated
+        if (*plan.type != "'") {
+            for (auto const& [key, value] : expr->Map()) {
+                if (key != "type") {
+                    collect(value);
+                }
+            }
+        }
+        if (independent and plan.builtin != nullptr and
+            kPureFunctions.contains(*plan.type)) {
+            plan.constant = expr;
+            plan.folded.emplace(*plan.type);
+        }
+    }
+    else {
+        for (auto const& [key, value] : expr->Map()) {
+            collect(value);
+        }
+    }
+    if (not plan.constant) {
+        plan.folded.clear();
+    }
+    auto const& stored = plans_.emplace(&*expr, std::move(plan)).first->second;
+    if (stored.constant) {
+        return stored.folded;
+    }
+    return std::nullopt;
+}
+
+auto Evaluator::Compile(ExpressionPtr const& expr) noexcept
+    -> CompiledExpressionPtr {
+    try {
+        return std::make_shared<CompiledExpression const>(expr);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
 auto Evaluator::EvaluationError::WhileEvaluating(ExpressionPtr const& expr,
                                                  Configuration const& env,
                                                  std::exception const& ex)
@@ -1395,6 +1716,11 @@ auto Evaluator::EvaluationError::WhileEval(const std::string& where,
     return EvaluationError{ss.str(), true, false, ex.InvolvedObjects()};
 }
 
+void Evaluator::SetBuiltinMemoization(std::size_t max_entries,
+                                      Statistics* stats) {
+    BuiltinMemo::Instance().Configure(max_entries, stats);
+}
+
 auto Evaluator::EvaluateExpression(
     ExpressionPtr const& expr,
     Configuration const& env,
@@ -1403,12 +1729,44 @@ auto Evaluator::EvaluateExpression(
     std::function<std::string(ExpressionPtr)> const& annotate_object,
     std::function<void(void)> const& note_user_context) noexcept
     -> ExpressionPtr {
+    return EvaluateReportingErrors(expr,
+                                   nullptr,
+                                   env,
+                                   provider_functions,
+                                   logger,
+                                   annotate_object,
+                                   note_user_context);
+}
+
+auto Evaluator::EvaluateExpression(
+    CompiledExpression const& compiled,
+    Configuration const& env,
+    FunctionMapPtr const& provider_functions,
+    std::function<void(std::string const&)> const& logger,
+    std::function<std::string(ExpressionPtr)> const& annotate_object,
+    std::function<void(void)> const& note_user_context) noexcept
+    -> ExpressionPtr {
+    return EvaluateReportingErrors(compiled.Expr(),
+                                   &compiled,
+                                   env,
+                                   provider_functions,
+                                   logger,
+                                   annotate_object,
+                                   note_user_context);
+}
+
+auto Evaluator::EvaluateReportingErrors(
+    ExpressionPtr const& expr,
+    CompiledExpression const* compiled,
+    Configuration const& env,
+    FunctionMapPtr const& provider_functions,
+    std::function<void(std::string const&)> const& logger,
+    std::function<std::string(ExpressionPtr)> const& annotate_object,
+    std::function<void(void)> const& note_user_context) noexcept
+    -> ExpressionPtr {
     std::stringstream ss{};
     try {
-        return Evaluate(
-            expr,
-            env,
-            FunctionMap::MakePtr(kBuiltInFunctions, provider_functions));
+        return Evaluate(expr, env, provider_functions, compiled);
     } catch (EvaluationError const& ex) {
         if (ex.UserContext()) {
             note_user_context();
@@ -1430,39 +1788,60 @@ auto Evaluator::EvaluateExpression(
 
 auto Evaluator::Evaluate(ExpressionPtr const& expr,
                          Configuration const& env,
-                         FunctionMapPtr const& functions) -> ExpressionPtr {
+                         FunctionMapPtr const& functions,
+                         CompiledExpression const* compiled) -> ExpressionPtr {
+    auto const* plan = compiled != nullptr ? compiled->Find(*expr) : nullptr;
+    if (plan != nullptr and plan->constant and
+        not IsShadowed(plan->folded, functions)) {
+        if (auto const& value = compiled->Value(*plan)) {
+            return value;
+        }
+    }
     try {
         if (expr->IsList()) {
             if (expr->List().empty()) {
                 return expr;
             }
             auto list = Expression::list_t{};
-            std::transform(
-                expr->List().cbegin(),
-                expr->List().cend(),
-                std::back_inserter(list),
-                [&](auto const& e) { return Evaluate(e, env, functions); });
+            std::transform(expr->List().cbegin(),
+                           expr->List().cend(),
+                           std::back_inserter(list),
+                           [&](auto const& e) {
+                               return Evaluate(e, env, functions, compiled);
+                           });
             return ExpressionPtr{list};
         }
         if (not expr->IsMap()) {
             return expr;
         }
-        if (not expr->Map().contains("type")) {
-            throw EvaluationError{fmt::format(
-                "Object without keyword 'type': {}", expr->ToString())};
+        Function const* func{};
+        std::string const* type{};
+        if (plan != nullptr and plan->type != nullptr) {
+            type = plan->type;
+            func = Resolve(*type, plan->builtin, functions);
+        }
+        else {
+            if (not expr->Map().contains("type")) {
+                throw EvaluationError{fmt::format(
+                    "Object without keyword 'type': {}", expr->ToString())};
+            }
+            type = &expr["type"]->String();
+            func = Resolve(*type,
+                           kBuiltInFunctions->Find(*type).value_or(nullptr),
+                           functions);
         }
-        auto const& type = expr["type"]->String();
-        auto func = functions->Find(type);
-        if (func) {
-            return (**func)(
-                [&functions](auto const& subexpr, auto const& subenv) {
-                    return Evaluator::Evaluate(subexpr, subenv, functions);
+        if (func != nullptr) {
+            return (*func)(
+                [&functions, compiled](auto const& subexpr,
+                                       auto const& subenv) {
+                    return Evaluator::Evaluate(
+                        subexpr, subenv, functions, compiled);
                 },
                 expr,
                 env);
         }
         throw EvaluationError{
-            fmt::format("Unknown syntactical construct {}", type)};
+            fmt::format("Unknown syntactical construct {}", *type)};
     } catch (EvaluationError const& ex) {
         throw EvaluationError::WhileEval(expr, env, ex);
     } catch (std::exception const& ex) {
@@ -18,12 +18,14 @@
 #include <cstddef>
 #include <exception>
 #include <functional>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "src/buildtool/build_engine/expression/expression_ptr.hpp"
 #include "src/buildtool/build_engine/expression/function_map.hpp"
+#include "src/buildtool/common/statistics.hpp"
 
 class Evaluator {
     struct ConfigData {
@@ -41,6 +43,14 @@ class Evaluator {
         return Config().expression_log_limit;
     }
 
+    /// \brief Memoize the results of built-in functions that only depend on
+    /// the values of their evaluated arguments, keeping at most the given
+    /// number of results; 0 disables memoization. Hits and misses are counted
+    /// in the given statistics, if any. Must not be called concurrently with
+    /// evaluating expressions.
+    static void SetBuiltinMemoization(std::size_t max_entries,
+                                      Statistics* stats = nullptr);
+
     class EvaluationError : public std::exception {
       public:
         explicit EvaluationError(std::string msg,
@@ -101,6 +111,19 @@ class Evaluator {
         std::vector<ExpressionPtr> involved_objects_;
     };
 
+    /// \brief Expression prepared for repeated evaluation, like the body of a
+    /// rule evaluated for every target defined by that rule. Built-in
+    /// functions are resolved once and parts of the expression that do not
+    /// depend on the environment are evaluated only once, when first reached.
+    /// Provider functions shadowing built-in functions are still honored.
+    class CompiledExpression;
+    using CompiledExpressionPtr = std::shared_ptr<CompiledExpression const>;
+
+    /// \brief Compile an expression for repeated evaluation.
+    /// \returns The compiled expression or nullptr on failure.
+    [[nodiscard]] static auto Compile(ExpressionPtr const& expr) noexcept
+        -> CompiledExpressionPtr;
+
     // Exception-free evaluation of expression
     [[nodiscard]] static auto EvaluateExpression(
         ExpressionPtr const& expr,
@@ -112,13 +135,38 @@ class Evaluator {
         std::function<void(void)> const& note_user_context =
             []() {}) noexcept -> ExpressionPtr;
 
+    // Exception-free evaluation of compiled expression
+    [[nodiscard]] static auto EvaluateExpression(
+        CompiledExpression const& compiled,
+        Configuration const& env,
+        FunctionMapPtr const& provider_functions,
+        std::function<void(std::string const&)> const& logger,
+        std::function<std::string(ExpressionPtr)> const& annotate_object =
+            [](auto const& /*unused*/) { return std::string{}; },
+        std::function<void(void)> const& note_user_context =
+            []() {}) noexcept -> ExpressionPtr;
+
     constexpr static std::size_t kDefaultExpressionLogLimit = 320;
 
   private:
-    [[nodiscard]] static auto Evaluate(ExpressionPtr const& expr,
-                                       Configuration const& env,
-                                       FunctionMapPtr const& functions)
+    [[nodiscard]] static auto EvaluateReportingErrors(
+        ExpressionPtr const& expr,
+        CompiledExpression const* compiled,
+        Configuration const& env,
+        FunctionMapPtr const& provider_functions,
+        std::function<void(std::string const&)> const& logger,
+        std::function<std::string(ExpressionPtr)> const& annotate_object,
+        std::function<void(void)> const& note_user_context) noexcept
         -> ExpressionPtr;
+
+    /// \brief Evaluate an expression, using the plans of the compiled
+    /// expression, if given, for its nodes. Provider functions take
+    /// precedence over built-in functions of the same name.
+    [[nodiscard]] static auto Evaluate(
+        ExpressionPtr const& expr,
+        Configuration const& env,
+        FunctionMapPtr const& functions,
+        CompiledExpression const* compiled = nullptr) -> ExpressionPtr;
     [[nodiscard]] static auto Config() noexcept -> ConfigData& {
         static ConfigData instance{};
         return instance;
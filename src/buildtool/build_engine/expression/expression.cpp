@@ -15,16 +15,85 @@
 #include "src/buildtool/build_engine/expression/expression.hpp"
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #include "fmt/core.h"
+#include "src/buildtool/build_engine/expression/expression_interner.hpp"
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/crypto/hasher.hpp"
 #include "src/utils/cpp/gsl.hpp"
 #include "src/utils/cpp/json.hpp"
 
+namespace {
+
+// Structural hashing of expressions. Every expression is hashed as a type tag
+// followed by its content, with sizes and numbers in a fixed-width
+// little-endian encoding. Children of lists, maps, results, and nodes
+// contribute their (cached) hashes. The encoding is independent of the JSON
+// representation and must never change, as expression hashes identify
+// actions and the nodes of serialized target results.
+enum class HashTag : char {
+    kNone = 'N',
+    kFalse = 'F',
+    kTrue = 'T',
+    kNumber = 'D',
+    kString = 'S',
+    kName = '$',
+    kArtifact = '@',
+    kResult = '=',
+    kValueNode = '#',
+    kAbstractNode = '&',
+    kList = '[',
+    kMap = '{'
+};
+
+void UpdateTag(gsl::not_null<Hasher*> const& hasher, HashTag tag) noexcept {
+    auto const c = static_cast<char>(tag);
+    hasher->Update(std::string_view{&c, 1});
+}
+
+void UpdateWord(gsl::not_null<Hasher*> const& hasher,
+                std::uint64_t word) noexcept {
+    std::array<char, sizeof(word)> bytes{};
+    for (auto& byte : bytes) {
+        byte = static_cast<char>(word & 0xFFU);
+        word >>= 8U;
+    }
+    hasher->Update(std::string_view{bytes.data(), bytes.size()});
+}
+
+void UpdateSize(gsl::not_null<Hasher*> const& hasher,
+                std::size_t size) noexcept {
+    UpdateWord(hasher, static_cast<std::uint64_t>(size));
+}
+
+void UpdateNumber(gsl::not_null<Hasher*> const& hasher,
+                  Expression::number_t number) noexcept {
+    // all NaNs are equal for the user, whatever their payload; 0.0 and -0.0
+    // are distinct, as they are rendered differently
+    if (std::isnan(number)) {
+        number = std::numeric_limits<Expression::number_t>::quiet_NaN();
+    }
+    UpdateWord(hasher, std::bit_cast<std::uint64_t>(number));
+}
+
+void UpdateString(gsl::not_null<Hasher*> const& hasher,
+                  std::string_view data) noexcept {
+    UpdateSize(hasher, data.size());
+    hasher->Update(data);
+}
+
+}  // namespace
+
 auto Expression::operator[](
     std::string const& key) const& -> ExpressionPtr const& {
     auto value = Map().Find(key);
@@ -160,7 +229,7 @@ auto Expression::ToString() const -> std::string {
     return AbbreviateJson(ToJson(), len);
 }
 
-auto Expression::ToHash() const noexcept -> std::string {
+auto Expression::ToHash() const noexcept -> std::string const& {
     return hash_.SetOnceAndGet([this] { return ComputeHash(); });
 }
 
@@ -170,18 +239,22 @@ auto Expression::IsCacheable() const -> bool {
 
 auto Expression::FromJson(nlohmann::json const& json) noexcept
     -> ExpressionPtr {
+    // values read from JSON are interned, so that equal (sub)values of target
+    // descriptions, rule definitions, and configurations share one node
+    auto& interner = ExpressionInterner::Instance();
     if (json.is_null()) {
-        return ExpressionPtr{none_t{}};
+        return interner.Intern(ExpressionPtr{none_t{}});
     }
     try {  // try-catch because json.get<>() could throw, although checked
         if (json.is_boolean()) {
-            return ExpressionPtr{json.get<bool>()};
+            return interner.Intern(ExpressionPtr{json.get<bool>()});
         }
         if (json.is_number()) {
-            return ExpressionPtr{json.get<number_t>()};
+            return interner.Intern(ExpressionPtr{json.get<number_t>()});
         }
         if (json.is_string()) {
-            return ExpressionPtr{std::string{json.get<std::string>()}};
+            return interner.Intern(
+                ExpressionPtr{std::string{json.get<std::string>()}});
         }
         if (json.is_array()) {
             auto l = Expression::list_t{};
@@ -190,14 +263,15 @@ auto Expression::FromJson(nlohmann::json const& json) noexcept
                            json.end(),
                            std::back_inserter(l),
                            [](auto const& j) { return FromJson(j); });
-            return ExpressionPtr{l};
+            return interner.Intern(ExpressionPtr{std::move(l)});
         }
         if (json.is_object()) {
             auto m = Expression::map_t::underlying_map_t{};
             for (auto const& el : json.items()) {
                 m.emplace(el.key(), FromJson(el.value()));
             }
-            return ExpressionPtr{Expression::map_t{m}};
+            return interner.Intern(
+                ExpressionPtr{Expression::map_t{std::move(m)}});
         }
     } catch (...) {
         EnsuresAudit(false);  // ensure that the try-block never throws
@@ -223,48 +297,70 @@ auto Expression::TypeString() const noexcept -> std::string {
 }
 
 auto Expression::ComputeHash() const noexcept -> std::string {
-    auto hash = std::string{};
-
     // The type of HashFunction is irrelevant here. It is used for
     // identification and quick comparison of expressions. SHA256 is used.
     HashFunction const hash_function{HashFunction::Type::PlainSHA256};
-    if (IsNone() or IsBool() or IsNumber() or IsString() or IsArtifact() or
-        IsResult() or IsNode() or IsName()) {
-        // just hash the JSON representation, but prepend "@" for artifact,
-        // "=" for result, "#" for node, and "$" for name.
-        std::string prefix;
-        if (IsArtifact()) {
-            prefix = "@";
-        }
-        else if (IsResult()) {
-            prefix = "=";
-        }
-        else if (IsNode()) {
-            prefix = "#";
+    auto hasher = hash_function.MakeHasher();
+    if (IsNone()) {
+        UpdateTag(&hasher, HashTag::kNone);
+    }
+    else if (IsBool()) {
+        UpdateTag(&hasher, Bool() ? HashTag::kTrue : HashTag::kFalse);
+    }
+    else if (IsNumber()) {
+        UpdateTag(&hasher, HashTag::kNumber);
+        UpdateNumber(&hasher, Number());
+    }
+    else if (IsString()) {
+        UpdateTag(&hasher, HashTag::kString);
+        UpdateString(&hasher, String());
+    }
+    else if (IsName()) {
+        UpdateTag(&hasher, HashTag::kName);
+        UpdateString(&hasher, Value<name_t>()->get().ToString());
+    }
+    else if (IsArtifact()) {
+        // artifact descriptions carry a hash of their own
+        UpdateTag(&hasher, HashTag::kArtifact);
+        UpdateString(&hasher, Value<artifact_t>()->get().Id());
+    }
+    else if (IsResult()) {
+        auto const& result = Value<result_t>()->get();
+        UpdateTag(&hasher, HashTag::kResult);
+        hasher.Update(result.artifact_stage->ToHash());
+        hasher.Update(result.provides->ToHash());
+        hasher.Update(result.runfiles->ToHash());
+    }
+    else if (IsNode()) {
+        auto const& node = Value<node_t>()->get();
+        if (node.IsValue()) {
+            UpdateTag(&hasher, HashTag::kValueNode);
+            hasher.Update(node.GetValue()->ToHash());
         }
-        else if (IsName()) {
-            prefix = "$";
+        else {
+            auto const& abstract = node.GetAbstract();
+            UpdateTag(&hasher, HashTag::kAbstractNode);
+            UpdateString(&hasher, abstract.node_type);
+            hasher.Update(abstract.string_fields->ToHash());
+            hasher.Update(abstract.target_fields->ToHash());
         }
-        hash = hash_function.PlainHashData(prefix + ToString()).Bytes();
-    }
-    else {
-        auto hasher = hash_function.MakeHasher();
-        if (IsList()) {
-            auto list = Value<Expression::list_t>();
-            hasher.Update("[");
-            for (auto const& el : list->get()) {
-                hasher.Update(el->ToHash());
-            }
+    }
+    else if (IsList()) {
+        auto const& list = Value<list_t>()->get();
+        UpdateTag(&hasher, HashTag::kList);
+        UpdateSize(&hasher, list.size());
+        for (auto const& el : list) {
+            hasher.Update(el->ToHash());
         }
-        else if (IsMap()) {
-            auto map = Value<Expression::map_t>();
-            hasher.Update("{");
-            for (auto const& el : map->get()) {
-                hasher.Update(hash_function.PlainHashData(el.first).Bytes());
-                hasher.Update(el.second->ToHash());
-            }
+    }
+    else if (IsMap()) {
+        auto const& items = Value<map_t>()->get();
+        UpdateTag(&hasher, HashTag::kMap);
+        UpdateSize(&hasher, items.size());
+        for (auto const& [key, value] : items) {
+            UpdateString(&hasher, key);
+            hasher.Update(value->ToHash());
         }
-        hash = std::move(hasher).Finalize().Bytes();
     }
-    return hash;
+    return std::move(hasher).Finalize().Bytes();
 }
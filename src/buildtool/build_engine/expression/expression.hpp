@@ -16,6 +16,7 @@
 #define INCLUDED_SRC_BUILDTOOL_BUILD_ENGINE_EXPRESSION_EXPRESSION_HPP
 
 #include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
@@ -42,6 +43,7 @@
 class Expression {
     friend auto operator+(Expression const& /*lhs*/,
                           Expression const& /*rhs*/) -> Expression;
+    friend class ExpressionInterner;
 
   public:
     using none_t = std::monostate;
@@ -79,7 +81,11 @@ class Expression {
     Expression() noexcept = default;
     ~Expression() noexcept = default;
     Expression(Expression const& other) noexcept = delete;
-    Expression(Expression&& other) noexcept = default;
+    // The moved-to expression is a new node, so it is not interned.
+    Expression(Expression&& other) noexcept
+        : data_{std::move(other.data_)},
+          hash_{std::move(other.hash_)},
+          is_cachable_{std::move(other.is_cachable_)} {}
     auto operator=(Expression const& other) noexcept = delete;
     auto operator=(Expression&& other) noexcept = delete;
 
@@ -107,6 +113,12 @@ class Expression {
     [[nodiscard]] auto IsList() const noexcept -> bool { return IsA<list_t>(); }
     [[nodiscard]] auto IsMap() const noexcept -> bool { return IsA<map_t>(); }
 
+    /// \brief Whether this node is the canonical node of its value, see
+    /// ExpressionInterner. Equal interned expressions are the same node.
+    [[nodiscard]] auto IsInterned() const noexcept -> bool {
+        return interned_.load(std::memory_order_acquire);
+    }
+
     [[nodiscard]] auto Bool() const -> bool { return Cast<bool>(); }
     [[nodiscard]] auto Number() const -> number_t { return Cast<number_t>(); }
     [[nodiscard]] auto Name() const -> name_t { return Cast<name_t>(); }
@@ -194,7 +206,13 @@ class Expression {
     template <class T>
     [[nodiscard]] auto operator==(T const& other) const noexcept -> bool {
         if constexpr (std::is_same_v<T, Expression>) {
-            return (&data_ == &other.data_) or (ToHash() == other.ToHash());
+            if (&data_ == &other.data_) {
+                return true;
+            }
+            if (IsInterned() and other.IsInterned()) {
+                return false;
+            }
+            return ToHash() == other.ToHash();
         }
         else {
             return IsValidType<T>() and (GetIndexOf<T>() == data_.index()) and
@@ -229,7 +247,7 @@ class Expression {
     [[nodiscard]] auto IsCacheable() const -> bool;
     [[nodiscard]] auto ToString() const -> std::string;
     [[nodiscard]] auto ToAbbrevString(std::size_t len) const -> std::string;
-    [[nodiscard]] auto ToHash() const noexcept -> std::string;
+    [[nodiscard]] auto ToHash() const noexcept -> std::string const&;
     [[nodiscard]] auto ToIdentifier() const noexcept -> std::string {
         return ToHexString(ToHash());
     }
@@ -266,6 +284,7 @@ class Expression {
 
     AtomicValue<std::string> hash_;
     AtomicValue<bool> is_cachable_;
+    std::atomic<bool> interned_{false};
 
     template <class T, std::size_t kIndex = 0>
         requires(IsValidType<T>())
@@ -358,7 +377,7 @@ struct hash<Expression> {
     [[nodiscard]] auto operator()(Expression const& e) const noexcept
         -> std::size_t {
         auto hash = std::size_t{};
-        auto bytes = e.ToHash();
+        auto const& bytes = e.ToHash();
         std::memcpy(&hash, bytes.data(), std::min(sizeof(hash), bytes.size()));
         return hash;
     }
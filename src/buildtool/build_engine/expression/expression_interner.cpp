@@ -0,0 +1,223 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/build_engine/expression/expression_interner.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "src/buildtool/build_engine/expression/expression.hpp"
+#include "src/utils/cpp/hash_combine.hpp"
+
+namespace {
+
+/// \brief Bit pattern of a number, with all NaNs mapped to the same one, as
+/// they are equal for the user. Hence, a single canonical NaN is interned.
+[[nodiscard]] auto Bits(Expression::number_t number) -> std::uint64_t {
+    if (std::isnan(number)) {
+        number = std::numeric_limits<Expression::number_t>::quiet_NaN();
+    }
+    return std::bit_cast<std::uint64_t>(number);
+}
+
+/// \brief Hash of the value of a node whose children are interned.
+[[nodiscard]] auto ShallowHash(Expression const& expr) -> std::size_t {
+    std::size_t seed{};
+    if (expr.IsNone()) {
+        return seed;
+    }
+    if (expr.IsBool()) {
+        hash_combine<bool>(&seed, expr.Bool());
+        return seed;
+    }
+    if (expr.IsNumber()) {
+        hash_combine<std::uint64_t>(&seed, Bits(expr.Number()));
+        return seed;
+    }
+    if (expr.IsString()) {
+        hash_combine<std::string>(&seed, expr.String());
+        return seed;
+    }
+    if (expr.IsList()) {
+        hash_combine<std::size_t>(&seed, expr.List().size());
+        for (auto const& el : expr.List()) {
+            hash_combine<void const*>(&seed, &*el);
+        }
+        return seed;
+    }
+    if (expr.IsMap()) {
+        for (auto const& [key, value] : expr.Map()) {
+            hash_combine<std::string>(&seed, key);
+            hash_combine<void const*>(&seed, &*value);
+        }
+        return seed;
+    }
+    // names, artifacts, results, and nodes are identified by their hash
+    return std::hash<Expression>{}(expr);
+}
+
+/// \brief Check equality of nodes whose children are interned.
+[[nodiscard]] auto ShallowEqual(Expression const& lhs, Expression const& rhs)
+    -> bool {
+    if (lhs.IsNone()) {
+        return rhs.IsNone();
+    }
+    if (lhs.IsBool()) {
+        return rhs.IsBool() and lhs.Bool() == rhs.Bool();
+    }
+    if (lhs.IsNumber()) {
+        // -0.0 and 0.0 have different hashes, so compare bitwise
+        return rhs.IsNumber() and Bits(lhs.Number()) == Bits(rhs.Number());
+    }
+    if (lhs.IsString()) {
+        return rhs.IsString() and lhs.String() == rhs.String();
+    }
+    if (lhs.IsList()) {
+        if (not rhs.IsList() or lhs.List().size() != rhs.List().size()) {
+            return false;
+        }
+        return std::equal(
+            lhs.List().begin(),
+            lhs.List().end(),
+            rhs.List().begin(),
+            [](auto const& l, auto const& r) { return &*l == &*r; });
+    }
+    if (lhs.IsMap()) {
+        if (not rhs.IsMap() or lhs.Map().size() != rhs.Map().size()) {
+            return false;
+        }
+        return std::equal(lhs.Map().begin(),
+                          lhs.Map().end(),
+                          rhs.Map().begin(),
+                          [](auto const& l, auto const& r) {
+                              return l.first == r.first and
+                                     &*l.second == &*r.second;
+                          });
+    }
+    return lhs == rhs;
+}
+
+/// \brief Estimated memory of a node, including the content it owns, but not
+/// its children.
+[[nodiscard]] auto EstimateSize(Expression const& expr) -> std::size_t {
+    auto size = sizeof(Expression);
+    if (expr.IsString()) {
+        size += expr.String().capacity();
+    }
+    else if (expr.IsList()) {
+        size += expr.List().capacity() * sizeof(ExpressionPtr);
+    }
+    else if (expr.IsMap()) {
+        // key, value, and the tree node of the underlying map
+        static constexpr std::size_t kNodeOverhead = 32;
+        for (auto const& [key, value] : expr.Map()) {
+            size += sizeof(std::string) + key.capacity() +
+                    sizeof(ExpressionPtr) + kNodeOverhead;
+        }
+    }
+    return size;
+}
+
+}  // namespace
+
+auto ExpressionInterner::Instance() noexcept -> ExpressionInterner& {
+    static ExpressionInterner instance{};
+    return instance;
+}
+
+auto ExpressionInterner::Intern(ExpressionPtr const& expr) noexcept
+    -> ExpressionPtr {
+    if (not expr or expr->IsInterned()) {
+        return expr;
+    }
+    try {
+        return Lookup(InternChildren(expr));
+    } catch (...) {
+        return expr;
+    }
+}
+
+auto ExpressionInterner::InternChildren(ExpressionPtr const& expr)
+    -> ExpressionPtr {
+    if (expr->IsList()) {
+        auto const& list = expr->List();
+        if (std::all_of(list.begin(), list.end(), [](auto const& el) {
+                return el->IsInterned();
+            })) {
+            return expr;
+        }
+        Expression::list_t interned{};
+        interned.reserve(list.size());
+        for (auto const& el : list) {
+            interned.emplace_back(Intern(el));
+        }
+        return ExpressionPtr{std::move(interned)};
+    }
+    if (expr->IsMap()) {
+        auto const& map = expr->Map();
+        if (std::all_of(map.begin(), map.end(), [](auto const& el) {
+                return el.second->IsInterned();
+            })) {
+            return expr;
+        }
+        Expression::map_t::underlying_map_t interned{};
+        for (auto const& [key, value] : map) {
+            interned.emplace(key, Intern(value));
+        }
+        return ExpressionPtr{Expression::map_t{std::move(interned)}};
+    }
+    return expr;
+}
+
+auto ExpressionInterner::Lookup(ExpressionPtr const& expr) -> ExpressionPtr {
+    ++num_interned_;
+    auto const hash = ShallowHash(*expr);
+    auto& shard = shards_.at(hash % kShards);
+    std::unique_lock lock{shard.mutex};
+
+    auto [begin, end] = shard.table.equal_range(hash);
+    for (auto it = begin; it != end;) {
+        auto canonical = it->second.lock();
+        if (not canonical) {
+            it = shard.table.erase(it);
+            continue;
+        }
+        if (ShallowEqual(*expr, *canonical)) {
+            ++num_shared_;
+            if (expr.ptr_.use_count() == 1) {
+                num_saved_bytes_ += EstimateSize(*expr);
+            }
+            ExpressionPtr result{nullptr};
+            result.ptr_ = std::move(canonical);
+            return result;
+        }
+        ++it;
+    }
+
+    // Drop entries of freed nodes from time to time.
+    if (shard.table.size() >= shard.sweep_size) {
+        std::erase_if(shard.table,
+                      [](auto const& entry) { return entry.second.expired(); });
+        shard.sweep_size = std::max(kMinSweepSize, 2 * shard.table.size());
+    }
+    shard.table.emplace(hash, expr.ptr_);
+    expr.ptr_->interned_.store(true, std::memory_order_release);
+    return expr;
+}
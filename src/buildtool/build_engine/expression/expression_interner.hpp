@@ -0,0 +1,88 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_BUILD_ENGINE_EXPRESSION_EXPRESSION_INTERNER_HPP
+#define INCLUDED_SRC_BUILDTOOL_BUILD_ENGINE_EXPRESSION_EXPRESSION_INTERNER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "src/buildtool/build_engine/expression/expression_ptr.hpp"
+
+class Expression;
+
+/// \brief Concurrent table of hash-consed expressions. Interning an
+/// expression returns the canonical node of its value, so that equal values
+/// share one node and interned expressions compare by pointer. Children of
+/// lists and maps are interned first, so the table is keyed by the values of
+/// scalars and the identity of children, without serializing or hashing
+/// whole values. The table only holds weak references, so canonical nodes are
+/// released once no longer used; their entries are dropped lazily. All
+/// methods are thread-safe.
+class ExpressionInterner final {
+  public:
+    [[nodiscard]] static auto Instance() noexcept -> ExpressionInterner&;
+
+    /// \brief Obtain the canonical node equal to the given expression.
+    /// \returns The canonical node or the expression itself, if it cannot be
+    /// interned (nullptr, or a number that is not a number).
+    [[nodiscard]] auto Intern(ExpressionPtr const& expr) noexcept
+        -> ExpressionPtr;
+
+    /// \brief Number of expressions looked up in the table.
+    [[nodiscard]] auto InternedCounter() const noexcept -> std::size_t {
+        return num_interned_;
+    }
+
+    /// \brief Number of expressions replaced by an existing canonical node.
+    [[nodiscard]] auto SharedCounter() const noexcept -> std::size_t {
+        return num_shared_;
+    }
+
+    /// \brief Estimated number of bytes of the replaced expressions that
+    /// were freed by sharing.
+    [[nodiscard]] auto SavedBytesCounter() const noexcept -> std::size_t {
+        return num_saved_bytes_;
+    }
+
+  private:
+    static constexpr std::size_t kShards = 64;
+    static constexpr std::size_t kMinSweepSize = 1024;
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_multimap<std::size_t, std::weak_ptr<Expression>> table;
+        std::size_t sweep_size{kMinSweepSize};
+    };
+
+    std::array<Shard, kShards> shards_;
+    std::atomic<std::size_t> num_interned_{};
+    std::atomic<std::size_t> num_shared_{};
+    std::atomic<std::size_t> num_saved_bytes_{};
+
+    ExpressionInterner() = default;
+
+    /// \brief Replace children of lists and maps by their canonical nodes.
+    [[nodiscard]] auto InternChildren(ExpressionPtr const& expr)
+        -> ExpressionPtr;
+
+    /// \brief Look up a node, whose children are interned, in the table.
+    [[nodiscard]] auto Lookup(ExpressionPtr const& expr) -> ExpressionPtr;
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_BUILD_ENGINE_EXPRESSION_EXPRESSION_INTERNER_HPP
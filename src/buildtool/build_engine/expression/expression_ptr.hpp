@@ -31,6 +31,8 @@
 class Expression;
 
 class ExpressionPtr {
+    friend class ExpressionInterner;
+
   public:
     // Initialize to nullptr
     explicit ExpressionPtr(std::nullptr_t /*ptr*/) noexcept : ptr_{nullptr} {}
@@ -15,7 +15,9 @@
 #ifndef INCLUDED_SRC_BUILDTOOL_BUILD_ENGINE_EXPRESSION_LINKED_MAP_HPP
 #define INCLUDED_SRC_BUILDTOOL_BUILD_ENGINE_EXPRESSION_LINKED_MAP_HPP
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iterator>
 #include <map>
@@ -27,7 +29,6 @@
 #include <vector>
 
 #include "fmt/core.h"
-#include "src/buildtool/multithreading/atomic_value.hpp"
 #include "src/utils/cpp/hash_combine.hpp"
 
 template <class K, class V, class NextPtr>
@@ -61,25 +62,105 @@ class LinkedMapPtr {
 };
 
 /// \brief Immutable LinkedMap.
-/// Uses smart pointers to build up a list of pointer-linked maps. The NextPtr
-/// that is used internally can be overloaded by any class implementing the
-/// following methods:
+/// A map can be created from entries or by shadowing another map (next) with
+/// new entries (content). Internally, entries are kept in a persistent treap:
+/// a binary search tree by key that is a heap by a priority derived from the
+/// hash of the key. Nodes are immutable and shared between maps; shadowing a
+/// map merges both trees, creating new nodes only on the paths to the keys of
+/// the content. Therefore, lookups take O(log n), independent of how the map
+/// was composed, and iteration is in key order without copying entries. As
+/// the shape of a treap only depends on its keys, maps sharing most of their
+/// entries also share most of their nodes.
+/// The NextPtr used to pass maps to shadow can be overloaded by any class
+/// implementing the following methods:
 ///     1. auto IsNotNull() const noexcept -> bool;
 ///     2. auto LinkedMap() const& -> LinkedMap<K, V, NextPtr> const&;
 ///     3. static auto Make(LinkedMap<K, V, NextPtr>&&) -> NextPtr;
 template <class K, class V, class NextPtr = LinkedMapPtr<K, V>>
 class LinkedMap {
     using item_t = std::pair<K, V>;
-    using items_t = std::vector<item_t>;
     using keys_t = std::vector<K>;
     using values_t = std::vector<V>;
 
+    struct Node;
+    using NodePtr = std::shared_ptr<Node const>;
+    using ItemPtr = std::shared_ptr<item_t const>;
+
+    struct Node {
+        ItemPtr item;
+        std::size_t priority;
+        std::size_t size;
+        NodePtr left;
+        NodePtr right;
+
+        Node(ItemPtr item_,
+             std::size_t priority_,
+             NodePtr left_,
+             NodePtr right_) noexcept
+            : item{std::move(item_)},
+              priority{priority_},
+              size{1 + SizeOf(left_) + SizeOf(right_)},
+              left{std::move(left_)},
+              right{std::move(right_)} {}
+    };
+
   public:
     using Ptr = NextPtr;
-    // When merging maps, we always rely on entries being traversed in key
-    // order; so keep the underlying map an ordered data structure.
+    // Maps to create a LinkedMap from are ordered, so that they can be
+    // converted to a tree without sorting.
     using underlying_map_t = std::map<K, V>;
 
+    /// \brief Iterator over the entries of a map in key order. Only valid as
+    /// long as the map it was obtained from.
+    class const_iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = item_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = item_t const*;
+        using reference = item_t const&;
+
+        const_iterator() noexcept = default;
+        explicit const_iterator(Node const* root) { PushLeftmost(root); }
+
+        [[nodiscard]] auto operator*() const -> reference {
+            return *path_.back()->item;
+        }
+        [[nodiscard]] auto operator->() const -> pointer {
+            return path_.back()->item.get();
+        }
+        auto operator++() -> const_iterator& {
+            auto const* node = path_.back();
+            path_.pop_back();
+            PushLeftmost(node->right.get());
+            return *this;
+        }
+        auto operator++(int) -> const_iterator {
+            auto it = *this;
+            ++(*this);
+            return it;
+        }
+        [[nodiscard]] auto operator==(
+            const_iterator const& other) const noexcept -> bool {
+            return Current() == other.Current();
+        }
+
+      private:
+        // nodes whose entries and right subtrees are still to be visited
+        std::vector<Node const*> path_;
+
+        void PushLeftmost(Node const* node) {
+            while (node != nullptr) {
+                path_.push_back(node);
+                node = node->left.get();
+            }
+        }
+
+        [[nodiscard]] auto Current() const noexcept -> Node const* {
+            return path_.empty() ? nullptr : path_.back();
+        }
+    };
+
     static constexpr auto MakePtr(underlying_map_t map) -> Ptr {
         return Ptr::Make(LinkedMap<K, V, Ptr>{std::move(map)});
     }
@@ -110,21 +191,20 @@ class LinkedMap {
             LinkedMap<K, V, Ptr>{next, std::move(key), std::move(value)});
     }
 
-    explicit LinkedMap(underlying_map_t map) noexcept : map_{std::move(map)} {}
-    explicit LinkedMap(item_t item) noexcept { map_.emplace(std::move(item)); }
-    LinkedMap(K key, V val) noexcept {
-        map_.emplace(std::move(key), std::move(val));
-    }
+    explicit LinkedMap(underlying_map_t map) noexcept
+        : root_{Build(std::move(map))} {}
+    explicit LinkedMap(item_t item) noexcept : root_{Leaf(std::move(item))} {}
+    LinkedMap(K key, V val) noexcept
+        : root_{Leaf(item_t{std::move(key), std::move(val)})} {}
     LinkedMap(Ptr next, Ptr content) noexcept
-        : next_{std::move(next)}, content_{std::move(content)} {}
+        : root_{Merge(RootOf(content), RootOf(next))} {}
     LinkedMap(Ptr next, underlying_map_t map) noexcept
-        : next_{std::move(next)}, map_{std::move(map)} {}
-    LinkedMap(Ptr next, item_t item) noexcept : next_{std::move(next)} {
-        map_.emplace(std::move(item));
-    }
-    LinkedMap(Ptr next, K key, V val) noexcept : next_{std::move(next)} {
-        map_.emplace(std::move(key), std::move(val));
-    }
+        : root_{Merge(Build(std::move(map)), RootOf(next))} {}
+    LinkedMap(Ptr next, item_t item) noexcept
+        : root_{Merge(Leaf(std::move(item)), RootOf(next))} {}
+    LinkedMap(Ptr next, K key, V val) noexcept
+        : root_{Merge(Leaf(item_t{std::move(key), std::move(val)}),
+                      RootOf(next))} {}
 
     LinkedMap() noexcept = default;
     LinkedMap(LinkedMap const& other) noexcept = delete;
@@ -149,7 +229,7 @@ class LinkedMap {
     [[nodiscard]] auto at(K const& key) && -> V {
         auto value = Find(key);
         if (value) {
-            return std::move(*value);
+            return **value;
         }
         throw std::out_of_range{fmt::format("Missing key {}", key)};
     }
@@ -159,77 +239,49 @@ class LinkedMap {
     }
 
     [[nodiscard]] auto empty() const noexcept -> bool {
-        return (content_.IsNotNull() ? content_.Map().empty()
-                                     : map_.empty()) and
-               (not next_.IsNotNull() or next_.Map().empty());
+        return root_ == nullptr;
     }
 
     [[nodiscard]] auto Find(K const& key) const& noexcept
         -> std::optional<V const*> {
-        if (content_.IsNotNull()) {
-            auto val = content_.Map().Find(key);
-            if (val) {
-                return val;
+        auto const* node = root_.get();
+        while (node != nullptr) {
+            auto const& node_key = node->item->first;
+            if (key < node_key) {
+                node = node->left.get();
             }
-        }
-        else {
-            auto it = map_.find(key);
-            if (it != map_.end()) {
-                return &it->second;
+            else if (node_key < key) {
+                node = node->right.get();
             }
-        }
-        if (next_.IsNotNull()) {
-            auto val = next_.Map().Find(key);
-            if (val) {
-                return val;
+            else {
+                return &node->item->second;
             }
         }
         return std::nullopt;
     }
 
+    // Nodes are shared with other maps, so values are copied.
     [[nodiscard]] auto Find(K const& key) && noexcept -> std::optional<V> {
-        if (content_.IsNotNull()) {
-            auto val = content_.Map().Find(key);
-            if (val) {
-                return **val;
-            }
-        }
-        else {
-            auto it = map_.find(key);
-            if (it != map_.end()) {
-                return std::move(it->second);
-            }
-        }
-        if (next_.IsNotNull()) {
-            auto val = next_.Map().Find(key);
-            if (val) {
-                return **val;
-            }
+        auto value = std::as_const(*this).Find(key);
+        if (value) {
+            return **value;
         }
         return std::nullopt;
     }
 
+    /// \brief Find the smallest key present in both maps with different
+    /// values. Looks up the entries of the smaller map in the larger one.
     [[nodiscard]] auto FindConflictingDuplicate(LinkedMap const& other)
         const& noexcept -> std::optional<std::reference_wrapper<K const>> {
-        auto const& my_items = Items();
-        auto const& other_items = other.Items();
-        // Search for duplicates, using that iteration over the items is
-        // ordered by keys.
-        auto me = my_items.begin();
-        auto they = other_items.begin();
-        while (me != my_items.end() and they != other_items.end()) {
-            if (me->first == they->first) {
-                if (not(me->second == they->second)) {
-                    return me->first;
-                }
-                ++me;
-                ++they;
-            }
-            else if (me->first < they->first) {
-                ++me;
-            }
-            else {
-                ++they;
+        if (root_ == other.root_) {
+            return std::nullopt;
+        }
+        auto const& smaller = size() <= other.size() ? *this : other;
+        auto const& larger = size() <= other.size() ? other : *this;
+        for (auto const& [key, value] : smaller) {
+            auto other_value = larger.Find(key);
+            if (other_value and not(value == **other_value)) {
+                return key;
             }
         }
         return std::nullopt;
@@ -238,136 +290,205 @@ class LinkedMap {
     [[nodiscard]] auto FindConflictingDuplicate(
         LinkedMap const& other) && noexcept = delete;
 
-    // NOTE: Expensive, needs to compute sorted items.
     [[nodiscard]] auto size() const noexcept -> std::size_t {
-        return Items().size();
+        return SizeOf(root_);
     }
-    // NOTE: Expensive, needs to compute sorted items.
-    [[nodiscard]] auto begin() const& -> typename items_t::const_iterator {
-        return Items().cbegin();
-    }
-    // NOTE: Expensive, needs to compute sorted items.
-    [[nodiscard]] auto end() const& -> typename items_t::const_iterator {
-        return Items().cend();
-    }
-    // NOTE: Expensive, needs to compute sorted items.
-    [[nodiscard]] auto cbegin() const& -> typename items_t::const_iterator {
-        return begin();
-    }
-    // NOTE: Expensive, needs to compute sorted items.
-    [[nodiscard]] auto cend() const& -> typename items_t::const_iterator {
-        return end();
+    [[nodiscard]] auto begin() const& -> const_iterator {
+        return const_iterator{root_.get()};
     }
+    [[nodiscard]] auto end() const& -> const_iterator { return {}; }
+    [[nodiscard]] auto cbegin() const& -> const_iterator { return begin(); }
+    [[nodiscard]] auto cend() const& -> const_iterator { return end(); }
 
-    [[nodiscard]] auto begin() && -> typename items_t::const_iterator = delete;
-    [[nodiscard]] auto end() && -> typename items_t::const_iterator = delete;
-    [[nodiscard]] auto cbegin() && -> typename items_t::const_iterator = delete;
-    [[nodiscard]] auto cend() && -> typename items_t::const_iterator = delete;
+    [[nodiscard]] auto begin() && -> const_iterator = delete;
+    [[nodiscard]] auto end() && -> const_iterator = delete;
+    [[nodiscard]] auto cbegin() && -> const_iterator = delete;
+    [[nodiscard]] auto cend() && -> const_iterator = delete;
 
-    // NOTE: Expensive, needs to compute sorted items.
     [[nodiscard]] auto operator==(
         LinkedMap<K, V, NextPtr> const& other) const noexcept -> bool {
-        return this == &other or (this->empty() and other.empty()) or
-               this->Items() == other.Items();
-    }
-
-    // NOTE: Expensive, needs to compute sorted items.
-    [[nodiscard]] auto Items() const& -> items_t const& {
-        return items_.SetOnceAndGet([this] { return ComputeSortedItems(); });
+        return this == &other or root_ == other.root_ or
+               (size() == other.size() and
+                std::equal(begin(), end(), other.begin()));
     }
 
-    [[nodiscard]] auto Items() && = delete;
-
-    // NOTE: Expensive, needs to compute sorted items.
     [[nodiscard]] auto Keys() const -> keys_t {
         auto keys = keys_t{};
-        auto const& items = Items();
-        keys.reserve(items.size());
-        std::transform(items.begin(),
-                       items.end(),
+        keys.reserve(size());
+        std::transform(begin(),
+                       end(),
                        std::back_inserter(keys),
                        [](auto const& item) { return item.first; });
         return keys;
     }
 
-    // NOTE: Expensive, needs to compute sorted items.
     [[nodiscard]] auto Values() const -> values_t {
         auto values = values_t{};
-        auto const& items = Items();
-        values.reserve(items.size());
-        std::transform(items.begin(),
-                       items.end(),
+        values.reserve(size());
+        std::transform(begin(),
+                       end(),
                        std::back_inserter(values),
                        [](auto const& item) { return item.second; });
         return values;
     }
 
   private:
-    Ptr next_{};              // map that is shadowed by this map
-    Ptr content_{};           // content of this map if set
-    underlying_map_t map_{};  // content of this map if content_ is not set
+    NodePtr root_{};
 
-    AtomicValue<items_t> items_{};
+    [[nodiscard]] static auto SizeOf(NodePtr const& node) noexcept
+        -> std::size_t {
+        return node ? node->size : 0;
+    }
 
-    [[nodiscard]] auto ComputeSortedItems() const noexcept -> items_t {
-        auto size = content_.IsNotNull() ? content_.Map().size() : map_.size();
-        if (next_.IsNotNull()) {
-            size += next_.Map().size();
-        }
+    [[nodiscard]] static auto RootOf(Ptr const& ptr) noexcept -> NodePtr {
+        return ptr.IsNotNull() ? ptr.Map().root_ : NodePtr{};
+    }
 
-        auto items = items_t{};
-        items.reserve(size);
+    [[nodiscard]] static auto Priority(K const& key) noexcept -> std::size_t {
+        // mix the hash, as std::hash is the identity for integral types
+        auto x = static_cast<std::uint64_t>(std::hash<K>{}(key));
+        x = (x ^ (x >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27U)) * 0x94d049bb133111ebULL;
+        return static_cast<std::size_t>(x ^ (x >> 31U));
+    }
 
-        auto empty = items_t{};
-        auto map_copy = items_t{};
-        typename items_t::const_iterator citemsit;
-        typename items_t::const_iterator citemsend;
-        typename items_t::const_iterator nitemsit;
-        typename items_t::const_iterator nitemsend;
+    /// \brief Order of nodes in the heap, with ties broken by key.
+    [[nodiscard]] static auto IsAbove(Node const& lhs,
+                                      Node const& rhs) noexcept -> bool {
+        return lhs.priority > rhs.priority or
+               (lhs.priority == rhs.priority and
+                lhs.item->first < rhs.item->first);
+    }
 
-        if (content_.IsNotNull()) {
-            auto const& citems = content_.Map().Items();
-            citemsit = citems.begin();
-            citemsend = citems.end();
-        }
-        else {
-            map_copy.reserve(map_.size());
-            map_copy.insert(map_copy.end(), map_.begin(), map_.end());
-            citemsit = map_copy.begin();
-            citemsend = map_copy.end();
+    [[nodiscard]] static auto Leaf(item_t item) -> NodePtr {
+        auto priority = Priority(item.first);
+        return std::make_shared<Node const>(
+            std::make_shared<item_t const>(std::move(item)),
+            priority,
+            nullptr,
+            nullptr);
+    }
+
+    /// \brief Node with the given entry and children, reusing the original
+    /// node if nothing changed.
+    [[nodiscard]] static auto Rebuild(NodePtr const& node,
+                                      ItemPtr const& item,
+                                      NodePtr left,
+                                      NodePtr right) -> NodePtr {
+        if (item == node->item and left == node->left and
+            right == node->right) {
+            return node;
         }
-        if (next_.IsNotNull()) {
-            auto const& nitems = next_.Map().Items();
-            nitemsit = nitems.begin();
-            nitemsend = nitems.end();
+        return std::make_shared<Node const>(
+            item, node->priority, std::move(left), std::move(right));
+    }
+
+    /// \brief Build a tree from entries in key order in linear time, by
+    /// keeping the nodes of the rightmost path on a stack.
+    [[nodiscard]] static auto Build(underlying_map_t map) -> NodePtr {
+        if (map.empty()) {
+            return nullptr;
         }
-        else {
-            nitemsit = empty.begin();
-            nitemsend = empty.end();
+        // Entries are moved to a single block, shared by all nodes.
+        auto block = std::make_shared<std::vector<item_t>>();
+        block->reserve(map.size());
+        while (not map.empty()) {
+            auto entry = map.extract(map.begin());
+            block->emplace_back(std::move(entry.key()),
+                                std::move(entry.mapped()));
         }
 
-        while (citemsit != citemsend and nitemsit != nitemsend) {
-            if (citemsit->first == nitemsit->first) {
-                items.push_back(*citemsit);
-                ++citemsit;
-                ++nitemsit;
-            }
-            else if (citemsit->first < nitemsit->first) {
-                items.push_back(*citemsit);
-                ++citemsit;
-            }
-            else {
-                items.push_back(*nitemsit);
-                ++nitemsit;
+        struct Pending {
+            ItemPtr item;
+            std::size_t priority;
+            NodePtr left;
+        };
+        std::vector<Pending> pending{};
+        auto finalize = [&pending](NodePtr right) -> NodePtr {
+            auto& top = pending.back();
+            auto node = std::make_shared<Node const>(std::move(top.item),
+                                                     top.priority,
+                                                     std::move(top.left),
+                                                     std::move(right));
+            pending.pop_back();
+            return node;
+        };
+
+        for (auto const& item : *block) {
+            auto current =
+                Pending{.item = ItemPtr{block, &item},
+                        .priority = Priority(item.first),
+                        .left = nullptr};
+            // pop all pending nodes below the new one; the last popped node
+            // becomes its left child
+            NodePtr left{};
+            while (not pending.empty() and
+                   (pending.back().priority < current.priority or
+                    (pending.back().priority == current.priority and
+                     current.item->first < pending.back().item->first))) {
+                left = finalize(std::move(left));
             }
+            current.left = std::move(left);
+            pending.emplace_back(std::move(current));
+        }
+        NodePtr root{};
+        while (not pending.empty()) {
+            root = finalize(std::move(root));
         }
+        return root;
+    }
 
-        // No more comparisons to be made; copy over the remaining
-        // entries
-        items.insert(items.end(), citemsit, citemsend);
-        items.insert(items.end(), nitemsit, nitemsend);
+    struct SplitResult {
+        NodePtr less;
+        NodePtr equal;
+        NodePtr greater;
+    };
 
-        return items;
+    /// \brief Split a tree into entries less than, equal to, and greater than
+    /// the given key.
+    [[nodiscard]] static auto Split(NodePtr const& node, K const& key)
+        -> SplitResult {
+        if (not node) {
+            return {};
+        }
+        auto const& node_key = node->item->first;
+        if (key < node_key) {
+            auto split = Split(node->left, key);
+            split.greater = Rebuild(
+                node, node->item, std::move(split.greater), node->right);
+            return split;
+        }
+        if (node_key < key) {
+            auto split = Split(node->right, key);
+            split.less =
+                Rebuild(node, node->item, node->left, std::move(split.less));
+            return split;
+        }
+        return {node->left, node, node->right};
+    }
+
+    /// \brief Merge two trees, taking the entry of upper for duplicate keys.
+    /// Subtrees shared by both trees are not traversed.
+    [[nodiscard]] static auto Merge(NodePtr const& upper,
+                                    NodePtr const& lower) -> NodePtr {
+        if (not upper or upper == lower) {
+            return upper ? upper : lower;
+        }
+        if (not lower) {
+            return upper;
+        }
+        if (IsAbove(*upper, *lower)) {
+            auto split = Split(lower, upper->item->first);
+            return Rebuild(upper,
+                           upper->item,
+                           Merge(upper->left, split.less),
+                           Merge(upper->right, split.greater));
+        }
+        auto split = Split(upper, lower->item->first);
+        return Rebuild(lower,
+                       split.equal ? split.equal->item : lower->item,
+                       Merge(split.less, lower->left),
+                       Merge(split.greater, lower->right));
     }
 };
 
@@ -1868,6 +1868,14 @@ auto CreateTargetMap(
                                    auto logger,
                                    auto subcaller,
                                    auto key) {
+        if (context->profile != nullptr) {
+            context->profile->NoteAnalysisStart(key);
+            setter = std::make_shared<TargetMap::Setter>(
+                [profile = context->profile, key, setter](auto&& value) {
+                    profile->NoteAnalysisEnd(key);
+                    (*setter)(std::forward<decltype(value)>(value));
+                });
+        }
         if (key.target.IsAnonymousTarget()) {
             withTargetNode(context,
                            key,
@@ -2032,7 +2040,6 @@ auto CreateTargetMap(
                 });
         }
     };
-    return AsyncMapConsumer<ConfiguredTarget, AnalysedTargetPtr>(target_reader,
-                                                                 jobs);
+    return TargetMap(target_reader, jobs);
 }
 }  // namespace BuildMaps::Target
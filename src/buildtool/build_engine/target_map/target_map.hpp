@@ -31,10 +31,16 @@
 #include "src/buildtool/build_engine/target_map/result_map.hpp"
 #include "src/buildtool/main/analyse_context.hpp"
 #include "src/buildtool/multithreading/async_map_consumer.hpp"
+#include "src/buildtool/multithreading/concurrent_async_map.hpp"
 
 namespace BuildMaps::Target {
 
-using TargetMap = AsyncMapConsumer<ConfiguredTarget, AnalysedTargetPtr>;
+// The target map is the most contended map during analysis, so it uses the
+// lock-free map backend.
+using TargetMap =
+    AsyncMapConsumer<ConfiguredTarget,
+                     AnalysedTargetPtr,
+                     ConcurrentAsyncMap<ConfiguredTarget, AnalysedTargetPtr>>;
 
 auto CreateTargetMap(
     const gsl::not_null<AnalyseContext*>&,
@@ -38,6 +38,7 @@
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
 #include "src/buildtool/main/build_utils.hpp"
+#include "src/buildtool/storage/file_chunker.hpp"
 #include "src/utils/cpp/path.hpp"
 
 inline constexpr auto kDefaultTimeout = std::chrono::milliseconds{300000};
@@ -62,6 +63,7 @@ struct LogArguments {
 /// \brief Arguments required for analysing targets.
 struct AnalysisArguments {
     std::optional<std::size_t> expression_log_limit;
+    std::size_t builtin_memo_size{};
     std::vector<std::string> defines;
     std::filesystem::path config_file;
     std::optional<nlohmann::json> target;
@@ -105,16 +107,21 @@ struct EndpointArguments {
     std::optional<std::string> remote_execution_address;
     std::vector<std::string> platform_properties;
     std::optional<std::filesystem::path> remote_execution_dispatch_file;
+    std::optional<int> remote_compression_level;
+    ChunkingProfile chunking_profile{ChunkingProfile::Default};
 };
 
 /// \brief Arguments required for building.
 struct BuildArguments {
     std::optional<std::vector<std::string>> local_launcher{std::nullopt};
+    bool local_tree_cache{false};
     std::chrono::milliseconds timeout{kDefaultTimeout};
     std::size_t build_jobs{};
+    bool critical_path_first{false};
     std::optional<std::string> dump_artifacts{std::nullopt};
     std::optional<std::string> print_to_stdout{std::nullopt};
     bool show_runfiles{false};
+    std::optional<std::filesystem::path> profile{std::nullopt};
 };
 
 /// \brief Arguments related to target-level caching
@@ -188,6 +195,8 @@ struct ServeArguments {
 
 struct GcArguments {
     bool no_rotate{};
+    std::optional<std::uint64_t> max_size;
+    std::optional<std::uint64_t> target_size;
 };
 
 struct ToAddArguments {
@@ -284,6 +293,11 @@ static inline auto SetupAnalysisArguments(
                                 "in error messages (Default {})",
                                 Evaluator::kDefaultExpressionLogLimit))
         ->type_name("NUM");
+    app->add_option("--memoize-builtins",
+                    clargs->builtin_memo_size,
+                    "Maximal number of results of pure built-in functions "
+                    "memoized during analysis (Default: 0, no memoization)")
+        ->type_name("NUM");
     app->add_option_function<std::string>(
            "-D,--defines",
            [clargs](auto const& d) { clargs->defines.emplace_back(d); },
@@ -442,6 +456,19 @@ static inline auto SetupCacheArguments(
            },
            "Root for local CAS, cache, and build directories.")
         ->type_name("PATH");
+    app->add_option_function<std::string>(
+           "--chunking-profile",
+           [clargs](auto const& name) {
+               if (auto profile = ChunkingProfileFromString(name)) {
+                   clargs->chunking_profile = *profile;
+               }
+           },
+           fmt::format("Chunking profile for splitting large objects in the "
+                       "local CAS. One of {}. (Default: {})",
+                       nlohmann::json(ChunkingProfileNames()).dump(),
+                       ToString(ChunkingProfile::Default)))
+        ->type_name("NAME")
+        ->check(CLI::IsMember(ChunkingProfileNames()));
 }
 
 static inline auto SetupExecutionEndpointArguments(
@@ -451,6 +478,13 @@ static inline auto SetupExecutionEndpointArguments(
                     clargs->remote_execution_address,
                     "Address of the remote-execution service.")
         ->type_name("NAME:PORT");
+    app->add_option("--remote-compression-level",
+                    clargs->remote_compression_level,
+                    "Compress blobs transferred to and from the "
+                    "remote-execution service with DEFLATE at the given level, "
+                    "if supported by the remote side.")
+        ->type_name("NUM")
+        ->check(CLI::Range(1, 9));
 }
 
 static inline auto SetupExecutionPropertiesArguments(
@@ -495,6 +529,11 @@ static inline auto SetupCommonBuildArguments(
            "prepend actions' commands before being executed locally.")
         ->type_name("JSON")
         ->default_val(nlohmann::json(kDefaultLauncher).dump());
+    app->add_flag("--local-tree-cache",
+                  clargs->local_tree_cache,
+                  "Stage large input trees of locally executed actions as "
+                  "symlinks to read-only trees materialised once in the "
+                  "local build root.");
 }
 
 static inline auto SetupBuildArguments(
@@ -514,6 +553,12 @@ static inline auto SetupBuildArguments(
            clargs->build_jobs,
            "Number of jobs to run during build phase (Default: same as jobs).")
         ->type_name("NUM");
+
+    app->add_flag("--critical-path-first",
+                  clargs->critical_path_first,
+                  "Process ready actions with the longest chain of dependent "
+                  "actions first, estimated by execution times of previous "
+                  "builds.");
 }
 
 static inline auto SetupExtendedBuildArguments(
@@ -533,6 +578,12 @@ static inline auto SetupExtendedBuildArguments(
                     clargs->print_to_stdout,
                     "After building, print the specified artifact to stdout.")
         ->type_name("LOGICAL_PATH");
+
+    app->add_option("--profile",
+                    clargs->profile,
+                    "Write timing information of analysis and of each action "
+                    "as JSON to the specified file.")
+        ->type_name("PATH");
 }
 
 static inline auto SetupTCArguments(gsl::not_null<CLI::App*> const& app,
@@ -799,6 +850,20 @@ static inline void SetupGcArguments(gsl::not_null<CLI::App*> const& app,
                   args->no_rotate,
                   "Do not rotate cache generations, only clean up what can be "
                   "done without losing cache.");
+    app->add_option("--max-size",
+                    args->max_size,
+                    "Maximal size of the local cache; if exceeded, the least "
+                    "recently used objects not in use since the last garbage "
+                    "collection are evicted. Accepts units like KB, MB, GB.")
+        ->type_name("SIZE")
+        ->transform(CLI::AsSizeValue(/*kb_is_1000=*/false));
+    app->add_option("--target-size",
+                    args->target_size,
+                    "Size to shrink the local cache to if it exceeds its "
+                    "maximal size (Default: the maximal size).")
+        ->type_name("SIZE")
+        ->transform(CLI::AsSizeValue(/*kb_is_1000=*/false))
+        ->needs("--max-size");
 }
 
 #endif  // INCLUDED_SRC_BUILDTOOL_COMMON_CLI_HPP
@@ -0,0 +1,132 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/common/resource_usage.hpp"
+
+#include <exception>
+
+#include "fmt/core.h"
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/struct.pb.h"
+
+namespace {
+
+// Identifies the google.protobuf.Struct holding the resource usage among the
+// auxiliary metadata of an execution.
+constexpr auto kKindField = "kind";
+constexpr auto kKind = "resource usage";
+
+constexpr auto kUserTimeField = "user time seconds";
+constexpr auto kSystemTimeField = "system time seconds";
+constexpr auto kMaxRssField = "max rss kib";
+constexpr auto kInputBlocksField = "input blocks";
+constexpr auto kOutputBlocksField = "output blocks";
+constexpr auto kSpawnTimeField = "spawn time seconds";
+
+[[nodiscard]] auto ToMicroseconds(struct timeval const& time) noexcept
+    -> std::chrono::microseconds {
+    return std::chrono::seconds{time.tv_sec} +
+           std::chrono::microseconds{time.tv_usec};
+}
+
+[[nodiscard]] auto ToSeconds(std::chrono::microseconds time) noexcept
+    -> double {
+    return std::chrono::duration<double>{time}.count();
+}
+
+[[nodiscard]] auto FromSeconds(double seconds) noexcept
+    -> std::chrono::microseconds {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::duration<double>{seconds});
+}
+
+}  // namespace
+
+auto ResourceUsage::FromRusage(struct rusage const& usage) noexcept
+    -> ResourceUsage {
+    return ResourceUsage{
+        .user_time = ToMicroseconds(usage.ru_utime),
+        .system_time = ToMicroseconds(usage.ru_stime),
+        .max_rss_kib = static_cast<std::int64_t>(usage.ru_maxrss),
+        .input_blocks = static_cast<std::int64_t>(usage.ru_inblock),
+        .output_blocks = static_cast<std::int64_t>(usage.ru_oublock)};
+}
+
+auto ResourceUsage::FromExecutionMetadata(
+    bazel_re::ExecutedActionMetadata const& metadata) noexcept
+    -> std::optional<ResourceUsage> {
+    try {
+        for (auto const& any : metadata.auxiliary_metadata()) {
+            google::protobuf::Struct data{};
+            if (not any.Is<google::protobuf::Struct>() or
+                not any.UnpackTo(&data)) {
+                continue;
+            }
+            auto const& fields = data.fields();
+            auto const kind = fields.find(kKindField);
+            if (kind == fields.end() or kind->second.string_value() != kKind) {
+                continue;
+            }
+            auto const number = [&fields](char const* name) -> double {
+                auto const it = fields.find(name);
+                return it == fields.end() ? 0.0 : it->second.number_value();
+            };
+            return ResourceUsage{
+                .user_time = FromSeconds(number(kUserTimeField)),
+                .system_time = FromSeconds(number(kSystemTimeField)),
+                .max_rss_kib = static_cast<std::int64_t>(number(kMaxRssField)),
+                .input_blocks =
+                    static_cast<std::int64_t>(number(kInputBlocksField)),
+                .output_blocks =
+                    static_cast<std::int64_t>(number(kOutputBlocksField)),
+                .spawn_time = FromSeconds(number(kSpawnTimeField))};
+        }
+    } catch (...) {
+        // malformed metadata is ignored
+    }
+    return std::nullopt;
+}
+
+auto ResourceUsage::AddToExecutionMetadata(
+    gsl::not_null<bazel_re::ExecutedActionMetadata*> const& metadata)
+    const noexcept -> bool {
+    try {
+        google::protobuf::Struct data{};
+        auto& fields = *data.mutable_fields();
+        fields[kKindField].set_string_value(kKind);
+        fields[kUserTimeField].set_number_value(ToSeconds(user_time));
+        fields[kSystemTimeField].set_number_value(ToSeconds(system_time));
+        fields[kMaxRssField].set_number_value(static_cast<double>(max_rss_kib));
+        fields[kInputBlocksField].set_number_value(
+            static_cast<double>(input_blocks));
+        fields[kOutputBlocksField].set_number_value(
+            static_cast<double>(output_blocks));
+        fields[kSpawnTimeField].set_number_value(ToSeconds(spawn_time));
+        return metadata->add_auxiliary_metadata()->PackFrom(data);
+    } catch (...) {
+        return false;
+    }
+}
+
+auto ResourceUsage::ToString() const -> std::string {
+    return fmt::format(
+        "user time {:.3f}s, system time {:.3f}s, max RSS {} KiB, {} blocks "
+        "read, {} blocks written, spawned in {:.3f}ms",
+        ToSeconds(user_time),
+        ToSeconds(system_time),
+        max_rss_kib,
+        input_blocks,
+        output_blocks,
+        std::chrono::duration<double, std::milli>{spawn_time}.count());
+}
@@ -0,0 +1,57 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_COMMON_RESOURCE_USAGE_HPP
+#define INCLUDED_SRC_BUILDTOOL_COMMON_RESOURCE_USAGE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "gsl/gsl"
+#include "src/buildtool/common/bazel_types.hpp"
+
+/// \brief Resource usage of an executed action, i.e., of the processes it
+/// consisted of.
+struct ResourceUsage final {
+    std::chrono::microseconds user_time{};
+    std::chrono::microseconds system_time{};
+    std::int64_t max_rss_kib{};  // maximal resident set size
+    std::int64_t input_blocks{};
+    std::int64_t output_blocks{};
+    std::chrono::microseconds spawn_time{};  // until the command was executed
+
+    [[nodiscard]] static auto FromRusage(struct rusage const& usage) noexcept
+        -> ResourceUsage;
+
+    /// \brief Read the resource usage from the auxiliary metadata of an
+    /// execution, if reported there.
+    [[nodiscard]] static auto FromExecutionMetadata(
+        bazel_re::ExecutedActionMetadata const& metadata) noexcept
+        -> std::optional<ResourceUsage>;
+
+    /// \brief Report the resource usage as auxiliary metadata of an
+    /// execution, encoded as google.protobuf.Struct.
+    [[nodiscard]] auto AddToExecutionMetadata(
+        gsl::not_null<bazel_re::ExecutedActionMetadata*> const& metadata)
+        const noexcept -> bool;
+
+    /// \brief Human-readable summary for log messages.
+    [[nodiscard]] auto ToString() const -> std::string;
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_COMMON_RESOURCE_USAGE_HPP
@@ -28,6 +28,8 @@ class Statistics {
         num_rebuilt_actions_compared_ = 0;
         num_rebuilt_actions_missing_ = 0;
         num_trees_analysed_ = 0;
+        num_builtin_memo_hits_ = 0;
+        num_builtin_memo_misses_ = 0;
     }
     void IncrementActionsQueuedCounter() noexcept { ++num_actions_queued_; }
     void IncrementActionsExecutedCounter() noexcept { ++num_actions_executed_; }
@@ -50,6 +52,12 @@ class Statistics {
     void IncrementExportsFoundCounter() noexcept { ++num_exports_found_; }
     void IncrementExportsServedCounter() noexcept { ++num_exports_served_; }
     void IncrementTreesAnalysedCounter() noexcept { ++num_trees_analysed_; }
+    void IncrementBuiltinMemoHitsCounter() noexcept {
+        ++num_builtin_memo_hits_;
+    }
+    void IncrementBuiltinMemoMissesCounter() noexcept {
+        ++num_builtin_memo_misses_;
+    }
     [[nodiscard]] auto ActionsQueuedCounter() const noexcept -> int {
         return num_actions_queued_;
     }
@@ -89,6 +97,12 @@ class Statistics {
     [[nodiscard]] auto TreesAnalysedCounter() const noexcept -> int {
         return num_trees_analysed_;
     }
+    [[nodiscard]] auto BuiltinMemoHitsCounter() const noexcept -> int {
+        return num_builtin_memo_hits_;
+    }
+    [[nodiscard]] auto BuiltinMemoMissesCounter() const noexcept -> int {
+        return num_builtin_memo_misses_;
+    }
 
   private:
     std::atomic<int> num_actions_queued_;
@@ -104,6 +118,8 @@ class Statistics {
     std::atomic<int> num_exports_found_;
     std::atomic<int> num_exports_served_;
     std::atomic<int> num_trees_analysed_;
+    std::atomic<int> num_builtin_memo_hits_;
+    std::atomic<int> num_builtin_memo_misses_;
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_COMMON_STATISTICS_HPP
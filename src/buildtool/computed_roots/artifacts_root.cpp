@@ -152,7 +152,7 @@ auto ArtifactsRoot(ExpressionPtr const& stage,
     // subtrees will be next to each other. So, we compute the final tree
     // keeping a stack of partially set up tree while walking.
     auto partial_tree = PartialTree();
-    for (auto const& [ps, entry] : stage->Map().Items()) {
+    for (auto const& [ps, entry] : stage->Map()) {
         if (not entry->IsArtifact()) {
             (*logger)(fmt::format("Expected stage, but at entry {} found {}",
                                   nlohmann::json(ps).dump(),
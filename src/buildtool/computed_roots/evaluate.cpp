@@ -498,6 +498,7 @@ void ComputeTreeStructureAndFill(
                           .SetBuildRoot(storage_config->build_root)
                           .SetNumGenerations(storage_config->num_generations)
                           .SetHashType(HashFunction::Type::GitSHA1)
+                          .SetChunkingProfile(storage_config->chunking_profile)
                           .Build();
         if (not config) {
             std::invoke(
@@ -14,21 +14,169 @@
 
 #include "src/buildtool/crypto/hash_function.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
 #include <exception>
-#include <fstream>
-#include <limits>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
 
 namespace {
+// Files are read in chunks of that size, which is large enough to make the
+// cost of system calls negligible, but is only allocated for large files.
+constexpr std::size_t kFileBufferSize = std::size_t{512} << 10U;
+
+// Files of at least that size are read by a separate thread, so that reading
+// ahead overlaps with hashing and the wall time approaches a single read.
+constexpr std::uintmax_t kReadAheadThreshold = std::uintmax_t{64} << 20U;
+
+// Number of buffers of kFileBufferSize filled ahead of hashing.
+constexpr std::size_t kReadAheadBuffers = 4;
+
+// Batches of smaller total size are hashed by the calling thread only.
+constexpr std::size_t kParallelHashThreshold = std::size_t{1} << 20U;
+
 [[nodiscard]] auto CreateGitTreeTag(std::size_t size) noexcept -> std::string {
     return std::string("tree ") + std::to_string(size) + '\0';
 }
 [[nodiscard]] auto CreateGitBlobTag(std::size_t size) noexcept -> std::string {
     return std::string("blob ") + std::to_string(size) + '\0';
 }
+
+/// \brief Fill the buffer from the file, unless its end is reached before.
+/// \returns The number of bytes read or std::nullopt on read errors.
+[[nodiscard]] auto ReadBlock(int fd, std::string* buffer) noexcept
+    -> std::optional<std::size_t> {
+    std::size_t pos{};
+    while (pos < buffer->size()) {
+        auto const count =
+            ::read(fd, buffer->data() + pos, buffer->size() - pos);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            return std::nullopt;
+        }
+        if (count == 0) {
+            break;
+        }
+        pos += static_cast<std::size_t>(count);
+    }
+    return pos;
+}
+
+/// \brief Hash the remaining content of a file by the calling thread.
+/// \returns The number of bytes hashed or std::nullopt on read errors.
+[[nodiscard]] auto HashSequentially(int fd,
+                                    std::uintmax_t size,
+                                    gsl::not_null<Hasher*> const& hasher)
+    -> std::optional<std::uintmax_t> {
+    // hash directly from the buffer, which is not larger than the file
+    auto buffer =
+        std::string(static_cast<std::size_t>(std::clamp<std::uintmax_t>(
+                        size, std::uintmax_t{1}, kFileBufferSize)),
+                    '\0');
+    std::uintmax_t total{};
+    while (true) {
+        auto const count = ReadBlock(fd, &buffer);
+        if (not count) {
+            return std::nullopt;
+        }
+        if (*count == 0) {
+            return total;
+        }
+        hasher->Update(std::string_view{buffer.data(), *count});
+        total += *count;
+    }
+}
+
+/// \brief Hash the remaining content of a file, while a separate thread
+/// reads ahead into a ring of buffers.
+/// \returns The number of bytes hashed or std::nullopt on read errors.
+[[nodiscard]] auto HashReadAhead(int fd, gsl::not_null<Hasher*> const& hasher)
+    -> std::optional<std::uintmax_t> {
+    struct Block {
+        std::string data = std::string(kFileBufferSize, '\0');
+        std::size_t size{};
+    };
+    std::vector<Block> blocks(kReadAheadBuffers);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t produced{};  // number of blocks read
+    std::size_t consumed{};  // number of blocks hashed
+    bool finished{};         // end of file reached or read error
+    bool failed{};
+
+    auto const read_ahead = [&]() {
+        while (true) {
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&]() {
+                    return produced - consumed < kReadAheadBuffers;
+                });
+            }
+            // the block is not hashed before produced is incremented
+            auto& block = blocks[produced % kReadAheadBuffers];
+            auto const count = ReadBlock(fd, &block.data);
+            {
+                std::unique_lock lock{mutex};
+                if (count and *count > 0) {
+                    block.size = *count;
+                    ++produced;
+                }
+                else {
+                    finished = true;
+                    failed = not count;
+                }
+            }
+            cv.notify_all();
+            if (not count or *count == 0) {
+                return;
+            }
+        }
+    };
+    std::thread reader{};
+    try {
+        reader = std::thread{read_ahead};
+    } catch (...) {
+        return HashSequentially(fd, kFileBufferSize, hasher);
+    }
+
+    std::uintmax_t total{};
+    while (true) {
+        std::unique_lock lock{mutex};
+        cv.wait(lock, [&]() { return consumed < produced or finished; });
+        if (consumed == produced) {
+            break;
+        }
+        auto const& block = blocks[consumed % kReadAheadBuffers];
+        lock.unlock();
+        hasher->Update(std::string_view{block.data.data(), block.size});
+        total += block.size;
+        lock.lock();
+        ++consumed;
+        lock.unlock();
+        cv.notify_all();
+    }
+    reader.join();
+    if (failed) {
+        return std::nullopt;
+    }
+    return total;
+}
+
 }  // namespace
 
 auto HashFunction::HashBlobData(std::string const& data) const noexcept
@@ -46,7 +194,77 @@ auto HashFunction::PlainHashData(std::string const& data) const noexcept
     return HashTaggedLine(data, std::nullopt);
 }
 
-auto HashFunction::HashTaggedLine(std::string const& data,
+auto HashFunction::HashBlobsData(std::vector<std::string_view> const& data,
+                                 std::size_t jobs) const noexcept
+    -> std::vector<Hasher::HashDigest> {
+    std::vector<std::optional<Hasher::HashDigest>> digests(data.size());
+    auto const hash_range = [this, &data, &digests](std::size_t begin,
+                                                    std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            digests[i] = HashTaggedLine(data[i], CreateGitBlobTag);
+        }
+    };
+
+    // split into ranges of roughly equal size in bytes
+    std::size_t total{};
+    for (auto const& blob : data) {
+        total += blob.size();
+    }
+    jobs = std::clamp(total / kParallelHashThreshold,
+                      std::size_t{1},
+                      std::max(jobs, std::size_t{1}));
+    std::vector<std::pair<std::size_t, std::size_t>> ranges{};
+    std::size_t begin{};
+    std::size_t range_size{};
+    for (std::size_t i{}; i < data.size(); ++i) {
+        range_size += data[i].size();
+        if (range_size * jobs >= total and ranges.size() + 1 < jobs) {
+            ranges.emplace_back(begin, i + 1);
+            begin = i + 1;
+            range_size = 0;
+        }
+    }
+    ranges.emplace_back(begin, data.size());
+
+    std::vector<std::thread> threads{};
+    threads.reserve(ranges.size());
+    for (std::size_t i = 1; i < ranges.size(); ++i) {
+        try {
+            threads.emplace_back(hash_range, ranges[i].first, ranges[i].second);
+        } catch (...) {
+            hash_range(ranges[i].first, ranges[i].second);
+        }
+    }
+    hash_range(ranges[0].first, ranges[0].second);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<Hasher::HashDigest> result{};
+    result.reserve(digests.size());
+    for (auto& digest : digests) {
+        result.emplace_back(*std::move(digest));
+    }
+    return result;
+}
+
+auto HashFunction::MakeBlobHasher(std::size_t size) const noexcept -> Hasher {
+    auto hasher = MakeHasher();
+    if (type_ == Type::GitSHA1) {
+        hasher.Update(CreateGitBlobTag(size));
+    }
+    return hasher;
+}
+
+auto HashFunction::MakeTreeHasher(std::size_t size) const noexcept -> Hasher {
+    auto hasher = MakeHasher();
+    if (type_ == Type::GitSHA1) {
+        hasher.Update(CreateGitTreeTag(size));
+    }
+    return hasher;
+}
+
+auto HashFunction::HashTaggedLine(std::string_view data,
                                   std::optional<TagCreator> tag_creator)
     const noexcept -> Hasher::HashDigest {
     auto hasher = MakeHasher();
@@ -70,32 +288,37 @@ auto HashFunction::HashTreeFile(std::filesystem::path const& path) const
 auto HashFunction::HashTaggedFile(std::filesystem::path const& path,
                                   TagCreator const& tag_creator) const noexcept
     -> std::optional<std::pair<Hasher::HashDigest, std::uintmax_t>> {
-    auto const size = std::filesystem::file_size(path);
-
-    static constexpr std::size_t kChunkSize{4048};
-    static_assert(kChunkSize < std::numeric_limits<std::streamsize>::max(),
-                  "An overflow will occur while reading");
-
-    auto hasher = MakeHasher();
-    if (type_ == Type::GitSHA1) {
-        hasher.Update(std::invoke(tag_creator, size));
-    }
-
     try {
-        auto chunk = std::string(kChunkSize, '\0');
-        std::ifstream file_reader(path.string(), std::ios::binary);
-        if (not file_reader.is_open()) {
+        int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::nullopt;
+        }
+        auto const close_fd = gsl::finally([fd]() { ::close(fd); });
+        struct stat info{};
+        if (::fstat(fd, &info) != 0) {
             return std::nullopt;
         }
+        auto const size = static_cast<std::uintmax_t>(info.st_size);
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
 
-        while (file_reader.good()) {
-            file_reader.read(chunk.data(),
-                             static_cast<std::streamsize>(kChunkSize));
+        auto hasher = MakeHasher();
+        if (type_ == Type::GitSHA1) {
+            hasher.Update(std::invoke(tag_creator, size));
+        }
 
-            auto const count = static_cast<std::size_t>(file_reader.gcount());
-            hasher.Update(chunk.substr(0, count));
+        auto const total = size >= kReadAheadThreshold
+                               ? HashReadAhead(fd, &hasher)
+                               : HashSequentially(fd, size, &hasher);
+        if (not total) {
+            return std::nullopt;
+        }
+        if (*total != size) {
+            // the size is part of Git hashes, so do not report a wrong one
+            Logger::Log(LogLevel::Debug,
+                        "File {} changed its size while hashing",
+                        path.string());
+            return std::nullopt;
         }
-        file_reader.close();
         return std::make_pair(std::move(hasher).Finalize(), size);
     } catch (std::exception const& e) {
         Logger::Log(LogLevel::Debug,
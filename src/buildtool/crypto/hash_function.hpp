@@ -21,7 +21,9 @@
 #include <functional>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include "gsl/gsl"
 #include "src/buildtool/crypto/hasher.hpp"
@@ -56,6 +58,14 @@ class HashFunction {
     [[nodiscard]] auto PlainHashData(std::string const& data) const noexcept
         -> Hasher::HashDigest;
 
+    /// \brief Compute the blob hashes of many strings at once. Batches of
+    /// sufficient total size are split among up to the given number of
+    /// threads.
+    /// \returns The digests in the order of the given data.
+    [[nodiscard]] auto HashBlobsData(std::vector<std::string_view> const& data,
+                                     std::size_t jobs) const noexcept
+        -> std::vector<Hasher::HashDigest>;
+
     /// \brief Compute the blob hash of a file or std::nullopt on IO error.
     [[nodiscard]] auto HashBlobFile(
         std::filesystem::path const& path) const noexcept
@@ -81,12 +91,22 @@ class HashFunction {
         return *std::move(hasher);
     }
 
+    /// \brief Obtain incremental hasher for computing the blob hash of content
+    /// of the given size, which is fed to the hasher afterwards.
+    [[nodiscard]] auto MakeBlobHasher(std::size_t size) const noexcept
+        -> Hasher;
+
+    /// \brief Obtain incremental hasher for computing the tree hash of content
+    /// of the given size, which is fed to the hasher afterwards.
+    [[nodiscard]] auto MakeTreeHasher(std::size_t size) const noexcept
+        -> Hasher;
+
   private:
     Type const type_;
 
     using TagCreator = std::function<std::string(std::size_t)>;
 
-    [[nodiscard]] auto HashTaggedLine(std::string const& data,
+    [[nodiscard]] auto HashTaggedLine(std::string_view data,
                                       std::optional<TagCreator> tag_creator)
         const noexcept -> Hasher::HashDigest;
 
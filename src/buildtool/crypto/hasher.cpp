@@ -83,8 +83,7 @@ struct InitializeVisitor final {
 struct UpdateVisitor final {
     static constexpr std::string_view kLogInfo = "Update";
 
-    explicit UpdateVisitor(gsl::not_null<std::string const*> const& data)
-        : data_{*data} {}
+    explicit UpdateVisitor(std::string_view data) : data_{data} {}
 
     // NOLINTNEXTLINE(google-runtime-references)
     [[nodiscard]] auto operator()(SHA_CTX& ctx) const -> bool {
@@ -100,7 +99,7 @@ struct UpdateVisitor final {
     }
 
   private:
-    std::string const& data_;
+    std::string_view data_;
 };
 
 struct FinalizeVisitor final {
@@ -157,8 +156,8 @@ auto Hasher::Create(HashType type) noexcept -> std::optional<Hasher> {
     return std::nullopt;
 }
 
-auto Hasher::Update(std::string const& data) noexcept -> bool {
-    return Visit<UpdateVisitor>(sha_ctx_.get(), &data);
+auto Hasher::Update(std::string_view data) noexcept -> bool {
+    return Visit<UpdateVisitor>(sha_ctx_.get(), data);
 }
 
 auto Hasher::Finalize() && noexcept -> HashDigest {
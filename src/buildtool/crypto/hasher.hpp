@@ -20,6 +20,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>  // std::move
 
 #include "src/utils/cpp/hex_string.hpp"
@@ -78,8 +79,8 @@ class Hasher final {
     auto operator=(Hasher const& other) noexcept -> Hasher& = delete;
     ~Hasher() noexcept;
 
-    /// \brief Feed data to the hasher.
-    auto Update(std::string const& data) noexcept -> bool;
+    /// \brief Feed data to the hasher. The data is not copied.
+    auto Update(std::string_view data) noexcept -> bool;
 
     /// \brief Finalize hash.
     [[nodiscard]] auto Finalize() && noexcept -> HashDigest;
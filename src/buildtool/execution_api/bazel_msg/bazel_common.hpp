@@ -18,10 +18,14 @@
 /// \file bazel_common.hpp
 /// \brief Common types and functions required by Bazel API.
 
+#include <optional>
+
 struct ExecutionConfiguration {
     int execution_priority{};
     int results_cache_priority{};
     bool skip_cache_lookup{};
+    // Level for compressing byte-stream transfers, if requested.
+    std::optional<int> compression_level{};
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_API_BAZEL_MSG_BAZEL_COMMON_HPP
@@ -16,6 +16,7 @@
 
 #include <algorithm>
 #include <compare>
+#include <cstddef>
 #include <exception>
 #include <filesystem>
 #include <functional>
@@ -741,26 +742,30 @@ auto BazelMsgFactory::CreateGitTreeDigestFromDirectory(
 
 auto BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
     std::filesystem::path const& root,
-    FileStoreFunc const& store_file,
+    FilesStoreFunc const& store_files,
     TreeStoreFunc const& store_dir,
     SymlinkStoreFunc const& store_symlink) noexcept
     -> std::optional<ArtifactDigest> {
     std::vector<bazel_re::FileNode> files{};
     std::vector<bazel_re::DirectoryNode> dirs{};
     std::vector<bazel_re::SymlinkNode> symlinks{};
+    // Files of this directory, stored together once the directory is read
+    std::vector<std::pair<std::filesystem::path, bool>> file_paths{};
+    std::vector<std::pair<std::string, ObjectType>> file_entries{};
 
-    auto dir_reader = [&files,
+    auto dir_reader = [&file_paths,
+                       &file_entries,
                        &dirs,
                        &symlinks,
                        &root,
-                       &store_file,
+                       &store_files,
                        &store_dir,
                        &store_symlink](auto name, auto type) {
         const auto full_name = root / name;
         if (IsTreeObject(type)) {
             // create and store sub directory
             auto digest = CreateDirectoryDigestFromLocalTree(
-                root / name, store_file, store_dir, store_symlink);
+                root / name, store_files, store_dir, store_symlink);
             if (not digest) {
                 Logger::Log(LogLevel::Error,
                             "failed storing tree {}",
@@ -786,14 +791,10 @@ auto BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
                             full_name.string());
                 return false;
             }
-            // create and store file
-            if (auto digest = store_file(full_name, IsExecutableObject(type))) {
-                auto file = CreateFileNode(name.string(), type, *digest);
-                files.emplace_back(std::move(file));
-                return true;
-            }
-            Logger::Log(
-                LogLevel::Error, "failed storing file {}", full_name.string());
+            // collect file to be stored
+            file_paths.emplace_back(full_name, IsExecutableObject(type));
+            file_entries.emplace_back(name.string(), type);
+            return true;
         } catch (std::exception const& ex) {
             Logger::Log(
                 LogLevel::Error, "storing file failed with:\n{}", ex.what());
@@ -803,6 +804,19 @@ auto BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
 
     if (FileSystemManager::ReadDirectory(
             root, dir_reader, /*allow_upwards=*/true)) {
+        auto digests = store_files(file_paths);
+        if (not digests or digests->size() != file_paths.size()) {
+            Logger::Log(LogLevel::Error,
+                        "failed storing files of {}",
+                        root.string());
+            return std::nullopt;
+        }
+        files.reserve(digests->size());
+        for (std::size_t i{}; i < digests->size(); ++i) {
+            files.emplace_back(CreateFileNode(file_entries[i].first,
+                                              file_entries[i].second,
+                                              (*digests)[i]));
+        }
         auto dir = CreateDirectory(files, dirs, symlinks);
         if (auto bytes = SerializeMessage(dir)) {
             try {
@@ -820,21 +834,26 @@ auto BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
 
 auto BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
     std::filesystem::path const& root,
-    FileStoreFunc const& store_file,
+    FilesStoreFunc const& store_files,
     TreeStoreFunc const& store_tree,
     SymlinkStoreFunc const& store_symlink) noexcept
     -> std::optional<ArtifactDigest> {
     GitRepo::tree_entries_t entries{};
+    // Files of this directory, stored together once the directory is read
+    std::vector<std::pair<std::filesystem::path, bool>> file_paths{};
+    std::vector<std::pair<std::string, ObjectType>> file_entries{};
     auto dir_reader = [&entries,
+                       &file_paths,
+                       &file_entries,
                        &root,
-                       &store_file,
+                       &store_files,
                        &store_tree,
                        &store_symlink](auto name, auto type) {
         const auto full_name = root / name;
         if (IsTreeObject(type)) {
             // create and store sub directory
             if (auto digest = CreateGitTreeDigestFromLocalTree(
-                    full_name, store_file, store_tree, store_symlink)) {
+                    full_name, store_files, store_tree, store_symlink)) {
                 if (auto raw_id = FromHexString(digest->hash())) {
                     entries[std::move(*raw_id)].emplace_back(name.string(),
                                                              ObjectType::Tree);
@@ -868,16 +887,10 @@ auto BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
                 }
                 return false;
             }
-            // create and store file
-            if (auto digest = store_file(full_name, IsExecutableObject(type))) {
-                if (auto raw_id = FromHexString(digest->hash())) {
-                    entries[std::move(*raw_id)].emplace_back(name.string(),
-                                                             type);
-                    return true;
-                }
-            }
-            Logger::Log(
-                LogLevel::Error, "failed storing file {}", full_name.string());
+            // collect file to be stored
+            file_paths.emplace_back(full_name, IsExecutableObject(type));
+            file_entries.emplace_back(name.string(), type);
+            return true;
         } catch (std::exception const& ex) {
             Logger::Log(
                 LogLevel::Error, "storing file failed with:\n{}", ex.what());
@@ -887,6 +900,24 @@ auto BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
 
     if (FileSystemManager::ReadDirectory(
             root, dir_reader, /*allow_upwards=*/true)) {
+        auto digests = store_files(file_paths);
+        if (not digests or digests->size() != file_paths.size()) {
+            Logger::Log(LogLevel::Error,
+                        "failed storing files of {}",
+                        root.string());
+            return std::nullopt;
+        }
+        for (std::size_t i{}; i < digests->size(); ++i) {
+            auto raw_id = FromHexString((*digests)[i].hash());
+            if (not raw_id) {
+                Logger::Log(LogLevel::Error,
+                            "failed storing file {}",
+                            (root / file_entries[i].first).string());
+                return std::nullopt;
+            }
+            entries[*std::move(raw_id)].emplace_back(
+                std::move(file_entries[i].first), file_entries[i].second);
+        }
         if (auto tree = GitRepo::CreateShallowTree(entries)) {
             try {
                 return store_tree(tree->second);
@@ -916,12 +947,10 @@ auto BazelMsgFactory::CreateActionDigestFromCommandLine(
     if (request.store_blob) {
         std::invoke(*request.store_blob,
                     BazelBlob{ArtifactDigestFactory::ToBazel(cmd->digest),
-                              cmd->data,
-                              cmd->is_exec});
+                              *cmd});
         std::invoke(*request.store_blob,
                     BazelBlob{ArtifactDigestFactory::ToBazel(action->digest),
-                              action->data,
-                              action->is_exec});
+                              *action});
     }
     return action->digest;
 }
@@ -22,6 +22,7 @@
 #include <map>
 #include <optional>
 #include <string>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -59,6 +60,9 @@ class BazelMsgFactory {
         bool)>;
     using FileStoreFunc = std::function<
         std::optional<ArtifactDigest>(std::filesystem::path const&, bool)>;
+    using FilesStoreFunc =
+        std::function<std::optional<std::vector<ArtifactDigest>>(
+            std::vector<std::pair<std::filesystem::path, bool>> const&)>;
     using SymlinkStoreFunc =
         std::function<std::optional<ArtifactDigest>(std::string const&)>;
     using TreeStoreFunc =
@@ -135,13 +139,14 @@ class BazelMsgFactory {
     /// \brief Create Directory digest from local file root.
     /// Recursively traverse entire root and store files and directories.
     /// \param root         Path to local file root.
-    /// \param store_file   Function for storing local file via path.
+    /// \param store_files  Function for storing the local files of a
+    /// directory together via their paths.
     /// \param store_dir    Function for storing Directory blobs.
     /// \param store_symlink  Function for storing symlink via content.
     /// \returns Digest representing the entire file root.
     [[nodiscard]] static auto CreateDirectoryDigestFromLocalTree(
         std::filesystem::path const& root,
-        FileStoreFunc const& store_file,
+        FilesStoreFunc const& store_files,
         TreeStoreFunc const& store_dir,
         SymlinkStoreFunc const& store_symlink) noexcept
         -> std::optional<ArtifactDigest>;
@@ -149,13 +154,14 @@ class BazelMsgFactory {
     /// \brief Create Git tree digest from local file root.
     /// Recursively traverse entire root and store files and directories.
     /// \param root         Path to local file root.
-    /// \param store_file   Function for storing local file via path.
+    /// \param store_files  Function for storing the local files of a
+    /// directory together via their paths.
     /// \param store_tree   Function for storing git trees.
     /// \param store_symlink  Function for storing symlink via content.
     /// \returns Digest representing the entire file root.
     [[nodiscard]] static auto CreateGitTreeDigestFromLocalTree(
         std::filesystem::path const& root,
-        FileStoreFunc const& store_file,
+        FilesStoreFunc const& store_files,
         TreeStoreFunc const& store_tree,
         SymlinkStoreFunc const& store_symlink) noexcept
         -> std::optional<ArtifactDigest>;
@@ -36,6 +36,8 @@ auto ApiBundle::Create(
     if (auto const address = remote_context->exec_config->remote_address) {
         ExecutionConfiguration config;
         config.skip_cache_lookup = false;
+        config.compression_level =
+            remote_context->exec_config->compression_level;
         remote_api = std::make_shared<BazelApi>("remote-execution",
                                                 address->host,
                                                 address->port,
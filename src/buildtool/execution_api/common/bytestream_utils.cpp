@@ -14,6 +14,8 @@
 
 #include "src/buildtool/execution_api/common/bytestream_utils.hpp"
 
+#include <cstddef>
+#include <iterator>
 #include <string_view>
 #include <utility>
 #include <vector>
@@ -48,6 +50,26 @@ namespace {
     return parts;
 }
 
+[[nodiscard]] auto ToString(ByteStreamUtils::Compressor compressor) noexcept
+    -> std::string_view {
+    switch (compressor) {
+        case ByteStreamUtils::Compressor::Identity:
+            return "identity";
+        case ByteStreamUtils::Compressor::Deflate:
+            return "deflate";
+    }
+    return "identity";  // unreachable
+}
+
+[[nodiscard]] auto FromString(std::string_view compressor) noexcept
+    -> std::optional<ByteStreamUtils::Compressor> {
+    // The identity compressor is never part of a resource name.
+    if (compressor == ToString(ByteStreamUtils::Compressor::Deflate)) {
+        return ByteStreamUtils::Compressor::Deflate;
+    }
+    return std::nullopt;
+}
+
 [[nodiscard]] inline auto ToBazelDigest(std::string hash,
                                         std::int64_t size) noexcept
     -> bazel_re::Digest {
@@ -58,14 +80,23 @@ namespace {
 }
 }  // namespace
 
-ByteStreamUtils::ReadRequest::ReadRequest(
-    std::string instance_name,
-    bazel_re::Digest const& digest) noexcept
+ByteStreamUtils::ReadRequest::ReadRequest(std::string instance_name,
+                                          bazel_re::Digest const& digest,
+                                          Compressor compressor) noexcept
     : instance_name_{std::move(instance_name)},
       hash_{digest.hash()},
-      size_{digest.size_bytes()} {}
+      size_{digest.size_bytes()},
+      compressor_{compressor} {}
 
 auto ByteStreamUtils::ReadRequest::ToString() && noexcept -> std::string {
+    if (compressor_ != Compressor::Identity) {
+        return fmt::format("{}/{}/{}/{}/{}",
+                           std::move(instance_name_),
+                           ByteStreamUtils::kCompressedBlobs,
+                           ::ToString(compressor_),
+                           std::move(hash_),
+                           size_);
+    }
     return fmt::format("{}/{}/{}/{}",
                        std::move(instance_name_),
                        ByteStreamUtils::kBlobs,
@@ -81,13 +112,24 @@ auto ByteStreamUtils::ReadRequest::FromString(
     static constexpr std::size_t kSizeIndex = 3U;
     static constexpr std::size_t kReadRequestPartsCount = 4U;
 
-    auto const parts = ::SplitRequest(request);
-    if (parts.size() != kReadRequestPartsCount or
-        parts.at(kBlobsIndex).compare(ByteStreamUtils::kBlobs) != 0) {
+    auto parts = ::SplitRequest(request);
+    ReadRequest result;
+    if (parts.size() == kReadRequestPartsCount + 1 and
+        parts.at(kBlobsIndex).compare(ByteStreamUtils::kCompressedBlobs) ==
+            0) {
+        // Drop the compressor to obtain the layout of a plain request.
+        auto compressor = ::FromString(parts.at(kBlobsIndex + 1));
+        if (not compressor) {
+            return std::nullopt;
+        }
+        result.compressor_ = *compressor;
+        parts.erase(std::next(parts.begin(),
+                              static_cast<std::ptrdiff_t>(kBlobsIndex + 1)));
+    } else if (parts.size() != kReadRequestPartsCount or
+               parts.at(kBlobsIndex).compare(ByteStreamUtils::kBlobs) != 0) {
         return std::nullopt;
     }
 
-    ReadRequest result;
     result.instance_name_ = std::string(parts.at(kInstanceNameIndex));
     result.hash_ = std::string(parts.at(kHashIndex));
     try {
@@ -103,16 +145,27 @@ auto ByteStreamUtils::ReadRequest::GetDigest() const noexcept
     return ToBazelDigest(hash_, size_);
 }
 
-ByteStreamUtils::WriteRequest::WriteRequest(
-    std::string instance_name,
-    std::string uuid,
-    bazel_re::Digest const& digest) noexcept
+ByteStreamUtils::WriteRequest::WriteRequest(std::string instance_name,
+                                            std::string uuid,
+                                            bazel_re::Digest const& digest,
+                                            Compressor compressor) noexcept
     : instance_name_{std::move(instance_name)},
       uuid_{std::move(uuid)},
       hash_{digest.hash()},
-      size_{digest.size_bytes()} {}
+      size_{digest.size_bytes()},
+      compressor_{compressor} {}
 
 auto ByteStreamUtils::WriteRequest::ToString() && noexcept -> std::string {
+    if (compressor_ != Compressor::Identity) {
+        return fmt::format("{}/{}/{}/{}/{}/{}/{}",
+                           std::move(instance_name_),
+                           ByteStreamUtils::kUploads,
+                           std::move(uuid_),
+                           ByteStreamUtils::kCompressedBlobs,
+                           ::ToString(compressor_),
+                           std::move(hash_),
+                           size_);
+    }
     return fmt::format("{}/{}/{}/{}/{}/{}",
                        std::move(instance_name_),
                        ByteStreamUtils::kUploads,
@@ -132,14 +185,27 @@ auto ByteStreamUtils::WriteRequest::FromString(
     static constexpr std::size_t kSizeIndex = 5U;
     static constexpr std::size_t kWriteRequestPartsCount = 6U;
 
-    auto const parts = ::SplitRequest(request);
-    if (parts.size() != kWriteRequestPartsCount or
-        parts.at(kUploadsIndex).compare(ByteStreamUtils::kUploads) != 0 or
-        parts.at(kBlobsIndex).compare(ByteStreamUtils::kBlobs) != 0) {
+    auto parts = ::SplitRequest(request);
+    WriteRequest result;
+    if (parts.size() == kWriteRequestPartsCount + 1 and
+        parts.at(kBlobsIndex).compare(ByteStreamUtils::kCompressedBlobs) ==
+            0) {
+        // Drop the compressor to obtain the layout of a plain request.
+        auto compressor = ::FromString(parts.at(kBlobsIndex + 1));
+        if (not compressor) {
+            return std::nullopt;
+        }
+        result.compressor_ = *compressor;
+        parts.erase(std::next(parts.begin(),
+                              static_cast<std::ptrdiff_t>(kBlobsIndex + 1)));
+    } else if (parts.size() != kWriteRequestPartsCount or
+               parts.at(kBlobsIndex).compare(ByteStreamUtils::kBlobs) != 0) {
+        return std::nullopt;
+    }
+    if (parts.at(kUploadsIndex).compare(ByteStreamUtils::kUploads) != 0) {
         return std::nullopt;
     }
 
-    WriteRequest result;
     result.instance_name_ = std::string(parts.at(kInstanceNameIndex));
     result.uuid_ = std::string(parts.at(kUUIDIndex));
     result.hash_ = std::string(parts.at(kHashIndex));
@@ -27,21 +27,30 @@ namespace bazel_re = build::bazel::remote::execution::v2;
 
 class ByteStreamUtils final {
     static constexpr auto* kBlobs = "blobs";
+    static constexpr auto* kCompressedBlobs = "compressed-blobs";
     static constexpr auto* kUploads = "uploads";
 
   public:
     // Chunk size for uploads (default size used by BuildBarn)
     static constexpr std::size_t kChunkSize = 64UL * 1024;
 
+    /// \brief Compression applied to the transferred data. The digest in the
+    /// resource name always refers to the uncompressed content.
+    enum class Compressor : std::uint8_t { Identity, Deflate };
+
     /// \brief Create a read request for the bytestream service to be
     /// transferred over the net. Handles serialization/deserialization on its
     /// own. The pattern is:
     /// "{instance_name}/{kBlobs}/{digest.hash()}/{digest.size_bytes()}".
     /// "instance_name_example/blobs/62183d7a696acf7e69e218efc82c93135f8c85f895/4424712"
+    /// or, for compressed transfers,
+    /// "{instance_name}/{kCompressedBlobs}/{compressor}/{digest.hash()}/{digest.size_bytes()}".
     class ReadRequest final {
       public:
-        explicit ReadRequest(std::string instance_name,
-                             bazel_re::Digest const& digest) noexcept;
+        explicit ReadRequest(
+            std::string instance_name,
+            bazel_re::Digest const& digest,
+            Compressor compressor = Compressor::Identity) noexcept;
 
         [[nodiscard]] auto ToString() && noexcept -> std::string;
 
@@ -55,10 +64,15 @@ class ByteStreamUtils final {
 
         [[nodiscard]] auto GetDigest() const noexcept -> bazel_re::Digest;
 
+        [[nodiscard]] auto GetCompressor() const noexcept -> Compressor {
+            return compressor_;
+        }
+
       private:
         std::string instance_name_;
         std::string hash_;
         std::int64_t size_ = 0;
+        Compressor compressor_ = Compressor::Identity;
 
         ReadRequest() = default;
     };
@@ -68,11 +82,15 @@ class ByteStreamUtils final {
     /// own. The pattern is:
     /// "{instance_name}/{kUploads}/{uuid}/{kBlobs}/{digest.hash()}/{digest.size_bytes()}".
     /// "instance_name_example/uploads/c4f03510-7d56-4490-8934-01bce1b1288e/blobs/62183d7a696acf7e69e218efc82c93135f8c85f895/4424712"
+    /// or, for compressed transfers,
+    /// "{instance_name}/{kUploads}/{uuid}/{kCompressedBlobs}/{compressor}/{digest.hash()}/{digest.size_bytes()}".
     class WriteRequest final {
       public:
-        explicit WriteRequest(std::string instance_name,
-                              std::string uuid,
-                              bazel_re::Digest const& digest) noexcept;
+        explicit WriteRequest(
+            std::string instance_name,
+            std::string uuid,
+            bazel_re::Digest const& digest,
+            Compressor compressor = Compressor::Identity) noexcept;
 
         [[nodiscard]] auto ToString() && noexcept -> std::string;
 
@@ -90,11 +108,16 @@ class ByteStreamUtils final {
 
         [[nodiscard]] auto GetDigest() const noexcept -> bazel_re::Digest;
 
+        [[nodiscard]] auto GetCompressor() const noexcept -> Compressor {
+            return compressor_;
+        }
+
       private:
         std::string instance_name_;
         std::string uuid_;
         std::string hash_;
         std::int64_t size_ = 0;
+        Compressor compressor_ = Compressor::Identity;
 
         WriteRequest() = default;
     };
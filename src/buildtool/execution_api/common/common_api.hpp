@@ -130,14 +130,14 @@ auto UpdateContainerAndUpload(
     // that we never store unnecessarily more data in the container than we need
     // per remote transfer.
     try {
-        if (blob.data->size() > kMaxBatchTransferSize) {
+        if (blob.GetContentSize() > kMaxBatchTransferSize) {
             // large blobs use individual stream upload
             if (not uploader(ContentBlobContainer<TDigest>{{blob}})) {
                 return false;
             }
         }
         else {
-            if (container->ContentSize() + blob.data->size() >
+            if (container->ContentSize() + blob.GetContentSize() >
                 kMaxBatchTransferSize) {
                 // swap away from original container to allow move during upload
                 ContentBlobContainer<TDigest> tmp_container{};
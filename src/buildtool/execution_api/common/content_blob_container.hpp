@@ -16,30 +16,126 @@
 #define INCLUDED_SRC_BUILDTOOL_EXECUTION_API_COMMON_CONTENT_BLOB_CONTAINER_HPP
 
 #include <cstddef>
+#include <exception>
+#include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>  //std::move
 #include <vector>
 
 #include "gsl/gsl"
+#include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/utils/cpp/chunked_reader.hpp"
+#include "src/utils/cpp/expected.hpp"
 #include "src/utils/cpp/transformed_range.hpp"
 
 template <typename TDigest>
 struct ContentBlob final {
     ContentBlob(TDigest mydigest, std::string mydata, bool is_exec) noexcept
         : digest{std::move(mydigest)},
-          data{std::make_shared<std::string>(std::move(mydata))},
-          is_exec{is_exec} {}
+          is_exec{is_exec},
+          data_{std::make_shared<std::string const>(std::move(mydata))},
+          size_{data_->size()} {}
 
     ContentBlob(TDigest mydigest,
-                gsl::not_null<std::shared_ptr<std::string>> const& mydata,
+                gsl::not_null<std::shared_ptr<std::string const>> const& mydata,
                 bool is_exec) noexcept
-        : digest{std::move(mydigest)}, data(mydata), is_exec{is_exec} {}
+        : digest{std::move(mydigest)},
+          is_exec{is_exec},
+          data_{mydata.get()},
+          size_{data_->size()} {}
+
+    /// \brief Create blob with the same content as a blob of different digest
+    /// type, e.g., to convert between ArtifactBlob and BazelBlob.
+    template <typename TOtherDigest>
+    ContentBlob(TDigest mydigest,
+                ContentBlob<TOtherDigest> const& other) noexcept
+        : digest{std::move(mydigest)},
+          is_exec{other.is_exec},
+          data_{other.data_},
+          file_{other.file_},
+          size_{other.size_} {}
+
+    /// \brief Create blob whose content is not kept in memory but read from
+    /// the given file on demand. The file must not be modified as long as the
+    /// blob is in use.
+    /// \param mydigest   Digest of the file's content
+    /// \param file       Path to the file
+    /// \param size       Size of the file's content
+    /// \param is_exec    Executable bit of the blob
+    [[nodiscard]] static auto FromFile(TDigest mydigest,
+                                       std::filesystem::path file,
+                                       std::size_t size,
+                                       bool is_exec) noexcept -> ContentBlob {
+        return ContentBlob{
+            std::move(mydigest), std::move(file), size, is_exec};
+    }
+
+    /// \brief Obtain the entire content. For blobs backed by a file, the file
+    /// is read and its content is not cached.
+    /// \returns The content or nullptr on read failure.
+    [[nodiscard]] auto ReadContent() const noexcept
+        -> std::shared_ptr<std::string const> {
+        if (data_) {
+            return data_;
+        }
+        try {
+            if (auto content = FileSystemManager::ReadFile(*file_)) {
+                return std::make_shared<std::string const>(
+                    *std::move(content));
+            }
+        } catch (...) {
+            return nullptr;
+        }
+        return nullptr;
+    }
+
+    /// \brief Obtain reader for the content in chunks of the given size,
+    /// without reading entire files into memory.
+    [[nodiscard]] auto ReadIncrementally(std::size_t chunk_size) const noexcept
+        -> expected<ChunkedReader, std::string> {
+        try {
+            if (data_) {
+                return ChunkedReader::FromMemory(chunk_size, data_);
+            }
+            return ChunkedReader::FromFile(chunk_size, *file_);
+        } catch (std::exception const& e) {
+            return unexpected{std::string{e.what()}};
+        }
+    }
+
+    /// \brief Size of the content in bytes.
+    [[nodiscard]] auto GetContentSize() const noexcept -> std::size_t {
+        return size_;
+    }
+
+    /// \brief Path to the file backing the content, if any.
+    [[nodiscard]] auto GetFilePath() const noexcept
+        -> std::optional<std::filesystem::path> const& {
+        return file_;
+    }
 
     TDigest digest;
-    std::shared_ptr<std::string> data;
     bool is_exec = false;
+
+  private:
+    template <typename TOtherDigest>
+    friend struct ContentBlob;
+
+    std::shared_ptr<std::string const> data_;    // content in memory, or
+    std::optional<std::filesystem::path> file_;  // content in file
+    std::size_t size_{};
+
+    ContentBlob(TDigest mydigest,
+                std::filesystem::path file,
+                std::size_t size,
+                bool is_exec) noexcept
+        : digest{std::move(mydigest)},
+          is_exec{is_exec},
+          file_{std::move(file)},
+          size_{size} {}
 };
 
 template <typename TDigest>
@@ -62,7 +158,7 @@ class ContentBlobContainer final {
         if (auto res = blobs_.emplace(std::move(digest), std::move(blob));
             res.second) {
             // only count size if blob was actually added
-            content_size_ += res.first->second.data->size();
+            content_size_ += res.first->second.GetContentSize();
         }
     }
 
@@ -17,12 +17,14 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "gsl/gsl"
 #include "src/buildtool/common/artifact.hpp"
+#include "src/buildtool/common/bazel_types.hpp"
 #include "src/utils/cpp/expected.hpp"
 
 /// \brief Abstract response.
@@ -65,6 +67,12 @@ class IExecutionResponse {
         -> expected<gsl::not_null<ArtifactInfos const*>, std::string> = 0;
     [[nodiscard]] virtual auto DirectorySymlinks() noexcept
         -> expected<gsl::not_null<DirSymlinks const*>, std::string> = 0;
+
+    /// \brief Metadata of the execution, if reported by the backend.
+    [[nodiscard]] virtual auto ExecutionMetadata() const noexcept
+        -> std::optional<bazel_re::ExecutedActionMetadata> {
+        return std::nullopt;
+    }
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_API_COMMON_REMOTE_EXECUTION_RESPONSE_HPP
@@ -15,11 +15,18 @@
 #include "src/buildtool/execution_api/execution_service/bytestream_server.hpp"
 
 #include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "fmt/core.h"
 #include "google/protobuf/stubs/port.h"
@@ -29,10 +36,11 @@
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/execution_api/common/bytestream_utils.hpp"
 #include "src/buildtool/execution_api/execution_service/cas_utils.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/storage/garbage_collector.hpp"
+#include "src/utils/cpp/deflate.hpp"
 #include "src/utils/cpp/expected.hpp"
-#include "src/utils/cpp/tmp_dir.hpp"
 
 auto BytestreamServiceImpl::Read(
     ::grpc::ServerContext* /*context*/,
@@ -74,12 +82,26 @@ auto BytestreamServiceImpl::Read(
         return ::grpc::Status{::grpc::StatusCode::NOT_FOUND, str};
     }
 
+    // The read offset refers to the uncompressed content.
+    std::optional<DeflateCompressor> compressor{};
+    if (read_request->GetCompressor() !=
+        ByteStreamUtils::Compressor::Identity) {
+        auto created =
+            DeflateCompressor::Create(DeflateCompressor::kDefaultLevel);
+        if (not created) {
+            logger_.Emit(LogLevel::Error, "{}", created.error());
+            return grpc::Status{grpc::StatusCode::INTERNAL, created.error()};
+        }
+        compressor.emplace(*std::move(created));
+    }
+
     std::ifstream stream{*path, std::ios::binary};
     stream.seekg(request->read_offset(), std::ios::beg);
 
     ::google::bytestream::ReadResponse response;
     std::string& buffer = *response.mutable_data();
     buffer.resize(ByteStreamUtils::kChunkSize);
+    ::google::bytestream::ReadResponse compressed_response;
 
     while (not stream.eof()) {
         stream.read(buffer.data(), ByteStreamUtils::kChunkSize);
@@ -94,6 +116,21 @@ auto BytestreamServiceImpl::Read(
             // do not send random bytes
             buffer.resize(static_cast<std::size_t>(stream.gcount()));
         }
+        if (compressor) {
+            auto compressed = compressor->Compress(buffer, stream.eof());
+            if (not compressed) {
+                auto const str = fmt::format("Failed to compress data for {}",
+                                             read_digest->hash());
+                logger_.Emit(
+                    LogLevel::Error, "{}: {}", str, compressed.error());
+                return grpc::Status{grpc::StatusCode::INTERNAL, str};
+            }
+            if (not compressed->empty()) {
+                *compressed_response.mutable_data() = *std::move(compressed);
+                writer->Write(compressed_response);
+            }
+            continue;
+        }
         writer->Write(response);
     }
     return ::grpc::Status::OK;
@@ -133,44 +170,281 @@ auto BytestreamServiceImpl::Write(
         logger_.Emit(LogLevel::Error, "{}", kStr);
         return grpc::Status{grpc::StatusCode::INTERNAL, kStr};
     }
-    auto const tmp_dir = storage_config_.CreateTypedTmpDir("execution-service");
-    if (not tmp_dir) {
-        return ::grpc::Status{::grpc::StatusCode::INTERNAL,
-                              "could not create TmpDir"};
-    }
 
-    auto tmp = tmp_dir->GetPath() / write_digest->hash();
+    RemoveExpiredUploads();
+
+    // Only a single stream may write to a resource at a time.
+    auto const resource_name = request.resource_name();
     {
-        std::ofstream stream{tmp, std::ios::binary};
-        do {  // NOLINT(cppcoreguidelines-avoid-do-while)
-            if (not stream.good()) {
-                auto const str = fmt::format("Failed to write data for {}",
-                                             write_digest->hash());
-                logger_.Emit(LogLevel::Error, "{}", str);
-                return ::grpc::Status{::grpc::StatusCode::INTERNAL, str};
+        std::unique_lock uploads_lock{uploads_mutex_};
+        if (not active_uploads_.emplace(resource_name).second) {
+            auto const str =
+                fmt::format("Write: concurrent write to {}", resource_name);
+            logger_.Emit(LogLevel::Debug, "{}", str);
+            return ::grpc::Status{::grpc::StatusCode::ABORTED, str};
+        }
+    }
+    auto const release = gsl::finally([this, &resource_name]() {
+        std::unique_lock uploads_lock{uploads_mutex_};
+        active_uploads_.erase(resource_name);
+    });
+
+    // Compressed uploads are decompressed while receiving them. As offsets
+    // into the compressed data cannot be mapped back to the uncompressed
+    // upload, they cannot be continued and always start from scratch.
+    std::optional<DeflateDecompressor> decompressor{};
+    if (write_request->GetCompressor() !=
+        ByteStreamUtils::Compressor::Identity) {
+        if (request.write_offset() != 0) {
+            auto const str = fmt::format(
+                "Write: compressed upload of {} cannot continue at offset {}",
+                write_digest->hash(),
+                request.write_offset());
+            logger_.Emit(LogLevel::Debug, "{}", str);
+            return ::grpc::Status{::grpc::StatusCode::OUT_OF_RANGE, str};
+        }
+        auto created = DeflateDecompressor::Create();
+        if (not created) {
+            logger_.Emit(LogLevel::Error, "{}", created.error());
+            return ::grpc::Status{::grpc::StatusCode::INTERNAL,
+                                  created.error()};
+        }
+        decompressor.emplace(*std::move(created));
+    }
+
+    // Continue a partially written upload at the requested offset, which must
+    // not exceed the committed size.
+    auto const upload = UploadPath(resource_name);
+    if (not FileSystemManager::CreateDirectory(upload.parent_path())) {
+        return ::grpc::Status{::grpc::StatusCode::INTERNAL,
+                              "could not create uploads directory"};
+    }
+    std::error_code ec{};
+    auto const committed = FileSystemManager::IsFile(upload)
+                               ? std::filesystem::file_size(upload, ec)
+                               : std::uintmax_t{0};
+    if (ec or request.write_offset() < 0 or
+        static_cast<std::uintmax_t>(request.write_offset()) > committed) {
+        auto const str =
+            fmt::format("Write: offset {} of {} exceeds committed size {}",
+                        request.write_offset(),
+                        write_digest->hash(),
+                        committed);
+        logger_.Emit(LogLevel::Debug, "{}", str);
+        return ::grpc::Status{::grpc::StatusCode::OUT_OF_RANGE, str};
+    }
+    // The content is hashed while it is written, so that the upload can be
+    // added to CAS without reading it again.
+    auto writer = CASContentWriter::Create(
+        storage_config_.hash_function,
+        *write_digest,
+        upload,
+        static_cast<std::uintmax_t>(request.write_offset()));
+    if (not writer) {
+        auto const str =
+            fmt::format("Write: {}", writer.error().error_message());
+        logger_.Emit(LogLevel::Error, "{}", str);
+        return ::grpc::Status{writer.error().error_code(), str};
+    }
+    auto content_writer = *std::move(writer);
+    // offset into the received data, which differs from the offset of the
+    // upload for compressed data
+    std::uintmax_t received = 0;
+    do {  // NOLINT(cppcoreguidelines-avoid-do-while)
+        auto const expected_offset =
+            decompressor ? received : content_writer.GetOffset();
+        if (static_cast<std::uintmax_t>(request.write_offset()) !=
+            expected_offset) {
+            auto const str =
+                fmt::format("Write: expected offset {} for {}, got {}",
+                            expected_offset,
+                            write_digest->hash(),
+                            request.write_offset());
+            logger_.Emit(LogLevel::Debug, "{}", str);
+            return ::grpc::Status{::grpc::StatusCode::INVALID_ARGUMENT, str};
+        }
+        if (decompressor) {
+            auto const limit = write_digest->size();
+            auto const error = decompressor->Decompress(
+                request.data(),
+                [&content_writer, limit](std::string const& chunk) {
+                    // reject content exceeding the announced size early
+                    if (limit != 0 and
+                        content_writer.GetOffset() + chunk.size() > limit) {
+                        return false;
+                    }
+                    return content_writer.Write(chunk);
+                });
+            if (error) {
+                static_cast<void>(FileSystemManager::RemoveFile(upload));
+                auto const str = fmt::format(
+                    "Write: invalid compressed data for {}: {}",
+                    write_digest->hash(),
+                    *error);
+                logger_.Emit(LogLevel::Debug, "{}", str);
+                return ::grpc::Status{::grpc::StatusCode::INVALID_ARGUMENT,
+                                      str};
             }
-            stream.write(request.data().data(),
-                         static_cast<std::streamsize>(request.data().size()));
-        } while (not request.finish_write() and reader->Read(&request));
+            received += request.data().size();
+        }
+        else if (not content_writer.Write(request.data())) {
+            auto const str = fmt::format("Failed to write data for {}",
+                                         write_digest->hash());
+            logger_.Emit(LogLevel::Error, "{}", str);
+            return ::grpc::Status{::grpc::StatusCode::INTERNAL, str};
+        }
+    } while (not request.finish_write() and reader->Read(&request));
+
+    if (decompressor and
+        (not request.finish_write() or not decompressor->IsFinished())) {
+        // Incomplete compressed uploads cannot be continued.
+        static_cast<void>(FileSystemManager::RemoveFile(upload));
+        auto const str =
+            fmt::format("Write: incomplete compressed upload of {}",
+                        write_digest->hash());
+        logger_.Emit(LogLevel::Debug, "{}", str);
+        return ::grpc::Status{request.finish_write()
+                                  ? ::grpc::StatusCode::INVALID_ARGUMENT
+                                  : ::grpc::StatusCode::ABORTED,
+                              str};
+    }
+
+    // For compressed uploads, the committed size refers to the received data.
+    auto const offset = decompressor ? received : content_writer.GetOffset();
+    if (not request.finish_write()) {
+        // The stream was closed before the upload was finished. Keep what was
+        // written so far, to be continued by another Write.
+        logger_.Emit(LogLevel::Debug,
+                     "Write: incomplete upload of {}, committed {} bytes",
+                     write_digest->hash(),
+                     offset);
+        response->set_committed_size(
+            static_cast<google::protobuf::int64>(offset));
+        return ::grpc::Status::OK;
     }
 
-    auto const status = CASUtils::AddFileToCAS(*write_digest, tmp, storage_);
+    auto const status = std::move(content_writer).Finish(storage_);
+    static_cast<void>(FileSystemManager::RemoveFile(upload));
     if (not status.ok()) {
         auto const str = fmt::format("Write: {}", status.error_message());
         logger_.Emit(LogLevel::Error, "{}", str);
         return ::grpc::Status{status.error_code(), str};
     }
-    response->set_committed_size(
-        static_cast<google::protobuf::int64>(std::filesystem::file_size(tmp)));
+    response->set_committed_size(static_cast<google::protobuf::int64>(offset));
     return ::grpc::Status::OK;
 }
 
 auto BytestreamServiceImpl::QueryWriteStatus(
     ::grpc::ServerContext* /*context*/,
-    const ::google::bytestream::QueryWriteStatusRequest* /*request*/,
-    ::google::bytestream::QueryWriteStatusResponse* /*response*/)
+    const ::google::bytestream::QueryWriteStatusRequest* request,
+    ::google::bytestream::QueryWriteStatusResponse* response)
     -> ::grpc::Status {
-    static constexpr auto kStr = "QueryWriteStatus not implemented";
-    logger_.Emit(LogLevel::Error, "{}", kStr);
-    return ::grpc::Status{grpc::StatusCode::UNIMPLEMENTED, kStr};
+    logger_.Emit(
+        LogLevel::Trace, "QueryWriteStatus {}", request->resource_name());
+    auto const write_request =
+        ByteStreamUtils::WriteRequest::FromString(request->resource_name());
+    if (not write_request) {
+        auto const str =
+            fmt::format("could not parse {}", request->resource_name());
+        logger_.Emit(LogLevel::Error, "{}", str);
+        return ::grpc::Status{::grpc::StatusCode::INVALID_ARGUMENT, str};
+    }
+    auto const write_digest = ArtifactDigestFactory::FromBazel(
+        storage_config_.hash_function.GetType(), write_request->GetDigest());
+    if (not write_digest) {
+        logger_.Emit(LogLevel::Debug, "{}", write_digest.error());
+        return ::grpc::Status{::grpc::StatusCode::INVALID_ARGUMENT,
+                              write_digest.error()};
+    }
+
+    auto const lock = GarbageCollector::SharedLock(storage_config_);
+    if (not lock) {
+        static constexpr auto kStr = "Could not acquire SharedLock";
+        logger_.Emit(LogLevel::Error, "{}", kStr);
+        return grpc::Status{grpc::StatusCode::INTERNAL, kStr};
+    }
+
+    // A finished upload is no longer staged, but available in CAS.
+    auto const upload = UploadPath(request->resource_name());
+    if (FileSystemManager::IsFile(upload)) {
+        std::error_code ec{};
+        auto const committed = std::filesystem::file_size(upload, ec);
+        if (not ec) {
+            response->set_committed_size(
+                static_cast<google::protobuf::int64>(committed));
+            response->set_complete(false);
+            return ::grpc::Status::OK;
+        }
+    }
+    auto const in_cas =
+        write_digest->IsTree()
+            ? storage_.CAS().TreePath(*write_digest).has_value()
+            : storage_.CAS().BlobPath(*write_digest, /*is_executable=*/false)
+                  .has_value();
+    if (in_cas) {
+        response->set_committed_size(
+            static_cast<google::protobuf::int64>(write_digest->size()));
+        response->set_complete(true);
+        return ::grpc::Status::OK;
+    }
+    auto const str = fmt::format("QueryWriteStatus: no upload to {}",
+                                 request->resource_name());
+    logger_.Emit(LogLevel::Debug, "{}", str);
+    return ::grpc::Status{::grpc::StatusCode::NOT_FOUND, str};
+}
+
+auto BytestreamServiceImpl::UploadPath(std::string const& resource_name)
+    const noexcept -> std::filesystem::path {
+    return UploadsDir() /
+           storage_config_.hash_function.PlainHashData(resource_name)
+               .HexString();
+}
+
+void BytestreamServiceImpl::RemoveExpiredUploads() noexcept {
+    try {
+        auto const now = std::chrono::steady_clock::now();
+        {
+            std::unique_lock lock{uploads_mutex_};
+            if (now - last_cleanup_ < kUploadTTL / 4) {
+                return;
+            }
+            last_cleanup_ = now;
+        }
+        auto const dir = UploadsDir();
+        if (not FileSystemManager::IsDirectory(dir)) {
+            return;
+        }
+        auto const expired =
+            std::filesystem::file_time_type::clock::now() - kUploadTTL;
+        std::vector<std::filesystem::path> candidates{};
+        for (auto const& entry : std::filesystem::directory_iterator{dir}) {
+            std::error_code ec{};
+            if (entry.last_write_time(ec) < expired and not ec) {
+                candidates.emplace_back(entry.path());
+            }
+        }
+        if (candidates.empty()) {
+            return;
+        }
+
+        // Uploads being written must not be removed; holding the lock, no
+        // write to an expired upload can start while removing it.
+        std::unique_lock lock{uploads_mutex_};
+        std::unordered_set<std::string> active{};
+        for (auto const& resource_name : active_uploads_) {
+            active.emplace(UploadPath(resource_name).string());
+        }
+        for (auto const& path : candidates) {
+            if (active.contains(path.string())) {
+                continue;
+            }
+            logger_.Emit(
+                LogLevel::Debug, "Removing expired upload {}", path.string());
+            static_cast<void>(FileSystemManager::RemoveFile(path));
+        }
+    } catch (std::exception const& ex) {
+        logger_.Emit(LogLevel::Warning,
+                     "Failed to remove expired uploads: {}",
+                     ex.what());
+    }
 }
@@ -15,6 +15,12 @@
 #ifndef BYTESTREAM_SERVER_HPP
 #define BYTESTREAM_SERVER_HPP
 
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
 #include <grpcpp/grpcpp.h>
 
 #include "google/bytestream/bytestream.grpc.pb.h"
@@ -86,9 +92,31 @@ class BytestreamServiceImpl : public ::google::bytestream::ByteStream::Service {
         -> ::grpc::Status override;
 
   private:
+    // Partially written uploads not continued for that long are removed.
+    static constexpr auto kUploadTTL = std::chrono::hours{1};
+
     StorageConfig const& storage_config_;
     Storage const& storage_;
     Logger logger_{"execution-service:bytestream"};
+
+    // Resource names of uploads currently being written.
+    std::mutex uploads_mutex_;
+    std::unordered_set<std::string> active_uploads_;
+    std::chrono::steady_clock::time_point last_cleanup_;
+
+    /// \brief Directory keeping partially written uploads, such that an
+    /// interrupted Write can be continued from the committed size.
+    [[nodiscard]] auto UploadsDir() const noexcept -> std::filesystem::path {
+        return storage_config_.EphemeralRoot() / "bytestream-uploads";
+    }
+
+    /// \brief File keeping the partially written upload of a resource.
+    [[nodiscard]] auto UploadPath(std::string const& resource_name)
+        const noexcept -> std::filesystem::path;
+
+    /// \brief Remove partially written uploads that expired. Expensive, so
+    /// the uploads dir is scanned at most once per a fraction of the TTL.
+    void RemoveExpiredUploads() noexcept;
 };
 
 #endif  // BYTESTREAM_SERVER_HPP
@@ -43,6 +43,8 @@ auto CapabilitiesServiceImpl::GetCapabilities(
                   "Max batch transfer size too large.");
     cache.add_supported_chunking_algorithms(
         ::bazel_re::ChunkingAlgorithm_Value::ChunkingAlgorithm_Value_FASTCDC);
+    cache.add_supported_compressors(
+        ::bazel_re::Compressor_Value::Compressor_Value_DEFLATE);
     *(response->mutable_cache_capabilities()) = cache;
 
     exec.set_digest_function(
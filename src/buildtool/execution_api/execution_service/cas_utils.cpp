@@ -14,14 +14,21 @@
 
 #include "src/buildtool/execution_api/execution_service/cas_utils.hpp"
 
+#include <cstddef>
+#include <exception>
+#include <ios>
 #include <optional>
+#include <string_view>
+#include <type_traits>
 #include <utility>
 
 #include "fmt/core.h"
 #include "gsl/gsl"
+#include "src/buildtool/common/artifact_digest_factory.hpp"
 #include "src/buildtool/common/protocol_traits.hpp"
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/storage/large_object_cas.hpp"
 
 namespace {
@@ -76,6 +83,39 @@ class CASContentValidator final {
         return ::grpc::Status::OK;
     }
 
+    /// \brief Add content to CAS, whose digest was already computed while
+    /// receiving it, without hashing the content again.
+    template <typename TData>
+    [[nodiscard]] auto AddVerified(ArtifactDigest const& digest,
+                                   ArtifactDigest const& computed,
+                                   TData const& data) const noexcept
+        -> grpc::Status {
+        if (auto err = CheckDigestConsistency(digest, computed)) {
+            // User error: did not get content with the announced hash
+            return ::grpc::Status{grpc::StatusCode::INVALID_ARGUMENT,
+                                  *std::move(err)};
+        }
+
+        if (digest.IsTree()) {
+            // For trees, check whether the tree invariant holds before storing
+            // the actual tree object.
+            if (auto err = storage_.CAS().CheckTreeInvariant(digest, data)) {
+                return ToGrpc(std::move(*err));
+            }
+        }
+
+        auto const cas_digest = digest.IsTree()
+                                    ? StoreVerifiedTree(computed, data)
+                                    : StoreVerifiedBlob(computed, data);
+        if (not cas_digest) {
+            return ::grpc::Status{grpc::StatusCode::INTERNAL,
+                                  fmt::format("Could not upload {} {}",
+                                              digest.IsTree() ? "tree" : "blob",
+                                              digest.hash())};
+        }
+        return ::grpc::Status::OK;
+    }
+
   private:
     Storage const& storage_;
     bool const is_owner_;
@@ -105,6 +145,36 @@ class CASContentValidator final {
         }
     }
 
+    template <typename TData>
+    [[nodiscard]] auto StoreVerifiedTree(ArtifactDigest const& digest,
+                                         TData const& data) const noexcept
+        -> std::optional<ArtifactDigest> {
+        if constexpr (std::is_same_v<TData, std::string>) {
+            return storage_.CAS().StoreVerifiedTree(digest, data);
+        }
+        else {
+            return is_owner_
+                       ? storage_.CAS().StoreVerifiedTree<true>(digest, data)
+                       : storage_.CAS().StoreVerifiedTree<false>(digest, data);
+        }
+    }
+
+    template <typename TData>
+    [[nodiscard]] auto StoreVerifiedBlob(ArtifactDigest const& digest,
+                                         TData const& data) const noexcept
+        -> std::optional<ArtifactDigest> {
+        static constexpr bool kIsExec = false;
+        if constexpr (std::is_same_v<TData, std::string>) {
+            return storage_.CAS().StoreVerifiedBlob(digest, data, kIsExec);
+        }
+        else {
+            return is_owner_ ? storage_.CAS().StoreVerifiedBlob<true>(
+                                   digest, data, kIsExec)
+                             : storage_.CAS().StoreVerifiedBlob<false>(
+                                   digest, data, kIsExec);
+        }
+    }
+
     [[nodiscard]] auto CheckDigestConsistency(ArtifactDigest const& ref,
                                               ArtifactDigest const& computed)
         const noexcept -> std::optional<std::string>;
@@ -114,7 +184,16 @@ class CASContentValidator final {
 auto CASUtils::AddDataToCAS(ArtifactDigest const& digest,
                             std::string const& content,
                             Storage const& storage) noexcept -> grpc::Status {
-    return CASContentValidator{&storage}.Add(digest, content);
+    // Hash the content once and verify it before writing it to CAS.
+    auto const hash_function = storage.GetHashFunction();
+    auto const computed =
+        digest.IsTree()
+            ? ArtifactDigestFactory::HashDataAs<ObjectType::Tree>(hash_function,
+                                                                  content)
+            : ArtifactDigestFactory::HashDataAs<ObjectType::File>(hash_function,
+                                                                  content);
+    return CASContentValidator{&storage}.AddVerified(
+        digest, computed, content);
 }
 
 auto CASUtils::AddFileToCAS(ArtifactDigest const& digest,
@@ -124,6 +203,118 @@ auto CASUtils::AddFileToCAS(ArtifactDigest const& digest,
     return CASContentValidator{&storage, is_owner}.Add(digest, file);
 }
 
+auto CASContentWriter::Create(HashFunction hash_function,
+                              ArtifactDigest const& digest,
+                              std::filesystem::path const& file,
+                              std::uintmax_t offset) noexcept
+    -> expected<CASContentWriter, grpc::Status> {
+    // Git hashes are prefixed by the size of the content, which, in native
+    // mode, may be announced as 0 if unknown. In that case, the file is hashed
+    // after writing.
+    auto hasher = std::optional<Hasher>{};
+    if (not ProtocolTraits::IsNative(hash_function.GetType()) or
+        digest.size() != 0) {
+        hasher = digest.IsTree() ? hash_function.MakeTreeHasher(digest.size())
+                                 : hash_function.MakeBlobHasher(digest.size());
+    }
+
+    try {
+        if (offset > 0) {
+            // drop content beyond the offset and hash the remaining content
+            std::filesystem::resize_file(file, offset);
+            if (hasher) {
+                static constexpr std::size_t kChunkSize = 64UL * 1024;
+                auto chunk = std::string(kChunkSize, '\0');
+                std::ifstream stream{file, std::ios::binary};
+                while (stream.good()) {
+                    stream.read(chunk.data(),
+                                static_cast<std::streamsize>(kChunkSize));
+                    auto const count =
+                        static_cast<std::size_t>(stream.gcount());
+                    if (not hasher->Update(
+                            std::string_view{chunk}.substr(0, count))) {
+                        return unexpected{grpc::Status{
+                            grpc::StatusCode::INTERNAL,
+                            fmt::format("could not hash {}", file.string())}};
+                    }
+                }
+                if (stream.bad()) {
+                    return unexpected{grpc::Status{
+                        grpc::StatusCode::INTERNAL,
+                        fmt::format("could not read {}", file.string())}};
+                }
+            }
+        }
+
+        auto stream = std::ofstream{
+            file,
+            std::ios::binary | (offset == 0 ? std::ios::trunc : std::ios::app)};
+        if (not stream.good()) {
+            return unexpected{grpc::Status{
+                grpc::StatusCode::INTERNAL,
+                fmt::format("could not open {}", file.string())}};
+        }
+        return CASContentWriter{
+            digest, file, std::move(stream), std::move(hasher), offset};
+    } catch (std::exception const& ex) {
+        return unexpected{grpc::Status{
+            grpc::StatusCode::INTERNAL,
+            fmt::format(
+                "could not continue {}: {}", file.string(), ex.what())}};
+    }
+}
+
+auto CASContentWriter::Write(std::string const& data) noexcept -> bool {
+    try {
+        stream_.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (not stream_.good() or (hasher_ and not hasher_->Update(data))) {
+            return false;
+        }
+        offset_ += data.size();
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+auto CASContentWriter::Finish(Storage const& storage) && noexcept
+    -> grpc::Status {
+    try {
+        stream_.close();
+    } catch (...) {
+        stream_.setstate(std::ios::failbit);
+    }
+    if (stream_.fail()) {
+        return grpc::Status{grpc::StatusCode::INTERNAL,
+                            fmt::format("could not write {}", file_.string())};
+    }
+    if (not hasher_) {
+        return CASUtils::AddFileToCAS(digest_, file_, storage);
+    }
+
+    auto const computed = ArtifactDigestFactory::Create(
+        digest_.GetHashType(),
+        std::move(*hasher_).Finalize().HexString(),
+        static_cast<std::size_t>(offset_),
+        digest_.IsTree());
+    if (not computed) {
+        return grpc::Status{grpc::StatusCode::INTERNAL, computed.error()};
+    }
+    return CASContentValidator{&storage}.AddVerified(
+        digest_, *computed, file_);
+}
+
+CASContentWriter::CASContentWriter(ArtifactDigest digest,
+                                   std::filesystem::path file,
+                                   std::ofstream stream,
+                                   std::optional<Hasher> hasher,
+                                   std::uintmax_t offset) noexcept
+    : digest_{std::move(digest)},
+      file_{std::move(file)},
+      stream_{std::move(stream)},
+      hasher_{std::move(hasher)},
+      offset_{offset} {}
+
 auto CASUtils::SplitBlobIdentity(ArtifactDigest const& blob_digest,
                                  Storage const& storage) noexcept
     -> expected<std::vector<ArtifactDigest>, grpc::Status> {
@@ -15,13 +15,18 @@
 #ifndef INCLUDED_SRC_BUILDTOOL_EXECUTION_API_EXECUTION_SERVICE_CAS_UTILS_HPP
 #define INCLUDED_SRC_BUILDTOOL_EXECUTION_API_EXECUTION_SERVICE_CAS_UTILS_HPP
 
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include <grpcpp/support/status.h>
 
 #include "src/buildtool/common/artifact_digest.hpp"
+#include "src/buildtool/crypto/hash_function.hpp"
+#include "src/buildtool/crypto/hasher.hpp"
 #include "src/buildtool/storage/storage.hpp"
 #include "src/utils/cpp/expected.hpp"
 
@@ -55,4 +60,51 @@ class CASUtils {
         -> expected<ArtifactDigest, grpc::Status>;
 };
 
+/// \brief Writes the content of a CAS entry to a file, as it is received in
+/// chunks. The content is hashed while being written, so that the file can be
+/// added to CAS without reading it again.
+class CASContentWriter final {
+  public:
+    /// \brief Start writing content for the given digest to a file.
+    /// \param digest   The digest the content is announced with.
+    /// \param file     The file to write to.
+    /// \param offset   Offset to continue writing a partially written file at.
+    /// Content before this offset is read back from the file once.
+    /// \returns The writer on success or an error status.
+    [[nodiscard]] static auto Create(HashFunction hash_function,
+                                     ArtifactDigest const& digest,
+                                     std::filesystem::path const& file,
+                                     std::uintmax_t offset) noexcept
+        -> expected<CASContentWriter, grpc::Status>;
+
+    /// \brief Append data to the file.
+    /// \returns Whether the data was written successfully.
+    [[nodiscard]] auto Write(std::string const& data) noexcept -> bool;
+
+    /// \brief The number of bytes written to the file so far.
+    [[nodiscard]] auto GetOffset() const noexcept -> std::uintmax_t {
+        return offset_;
+    }
+
+    /// \brief Close the file and, if the content matches the announced
+    /// digest, add it to CAS. The file is moved to CAS if possible.
+    [[nodiscard]] auto Finish(Storage const& storage) && noexcept
+        -> grpc::Status;
+
+  private:
+    ArtifactDigest digest_;
+    std::filesystem::path file_;
+    std::ofstream stream_;
+    // Hasher for the content, if its size is known in advance, as required
+    // for git hashes; otherwise the file is hashed after writing.
+    std::optional<Hasher> hasher_;
+    std::uintmax_t offset_ = 0;
+
+    CASContentWriter(ArtifactDigest digest,
+                     std::filesystem::path file,
+                     std::ofstream stream,
+                     std::optional<Hasher> hasher,
+                     std::uintmax_t offset) noexcept;
+};
+
 #endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_API_EXECUTION_SERVICE_CAS_UTILS_HPP
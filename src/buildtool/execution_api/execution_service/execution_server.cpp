@@ -28,6 +28,7 @@
 
 #include "fmt/core.h"
 #include "google/protobuf/any.pb.h"
+#include "google/protobuf/duration.pb.h"
 #include "google/protobuf/repeated_ptr_field.h"
 #include "google/protobuf/timestamp.pb.h"
 #include "google/rpc/status.pb.h"
@@ -104,6 +105,15 @@ auto ExecutionServiceImpl::ToIExecutionAction(
     execution_action->SetCacheFlag(
         action.do_not_cache() ? IExecutionAction::CacheFlag::DoNotCacheOutput
                               : IExecutionAction::CacheFlag::CacheOutput);
+    if (action.has_timeout()) {
+        auto const timeout =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::seconds{action.timeout().seconds()} +
+                std::chrono::nanoseconds{action.timeout().nanos()});
+        if (timeout > std::chrono::milliseconds::zero()) {
+            execution_action->SetTimeout(timeout);
+        }
+    }
     return execution_action;
 }
 
@@ -154,6 +164,10 @@ auto ExecutionServiceImpl::ToBazelExecuteResponse(
             ArtifactDigestFactory::ToBazel(*cas_digest);
     }
 
+    if (auto metadata = i_execution_response->ExecutionMetadata()) {
+        (*action_result.mutable_execution_metadata()) = *std::move(metadata);
+    }
+
     ::bazel_re::ExecuteResponse bazel_response{};
     (*bazel_response.mutable_result()) = std::move(action_result);
     bazel_response.set_cached_result(i_execution_response->IsCached());
@@ -31,6 +31,12 @@ struct LocalExecutionConfig final {
     // Launcher to be prepended to action's command before executed.
     // Default: ["env", "--"]
     std::vector<std::string> const launcher = {"env", "--"};
+
+    // Stage large input trees as symlinks to read-only trees materialised
+    // once in the local build root, instead of hard linking all their files
+    // for every action.
+    // Default: false
+    bool const tree_cache = false;
 };
 
 class LocalExecutionConfig::Builder final {
@@ -40,6 +46,11 @@ class LocalExecutionConfig::Builder final {
         return *this;
     }
 
+    auto SetTreeCache(bool tree_cache) noexcept -> Builder& {
+        tree_cache_ = tree_cache;
+        return *this;
+    }
+
     /// \brief Finalize building and create LocalExecutionConfig.
     /// \return LocalExecutionConfig on success, an error string on failure.
     [[nodiscard]] auto Build() const noexcept
@@ -57,11 +68,14 @@ class LocalExecutionConfig::Builder final {
             }
         }
 
-        return LocalExecutionConfig{.launcher = std::move(launcher)};
+        return LocalExecutionConfig{
+            .launcher = std::move(launcher),
+            .tree_cache = tree_cache_.value_or(default_config.tree_cache)};
     }
 
   private:
     std::optional<std::vector<std::string>> launcher_;
+    std::optional<bool> tree_cache_;
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_API_LOCAL_CONFIG_HPP
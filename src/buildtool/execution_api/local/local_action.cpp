@@ -15,19 +15,35 @@
 #include "src/buildtool/execution_api/local/local_action.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <exception>
 #include <filesystem>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "google/protobuf/repeated_ptr_field.h"
+#include "google/protobuf/timestamp.pb.h"
 #include "nlohmann/json.hpp"
 #include "src/buildtool/common/artifact_digest_factory.hpp"
 #include "src/buildtool/common/protocol_traits.hpp"
+#include "src/buildtool/common/resource_usage.hpp"
 #include "src/buildtool/execution_api/common/execution_common.hpp"
 #include "src/buildtool/execution_api/common/tree_reader.hpp"
 #include "src/buildtool/execution_api/local/config.hpp"
@@ -37,6 +53,7 @@
 #include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/logging/log_level.hpp"
+#include "src/buildtool/multithreading/task_system.hpp"
 #include "src/buildtool/storage/storage.hpp"
 #include "src/buildtool/system/system_command.hpp"
 #include "src/utils/cpp/expected.hpp"
@@ -44,6 +61,106 @@
 
 namespace {
 
+// Inputs with fewer entries are staged by the calling thread.
+constexpr std::size_t kParallelStagingThreshold = 1024;
+
+// Maximal number of entries of a directory staged by a single task.
+constexpr std::size_t kStagingBatchSize = 256;
+
+// Subtrees with at least that many leafs are taken from the tree cache, if
+// enabled.
+constexpr std::size_t kMinCachedTreeLeafs = 1000;
+
+// Number of threads of the pool helping all local actions to stage their
+// inputs and to store their outputs. Actions are already executed in parallel
+// and the file operations contend for the same file system, so more threads
+// hardly pay off.
+constexpr std::size_t kMaxSharedJobs = 8;
+
+// Outputs with fewer regular files are stored by the calling thread.
+constexpr std::size_t kParallelCollectionThreshold = 256;
+
+// Maximal number of output files stored by a single task.
+constexpr std::size_t kCollectionBatchSize = 32;
+
+// Actions taking more than this fraction of their timeout are reported as
+// slow.
+constexpr int kSlowActionDivisor = 2;
+
+[[nodiscard]] auto ToSeconds(std::chrono::nanoseconds duration) noexcept
+    -> double {
+    return std::chrono::duration<double>{duration}.count();
+}
+
+void SetTimestamp(gsl::not_null<google::protobuf::Timestamp*> const& timestamp,
+                  std::chrono::system_clock::time_point time) noexcept {
+    auto const since_epoch = time.time_since_epoch();
+    auto const seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    timestamp->set_seconds(seconds.count());
+    timestamp->set_nanos(static_cast<std::int32_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch -
+                                                             seconds)
+            .count()));
+}
+
+/// \brief Check whether a directory is or contains a path.
+[[nodiscard]] auto PathContains(std::filesystem::path const& dir,
+                                std::filesystem::path const& path) noexcept
+    -> bool {
+    return std::mismatch(dir.begin(), dir.end(), path.begin(), path.end())
+               .first == dir.end();
+}
+
+/// \brief Process-wide pool of threads helping local actions with large
+/// inputs and outputs. It is shared by all actions, so that the number of
+/// threads does not grow with the number of actions executed in parallel.
+[[nodiscard]] auto SharedPool() -> TaskSystem& {
+    static TaskSystem pool{std::min(
+        kMaxSharedJobs,
+        std::max(std::size_t{1},
+                 std::size_t{std::thread::hardware_concurrency()}))};
+    return pool;
+}
+
+/// \brief Call work(i) for every i < count, on the calling thread and on the
+/// threads of the shared pool, and wait until all calls returned. The calling
+/// thread takes part, so that it makes progress even if the pool is busy with
+/// the work of other actions. Tasks only starting once all calls were taken
+/// return without touching the work.
+template <typename TWork>
+void RunOnSharedPool(std::size_t count, TWork const& work) {
+    struct State {
+        TWork const* work;
+        std::size_t count;
+        std::atomic<std::size_t> next{};
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t done{};
+    };
+    auto state = std::make_shared<State>();
+    state->work = &work;
+    state->count = count;
+    auto const run = [](State* state) noexcept {
+        for (auto i = state->next++; i < state->count; i = state->next++) {
+            (*state->work)(i);
+            std::unique_lock lock{state->mutex};
+            if (++state->done == state->count) {
+                state->cv.notify_all();
+            }
+        }
+    };
+    auto& pool = SharedPool();
+    auto const helpers =
+        std::min(count > 0 ? count - 1 : 0, pool.NumberOfThreads());
+    for (std::size_t i{}; i < helpers; ++i) {
+        pool.QueueTask([state, run]() { run(state.get()); });
+    }
+    run(state.get());
+    std::unique_lock lock{state->mutex};
+    state->cv.wait(lock, [&state]() { return state->done == state->count; });
+}
+
 /// \brief Removes specified directory if KeepBuildDir() is not set.
 class BuildCleanupAnchor {
   public:
@@ -67,11 +184,37 @@ class BuildCleanupAnchor {
 
 [[nodiscard]] auto CreateDigestFromLocalOwnedTree(
     Storage const& storage,
-    std::filesystem::path const& dir_path) -> std::optional<ArtifactDigest> {
+    std::filesystem::path const& dir_path,
+    LocalAction::StoredBlobs const& stored) -> std::optional<ArtifactDigest> {
     auto const& cas = storage.CAS();
-    auto store_blob = [&cas](std::filesystem::path const& path,
-                             auto is_exec) -> std::optional<ArtifactDigest> {
-        return cas.StoreBlob</*kOwner=*/true>(path, is_exec);
+    // Files not stored before are stored together per directory.
+    auto store_blobs =
+        [&cas, &stored](
+            std::vector<std::pair<std::filesystem::path, bool>> const& files)
+        -> std::optional<std::vector<ArtifactDigest>> {
+        std::vector<ArtifactDigest> digests(files.size());
+        std::vector<std::size_t> missing{};
+        std::vector<std::pair<std::filesystem::path, bool>> to_store{};
+        for (std::size_t i{}; i < files.size(); ++i) {
+            if (auto it = stored.find(files[i].first.string());
+                it != stored.end()) {
+                digests[i] = it->second;
+            }
+            else {
+                missing.emplace_back(i);
+                to_store.emplace_back(files[i]);
+            }
+        }
+        if (not to_store.empty()) {
+            auto new_digests = cas.StoreBlobs</*kOwner=*/true>(to_store);
+            if (not new_digests) {
+                return std::nullopt;
+            }
+            for (std::size_t k{}; k < missing.size(); ++k) {
+                digests[missing[k]] = std::move((*new_digests)[k]);
+            }
+        }
+        return digests;
     };
     auto store_tree =
         [&cas](std::string const& content) -> std::optional<ArtifactDigest> {
@@ -83,9 +226,30 @@ class BuildCleanupAnchor {
     };
     return ProtocolTraits::IsNative(storage.GetHashFunction().GetType())
                ? BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
-                     dir_path, store_blob, store_tree, store_symlink)
+                     dir_path, store_blobs, store_tree, store_symlink)
                : BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
-                     dir_path, store_blob, store_tree, store_symlink);
+                     dir_path, store_blobs, store_tree, store_symlink);
+}
+
+/// \brief Collect the regular files in a directory and all its
+/// subdirectories, with their paths formed like by BazelMsgFactory.
+[[nodiscard]] auto CollectFilesInTree(
+    std::filesystem::path const& dir,
+    gsl::not_null<std::vector<std::pair<std::filesystem::path, bool>>*> const&
+        files) noexcept -> bool {
+    return FileSystemManager::ReadDirectory(
+        dir,
+        [&dir, &files](auto const& name, ObjectType type) -> bool {
+            auto path = dir / name;
+            if (IsTreeObject(type)) {
+                return CollectFilesInTree(path, files);
+            }
+            if (IsFileObject(type)) {
+                files->emplace_back(std::move(path), IsExecutableObject(type));
+            }
+            return true;
+        },
+        /*allow_upwards=*/true);
 }
 
 }  // namespace
@@ -203,11 +367,37 @@ auto LocalAction::Run(ArtifactDigest const& action_id) const noexcept
     std::copy(cmdline_.begin(), cmdline_.end(), std::back_inserter(cmdline));
 
     SystemCommand system{"LocalExecution"};
-    auto const exit_code =
-        system.Execute(cmdline, env_vars_, build_root / cwd_, *exec_path);
-    if (exit_code.has_value()) {
+    auto const start = std::chrono::system_clock::now();
+    auto const run_result = system.Run(
+        cmdline, env_vars_, build_root / cwd_, *exec_path, timeout_);
+    auto const end = std::chrono::system_clock::now();
+    if (run_result.has_value()) {
         Output result{};
-        result.action.set_exit_code(*exit_code);
+        result.action.set_exit_code(run_result->exit_code);
+        auto usage = ResourceUsage::FromRusage(run_result->usage);
+        usage.spawn_time = run_result->spawn_time;
+        auto* metadata = result.action.mutable_execution_metadata();
+        SetTimestamp(metadata->mutable_execution_start_timestamp(), start);
+        SetTimestamp(metadata->mutable_execution_completed_timestamp(), end);
+        if (not usage.AddToExecutionMetadata(metadata)) {
+            logger_.Emit(LogLevel::Debug, "failed to record resource usage");
+        }
+        if (run_result->timed_out) {
+            logger_.Emit(LogLevel::Error,
+                         "action {} was killed after exceeding its timeout "
+                         "of {}s\n{}",
+                         action_id.hash(),
+                         ToSeconds(timeout_),
+                         usage.ToString());
+        }
+        else if ((end - start) * kSlowActionDivisor > timeout_) {
+            logger_.Emit(LogLevel::Warning,
+                         "action {} took {}s of its timeout of {}s\n{}",
+                         action_id.hash(),
+                         ToSeconds(end - start),
+                         ToSeconds(timeout_),
+                         usage.ToString());
+        }
         if (auto const digest = DigestFromOwnedFile(*exec_path / "stdout")) {
             *result.action.mutable_stdout_digest() =
                 ArtifactDigestFactory::ToBazel(*digest);
@@ -218,7 +408,8 @@ auto LocalAction::Run(ArtifactDigest const& action_id) const noexcept
         }
 
         if (CollectAndStoreOutputs(&result.action, build_root / cwd_)) {
-            if (cache_flag_ == CacheFlag::CacheOutput) {
+            if (cache_flag_ == CacheFlag::CacheOutput and
+                not run_result->timed_out) {
                 if (not local_context_.storage->ActionCache().StoreResult(
                         action_id, result.action)) {
                     logger_.Emit(LogLevel::Warning,
@@ -235,21 +426,23 @@ auto LocalAction::Run(ArtifactDigest const& action_id) const noexcept
 }
 
 auto LocalAction::StageInput(
+    int dir_fd,
     std::filesystem::path const& target_path,
     Artifact::ObjectInfo const& info,
     gsl::not_null<LocalAction::FileCopies*> copies) const noexcept -> bool {
     static std::string const kCopyFileName{"blob"};
 
-    if (IsTreeObject(info.type)) {
-        return FileSystemManager::CreateDirectory(target_path);
-    }
-
     std::optional<std::filesystem::path> blob_path{};
-
-    if (auto lookup = copies->find(info); lookup != copies->end()) {
-        blob_path = lookup->second->GetPath() / kCopyFileName;
+    try {
+        std::unique_lock lock{copies->mutex};
+        if (auto lookup = copies->dirs.find(info);
+            lookup != copies->dirs.end()) {
+            blob_path = lookup->second->GetPath() / kCopyFileName;
+        }
+    } catch (...) {
+        // fall back to CAS
     }
-    else {
+    if (not blob_path) {
         blob_path = local_context_.storage->CAS().BlobPath(
             info.digest, IsExecutableObject(info.type));
     }
@@ -261,6 +454,7 @@ auto LocalAction::StageInput(
         return false;
     }
 
+    auto const name = target_path.filename();
     if (info.type == ObjectType::Symlink) {
         auto to =
             FileSystemManager::ReadContentAtPath(*blob_path, ObjectType::File);
@@ -270,24 +464,28 @@ auto LocalAction::StageInput(
                          (*blob_path).string());
             return false;
         }
-        return FileSystemManager::CreateSymlink(*to, target_path);
+        if (::symlinkat(to->c_str(), dir_fd, name.c_str()) != 0) {
+            logger_.Emit(LogLevel::Error,
+                         "Failed to create symlink {} to {}: {}",
+                         nlohmann::json(target_path.string()).dump(),
+                         nlohmann::json(*to).dump(),
+                         std::strerror(errno));
+            return false;
+        }
+        return true;
     }
 
-    if (not FileSystemManager::CreateDirectory(target_path.parent_path())) {
-        return false;
-    }
-    auto res = FileSystemManager::CreateFileHardlink(
-        *blob_path, target_path, LogLevel::Debug);
-    if (res) {
+    if (::linkat(AT_FDCWD, blob_path->c_str(), dir_fd, name.c_str(), 0) ==
+        0) {
         return true;
     }
-    if (res.error() != std::errc::too_many_links) {
+    if (errno != EMLINK) {
         logger_.Emit(LogLevel::Warning,
                      "Failed to link {} to {}: {}, {}",
                      nlohmann::json(blob_path->string()).dump(),
                      nlohmann::json(target_path.string()).dump(),
-                     res.error().value(),
-                     res.error().message());
+                     errno,
+                     std::strerror(errno));
         return false;
     }
     TmpDirPtr new_copy_dir =
@@ -310,7 +508,8 @@ auto LocalAction::StageInput(
         return false;
     }
     try {
-        copies->insert_or_assign(info, new_copy_dir);
+        std::unique_lock lock{copies->mutex};
+        copies->dirs.insert_or_assign(info, new_copy_dir);
     } catch (std::exception const& e) {
         logger_.Emit(LogLevel::Warning,
                      "Failed to update temp-copies map (continuing anyway): {}",
@@ -325,18 +524,309 @@ auto LocalAction::StageInputs(
     if (FileSystemManager::IsRelativePath(exec_path)) {
         return false;
     }
+    if (not local_context_.exec_config->tree_cache) {
+        auto reader =
+            TreeReader<LocalCasReader>{&local_context_.storage->CAS()};
+        auto result = reader.RecursivelyReadTreeLeafs(
+            root_digest_, exec_path, /*include_trees=*/true);
+        return result and
+               StageLeafs(exec_path, *result, /*tree_links=*/{}, copies);
+    }
+
+    // Trees containing the working directory or outputs are staged file by
+    // file, as the action writes to them.
+    std::vector<std::filesystem::path> protected_paths{};
+    try {
+        auto const cwd = ToNormalPath(exec_path / cwd_);
+        protected_paths.emplace_back(cwd);
+        for (auto const& local_path : output_files_) {
+            protected_paths.emplace_back(
+                ToNormalPath(cwd / local_path).parent_path());
+        }
+        for (auto const& local_path : output_dirs_) {
+            protected_paths.emplace_back(ToNormalPath(cwd / local_path));
+        }
+    } catch (std::exception const& e) {
+        logger_.Emit(LogLevel::Error, "Failed to stage inputs:\n{}", e.what());
+        return false;
+    }
+    ReadTreeResult leafs{};
+    std::vector<TreeLink> tree_links{};
+    return CollectInputs(root_digest_,
+                         exec_path,
+                         protected_paths,
+                         &leafs,
+                         &tree_links) and
+           StageLeafs(exec_path, leafs, tree_links, copies);
+}
+
+auto LocalAction::StageLeafs(
+    std::filesystem::path const& root,
+    ReadTreeResult const& leafs,
+    std::vector<TreeLink> const& tree_links,
+    gsl::not_null<FileCopies*> copies) const noexcept -> bool {
+    // A batch of entries of the same parent directory
+    struct Batch {
+        std::filesystem::path const* dir;
+        std::vector<std::size_t> indices;
+    };
+
+    try {
+        // Collect all directories to create. Directories are ordered, so that
+        // parents are created before their children.
+        std::set<std::filesystem::path> dirs{};
+        std::map<std::filesystem::path, std::vector<std::size_t>> entries{};
+        auto const add_dir = [&dirs, &root](std::filesystem::path dir) {
+            while (dir.native().size() > root.native().size() and
+                   dirs.insert(dir).second) {
+                dir = dir.parent_path();
+            }
+        };
+        for (std::size_t i{}; i < leafs.paths.size(); ++i) {
+            auto const& path = leafs.paths[i];
+            if (IsTreeObject(leafs.infos[i].type)) {
+                add_dir(path);
+            }
+            else {
+                add_dir(path.parent_path());
+                entries[path.parent_path()].push_back(i);
+            }
+        }
+        for (auto const& tree_link : tree_links) {
+            add_dir(tree_link.link.parent_path());
+        }
+
+        for (auto const& dir : dirs) {
+            std::error_code ec{};
+            std::filesystem::create_directory(dir, ec);
+            if (ec) {
+                logger_.Emit(LogLevel::Error,
+                             "Failed to create directory {}: {}",
+                             nlohmann::json(dir.string()).dump(),
+                             ec.message());
+                return false;
+            }
+        }
+
+        for (auto const& tree_link : tree_links) {
+            if (not FileSystemManager::CreateSymlink(tree_link.tree,
+                                                     tree_link.link)) {
+                return false;
+            }
+        }
+
+        std::vector<Batch> batches{};
+        for (auto const& [dir, indices] : entries) {
+            for (std::size_t pos{}; pos < indices.size();
+                 pos += kStagingBatchSize) {
+                auto const end =
+                    std::min(indices.size(), pos + kStagingBatchSize);
+                batches.emplace_back(Batch{
+                    .dir = &dir,
+                    .indices = std::vector<std::size_t>(
+                        indices.begin() + static_cast<std::ptrdiff_t>(pos),
+                        indices.begin() + static_cast<std::ptrdiff_t>(end))});
+            }
+        }
+
+        std::atomic_bool failure{false};
+        auto const stage_batch = [this, &leafs, &copies, &failure](
+                                     Batch const& batch) noexcept {
+            if (failure) {
+                return;
+            }
+            int const dir_fd =
+                ::open(batch.dir->c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (dir_fd < 0) {
+                logger_.Emit(LogLevel::Error,
+                             "Failed to open directory {}: {}",
+                             nlohmann::json(batch.dir->string()).dump(),
+                             std::strerror(errno));
+                failure = true;
+                return;
+            }
+            for (auto const i : batch.indices) {
+                if (not StageInput(dir_fd,
+                                   leafs.paths[i],
+                                   leafs.infos[i],
+                                   copies)) {
+                    failure = true;
+                    break;
+                }
+            }
+            ::close(dir_fd);
+        };
+
+        if (leafs.paths.size() < kParallelStagingThreshold or
+            batches.size() < 2) {
+            for (auto const& batch : batches) {
+                stage_batch(batch);
+            }
+        }
+        else {
+            RunOnSharedPool(batches.size(),
+                            [&stage_batch, &batches](std::size_t i) noexcept {
+                                stage_batch(batches[i]);
+                            });
+        }
+        return not failure;
+    } catch (std::exception const& e) {
+        logger_.Emit(LogLevel::Error, "Failed to stage inputs:\n{}", e.what());
+        return false;
+    }
+}
+
+auto LocalAction::CollectInputs(
+    ArtifactDigest const& digest,
+    std::filesystem::path const& path,
+    std::vector<std::filesystem::path> const& protected_paths,
+    gsl::not_null<ReadTreeResult*> const& leafs,
+    gsl::not_null<std::vector<TreeLink>*> const& tree_links) const noexcept
+    -> bool {
     auto reader = TreeReader<LocalCasReader>{&local_context_.storage->CAS()};
-    auto result = reader.RecursivelyReadTreeLeafs(
-        root_digest_, exec_path, /*include_trees=*/true);
-    if (not result) {
+    auto entries = reader.ReadDirectTreeEntries(digest, path);
+    if (not entries) {
         return false;
     }
-    for (std::size_t i{}; i < result->paths.size(); ++i) {
-        if (not StageInput(result->paths.at(i), result->infos.at(i), copies)) {
-            return false;
+    try {
+        if (entries->paths.empty()) {
+            leafs->paths.emplace_back(path);
+            leafs->infos.emplace_back(Artifact::ObjectInfo{
+                .digest = digest, .type = ObjectType::Tree});
+            return true;
         }
+        for (std::size_t i{}; i < entries->paths.size(); ++i) {
+            auto const& entry_path = entries->paths[i];
+            auto const& info = entries->infos[i];
+            if (not IsTreeObject(info.type)) {
+                leafs->paths.emplace_back(entry_path);
+                leafs->infos.emplace_back(info);
+                continue;
+            }
+            if (std::any_of(protected_paths.begin(),
+                            protected_paths.end(),
+                            [&entry_path](auto const& protected_path) {
+                                return PathContains(entry_path, protected_path);
+                            })) {
+                if (not CollectInputs(info.digest,
+                                      entry_path,
+                                      protected_paths,
+                                      leafs,
+                                      tree_links)) {
+                    return false;
+                }
+                continue;
+            }
+            auto subtree = reader.RecursivelyReadTreeLeafs(
+                info.digest, entry_path, /*include_trees=*/true);
+            if (not subtree) {
+                return false;
+            }
+            if (subtree->paths.size() < kMinCachedTreeLeafs) {
+                std::move(subtree->paths.begin(),
+                          subtree->paths.end(),
+                          std::back_inserter(leafs->paths));
+                std::move(subtree->infos.begin(),
+                          subtree->infos.end(),
+                          std::back_inserter(leafs->infos));
+                continue;
+            }
+            // Without a materialised tree, the subtree is staged file by file.
+            auto tree = MaterialiseTree(info.digest);
+            if (not tree) {
+                std::move(subtree->paths.begin(),
+                          subtree->paths.end(),
+                          std::back_inserter(leafs->paths));
+                std::move(subtree->infos.begin(),
+                          subtree->infos.end(),
+                          std::back_inserter(leafs->infos));
+                continue;
+            }
+            tree_links->emplace_back(
+                TreeLink{.link = entry_path, .tree = *std::move(tree)});
+        }
+        return true;
+    } catch (std::exception const& e) {
+        logger_.Emit(
+            LogLevel::Error, "Failed to collect inputs:\n{}", e.what());
+        return false;
+    }
+}
+
+auto LocalAction::MaterialiseTree(ArtifactDigest const& digest) const noexcept
+    -> std::optional<std::filesystem::path> {
+    auto const trees_dir =
+        local_context_.storage_config->CreateGenerationConfig(0)
+            .materialised_trees;
+    auto tree_path = trees_dir / digest.hash();
+    if (FileSystemManager::IsDirectory(tree_path)) {
+        // Trees are only moved into place once read-only; anything else was
+        // not created by us and is not shared with actions.
+        std::error_code ec{};
+        auto const status = std::filesystem::status(tree_path, ec);
+        if (not ec and (status.permissions() &
+                        std::filesystem::perms::owner_write) ==
+                           std::filesystem::perms::none) {
+            return tree_path;
+        }
+        logger_.Emit(LogLevel::Warning,
+                     "Ignoring writable materialised tree {}",
+                     nlohmann::json(tree_path.string()).dump());
+        return std::nullopt;
+    }
+
+    // Materialise next to the final location, make the tree read-only, and
+    // move it into place, so that concurrent actions only ever see complete
+    // trees that no action can modify. Moving a directory within the same
+    // parent does not require write permission on it.
+    auto const staging_path = CreateUniquePath(tree_path);
+    if (not staging_path) {
+        logger_.Emit(LogLevel::Warning,
+                     "Failed to create a unique path to materialise tree {}",
+                     digest.hash());
+        return std::nullopt;
+    }
+    auto reader = TreeReader<LocalCasReader>{&local_context_.storage->CAS()};
+    auto leafs = reader.RecursivelyReadTreeLeafs(
+        digest, *staging_path, /*include_trees=*/true);
+    FileCopies copies{};
+    if (not leafs or not FileSystemManager::CreateDirectory(trees_dir) or
+        not FileSystemManager::CreateDirectory(*staging_path) or
+        not StageLeafs(*staging_path, *leafs, /*tree_links=*/{}, &copies) or
+        not FileSystemManager::SetDirectoriesWritable(*staging_path,
+                                                      /*writable=*/false)) {
+        logger_.Emit(
+            LogLevel::Warning, "Failed to materialise tree {}", digest.hash());
+        RemoveMaterialisedTree(*staging_path);
+        return std::nullopt;
+    }
+    if (::rename(staging_path->c_str(), tree_path.c_str()) != 0) {
+        auto const error = errno;
+        RemoveMaterialisedTree(*staging_path);
+        if ((error == EEXIST or error == ENOTEMPTY) and
+            FileSystemManager::IsDirectory(tree_path)) {
+            return tree_path;
+        }
+        logger_.Emit(LogLevel::Warning,
+                     "Failed to move materialised tree {} to {}: {}",
+                     digest.hash(),
+                     nlohmann::json(tree_path.string()).dump(),
+                     std::strerror(error));
+        return std::nullopt;
+    }
+    return tree_path;
+}
+
+void LocalAction::RemoveMaterialisedTree(
+    std::filesystem::path const& path) const noexcept {
+    if (FileSystemManager::IsDirectory(path) and
+        not(FileSystemManager::SetDirectoriesWritable(path,
+                                                      /*writable=*/true) and
+            FileSystemManager::RemoveDirectory(path, /*recursively=*/true))) {
+        logger_.Emit(LogLevel::Warning,
+                     "Failed to remove partially materialised tree {}",
+                     nlohmann::json(path.string()).dump());
     }
-    return true;
 }
 
 auto LocalAction::CreateDirectoryStructure(
@@ -385,10 +875,79 @@ auto LocalAction::CreateDirectoryStructure(
                        });
 }
 
+auto LocalAction::StoreOutputBlobs(std::filesystem::path const& exec_path)
+    const noexcept -> StoredBlobs {
+    StoredBlobs stored{};
+    try {
+        std::vector<std::pair<std::filesystem::path, bool>> files{};
+        for (auto const& local_path : output_files_) {
+            auto path = exec_path / local_path;
+            auto type = FileSystemManager::Type(path, /*allow_upwards=*/true);
+            if (type and IsFileObject(*type)) {
+                files.emplace_back(std::move(path), IsExecutableObject(*type));
+            }
+        }
+        for (auto const& local_path : output_dirs_) {
+            auto path = exec_path / local_path;
+            auto type = FileSystemManager::Type(path, /*allow_upwards=*/true);
+            if (type and IsTreeObject(*type) and
+                not CollectFilesInTree(path, &files)) {
+                return stored;
+            }
+        }
+        if (files.size() < kParallelCollectionThreshold) {
+            return stored;
+        }
+        // output files might be located in output directories as well
+        std::sort(files.begin(), files.end());
+        files.erase(std::unique(files.begin(),
+                                files.end(),
+                                [](auto const& lhs, auto const& rhs) {
+                                    return lhs.first == rhs.first;
+                                }),
+                    files.end());
+
+        // Store in batches of consecutive files; the resulting digests do
+        // not depend on the order of storing, as trees are only computed
+        // afterwards, when the outputs are collected.
+        std::vector<std::optional<ArtifactDigest>> digests(files.size());
+        auto const store_batch = [&cas = local_context_.storage->CAS(),
+                                  &files,
+                                  &digests](std::size_t begin,
+                                            std::size_t end) noexcept {
+            for (auto i = begin; i < end; ++i) {
+                digests[i] = cas.StoreBlob</*kOwner=*/true>(files[i].first,
+                                                             files[i].second);
+            }
+        };
+        RunOnSharedPool(
+            (files.size() + kCollectionBatchSize - 1) / kCollectionBatchSize,
+            [&store_batch, &files](std::size_t i) noexcept {
+                auto const pos = i * kCollectionBatchSize;
+                store_batch(pos,
+                            std::min(files.size(), pos + kCollectionBatchSize));
+            });
+
+        stored.reserve(files.size());
+        for (std::size_t i{}; i < files.size(); ++i) {
+            if (digests[i]) {
+                stored.emplace(files[i].first.string(), *std::move(digests[i]));
+            }
+        }
+    } catch (std::exception const& e) {
+        logger_.Emit(LogLevel::Debug,
+                     "Failed to store outputs in parallel:\n{}",
+                     e.what());
+        stored.clear();
+    }
+    return stored;
+}
+
 /// \brief We expect either a regular file, or a symlink.
 auto LocalAction::CollectOutputFileOrSymlink(
     std::filesystem::path const& exec_path,
-    std::string const& local_path) const noexcept
+    std::string const& local_path,
+    StoredBlobs const& stored) const noexcept
     -> std::optional<OutputFileOrSymlink> {
     auto file_path = exec_path / local_path;
     auto type = FileSystemManager::Type(file_path, /*allow_upwards=*/true);
@@ -416,8 +975,12 @@ auto LocalAction::CollectOutputFileOrSymlink(
     }
     else if (IsFileObject(*type)) {
         bool is_executable = IsExecutableObject(*type);
-        auto digest = local_context_.storage->CAS().StoreBlob</*kOwner=*/true>(
-            file_path, is_executable);
+        auto const it = stored.find(file_path.string());
+        auto digest =
+            it != stored.end()
+                ? std::optional{it->second}
+                : local_context_.storage->CAS().StoreBlob</*kOwner=*/true>(
+                      file_path, is_executable);
         if (digest) {
             auto out_file = bazel_re::OutputFile{};
             out_file.set_path(local_path);
@@ -436,7 +999,8 @@ auto LocalAction::CollectOutputFileOrSymlink(
 
 auto LocalAction::CollectOutputDirOrSymlink(
     std::filesystem::path const& exec_path,
-    std::string const& local_path) const noexcept
+    std::string const& local_path,
+    StoredBlobs const& stored) const noexcept
     -> std::optional<OutputDirOrSymlink> {
     auto dir_path = exec_path / local_path;
     auto type = FileSystemManager::Type(dir_path, /*allow_upwards=*/true);
@@ -464,7 +1028,7 @@ auto LocalAction::CollectOutputDirOrSymlink(
     }
     else if (IsTreeObject(*type)) {
         if (auto digest = CreateDigestFromLocalOwnedTree(
-                *local_context_.storage, dir_path)) {
+                *local_context_.storage, dir_path, stored)) {
             auto out_dir = bazel_re::OutputDirectory{};
             out_dir.set_path(local_path);
             (*out_dir.mutable_tree_digest()) =
@@ -486,9 +1050,10 @@ auto LocalAction::CollectAndStoreOutputs(
     bazel_re::ActionResult* result,
     std::filesystem::path const& exec_path) const noexcept -> bool {
     try {
+        auto const stored = StoreOutputBlobs(exec_path);
         logger_.Emit(LogLevel::Trace, "collecting outputs:");
         for (auto const& path : output_files_) {
-            auto out = CollectOutputFileOrSymlink(exec_path, path);
+            auto out = CollectOutputFileOrSymlink(exec_path, path, stored);
             if (not out) {
                 logger_.Emit(LogLevel::Error,
                              "could not collect output file or symlink {}",
@@ -512,7 +1077,7 @@ auto LocalAction::CollectAndStoreOutputs(
             }
         }
         for (auto const& path : output_dirs_) {
-            auto out = CollectOutputDirOrSymlink(exec_path, path);
+            auto out = CollectOutputDirOrSymlink(exec_path, path, stored);
             if (not out) {
                 logger_.Emit(LogLevel::Error,
                              "could not collect output dir or symlink {}",
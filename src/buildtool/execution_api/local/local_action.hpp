@@ -21,6 +21,7 @@
 #include <filesystem>
 #include <functional>  // IWYU pragma: keep
 #include <map>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -36,6 +37,7 @@
 #include "src/buildtool/execution_api/bazel_msg/bazel_msg_factory.hpp"
 #include "src/buildtool/execution_api/common/execution_action.hpp"
 #include "src/buildtool/execution_api/common/execution_response.hpp"
+#include "src/buildtool/execution_api/common/tree_reader.hpp"
 #include "src/buildtool/execution_api/local/context.hpp"
 #include "src/buildtool/logging/logger.hpp"
 #include "src/buildtool/storage/config.hpp"
@@ -56,7 +58,15 @@ class LocalAction final : public IExecutionAction {
     using OutputDirOrSymlink =
         std::variant<bazel_re::OutputDirectory, bazel_re::OutputSymlink>;
 
-    using FileCopies = std::unordered_map<Artifact::ObjectInfo, TmpDirPtr>;
+    /// \brief Copies of blobs that have too many hard links already, shared
+    /// by all staging tasks of an action.
+    struct FileCopies {
+        std::mutex mutex;
+        std::unordered_map<Artifact::ObjectInfo, TmpDirPtr> dirs;
+    };
+
+    /// \brief Digests of output files already stored in CAS, keyed by path.
+    using StoredBlobs = std::unordered_map<std::string, ArtifactDigest>;
 
     auto Execute(Logger const* logger) noexcept
         -> IExecutionResponse::Ptr final;
@@ -125,7 +135,11 @@ class LocalAction final : public IExecutionAction {
     [[nodiscard]] auto Run(ArtifactDigest const& action_id) const noexcept
         -> std::optional<Output>;
 
+    /// \brief Stage a file or symlink as entry of an existing directory.
+    /// \param dir_fd      Open file descriptor of the parent directory.
+    /// \param target_path Full path of the entry to create.
     [[nodiscard]] auto StageInput(
+        int dir_fd,
         std::filesystem::path const& target_path,
         Artifact::ObjectInfo const& info,
         gsl::not_null<FileCopies*> copies) const noexcept -> bool;
@@ -133,23 +147,75 @@ class LocalAction final : public IExecutionAction {
     /// \brief Stage input artifacts and leaf trees to the execution directory.
     /// Stage artifacts and their parent directory structure from CAS to the
     /// specified execution directory. The execution directory may no exist.
+    /// If the tree cache is enabled, large subtrees are staged as symlinks to
+    /// their materialised copy in the local build root.
     /// \param[in] exec_path Absolute path to the execution directory.
     /// \returns Success indicator.
     [[nodiscard]] auto StageInputs(
         std::filesystem::path const& exec_path,
         gsl::not_null<FileCopies*> copies) const noexcept -> bool;
 
+    /// \brief Symlink to be staged for a materialised tree.
+    struct TreeLink {
+        std::filesystem::path link;
+        std::filesystem::path tree;
+    };
+
+    /// \brief Stage leafs and links to materialised trees below a directory.
+    /// Every directory is created once, before any of its entries. Entries are
+    /// then linked in batches per parent directory, relative to an open file
+    /// descriptor of that directory; large inputs are staged in parallel, with
+    /// the help of a pool of threads shared by all local actions.
+    [[nodiscard]] auto StageLeafs(std::filesystem::path const& root,
+                                  ReadTreeResult const& leafs,
+                                  std::vector<TreeLink> const& tree_links,
+                                  gsl::not_null<FileCopies*> copies)
+        const noexcept -> bool;
+
+    /// \brief Collect the leafs of a tree to be staged at the given path.
+    /// Subtrees with many leafs are materialised in the tree cache and
+    /// collected as links instead, unless they contain a protected path.
+    [[nodiscard]] auto CollectInputs(
+        ArtifactDigest const& digest,
+        std::filesystem::path const& path,
+        std::vector<std::filesystem::path> const& protected_paths,
+        gsl::not_null<ReadTreeResult*> const& leafs,
+        gsl::not_null<std::vector<TreeLink>*> const& tree_links)
+        const noexcept -> bool;
+
+    /// \brief Get the materialised copy of a tree from the tree cache of the
+    /// youngest generation, materialising it first if needed. Materialised
+    /// trees are read-only, as they are shared by all actions.
+    /// \returns The path of the tree, or nullopt if the tree is not available
+    /// from the cache and has to be staged file by file.
+    [[nodiscard]] auto MaterialiseTree(ArtifactDigest const& digest)
+        const noexcept -> std::optional<std::filesystem::path>;
+
+    /// \brief Remove a read-only tree that could not be moved into the cache.
+    void RemoveMaterialisedTree(
+        std::filesystem::path const& path) const noexcept;
+
     [[nodiscard]] auto CreateDirectoryStructure(
         std::filesystem::path const& exec_path) const noexcept -> bool;
 
+    /// \brief Store the regular files among the outputs, including those in
+    /// output directories, in CAS ahead of collecting the outputs. Large
+    /// outputs are stored in parallel, with the help of the pool shared by all
+    /// local actions; small ones are left to the collection.
+    /// Files failing to be stored are omitted, to be reported when collected.
+    [[nodiscard]] auto StoreOutputBlobs(
+        std::filesystem::path const& exec_path) const noexcept -> StoredBlobs;
+
     [[nodiscard]] auto CollectOutputFileOrSymlink(
         std::filesystem::path const& exec_path,
-        std::string const& local_path) const noexcept
+        std::string const& local_path,
+        StoredBlobs const& stored) const noexcept
         -> std::optional<OutputFileOrSymlink>;
 
     [[nodiscard]] auto CollectOutputDirOrSymlink(
         std::filesystem::path const& exec_path,
-        std::string const& local_path) const noexcept
+        std::string const& local_path,
+        StoredBlobs const& stored) const noexcept
         -> std::optional<OutputDirOrSymlink>;
 
     [[nodiscard]] auto CollectAndStoreOutputs(
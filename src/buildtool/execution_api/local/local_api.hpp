@@ -188,29 +188,28 @@ class LocalApi final : public IExecutionApi {
                 return false;
             }
 
-            // Read artifact content (file or symlink).
-            auto const& content = FileSystemManager::ReadFile(*path);
-            if (not content) {
-                return false;
-            }
-
             // Regenerate digest since object infos read by
-            // storage_.ReadTreeInfos() will contain 0 as size.
-            ArtifactDigest digest =
+            // storage_.ReadTreeInfos() will contain 0 as size. The content is
+            // streamed from the CAS entry, not read into memory.
+            auto digest =
                 IsTreeObject(info.type)
-                    ? ArtifactDigestFactory::HashDataAs<ObjectType::Tree>(
-                          local_context_.storage_config->hash_function,
-                          *content)
-                    : ArtifactDigestFactory::HashDataAs<ObjectType::File>(
+                    ? ArtifactDigestFactory::HashFileAs<ObjectType::Tree>(
+                          local_context_.storage_config->hash_function, *path)
+                    : ArtifactDigestFactory::HashFileAs<ObjectType::File>(
                           local_context_.storage_config->hash_function,
-                          *content);
+                          *path);
+            if (not digest) {
+                return false;
+            }
 
             // Collect blob and upload to remote CAS if transfer size reached.
+            auto blob = ArtifactBlob::FromFile(*digest,
+                                               *path,
+                                               digest->size(),
+                                               IsExecutableObject(info.type));
             if (not UpdateContainerAndUpload<ArtifactDigest>(
                     &container,
-                    ArtifactBlob{std::move(digest),
-                                 *content,
-                                 IsExecutableObject(info.type)},
+                    std::move(blob),
                     /*exception_is_fatal=*/true,
                     [&api](ArtifactBlobContainer&& blobs) {
                         return api.Upload(std::move(blobs),
@@ -254,10 +253,27 @@ class LocalApi final : public IExecutionApi {
             range.begin(),
             range.end(),
             [&cas = local_context_.storage->CAS()](ArtifactBlob const& blob) {
-                auto const cas_digest =
-                    blob.digest.IsTree()
-                        ? cas.StoreTree(*blob.data)
-                        : cas.StoreBlob(*blob.data, blob.is_exec);
+                std::optional<ArtifactDigest> cas_digest{};
+                if (auto const& file = blob.GetFilePath()) {
+                    // Files already in CAS are not hashed again, as their
+                    // digests are typically taken from the file hash cache.
+                    bool const present =
+                        blob.digest.IsTree()
+                            ? cas.TreePath(blob.digest).has_value()
+                            : cas.BlobPath(blob.digest, blob.is_exec)
+                                  .has_value();
+                    if (present) {
+                        return true;
+                    }
+                    cas_digest = blob.digest.IsTree()
+                                     ? cas.StoreTree(*file)
+                                     : cas.StoreBlob(*file, blob.is_exec);
+                }
+                else if (auto const content = blob.ReadContent()) {
+                    cas_digest = blob.digest.IsTree()
+                                     ? cas.StoreTree(*content)
+                                     : cas.StoreBlob(*content, blob.is_exec);
+                }
                 return cas_digest and *cas_digest == blob.digest;
             });
     }
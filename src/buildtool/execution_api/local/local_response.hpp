@@ -99,6 +99,18 @@ class LocalResponse final : public IExecutionResponse {
             &dir_symlinks_);  // explicit type needed for expected
     }
 
+    auto ExecutionMetadata() const noexcept
+        -> std::optional<bazel_re::ExecutedActionMetadata> final {
+        try {
+            if (output_.action.has_execution_metadata()) {
+                return output_.action.execution_metadata();
+            }
+        } catch (...) {
+            // metadata is informative only
+        }
+        return std::nullopt;
+    }
+
   private:
     std::string action_id_;
     LocalAction::Output output_{};
@@ -176,8 +176,7 @@ namespace {
         blobs.reserve(container.Size());
         for (const auto& blob : container.Blobs()) {
             blobs.emplace_back(ArtifactDigestFactory::ToBazel(blob.digest),
-                               blob.data,
-                               blob.is_exec);
+                               blob);
         }
     } catch (...) {
         return std::nullopt;
@@ -287,9 +286,11 @@ auto BazelApi::CreateAction(
         for (std::size_t pos = 0; pos < blobs.size(); ++pos) {
             auto gpos = artifact_pos[count + pos];
             auto const& type = artifacts_info[gpos].type;
-            if (not FileSystemManager::WriteFileAs</*kSetEpochTime=*/true,
+            auto const content = blobs[pos].ReadContent();
+            if (content == nullptr or
+                not FileSystemManager::WriteFileAs</*kSetEpochTime=*/true,
                                                    /*kSetWritable=*/true>(
-                    *blobs[pos].data, output_paths[gpos], type)) {
+                    *content, output_paths[gpos], type)) {
                 Logger::Log(LogLevel::Warning,
                             "staging to output path {} failed.",
                             output_paths[gpos].string());
@@ -551,7 +552,9 @@ auto BazelApi::CreateAction(
     -> std::optional<std::string> {
     auto reader = network_->CreateReader();
     if (auto blob = reader.ReadSingleBlob(artifact_info.digest)) {
-        return *blob->data;
+        if (auto content = blob->ReadContent()) {
+            return *content;
+        }
     }
     return std::nullopt;
 }
@@ -588,7 +591,8 @@ auto BazelApi::CreateAction(
             targets->reserve(digests.size());
             for (auto blobs : reader.ReadIncrementally(digests)) {
                 for (auto const& blob : blobs) {
-                    targets->emplace_back(*blob.data);
+                    // blobs read from the network are kept in memory
+                    targets->emplace_back(*blob.ReadContent());
                 }
             }
         });
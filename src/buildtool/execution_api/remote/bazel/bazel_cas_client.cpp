@@ -37,6 +37,7 @@
 #include "src/buildtool/execution_api/common/message_limits.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/logging/log_level.hpp"
+#include "src/utils/cpp/deflate.hpp"
 #include "src/utils/cpp/transformed_range.hpp"
 
 namespace {
@@ -172,17 +173,75 @@ namespace {
     return supported;
 }
 
+// Compressed byte-stream transfers are supported if the remote lists the
+// compressor in its cache capabilities.
+[[nodiscard]] auto CompressionSupport(
+    std::string const& instance_name,
+    std::unique_ptr<bazel_re::Capabilities::Stub> const& stub) noexcept
+    -> bool {
+    grpc::ClientContext context{};
+    bazel_re::GetCapabilitiesRequest request{};
+    bazel_re::ServerCapabilities response{};
+    request.set_instance_name(instance_name);
+    grpc::Status status = stub->GetCapabilities(&context, request, &response);
+    if (not status.ok()) {
+        return false;
+    }
+    auto const& compressors =
+        response.cache_capabilities().supported_compressors();
+    return std::find(compressors.begin(),
+                     compressors.end(),
+                     bazel_re::Compressor_Value_DEFLATE) != compressors.end();
+}
+
+// Cached version of compression support request. As the capabilities differ
+// between endpoints, the cache is keyed by address and instance name.
+[[nodiscard]] auto CompressionSupportCached(
+    std::string const& address,
+    std::string const& instance_name,
+    std::unique_ptr<bazel_re::Capabilities::Stub> const& stub,
+    Logger const* logger) noexcept -> bool {
+    static auto mutex = std::shared_mutex{};
+    static auto compression_support_map =
+        std::unordered_map<std::string, bool>{};
+    auto const key = fmt::format("{}/{}", address, instance_name);
+    {
+        auto lock = std::shared_lock(mutex);
+        if (compression_support_map.contains(key)) {
+            return compression_support_map[key];
+        }
+    }
+    auto supported = ::CompressionSupport(instance_name, stub);
+    logger->Emit(LogLevel::Debug,
+                 "Compression support for \"{}\": {}",
+                 key,
+                 supported);
+    auto lock = std::unique_lock(mutex);
+    compression_support_map[key] = supported;
+    return supported;
+}
+
 }  // namespace
 
 BazelCasClient::BazelCasClient(
     std::string const& server,
     Port port,
     gsl::not_null<Auth const*> const& auth,
-    gsl::not_null<RetryConfig const*> const& retry_config) noexcept
-    : stream_{std::make_unique<ByteStreamClient>(server, port, auth)},
+    gsl::not_null<RetryConfig const*> const& retry_config,
+    std::optional<int> compression_level) noexcept
+    : stream_{std::make_unique<ByteStreamClient>(
+          server,
+          port,
+          auth,
+          compression_level.value_or(DeflateCompressor::kDefaultLevel))},
       retry_config_{*retry_config} {
     stub_ = bazel_re::ContentAddressableStorage::NewStub(
         CreateChannelWithCredentials(server, port, auth));
+    if (compression_level) {
+        capabilities_ = bazel_re::Capabilities::NewStub(
+            CreateChannelWithCredentials(server, port, auth));
+        address_ = server + ':' + std::to_string(port);
+    }
 }
 
 auto BazelCasClient::FindMissingBlobs(
@@ -321,9 +380,19 @@ auto BazelCasClient::UpdateSingleBlob(std::string const& instance_name,
         }
         uuid = CreateUUIDVersion4(*id);
     }
+    auto reader = blob.ReadIncrementally(ByteStreamUtils::kChunkSize);
+    if (not reader) {
+        logger_.Emit(LogLevel::Error,
+                     "Failed to read {}:{}:\n{}",
+                     blob.digest.hash(),
+                     blob.digest.size_bytes(),
+                     reader.error());
+        return false;
+    }
     auto ok = stream_->Write(
-        ByteStreamUtils::WriteRequest{instance_name, uuid, blob.digest},
-        *blob.data);
+        ByteStreamUtils::WriteRequest{
+            instance_name, uuid, blob.digest, GetCompressor(instance_name)},
+        *std::move(reader));
     if (not ok) {
         logger_.Emit(LogLevel::Error,
                      "Failed to write {}:{}",
@@ -336,15 +405,15 @@ auto BazelCasClient::UpdateSingleBlob(std::string const& instance_name,
 auto BazelCasClient::IncrementalReadSingleBlob(std::string const& instance_name,
                                                bazel_re::Digest const& digest)
     const noexcept -> ByteStreamClient::IncrementalReader {
-    return stream_->IncrementalRead(
-        ByteStreamUtils::ReadRequest{instance_name, digest});
+    return stream_->IncrementalRead(ByteStreamUtils::ReadRequest{
+        instance_name, digest, GetCompressor(instance_name)});
 }
 
 auto BazelCasClient::ReadSingleBlob(
     std::string const& instance_name,
     bazel_re::Digest const& digest) const noexcept -> std::optional<BazelBlob> {
-    if (auto data = stream_->Read(
-            ByteStreamUtils::ReadRequest{instance_name, digest})) {
+    if (auto data = stream_->Read(ByteStreamUtils::ReadRequest{
+            instance_name, digest, GetCompressor(instance_name)})) {
         return BazelBlob{digest, std::move(*data), /*is_exec=*/false};
     }
     return std::nullopt;
@@ -426,6 +495,16 @@ auto BazelCasClient::BlobSpliceSupport(
         hash_function, instance_name, stub_, &logger_);
 }
 
+auto BazelCasClient::GetCompressor(std::string const& instance_name)
+    const noexcept -> ByteStreamUtils::Compressor {
+    if (capabilities_ and
+        ::CompressionSupportCached(
+            address_, instance_name, capabilities_, &logger_)) {
+        return ByteStreamUtils::Compressor::Deflate;
+    }
+    return ByteStreamUtils::Compressor::Identity;
+}
+
 template <class TForwardIter>
 auto BazelCasClient::FindMissingBlobs(std::string const& instance_name,
                                       TForwardIter const& start,
@@ -504,10 +583,19 @@ auto BazelCasClient::BatchUpdateBlobs(
                 begin,
                 end,
                 "BatchUpdateBlobs",
-                [](bazel_re::BatchUpdateBlobsRequest* request,
-                   BazelBlob const* x) {
-                    *(request->add_requests()) =
+                [this](bazel_re::BatchUpdateBlobsRequest* request,
+                       BazelBlob const* x) {
+                    auto single_request =
                         BazelCasClient::CreateUpdateBlobsSingleRequest(*x);
+                    if (not single_request) {
+                        // the blob is not uploaded, so that the number of
+                        // uploaded digests reports the failure
+                        logger_.Emit(LogLevel::Warning,
+                                     "Failed to read content of {}",
+                                     x->digest.hash());
+                        return;
+                    }
+                    *(request->add_requests()) = *std::move(single_request);
                 });
         result.reserve(std::distance(begin, end));
         auto batch_update_blobs =
@@ -691,10 +779,14 @@ auto BazelCasClient::CreateBatchRequestsMaxSize(
 }
 
 auto BazelCasClient::CreateUpdateBlobsSingleRequest(BazelBlob const& b) noexcept
-    -> bazel_re::BatchUpdateBlobsRequest_Request {
+    -> std::optional<bazel_re::BatchUpdateBlobsRequest_Request> {
+    auto content = b.ReadContent();
+    if (content == nullptr) {
+        return std::nullopt;
+    }
     bazel_re::BatchUpdateBlobsRequest_Request r{};
     (*r.mutable_digest()) = b.digest;
-    r.set_data(*b.data);
+    r.set_data(*content);
     return r;
 }
 
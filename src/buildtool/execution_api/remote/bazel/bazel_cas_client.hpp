@@ -41,11 +41,14 @@
 /// https://github.com/bazelbuild/remote-apis/blob/e1fe21be4c9ae76269a5a63215bb3c72ed9ab3f0/build/bazel/remote/execution/v2/remote_execution.proto#L317
 class BazelCasClient {
   public:
+    /// \param compression_level   If set, byte-stream transfers are
+    /// compressed at the given level, provided the remote supports it.
     explicit BazelCasClient(
         std::string const& server,
         Port port,
         gsl::not_null<Auth const*> const& auth,
-        gsl::not_null<RetryConfig const*> const& retry_config) noexcept;
+        gsl::not_null<RetryConfig const*> const& retry_config,
+        std::optional<int> compression_level = std::nullopt) noexcept;
 
     /// \brief Find missing blobs
     /// \param[in] instance_name Name of the CAS instance
@@ -156,8 +159,16 @@ class BazelCasClient {
     std::unique_ptr<ByteStreamClient> stream_;
     RetryConfig const& retry_config_;
     std::unique_ptr<bazel_re::ContentAddressableStorage::Stub> stub_;
+    // Only set if compression is requested.
+    std::unique_ptr<bazel_re::Capabilities::Stub> capabilities_;
+    std::string address_;
     Logger logger_{"RemoteCasClient"};
 
+    /// \brief Compressor to use for byte-stream transfers, which is the
+    /// identity unless compression is requested and supported by the remote.
+    [[nodiscard]] auto GetCompressor(std::string const& instance_name)
+        const noexcept -> ByteStreamUtils::Compressor;
+
     template <class TOutputIter>
     [[nodiscard]] auto FindMissingBlobs(std::string const& instance_name,
                                         TOutputIter const& start,
@@ -174,9 +185,11 @@ class BazelCasClient {
                            typename TForwardIter::value_type const&)> const&
             request_builder) const noexcept -> std::vector<TRequest>;
 
+    /// \brief Create request for uploading a single blob in batch.
+    /// \returns The request or std::nullopt if the content cannot be read.
     [[nodiscard]] static auto CreateUpdateBlobsSingleRequest(
         BazelBlob const& b) noexcept
-        -> bazel_re::BatchUpdateBlobsRequest_Request;
+        -> std::optional<bazel_re::BatchUpdateBlobsRequest_Request>;
 
     [[nodiscard]] static auto CreateGetTreeRequest(
         std::string const& instance_name,
@@ -33,7 +33,11 @@ BazelNetwork::BazelNetwork(
     ExecutionConfiguration const& exec_config,
     gsl::not_null<HashFunction const*> const& hash_function) noexcept
     : instance_name_{std::move(instance_name)},
-      cas_{std::make_unique<BazelCasClient>(host, port, auth, retry_config)},
+      cas_{std::make_unique<BazelCasClient>(host,
+                                            port,
+                                            auth,
+                                            retry_config,
+                                            exec_config.compression_level)},
       ac_{std::make_unique<BazelAcClient>(host, port, auth, retry_config)},
       exec_{std::make_unique<BazelExecutionClient>(host,
                                                    port,
@@ -95,7 +99,7 @@ auto BazelNetwork::DoUploadBlobs(TIter const& first,
 
         auto it = std::stable_partition(
             sorted.begin(), sorted.end(), [](BazelBlob const* x) {
-                return x->data->size() <= kMaxBatchTransferSize;
+                return x->GetContentSize() <= kMaxBatchTransferSize;
             });
         auto digests_count =
             cas_->BatchUpdateBlobs(instance_name_, sorted.begin(), it);
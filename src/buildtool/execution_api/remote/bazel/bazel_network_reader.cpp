@@ -68,7 +68,7 @@ auto BazelNetworkReader::ReadDirectory(ArtifactDigest const& digest)
 
     if (auto blob = ReadSingleBlob(digest)) {
         return BazelMsgFactory::MessageFromString<bazel_re::Directory>(
-            *blob->data);
+            *blob->ReadContent());
     }
     Logger::Log(
         LogLevel::Debug, "Directory {} not found in CAS", digest.hash());
@@ -95,7 +95,7 @@ auto BazelNetworkReader::ReadGitTree(ArtifactDigest const& digest)
             }
             bool valid = std::all_of(
                 blobs.begin(), blobs.end(), [](ArtifactBlob const& blob) {
-                    return PathIsNonUpwards(*blob.data);
+                    return PathIsNonUpwards(*blob.ReadContent());
                 });
             if (not valid) {
                 return false;
@@ -105,9 +105,9 @@ auto BazelNetworkReader::ReadGitTree(ArtifactDigest const& digest)
         return true;
     };
 
-    std::string const& content = *read_blob->data;
-    return GitRepo::ReadTreeData(content,
-                                 hash_function_.HashTreeData(content).Bytes(),
+    auto const content = read_blob->ReadContent();
+    return GitRepo::ReadTreeData(*content,
+                                 hash_function_.HashTreeData(*content).Bytes(),
                                  check_symlinks,
                                  /*is_hex_id=*/false);
 }
@@ -123,7 +123,7 @@ auto BazelNetworkReader::DumpRawTree(Artifact::ObjectInfo const& info,
     }
 
     try {
-        return std::invoke(dumper, *read_blob->data);
+        return std::invoke(dumper, *read_blob->ReadContent());
     } catch (...) {
         return false;
     }
@@ -182,9 +182,7 @@ auto BazelNetworkReader::ReadSingleBlob(bazel_re::Digest const& digest)
         return std::nullopt;
     }
     return ArtifactBlob{
-        ArtifactDigest{*std::move(hash_info), blob->data->size()},
-        blob->data,
-        blob->is_exec};
+        ArtifactDigest{*std::move(hash_info), blob->GetContentSize()}, *blob};
 }
 
 auto BazelNetworkReader::ReadSingleBlob(ArtifactDigest const& digest)
@@ -222,9 +220,8 @@ auto BazelNetworkReader::BatchReadBlobs(
     for (auto const& blob : result) {
         if (auto hash_info = Validate(blob)) {
             artifacts.emplace_back(
-                ArtifactDigest{*std::move(hash_info), blob.data->size()},
-                blob.data,
-                blob.is_exec);
+                ArtifactDigest{*std::move(hash_info), blob.GetContentSize()},
+                blob);
         }
     }
     return artifacts;
@@ -242,9 +239,9 @@ auto BazelNetworkReader::Validate(BazelBlob const& blob) const noexcept
         return std::nullopt;
     }
 
-    // rehash data
+    // rehash data; blobs read from the network are kept in memory
     auto rehashed_info = HashInfo::HashData(
-        hash_function_, *blob.data, requested_hash_info->IsTree());
+        hash_function_, *blob.ReadContent(), requested_hash_info->IsTree());
 
     // ensure rehashed data produce the same hash
     if (*requested_hash_info != rehashed_info) {
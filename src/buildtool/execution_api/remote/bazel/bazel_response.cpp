@@ -67,7 +67,9 @@ auto BazelResponse::ReadStringBlob(bazel_re::Digest const& id) noexcept
     -> std::string {
     auto reader = network_->CreateReader();
     if (auto blob = reader.ReadSingleBlob(id)) {
-        return *blob->data;
+        if (auto content = blob->ReadContent()) {
+            return *content;
+        }
     }
     Logger::Log(LogLevel::Warning,
                 "reading digest {} from action response failed",
@@ -234,8 +236,9 @@ auto BazelResponse::Populate() noexcept -> std::optional<std::string> {
     for (auto tree_blobs : reader.ReadIncrementally(tree_digests)) {
         for (auto const& tree_blob : tree_blobs) {
             try {
+                // blobs read from the network are kept in memory
                 auto tree = BazelMsgFactory::MessageFromString<bazel_re::Tree>(
-                    *tree_blob.data);
+                    *tree_blob.ReadContent());
                 if (not tree) {
                     return fmt::format(
                         "BazelResponse: failed to create Tree for {}",
@@ -68,6 +68,18 @@ class BazelResponse final : public IExecutionResponse {
     auto DirectorySymlinks() noexcept
         -> expected<gsl::not_null<DirSymlinks const*>, std::string> final;
 
+    auto ExecutionMetadata() const noexcept
+        -> std::optional<bazel_re::ExecutedActionMetadata> final {
+        try {
+            if (output_.action_result.has_execution_metadata()) {
+                return output_.action_result.execution_metadata();
+            }
+        } catch (...) {
+            // metadata is informative only
+        }
+        return std::nullopt;
+    }
+
   private:
     std::string action_id_;
     std::shared_ptr<BazelNetwork> const network_;
@@ -34,6 +34,8 @@
 #include "src/buildtool/execution_api/common/bytestream_utils.hpp"
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
+#include "src/utils/cpp/chunked_reader.hpp"
+#include "src/utils/cpp/deflate.hpp"
 
 /// Implements client side for google.bytestream.ByteStream service.
 class ByteStreamClient {
@@ -42,12 +44,32 @@ class ByteStreamClient {
         friend class ByteStreamClient;
 
       public:
-        /// \brief Read next chunk of data.
+        /// \brief Read next chunk of data. Compressed data is decompressed.
         /// \returns empty string if stream finished and std::nullopt on error.
         [[nodiscard]] auto Next() -> std::optional<std::string> {
+            if (not reader_) {
+                return std::nullopt;
+            }
             google::bytestream::ReadResponse response{};
-            if (reader_->Read(&response)) {
-                return std::move(*response.mutable_data());
+            while (reader_->Read(&response)) {
+                if (not decompressor_) {
+                    return std::move(*response.mutable_data());
+                }
+                std::string output{};
+                if (auto error = decompressor_->Decompress(
+                        response.data(), [&output](std::string const& chunk) {
+                            output.append(chunk);
+                            return true;
+                        })) {
+                    logger_->Emit(LogLevel::Debug,
+                                  "Failed to decompress read data: {}",
+                                  *error);
+                    ctx_.TryCancel();
+                    return std::nullopt;
+                }
+                if (not output.empty()) {
+                    return output;
+                }
             }
 
             if (not finished_) {
@@ -59,6 +81,11 @@ class ByteStreamClient {
                                   status.error_message());
                     return std::nullopt;
                 }
+                if (decompressor_ and not decompressor_->IsFinished()) {
+                    logger_->Emit(LogLevel::Debug,
+                                  "Compressed read data is truncated");
+                    return std::nullopt;
+                }
                 finished_ = true;
             }
             return std::string{};
@@ -69,6 +96,7 @@ class ByteStreamClient {
         grpc::ClientContext ctx_;
         std::unique_ptr<grpc::ClientReader<google::bytestream::ReadResponse>>
             reader_;
+        std::optional<DeflateDecompressor> decompressor_;
         bool finished_{false};
 
         IncrementalReader(
@@ -76,15 +104,27 @@ class ByteStreamClient {
             ByteStreamUtils::ReadRequest&& read_request,
             Logger const* logger)
             : logger_{logger} {
+            if (read_request.GetCompressor() !=
+                ByteStreamUtils::Compressor::Identity) {
+                auto decompressor = DeflateDecompressor::Create();
+                if (not decompressor) {
+                    logger_->Emit(LogLevel::Debug, "{}", decompressor.error());
+                    return;
+                }
+                decompressor_.emplace(*std::move(decompressor));
+            }
             google::bytestream::ReadRequest request{};
             request.set_resource_name(std::move(read_request).ToString());
             reader_ = stub->Read(&ctx_, request);
         }
     };
 
-    explicit ByteStreamClient(std::string const& server,
-                              Port port,
-                              gsl::not_null<Auth const*> const& auth) noexcept {
+    explicit ByteStreamClient(
+        std::string const& server,
+        Port port,
+        gsl::not_null<Auth const*> const& auth,
+        int compression_level = DeflateCompressor::kDefaultLevel) noexcept
+        : compression_level_{compression_level} {
         stub_ = google::bytestream::ByteStream::NewStub(
             CreateChannelWithCredentials(server, port, auth));
     }
@@ -109,68 +149,87 @@ class ByteStreamClient {
         return output;
     }
 
+    /// \brief Write content in memory. The content is shared, not copied.
+    [[nodiscard]] auto Write(
+        ByteStreamUtils::WriteRequest&& write_request,
+        gsl::not_null<std::shared_ptr<std::string const>> const& data)
+        const noexcept -> bool {
+        try {
+            auto reader =
+                ChunkedReader::FromMemory(ByteStreamUtils::kChunkSize, data);
+            if (not reader) {
+                logger_.Emit(LogLevel::Warning, "{}", reader.error());
+                return false;
+            }
+            return Write(std::move(write_request), *std::move(reader));
+        } catch (...) {
+            logger_.Emit(LogLevel::Warning, "Caught exception in Write");
+            return false;
+        }
+    }
+
+    /// \brief Write content chunk by chunk, as provided by the reader. Only a
+    /// single chunk is in memory at a time, if the reader is backed by a file.
+    /// If the stream breaks, the write is resumed in a new stream from the
+    /// size committed by the server, as reported by QueryWriteStatus.
+    /// Compressed writes are restarted from the beginning instead.
     [[nodiscard]] auto Write(ByteStreamUtils::WriteRequest&& write_request,
-                             std::string const& data) const noexcept -> bool {
+                             ChunkedReader reader) const noexcept -> bool {
         try {
-            grpc::ClientContext ctx;
-            google::bytestream::WriteResponse response{};
-            auto writer = stub_->Write(&ctx, &response);
-
-            google::bytestream::WriteRequest request{};
-            request.set_resource_name(std::move(write_request).ToString());
-            request.mutable_data()->resize(ByteStreamUtils::kChunkSize, '\0');
-
-            std::size_t pos = 0;
-            do {  // NOLINT(cppcoreguidelines-avoid-do-while)
-                auto const size =
-                    std::min(data.size() - pos, ByteStreamUtils::kChunkSize);
-                request.mutable_data()->resize(size);
-                data.copy(request.mutable_data()->data(), size, pos);
-                request.set_write_offset(static_cast<int>(pos));
-                request.set_finish_write(pos + size >= data.size());
-                if (not writer->Write(request)) {
-                    // According to the docs, quote:
-                    // If there is an error or the connection is broken during
-                    // the `Write()`, the client should check the status of the
-                    // `Write()` by calling `QueryWriteStatus()` and continue
-                    // writing from the returned `committed_size`.
-                    auto const committed_size =
-                        QueryWriteStatus(request.resource_name());
-                    if (committed_size <= 0) {
-                        logger_.Emit(
-                            LogLevel::Warning,
-                            "broken stream for upload to resource name {}",
-                            request.resource_name());
+            bool const compress = write_request.GetCompressor() !=
+                                  ByteStreamUtils::Compressor::Identity;
+            auto const resource_name = std::move(write_request).ToString();
+            auto const size = reader.GetContentSize();
+            std::size_t offset = 0;
+            for (std::size_t attempt = 0;; ++attempt) {
+                auto const result =
+                    WriteFrom(resource_name, &reader, offset, compress);
+                if (result.committed_size) {
+                    if (*result.committed_size != size) {
+                        logger_.Emit(LogLevel::Warning,
+                                     "Commited size {} is different from the "
+                                     "original one {}.",
+                                     *result.committed_size,
+                                     size);
                         return false;
                     }
-                    pos = gsl::narrow<std::size_t>(committed_size);
+                    return true;
                 }
-                else {
-                    pos += ByteStreamUtils::kChunkSize;
+                if (not result.resumable or attempt >= kMaxResumeAttempts) {
+                    return false;
+                }
+                if (compress) {
+                    // The committed size of a compressed upload does not map
+                    // to an offset in the content, so start over.
+                    logger_.Emit(LogLevel::Debug,
+                                 "restarting compressed upload to resource "
+                                 "name {}",
+                                 resource_name);
+                    continue;
                 }
-            } while (pos < data.size());
-            if (not writer->WritesDone()) {
-                logger_.Emit(LogLevel::Warning,
-                             "broken stream for upload to resource name {}",
-                             request.resource_name());
-                return false;
-            }
 
-            auto status = writer->Finish();
-            if (not status.ok()) {
-                LogStatus(&logger_, LogLevel::Debug, status);
-                return false;
-            }
-            if (gsl::narrow<std::size_t>(response.committed_size()) !=
-                data.size()) {
-                logger_.Emit(
-                    LogLevel::Warning,
-                    "Commited size {} is different from the original one {}.",
-                    response.committed_size(),
-                    data.size());
-                return false;
+                // According to the docs, quote:
+                // If there is an error or the connection is broken during the
+                // `Write()`, the client should check the status of the
+                // `Write()` by calling `QueryWriteStatus()` and continue
+                // writing from the returned `committed_size`.
+                auto const status = QueryWriteStatus(resource_name);
+                if (not status) {
+                    // nothing committed, start over
+                    offset = 0;
+                }
+                else if (status->complete()) {
+                    return gsl::narrow<std::size_t>(status->committed_size()) ==
+                           size;
+                }
+                else {
+                    offset = gsl::narrow<std::size_t>(status->committed_size());
+                }
+                logger_.Emit(LogLevel::Debug,
+                             "resuming upload to resource name {} at {}",
+                             resource_name,
+                             offset);
             }
-            return true;
         } catch (...) {
             logger_.Emit(LogLevel::Warning, "Caught exception in Write");
             return false;
@@ -178,17 +237,140 @@ class ByteStreamClient {
     }
 
   private:
+    // Number of times an upload is resumed after the stream broke.
+    static constexpr std::size_t kMaxResumeAttempts = 3;
+
     std::unique_ptr<google::bytestream::ByteStream::Stub> stub_;
+    int compression_level_;
     Logger logger_{"ByteStreamClient"};
 
-    [[nodiscard]] auto QueryWriteStatus(
-        std::string const& resource_name) const noexcept -> std::int64_t {
+    struct WriteResult {
+        // committed size, if the stream finished successfully
+        std::optional<std::size_t> committed_size;
+        // whether the stream broke such that it can be resumed
+        bool resumable = false;
+    };
+
+    /// \brief Write content starting at the given offset in a single stream.
+    /// If requested, the content is compressed, in which case the offsets
+    /// sent refer to the compressed data.
+    [[nodiscard]] auto WriteFrom(std::string const& resource_name,
+                                 gsl::not_null<ChunkedReader*> const& reader,
+                                 std::size_t offset,
+                                 bool compress) const -> WriteResult {
+        std::optional<DeflateCompressor> compressor{};
+        if (compress) {
+            auto created = DeflateCompressor::Create(compression_level_);
+            if (not created) {
+                logger_.Emit(LogLevel::Warning, "{}", created.error());
+                return WriteResult{};
+            }
+            compressor.emplace(*std::move(created));
+        }
+
+        grpc::ClientContext ctx;
+        google::bytestream::WriteResponse response{};
+        auto writer = stub_->Write(&ctx, &response);
+
+        google::bytestream::WriteRequest request{};
+        request.set_resource_name(resource_name);
+        request.mutable_data()->reserve(ByteStreamUtils::kChunkSize);
+
+        auto const size = reader->GetContentSize();
+        std::size_t pos = offset;
+        std::size_t compressed_pos = 0;
+        do {  // NOLINT(cppcoreguidelines-avoid-do-while)
+            auto chunk = reader->ReadChunk(pos);
+            if (not chunk) {
+                logger_.Emit(LogLevel::Warning,
+                             "Failed to read content for upload to resource "
+                             "name {}:\n{}",
+                             resource_name,
+                             chunk.error());
+                return WriteResult{};
+            }
+            bool const last = pos + chunk->size() >= size;
+            if (compressor) {
+                auto data = compressor->Compress(*chunk, last);
+                if (not data) {
+                    logger_.Emit(LogLevel::Warning,
+                                 "Failed to compress content for upload to "
+                                 "resource name {}:\n{}",
+                                 resource_name,
+                                 data.error());
+                    return WriteResult{};
+                }
+                if (data->empty() and not last) {
+                    pos += chunk->size();
+                    continue;
+                }
+                *request.mutable_data() = *std::move(data);
+                request.set_write_offset(
+                    gsl::narrow<std::int64_t>(compressed_pos));
+                compressed_pos += request.data().size();
+            }
+            else {
+                request.mutable_data()->assign(chunk->data(), chunk->size());
+                request.set_write_offset(gsl::narrow<std::int64_t>(pos));
+            }
+            request.set_finish_write(last);
+            if (not writer->Write(request)) {
+                break;
+            }
+            pos += chunk->size();
+        } while (pos < size);
+
+        bool const written = pos >= size and writer->WritesDone();
+        auto status = writer->Finish();
+        if (not status.ok()) {
+            LogStatus(&logger_, LogLevel::Debug, status);
+            return WriteResult{.resumable = IsResumable(status.error_code())};
+        }
+        if (not written) {
+            logger_.Emit(LogLevel::Warning,
+                         "broken stream for upload to resource name {}",
+                         resource_name);
+            return WriteResult{.resumable = true};
+        }
+        if (compressor) {
+            // The committed size of a compressed upload is the size of the
+            // compressed data, or -1 if the blob was already present.
+            auto const committed = response.committed_size();
+            if (committed != -1 and
+                committed != gsl::narrow<std::int64_t>(compressed_pos)) {
+                logger_.Emit(LogLevel::Warning,
+                             "Committed size {} is different from the "
+                             "compressed size {}.",
+                             committed,
+                             compressed_pos);
+                return WriteResult{};
+            }
+            return WriteResult{.committed_size = size};
+        }
+        return WriteResult{.committed_size = gsl::narrow<std::size_t>(
+                               response.committed_size())};
+    }
+
+    [[nodiscard]] static auto IsResumable(grpc::StatusCode code) noexcept
+        -> bool {
+        return code == grpc::StatusCode::UNAVAILABLE or
+               code == grpc::StatusCode::DEADLINE_EXCEEDED or
+               code == grpc::StatusCode::ABORTED;
+    }
+
+    [[nodiscard]] auto QueryWriteStatus(std::string const& resource_name)
+        const noexcept
+        -> std::optional<google::bytestream::QueryWriteStatusResponse> {
         grpc::ClientContext ctx;
         google::bytestream::QueryWriteStatusRequest request{};
         request.set_resource_name(resource_name);
         google::bytestream::QueryWriteStatusResponse response{};
-        stub_->QueryWriteStatus(&ctx, request, &response);
-        return response.committed_size();
+        auto status = stub_->QueryWriteStatus(&ctx, request, &response);
+        if (not status.ok()) {
+            LogStatus(&logger_, LogLevel::Debug, status);
+            return std::nullopt;
+        }
+        return response;
     }
 };
 
@@ -101,5 +101,6 @@ auto RemoteExecutionConfig::Builder::Build() const noexcept
         .remote_address = std::move(remote_address),
         .dispatch = std::move(dispatch),
         .cache_address = std::move(cache_address),
-        .platform_properties = std::move(platform_properties)};
+        .platform_properties = std::move(platform_properties),
+        .compression_level = compression_level_};
 }
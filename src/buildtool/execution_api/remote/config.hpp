@@ -38,6 +38,10 @@ struct RemoteExecutionConfig final {
 
     // Platform properties for execution.
     ExecutionProperties const platform_properties;
+
+    // Level for compressing blobs transferred via the byte-stream API, if
+    // compression is requested.
+    std::optional<int> const compression_level;
 };
 
 class RemoteExecutionConfig::Builder final {
@@ -72,6 +76,12 @@ class RemoteExecutionConfig::Builder final {
         return *this;
     }
 
+    // Set compression level for byte-stream transfers.
+    auto SetCompressionLevel(std::optional<int> level) noexcept -> Builder& {
+        compression_level_ = level;
+        return *this;
+    }
+
     /// \brief Parse the set data to finalize creation of RemoteExecutionConfig.
     /// \return RemoteExecutionConfig on success, an error string on failure.
     [[nodiscard]] auto Build() const noexcept
@@ -89,6 +99,9 @@ class RemoteExecutionConfig::Builder final {
 
     // Platform properties for execution; needs parsing.
     std::vector<std::string> platform_properties_raw_;
+
+    // Compression level for byte-stream transfers.
+    std::optional<int> compression_level_;
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_API_REMOTE_CONFIG_HPP
@@ -20,7 +20,10 @@
 #include "src/buildtool/common/statistics.hpp"
 #include "src/buildtool/execution_api/common/api_bundle.hpp"
 #include "src/buildtool/execution_api/remote/context.hpp"
+#include "src/buildtool/profile/action_timings.hpp"
+#include "src/buildtool/profile/profile.hpp"
 #include "src/buildtool/progress_reporting/progress.hpp"
+#include "src/buildtool/storage/file_hash_cache.hpp"
 
 /// \brief Aggregate to be passed to graph traverser.
 /// \note No field is stored as const ref to avoid binding to temporaries.
@@ -30,6 +33,9 @@ struct ExecutionContext final {
     gsl::not_null<RemoteContext const*> const remote_context;
     gsl::not_null<Statistics*> const statistics;
     gsl::not_null<Progress*> const progress;
+    Profile* const profile = nullptr;
+    ActionTimings* const action_timings = nullptr;
+    FileHashCache* const file_hash_cache = nullptr;
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_ENGINE_EXECUTOR_CONTEXT_HPP
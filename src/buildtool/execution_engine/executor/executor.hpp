@@ -44,6 +44,7 @@
 #include "src/buildtool/common/protocol_traits.hpp"
 #include "src/buildtool/common/remote/remote_common.hpp"
 #include "src/buildtool/common/repository_config.hpp"
+#include "src/buildtool/common/resource_usage.hpp"
 #include "src/buildtool/common/statistics.hpp"
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/execution_api/bazel_msg/bazel_common.hpp"
@@ -63,8 +64,10 @@
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
+#include "src/buildtool/profile/profile.hpp"
 #include "src/buildtool/progress_reporting/progress.hpp"
 #include "src/buildtool/progress_reporting/task_tracker.hpp"
+#include "src/buildtool/storage/file_hash_cache.hpp"
 #include "src/utils/cpp/expected.hpp"
 #include "src/utils/cpp/hex_string.hpp"
 #include "src/utils/cpp/path_rebase.hpp"
@@ -87,10 +90,15 @@ class ExecutorImpl {
         std::chrono::milliseconds const& timeout,
         IExecutionAction::CacheFlag cache_flag,
         gsl::not_null<Statistics*> const& stats,
-        gsl::not_null<Progress*> const& progress)
+        gsl::not_null<Progress*> const& progress,
+        Profile* const profile = nullptr)
         -> std::optional<IExecutionResponse::Ptr> {
         auto const& inputs = action->Dependencies();
         auto const tree_action = action->Content().IsTreeAction();
+        auto const& action_id = action->Content().Id();
+        if (profile != nullptr) {
+            profile->NoteActionStarted(action_id);
+        }
 
         logger.Emit(LogLevel::Trace, [&inputs, tree_action]() {
             std::ostringstream oss{};
@@ -107,7 +115,12 @@ class ExecutorImpl {
             return oss.str();
         });
 
+        auto phase_start = Profile::Clock::now();
         auto const root_digest = CreateRootDigest(api, inputs);
+        if (profile != nullptr) {
+            profile->NoteActionPhase(
+                action_id, Profile::ActionPhase::kStaging, phase_start);
+        }
         if (not root_digest) {
             Logger::Log(LogLevel::Error,
                         "failed to create root digest for input artifacts.");
@@ -135,6 +148,7 @@ class ExecutorImpl {
         auto alternative_api = GetAlternativeEndpoint(
             merged_properties, remote_context, hash_function);
         if (alternative_api) {
+            phase_start = Profile::Clock::now();
             if (not api.ParallelRetrieveToCas(
                     std::vector<Artifact::ObjectInfo>{Artifact::ObjectInfo{
                         *root_digest, ObjectType::Tree, /* failed= */ false}},
@@ -146,6 +160,10 @@ class ExecutorImpl {
                             root_digest->hash());
                 return nullptr;
             }
+            if (profile != nullptr) {
+                profile->NoteActionPhase(
+                    action_id, Profile::ActionPhase::kUpload, phase_start);
+            }
         }
 
         auto base = action->Content().Cwd();
@@ -171,8 +189,14 @@ class ExecutorImpl {
         // set action options
         remote_action->SetCacheFlag(cache_flag);
         remote_action->SetTimeout(timeout);
+        phase_start = Profile::Clock::now();
         auto result = remote_action->Execute(&logger);
+        if (profile != nullptr) {
+            profile->NoteActionPhase(
+                action_id, Profile::ActionPhase::kExecution, phase_start);
+        }
         if (alternative_api) {
+            phase_start = Profile::Clock::now();
             if (result) {
                 auto const artifacts = result->Artifacts();
                 if (not artifacts) {
@@ -190,6 +214,10 @@ class ExecutorImpl {
                                 "dispatch endpoint");
                 }
             }
+            if (profile != nullptr) {
+                profile->NoteActionPhase(
+                    action_id, Profile::ActionPhase::kCollection, phase_start);
+            }
         }
         return result;
     }
@@ -205,7 +233,8 @@ class ExecutorImpl {
         Logger const& logger,
         gsl::not_null<DependencyGraph::ArtifactNode const*> const& artifact,
         gsl::not_null<const RepositoryConfig*> const& repo_config,
-        ApiBundle const& apis) noexcept -> bool {
+        ApiBundle const& apis,
+        FileHashCache* file_hash_cache = nullptr) noexcept -> bool {
         auto const object_info_opt = artifact->Content().Info();
         auto const file_path_opt = artifact->Content().FilePath();
         // If there is no object info and no file path, the artifact can not be
@@ -269,7 +298,8 @@ class ExecutorImpl {
                                    apis.hash_function,
                                    repo,
                                    repo_config,
-                                   *file_path_opt);
+                                   *file_path_opt,
+                                   file_hash_cache);
         if (not new_info) {
             Logger::Log(LogLevel::Error,
                         "artifact in {} could not be uploaded to CAS.",
@@ -481,13 +511,16 @@ class ExecutorImpl {
     /// \param repo         The global repository name, the artifact belongs to
     /// \param repo_config  Configuration specifying the workspace root
     /// \param file_path    The path of the file to be read
+    /// \param file_hash_cache Cache for digests of files of file-system
+    /// roots, if any
     /// \returns The computed object info on success
     [[nodiscard]] static auto UploadFile(
         IExecutionApi const& api,
         HashFunction hash_function,
         std::string const& repo,
         gsl::not_null<const RepositoryConfig*> const& repo_config,
-        std::filesystem::path const& file_path) noexcept
+        std::filesystem::path const& file_path,
+        FileHashCache* file_hash_cache) noexcept
         -> std::optional<Artifact::ObjectInfo> {
         auto const* ws_root = repo_config->WorkspaceRoot(repo);
         if (ws_root == nullptr) {
@@ -497,6 +530,32 @@ class ExecutorImpl {
         if (not object_type) {
             return std::nullopt;
         }
+
+        // Stream files from file-system roots from disk, to not keep the
+        // content of large files in memory.
+        if (IsFileObject(*object_type)) {
+            if (auto local_path = ws_root->GetLocalFilePath(file_path)) {
+                auto digest =
+                    file_hash_cache != nullptr
+                        ? file_hash_cache->HashFile(*local_path)
+                        : ArtifactDigestFactory::HashFileAs<ObjectType::File>(
+                              hash_function, *local_path);
+                if (not digest) {
+                    return std::nullopt;
+                }
+                auto blob = ArtifactBlob::FromFile(
+                    *digest,
+                    *std::move(local_path),
+                    digest->size(),
+                    IsExecutableObject(*object_type));
+                if (not api.Upload(ArtifactBlobContainer{{std::move(blob)}})) {
+                    return std::nullopt;
+                }
+                return Artifact::ObjectInfo{.digest = *std::move(digest),
+                                            .type = *object_type};
+            }
+        }
+
         auto content = ws_root->ReadContent(file_path);
         if (not content.has_value()) {
             return std::nullopt;
@@ -573,6 +632,7 @@ class ExecutorImpl {
         gsl::not_null<DependencyGraph::ActionNode const*> const& action,
         gsl::not_null<Statistics*> const& stats,
         gsl::not_null<Progress*> const& progress,
+        Profile* const profile,
         bool count_as_executed = false) -> bool {
         logger.Emit(LogLevel::Trace, "finished execution");
 
@@ -582,12 +642,22 @@ class ExecutorImpl {
             return false;
         }
 
-        if (not count_as_executed and response->IsCached()) {
+        bool const cached = not count_as_executed and response->IsCached();
+        if (cached) {
             logger.Emit(LogLevel::Trace, " - served from cache");
             stats->IncrementActionsCachedCounter();
         }
         else {
             stats->IncrementActionsExecutedCounter();
+            if (profile != nullptr) {
+                if (auto metadata = response->ExecutionMetadata()) {
+                    if (auto usage =
+                            ResourceUsage::FromExecutionMetadata(*metadata)) {
+                        profile->NoteActionResourceUsage(
+                            action->Content().Id(), *usage);
+                    }
+                }
+            }
         }
         progress->TaskTracker().Stop(action->Content().Id());
 
@@ -603,6 +673,12 @@ class ExecutorImpl {
                 action_failed = true;
             }
             else {
+                if (profile != nullptr) {
+                    profile->NoteActionCompleted(action->Content().Id(),
+                                                 cached,
+                                                 response->ExitCode(),
+                                                 /*output_sizes=*/{});
+                }
                 logger.Emit(LogLevel::Error,
                             "action returned non-zero exit code {}",
                             response->ExitCode());
@@ -611,7 +687,23 @@ class ExecutorImpl {
             }
         }
 
+        auto const collection_start = Profile::Clock::now();
         auto const artifacts = response->Artifacts();
+        if (profile != nullptr) {
+            profile->NoteActionPhase(action->Content().Id(),
+                                     Profile::ActionPhase::kCollection,
+                                     collection_start);
+            std::map<std::string, std::size_t> output_sizes{};
+            if (artifacts) {
+                for (auto const& [path, info] : *artifacts.value()) {
+                    output_sizes.emplace(path, info.digest.size());
+                }
+            }
+            profile->NoteActionCompleted(action->Content().Id(),
+                                         cached,
+                                         response->ExitCode(),
+                                         std::move(output_sizes));
+        }
         if (not artifacts) {
             logger.Emit(LogLevel::Error, artifacts.error());
             return false;
@@ -780,6 +872,8 @@ class ExecutorImpl {
                                        endpoint.ToJson().dump());
                 });
                 ExecutionConfiguration config;
+                config.compression_level =
+                    remote_context->exec_config->compression_level;
                 return std::make_unique<BazelApi>(
                     "alternative remote execution",
                     endpoint.host,
@@ -819,6 +913,7 @@ class Executor {
     [[nodiscard]] auto Process(
         gsl::not_null<DependencyGraph::ActionNode const*> const& action)
         const noexcept -> bool {
+        auto const start = std::chrono::steady_clock::now();
         // to avoid always creating a logger we might not need, which is a
         // non-copyable and non-movable object, we need some code duplication
         if (logger_ != nullptr) {
@@ -834,13 +929,16 @@ class Executor {
                 Impl::ScaleTime(timeout_, action->TimeoutScale()),
                 action->NoCache() ? CF::DoNotCacheOutput : CF::CacheOutput,
                 context_.statistics,
-                context_.progress);
+                context_.progress,
+                context_.profile);
+            NoteDuration(action, response, start);
             // check response and save digests of results
             return not response or Impl::ParseResponse(*logger_,
                                                        *response,
                                                        action,
                                                        context_.statistics,
-                                                       context_.progress);
+                                                       context_.progress,
+                                                       context_.profile);
         }
 
         Logger logger("action:" + action->Content().Id());
@@ -857,14 +955,25 @@ class Executor {
             Impl::ScaleTime(timeout_, action->TimeoutScale()),
             action->NoCache() ? CF::DoNotCacheOutput : CF::CacheOutput,
             context_.statistics,
-            context_.progress);
+            context_.progress,
+            context_.profile);
+        NoteDuration(action, response, start);
 
         // check response and save digests of results
         return not response or Impl::ParseResponse(logger,
                                                    *response,
                                                    action,
                                                    context_.statistics,
-                                                   context_.progress);
+                                                   context_.progress,
+                                                   context_.profile);
+    }
+
+    /// \brief Note that the action is ready and was queued for processing.
+    void NoteQueued(gsl::not_null<DependencyGraph::ActionNode const*> const&
+                        action) const noexcept {
+        if (context_.profile != nullptr) {
+            context_.profile->NoteActionQueued(action->Content().Id());
+        }
     }
 
     /// \brief Check artifact is available to the CAS or upload it.
@@ -877,19 +986,41 @@ class Executor {
         // to avoid always creating a logger we might not need, which is a
         // non-copyable and non-movable object, we need some code duplication
         if (logger_ != nullptr) {
-            return Impl::VerifyOrUploadArtifact(
-                *logger_, artifact, context_.repo_config, *context_.apis);
+            return Impl::VerifyOrUploadArtifact(*logger_,
+                                                artifact,
+                                                context_.repo_config,
+                                                *context_.apis,
+                                                context_.file_hash_cache);
         }
 
         Logger logger("artifact:" + ToHexString(artifact->Content().Id()));
-        return Impl::VerifyOrUploadArtifact(
-            logger, artifact, context_.repo_config, *context_.apis);
+        return Impl::VerifyOrUploadArtifact(logger,
+                                            artifact,
+                                            context_.repo_config,
+                                            *context_.apis,
+                                            context_.file_hash_cache);
     }
 
   private:
     ExecutionContext const& context_;
     Logger const* logger_;
     std::chrono::milliseconds timeout_;
+
+    /// \brief Record the time spent on an action that was actually executed,
+    /// to be used as estimate for its duration in later builds.
+    void NoteDuration(
+        gsl::not_null<DependencyGraph::ActionNode const*> const& action,
+        std::optional<IExecutionResponse::Ptr> const& response,
+        std::chrono::steady_clock::time_point start) const noexcept {
+        if (context_.action_timings != nullptr and response and
+            *response != nullptr and not(*response)->IsCached()) {
+            context_.action_timings->Note(
+                action->Content().Id(),
+                std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count());
+        }
+    }
 };
 
 /// \brief Rebuilder for running and comparing actions of two API endpoints.
@@ -931,7 +1062,8 @@ class Rebuilder {
             Impl::ScaleTime(timeout_, action->TimeoutScale()),
             CF::PretendCached,
             context_.statistics,
-            context_.progress);
+            context_.progress,
+            context_.profile);
 
         if (not response) {
             return true;  // action without response (e.g., tree action)
@@ -968,15 +1100,26 @@ class Rebuilder {
                                    action,
                                    context_.statistics,
                                    context_.progress,
+                                   context_.profile,
                                    /*count_as_executed=*/true);
     }
 
+    void NoteQueued(gsl::not_null<DependencyGraph::ActionNode const*> const&
+                        action) const noexcept {
+        if (context_.profile != nullptr) {
+            context_.profile->NoteActionQueued(action->Content().Id());
+        }
+    }
+
     [[nodiscard]] auto Process(
         gsl::not_null<DependencyGraph::ArtifactNode const*> const& artifact)
         const noexcept -> bool {
         Logger logger("artifact:" + ToHexString(artifact->Content().Id()));
-        return Impl::VerifyOrUploadArtifact(
-            logger, artifact, context_.repo_config, *context_.apis);
+        return Impl::VerifyOrUploadArtifact(logger,
+                                            artifact,
+                                            context_.repo_config,
+                                            *context_.apis,
+                                            context_.file_hash_cache);
     }
 
     [[nodiscard]] auto DumpFlakyActions() const -> nlohmann::json {
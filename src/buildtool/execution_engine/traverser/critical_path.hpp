@@ -0,0 +1,92 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_EXECUTION_ENGINE_TRAVERSER_CRITICAL_PATH_HPP
+#define INCLUDED_SRC_BUILDTOOL_EXECUTION_ENGINE_TRAVERSER_CRITICAL_PATH_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "gsl/gsl"
+#include "src/buildtool/execution_engine/dag/dag.hpp"
+
+/// \brief Weight of an action, e.g., its expected duration.
+using ActionWeight =
+    std::function<double(DependencyGraph::ActionNode const& action)>;
+
+/// \brief Compute the critical-path priority of all actions needed to build
+/// the given artifacts: the total weight of the heaviest path from the action
+/// (inclusive) to any of the given artifacts. Consumers of an action's outputs
+/// that are not needed for the given artifacts are not taken into account.
+[[nodiscard]] static inline auto ComputeCriticalPathPriorities(
+    std::vector<gsl::not_null<DependencyGraph::ArtifactNode const*>> const&
+        targets,
+    ActionWeight const& weight)
+    -> std::unordered_map<DependencyGraph::ActionNode const*, double> {
+    using ActionNodePtr = DependencyGraph::ActionNode const*;
+
+    // Collect all needed actions in post order, i.e., every action after all
+    // actions building its inputs. Iteratively, as the graph might be deep.
+    std::vector<ActionNodePtr> post_order{};
+    std::unordered_set<ActionNodePtr> seen{};
+    std::vector<std::pair<ActionNodePtr, std::size_t>> stack{};
+    for (auto const& target : targets) {
+        auto const* builder = target->BuilderActionNode();
+        if (builder == nullptr or not seen.emplace(builder).second) {
+            continue;
+        }
+        stack.emplace_back(builder, 0);
+        while (not stack.empty()) {
+            auto [action, next] = stack.back();
+            auto const& inputs = action->Children();
+            if (next < inputs.size()) {
+                ++stack.back().second;
+                auto const* dep = inputs[next]->BuilderActionNode();
+                if (dep != nullptr and seen.emplace(dep).second) {
+                    stack.emplace_back(dep, 0);
+                }
+            }
+            else {
+                post_order.emplace_back(action);
+                stack.pop_back();
+            }
+        }
+    }
+
+    // In reverse post order, all consumers of an action are handled before the
+    // action itself.
+    std::unordered_map<ActionNodePtr, double> priorities{};
+    priorities.reserve(post_order.size());
+    for (auto it = post_order.rbegin(); it != post_order.rend(); ++it) {
+        auto const* action = *it;
+        double downstream{};
+        for (auto const& output : action->Parents()) {
+            for (auto const& consumer : output->Parents()) {
+                auto found = priorities.find(consumer.get());
+                if (found != priorities.end()) {
+                    downstream = std::max(downstream, found->second);
+                }
+            }
+        }
+        priorities.emplace(action, weight(*action) + downstream);
+    }
+    return priorities;
+}
+
+#endif  // INCLUDED_SRC_BUILDTOOL_EXECUTION_ENGINE_TRAVERSER_CRITICAL_PATH_HPP
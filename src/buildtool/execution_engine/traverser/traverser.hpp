@@ -17,14 +17,21 @@
 
 #include <atomic>
 #include <cstddef>
+#include <exception>
 #include <functional>
+#include <mutex>
+#include <queue>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "gsl/gsl"
 #include "src/buildtool/common/identifier.hpp"
 #include "src/buildtool/execution_engine/dag/dag.hpp"
+#include "src/buildtool/execution_engine/traverser/critical_path.hpp"
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
 #include "src/buildtool/multithreading/task_system.hpp"
@@ -45,14 +52,22 @@ concept Runnable = requires(T const r,
 /// the //src/buildtool/execution_engine/task_system.
 /// Graph remains constant and the only parts of the nodes that are modified are
 /// their traversal state
+/// If an action weight is given, actions that are ready are processed in the
+/// order of their critical-path priority (see ComputeCriticalPathPriorities)
+/// instead of the order they became ready in.
 template <Runnable Executor>
 class Traverser {
   public:
     explicit Traverser(Executor const& r,
                        DependencyGraph const& graph,
                        std::size_t jobs,
-                       gsl::not_null<std::atomic<bool>*> const& fail_flag)
-        : runner_{r}, graph_{graph}, failed_{fail_flag}, tasker_{jobs} {}
+                       gsl::not_null<std::atomic<bool>*> const& fail_flag,
+                       ActionWeight weight = {})
+        : runner_{r},
+          graph_{graph},
+          failed_{fail_flag},
+          weight_{std::move(weight)},
+          tasker_{jobs} {}
     Traverser() = delete;
     Traverser(Traverser const&) = delete;
     Traverser(Traverser&&) = delete;
@@ -73,9 +88,16 @@ class Traverser {
                                     target_ids) noexcept -> bool;
 
   private:
+    using ActionNodePtr = DependencyGraph::ActionNode const*;
+    using ReadyAction = std::pair<double, ActionNodePtr>;
+
     Executor const& runner_{};
     DependencyGraph const& graph_;
     gsl::not_null<std::atomic<bool>*> failed_;
+    ActionWeight weight_;
+    std::unordered_map<ActionNodePtr, double> priorities_;
+    std::mutex ready_mutex_;
+    std::priority_queue<ReadyAction> ready_;  // highest priority on top
     TaskSystem tasker_;  // THIS SHOULD BE THE LAST MEMBER VARIABLE
 
     // Visits discover nodes and queue visits to their children nodes.
@@ -118,15 +140,47 @@ class Traverser {
             return;
         }
 
-        auto process_node = [this, node]() {
-            if (runner_.Process(node)) {
-                NotifyAvailable(node);
+        // runners may optionally observe when actions become ready
+        if constexpr (requires { runner_.NoteQueued(node); }) {
+            runner_.NoteQueued(node);
+        }
+        if constexpr (std::is_convertible_v<NodeTypePtr, ActionNodePtr>) {
+            if (not priorities_.empty()) {
+                QueuePrioritized(node);
+                return;
             }
-            else {
-                Abort();
+        }
+        tasker_.QueueTask([this, node]() { ProcessNode(node); });
+    }
+
+    // Add action to the ready actions and queue a task processing the ready
+    // action with the highest priority at the time the task is run.
+    void QueuePrioritized(ActionNodePtr action) noexcept {
+        auto it = priorities_.find(action);
+        auto priority = it != priorities_.end() ? it->second : 0.0;
+        {
+            std::unique_lock lock{ready_mutex_};
+            ready_.emplace(priority, action);
+        }
+        tasker_.QueueTask([this]() {
+            ActionNodePtr action{};
+            {
+                std::unique_lock lock{ready_mutex_};
+                action = ready_.top().second;
+                ready_.pop();
             }
-        };
-        tasker_.QueueTask(process_node);
+            ProcessNode(gsl::not_null<ActionNodePtr>{action});
+        });
+    }
+
+    template <typename NodeTypePtr>
+    void ProcessNode(NodeTypePtr node) noexcept {
+        if (runner_.Process(node)) {
+            NotifyAvailable(node);
+        }
+        else {
+            Abort();
+        }
     }
 
     void Abort() noexcept {
@@ -138,6 +192,25 @@ class Traverser {
 template <Runnable Executor>
 auto Traverser<Executor>::Traverse(
     std::unordered_set<ArtifactIdentifier> const& target_ids) noexcept -> bool {
+    if (weight_) {
+        try {
+            std::vector<gsl::not_null<DependencyGraph::ArtifactNode const*>>
+                targets{};
+            targets.reserve(target_ids.size());
+            for (auto const& artifact_id : target_ids) {
+                if (auto const* node = graph_.ArtifactNodeWithId(artifact_id)) {
+                    targets.emplace_back(node);
+                }
+            }
+            priorities_ = ComputeCriticalPathPriorities(targets, weight_);
+        } catch (std::exception const& e) {
+            Logger::Log(LogLevel::Warning,
+                        "Failed to compute action priorities, processing "
+                        "actions in order:\n{}",
+                        e.what());
+            priorities_.clear();
+        }
+    }
     for (auto artifact_id : target_ids) {
         auto const* artifact_node = graph_.ArtifactNodeWithId(artifact_id);
         if (artifact_node != nullptr) {
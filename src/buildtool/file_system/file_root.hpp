@@ -516,6 +516,20 @@ class FileRoot {
         return std::nullopt;
     }
 
+    /// \brief Path of a regular file in the local file system, if the root is
+    /// a file-system root. Allows processing the file's content without
+    /// reading it into memory as a whole.
+    [[nodiscard]] auto GetLocalFilePath(std::filesystem::path const& file_path)
+        const noexcept -> std::optional<std::filesystem::path> {
+        if (auto const* fs_root = std::get_if<fs_root_t>(&root_)) {
+            auto full_path = *fs_root / file_path;
+            if (FileSystemManager::IsFile(full_path)) {
+                return full_path;
+            }
+        }
+        return std::nullopt;
+    }
+
     [[nodiscard]] auto ReadDirectory(std::filesystem::path const& dir_path)
         const noexcept -> DirectoryEntries {
         try {
@@ -533,6 +533,38 @@ class FileSystemManager {
         }
     }
 
+    /// \brief Set a directory and all directories below it read-only (0555),
+    /// or writable by the owner again (0755). Symlinks are not followed.
+    [[nodiscard]] static auto SetDirectoriesWritable(
+        std::filesystem::path const& dir,
+        bool writable) noexcept -> bool {
+        try {
+            using std::filesystem::perms;
+            auto const p = (writable ? perms::owner_write : perms::none) |
+                           perms::owner_read | perms::owner_exec |
+                           perms::group_read | perms::group_exec |
+                           perms::others_read | perms::others_exec;
+            if (not std::filesystem::is_directory(
+                    std::filesystem::symlink_status(dir))) {
+                return false;
+            }
+            std::filesystem::permissions(dir, p);
+            for (auto const& entry :
+                 std::filesystem::recursive_directory_iterator{dir}) {
+                if (std::filesystem::is_directory(entry.symlink_status())) {
+                    std::filesystem::permissions(entry.path(), p);
+                }
+            }
+            return true;
+        } catch (std::exception const& e) {
+            Logger::Log(LogLevel::Error,
+                        "setting permissions of directory {}:\n{}",
+                        dir.string(),
+                        e.what());
+            return false;
+        }
+    }
+
     /// \brief Returns if symlink is non-upwards, i.e., its string content path
     /// never passes itself in the directory tree.
     /// \param non_strict if set, do not check non-upwardness. Use with care!
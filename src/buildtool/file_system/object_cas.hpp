@@ -92,6 +92,34 @@ class ObjectCAS {
         return StoreBlob(file_path, is_owner);
     }
 
+    /// \brief Store blob from bytes, whose digest is already known. The
+    /// bytes are not hashed again, so the caller is responsible for the
+    /// digest matching the content.
+    /// \param digest   The verified digest of the bytes.
+    /// \param bytes    The bytes do create the blob from.
+    /// \returns Digest of the stored blob or nullopt in case of error.
+    [[nodiscard]] auto StoreVerifiedBlobFromBytes(
+        ArtifactDigest const& digest,
+        std::string const& bytes) const noexcept
+        -> std::optional<ArtifactDigest> {
+        return StoreVerifiedBlob(digest, bytes, /*is_owner=*/true);
+    }
+
+    /// \brief Store blob from file path, whose digest is already known. The
+    /// file is not read again, so the caller is responsible for the digest
+    /// matching the content.
+    /// \param digest       The verified digest of the file.
+    /// \param file_path    The path of the file to store as blob.
+    /// \param is_owner     Indicates ownership for optimization (hardlink).
+    /// \returns Digest of the stored blob or nullopt in case of error.
+    [[nodiscard]] auto StoreVerifiedBlobFromFile(
+        ArtifactDigest const& digest,
+        std::filesystem::path const& file_path,
+        bool is_owner = false) const noexcept
+        -> std::optional<ArtifactDigest> {
+        return StoreVerifiedBlob(digest, file_path, is_owner);
+    }
+
     /// \brief Get path to blob.
     /// \param digest   Digest of the blob to lookup.
     /// \returns Path to blob if found or nullopt otherwise.
@@ -176,6 +204,23 @@ class ObjectCAS {
         logger_.Emit(LogLevel::Debug, "Failed to create digest.");
         return std::nullopt;
     }
+
+    /// \brief Store blob with known digest from unspecified data to storage.
+    template <class T>
+    [[nodiscard]] auto StoreVerifiedBlob(ArtifactDigest const& digest,
+                                         T const& data,
+                                         bool is_owner) const noexcept
+        -> std::optional<ArtifactDigest> {
+        auto const& id = digest.hash();
+        if (IsAvailable(digest, file_store_.GetPath(id))) {
+            return digest;
+        }
+        if (StoreBlobData(id, data, is_owner)) {
+            return digest;
+        }
+        logger_.Emit(LogLevel::Debug, "Failed to store blob {}.", id);
+        return std::nullopt;
+    }
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_FILE_SYSTEM_OBJECT_CAS_HPP
@@ -66,6 +66,7 @@
 #include "src/buildtool/execution_engine/dag/dag.hpp"
 #include "src/buildtool/execution_engine/executor/context.hpp"
 #include "src/buildtool/execution_engine/executor/executor.hpp"
+#include "src/buildtool/execution_engine/traverser/critical_path.hpp"
 #include "src/buildtool/execution_engine/traverser/traverser.hpp"
 #include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/jsonfs.hpp"
@@ -371,6 +372,25 @@ class GraphTraverser {
         return std::nullopt;
     }
 
+    /// \brief Weight of actions for critical-path-first processing, if
+    /// requested: the last known execution time, or the mean of all known
+    /// execution times for unknown actions. Without any known execution times,
+    /// all actions weigh the same.
+    [[nodiscard]] auto CriticalPathWeight() const -> ActionWeight {
+        if (not clargs_.build.critical_path_first) {
+            return {};
+        }
+        auto const* timings = context_.action_timings;
+        auto const fallback =
+            timings != nullptr ? timings->Mean().value_or(1.0) : 1.0;
+        return [timings, fallback](DependencyGraph::ActionNode const& action) {
+            if (timings == nullptr) {
+                return fallback;
+            }
+            return timings->Get(action.Content().Id()).value_or(fallback);
+        };
+    }
+
     /// \brief Traverses the graph. In case any of the artifact ids
     /// specified by the command line arguments is duplicated, execution is
     /// terminated.
@@ -385,7 +405,8 @@ class GraphTraverser {
         auto observer =
             std::thread([this, &done, &cv]() { reporter_(&done, &cv); });
         {
-            Traverser t{executor, g, clargs_.jobs, &failed};
+            Traverser t{
+                executor, g, clargs_.jobs, &failed, CriticalPathWeight()};
             traversing =
                 t.Traverse({std::begin(artifact_ids), std::end(artifact_ids)});
         }
@@ -406,7 +427,8 @@ class GraphTraverser {
         auto observer =
             std::thread([this, &done, &cv]() { reporter_(&done, &cv); });
         {
-            Traverser t{executor, g, clargs_.jobs, &failed};
+            Traverser t{
+                executor, g, clargs_.jobs, &failed, CriticalPathWeight()};
             traversing =
                 t.Traverse({std::begin(artifact_ids), std::end(artifact_ids)});
         }
@@ -83,10 +83,9 @@ auto AddArtifactsToCas(ToAddArguments const& clargs,
                             "Storing of trees only supported in native mode");
                 return false;
             }
-            auto store_blob =
-                [&cas](std::filesystem::path const& path,
-                       auto is_exec) -> std::optional<ArtifactDigest> {
-                return cas.StoreBlob</*kOwner=*/true>(path, is_exec);
+            auto store_blobs = [&cas](auto const& files)
+                -> std::optional<std::vector<ArtifactDigest>> {
+                return cas.StoreBlobs</*kOwner=*/true>(files);
             };
             auto store_tree = [&cas](std::string const& content)
                 -> std::optional<ArtifactDigest> {
@@ -97,7 +96,7 @@ auto AddArtifactsToCas(ToAddArguments const& clargs,
                 return cas.StoreBlob(content);
             };
             digest = BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
-                clargs.location, store_blob, store_tree, store_symlink);
+                clargs.location, store_blobs, store_tree, store_symlink);
         } break;
     }
 
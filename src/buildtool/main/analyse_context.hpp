@@ -18,6 +18,7 @@
 #include "gsl/gsl"
 #include "src/buildtool/common/repository_config.hpp"
 #include "src/buildtool/common/statistics.hpp"
+#include "src/buildtool/profile/profile.hpp"
 #include "src/buildtool/progress_reporting/progress.hpp"
 #include "src/buildtool/serve_api/remote/serve_api.hpp"
 #include "src/buildtool/storage/storage.hpp"
@@ -30,6 +31,7 @@ struct AnalyseContext final {
     gsl::not_null<Statistics*> const statistics;
     gsl::not_null<Progress*> const progress;
     ServeApi const* const serve = nullptr;
+    Profile* const profile = nullptr;
 };
 
 #endif  // INCLUDED_SRC_BUILDOOL_MAIN_ANALYSE_CONTEXT_HPP
@@ -39,6 +39,7 @@
 #include "src/buildtool/build_engine/expression/configuration.hpp"
 #include "src/buildtool/build_engine/expression/evaluator.hpp"
 #include "src/buildtool/build_engine/expression/expression.hpp"
+#include "src/buildtool/build_engine/expression/expression_interner.hpp"
 #include "src/buildtool/build_engine/expression/expression_ptr.hpp"
 #include "src/buildtool/build_engine/target_map/absent_target_map.hpp"
 #include "src/buildtool/build_engine/target_map/configured_target.hpp"
@@ -69,10 +70,13 @@
 #include "src/buildtool/main/install_cas.hpp"
 #include "src/buildtool/main/version.hpp"
 #include "src/buildtool/multithreading/task_system.hpp"
+#include "src/buildtool/profile/action_timings.hpp"
+#include "src/buildtool/profile/profile.hpp"
 #include "src/buildtool/progress_reporting/progress.hpp"
 #include "src/buildtool/serve_api/remote/serve_api.hpp"
 #include "src/buildtool/storage/config.hpp"
 #include "src/buildtool/storage/file_chunker.hpp"
+#include "src/buildtool/storage/file_hash_cache.hpp"
 #include "src/buildtool/storage/storage.hpp"
 #include "src/utils/cpp/expected.hpp"
 #include "src/utils/cpp/json.hpp"
@@ -136,6 +140,7 @@ void SetupLogging(LogArguments const& clargs) {
 
     auto config =
         builder.SetHashType(hash_type)
+            .SetChunkingProfile(eargs.chunking_profile)
             .SetRemoteExecutionArgs(
                 remote_address, remote_platform_properties, remote_dispatch)
             .Build();
@@ -154,6 +159,7 @@ void SetupLogging(LogArguments const& clargs) {
     if (bargs.local_launcher.has_value()) {
         builder.SetLauncher(*bargs.local_launcher);
     }
+    builder.SetTreeCache(bargs.local_tree_cache);
 
     auto config = builder.Build();
     if (config) {
@@ -170,7 +176,8 @@ void SetupLogging(LogArguments const& clargs) {
     builder.SetRemoteAddress(eargs.remote_execution_address)
         .SetRemoteExecutionDispatch(eargs.remote_execution_dispatch_file)
         .SetPlatformProperties(eargs.platform_properties)
-        .SetCacheAddress(rargs.cache_endpoint);
+        .SetCacheAddress(rargs.cache_endpoint)
+        .SetCompressionLevel(eargs.remote_compression_level);
 
     auto config = builder.Build();
     if (config) {
@@ -775,8 +782,22 @@ auto main(int argc, char* argv[]) -> int {
                 return kExitFailure;
             }
 
+            std::optional<CacheSizeLimits> size_limits;
+            if (arguments.gc.max_size) {
+                size_limits = CacheSizeLimits{
+                    .max_size = *arguments.gc.max_size,
+                    .target_size = arguments.gc.target_size.value_or(
+                        *arguments.gc.max_size)};
+                if (size_limits->target_size > size_limits->max_size) {
+                    Logger::Log(LogLevel::Error,
+                                "Target size must not exceed the maximal "
+                                "size of the cache.");
+                    return kExitFailure;
+                }
+            }
+
             if (GarbageCollector::TriggerGarbageCollection(
-                    *storage_config, arguments.gc.no_rotate)) {
+                    *storage_config, arguments.gc.no_rotate, size_limits)) {
                 return kExitSuccess;
             }
             return kExitFailure;
@@ -983,6 +1004,12 @@ auto main(int argc, char* argv[]) -> int {
         Statistics stats{};
         Progress progress{};
 
+        // profile instance, only if requested; needs to be kept alive as well
+        std::optional<Profile> profile{};
+        if (arguments.build.profile) {
+            profile.emplace(*arguments.build.profile);
+        }
+
 #ifndef BOOTSTRAP_BUILD_TOOL
         // pack the local context instances to be passed to ApiBundle
         LocalContext const local_context{.exec_config = &*local_exec_config,
@@ -995,11 +1022,38 @@ auto main(int argc, char* argv[]) -> int {
 
         auto const main_apis =
             ApiBundle::Create(&local_context, &remote_context, &repo_config);
+
+        // execution times of earlier builds, only if needed for scheduling
+        std::optional<ActionTimings> action_timings{};
+        if (arguments.build.critical_path_first) {
+            action_timings.emplace(&*storage_config);
+        }
+        // digests of files of file-system roots hashed in earlier builds
+        FileHashCache file_hash_cache{&*storage_config};
+        auto const save_build_caches = [&action_timings, &file_hash_cache]() {
+            if (action_timings and not action_timings->Save()) {
+                Logger::Log(LogLevel::Debug,
+                            "Failed to save execution times of actions.");
+            }
+            if (not file_hash_cache.Save()) {
+                Logger::Log(LogLevel::Debug,
+                            "Failed to save digests of local files.");
+            }
+        };
+
         ExecutionContext const exec_context{.repo_config = &repo_config,
                                             .apis = &main_apis,
                                             .remote_context = &remote_context,
                                             .statistics = &stats,
-                                            .progress = &progress};
+                                            .progress = &progress,
+                                            .profile = profile ? &*profile
+                                                               : nullptr,
+                                            .action_timings =
+                                                action_timings
+                                                    ? &*action_timings
+                                                    : nullptr,
+                                            .file_hash_cache =
+                                                &file_hash_cache};
         const GraphTraverser::CommandLineArguments traverse_args{
             jobs,
             std::move(arguments.build),
@@ -1085,11 +1139,13 @@ auto main(int argc, char* argv[]) -> int {
                                 arguments.graph.git_cas->string());
                 }
             }
-            if (traverser.BuildAndStage(arguments.graph.graph_file,
-                                        arguments.graph.artifacts)) {
-                return kExitSuccess;
+            auto success = traverser.BuildAndStage(arguments.graph.graph_file,
+                                                   arguments.graph.artifacts);
+            save_build_caches();
+            if (profile) {
+                profile->Write(&progress);
             }
-            return kExitFailure;
+            return success ? kExitSuccess : kExitFailure;
         }
         if (arguments.cmd == SubCommand::kDescribe) {
             if (auto id = DetermineNonExplicitTarget(main_repo,
@@ -1131,11 +1187,17 @@ auto main(int argc, char* argv[]) -> int {
 
         // create progress tracker for export targets
         Progress exports_progress{};
+
+        // memoization of built-in functions, counted in the statistics
+        Evaluator::SetBuiltinMemoization(arguments.analysis.builtin_memo_size,
+                                         &stats);
+
         AnalyseContext analyse_ctx{.repo_config = &repo_config,
                                    .storage = &storage,
                                    .statistics = &stats,
                                    .progress = &exports_progress,
-                                   .serve = serve ? &*serve : nullptr};
+                                   .serve = serve ? &*serve : nullptr,
+                                   .profile = profile ? &*profile : nullptr};
 
         auto analyse_result =
             AnalyseTarget(&analyse_ctx,
@@ -1151,6 +1213,9 @@ auto main(int argc, char* argv[]) -> int {
             std::ofstream os(*arguments.analysis.serve_errors_file);
             os << serve_errors.dump() << std::endl;
         }
+        if (profile and not analyse_result) {
+            profile->Write(&progress);
+        }
         if (analyse_result) {
             Logger::Log(LogLevel::Info,
                         "Analysed target {}",
@@ -1173,6 +1238,21 @@ auto main(int argc, char* argv[]) -> int {
                     uncached,
                     not_eligible);
             }
+            {
+                auto const& interner = ExpressionInterner::Instance();
+                Logger::Log(LogLevel::Performance,
+                            "Expression interning: {} of {} expressions "
+                            "shared, saving about {} KiB",
+                            interner.SharedCounter(),
+                            interner.InternedCounter(),
+                            interner.SavedBytesCounter() / 1024);
+            }
+            if (arguments.analysis.builtin_memo_size > 0) {
+                Logger::Log(LogLevel::Performance,
+                            "Built-in function memoization: {} hits, {} misses",
+                            stats.BuiltinMemoHitsCounter(),
+                            stats.BuiltinMemoMissesCounter());
+            }
 
             if (arguments.analysis.graph_file) {
                 analyse_result->result_map.ToFile(
@@ -1234,6 +1314,10 @@ auto main(int argc, char* argv[]) -> int {
                                         blobs,
                                         trees,
                                         std::move(cache_artifacts));
+            save_build_caches();
+            if (profile) {
+                profile->Write(&progress);
+            }
             if (build_result) {
                 WriteTargetCacheEntries(
                     cache_targets,
@@ -155,14 +155,14 @@ class AsyncMapConsumer {
                                Consumer&& consumer,
                                LoggerPtr&& logger,
                                FailureFunctionPtr&& fail) {
-        auto consumerptr = std::make_shared<Consumer>(std::move(consumer));
         if (keys.empty()) {
-            ts->QueueTask([consumerptr = std::move(consumerptr)]() {
-                (*consumerptr)({});
-            });
+            ts->QueueTask(
+                [consumer = std::move(consumer)]() { consumer({}); });
             return;
         }
 
+        auto consumerptr = std::make_shared<Consumer>(std::move(consumer));
+
         auto nodes = EnsureValuesEventuallyPresent(ts, keys, std::move(logger));
         auto first_node = nodes->at(0);
         if (fail) {
@@ -32,10 +32,10 @@
 /// format.
 /// \returns The resulting cycle message as a string, or nullopt if no cycle
 /// detected.
-template <typename K, typename V>
+template <typename K, typename V, typename M>
 [[nodiscard]] auto DetectAndReportCycle(
     std::string const& name,
-    AsyncMapConsumer<K, V> const& map,
+    AsyncMapConsumer<K, V, M> const& map,
     std::function<std::string(K const&)> key_printer)
     -> std::optional<std::string> {
     using namespace std::string_literals;
@@ -67,9 +67,9 @@ template <typename K, typename V>
 /// \param key_printer Callable returning key-specific identifier in string
 /// format.
 /// \param logger Named logger, or nullptr to use global logger.
-template <typename K, typename V>
+template <typename K, typename V, typename M>
 void DetectAndReportPending(std::string const& name,
-                            AsyncMapConsumer<K, V> const& map,
+                            AsyncMapConsumer<K, V, M> const& map,
                             std::function<std::string(K const&)> key_printer,
                             Logger const* logger = nullptr) {
     using namespace std::string_literals;
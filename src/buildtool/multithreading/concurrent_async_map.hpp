@@ -0,0 +1,277 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_MULTITHREADING_CONCURRENT_ASYNC_MAP_HPP
+#define INCLUDED_SRC_BUILDTOOL_MULTITHREADING_CONCURRENT_ASYNC_MAP_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>  // unique_lock
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>  // std::move
+#include <vector>
+
+#include "gsl/gsl"
+#include "src/buildtool/multithreading/async_map_node.hpp"
+#include "src/buildtool/multithreading/task_system.hpp"
+
+// Drop-in replacement for AsyncMap, to be used as the Map template argument of
+// AsyncMapConsumer for maps with many keys and high contention. Keys are stored
+// in a single open-addressing hash table (linear probing) whose slots are
+// atomic pointers to immutable entries. Look-ups are lock-free; insertions
+// only take a shared lock (to exclude concurrent resizing) and claim a slot
+// with compare-and-swap. Entries (and therefore nodes) are allocated from a
+// per-map arena and are alive as long as this map lives. Tables replaced by
+// resizing are kept alive as well, as concurrent readers might still probe
+// them; a look-up that misses an entry in an outdated table falls back to the
+// insertion path, which operates on the current table.
+template <typename KeyT, typename ValueT>
+class ConcurrentAsyncMap {
+  public:
+    // Nodes will be passed onto tasks. Nodes are owned by this map. Nodes are
+    // alive as long as this map lives.
+    using Node = AsyncMapNode<KeyT, ValueT>;
+    using NodePtr = Node*;
+
+    explicit ConcurrentAsyncMap(std::size_t jobs)
+        : table_{NewTable(InitialCapacity(jobs))} {}
+
+    ConcurrentAsyncMap() : ConcurrentAsyncMap(0) {}
+
+    ConcurrentAsyncMap(ConcurrentAsyncMap const&) = delete;
+    ConcurrentAsyncMap(ConcurrentAsyncMap&&) = delete;
+    auto operator=(ConcurrentAsyncMap const&) -> ConcurrentAsyncMap& = delete;
+    auto operator=(ConcurrentAsyncMap&&) -> ConcurrentAsyncMap& = delete;
+    ~ConcurrentAsyncMap() = default;
+
+    /// \brief Retrieve node for certain key. Key and new node are emplaced in
+    /// the map in case that the key does not exist already.
+    /// \returns pointer to the Node associated to given key
+    [[nodiscard]] auto GetOrCreateNode(KeyT const& key) -> NodePtr {
+        auto const hash = std::hash<KeyT>{}(key);
+        auto* node_or_null =
+            Find(table_.load(std::memory_order_acquire), hash, key);
+        return node_or_null != nullptr ? node_or_null : AddKey(hash, key);
+    }
+
+    [[nodiscard]] auto GetPendingKeys() const -> std::vector<KeyT> {
+        std::vector<KeyT> keys{};
+        keys.reserve(size_.load());
+        auto const* table = table_.load(std::memory_order_acquire);
+        for (auto const& slot : table->slots) {
+            auto const* entry = slot.load(std::memory_order_acquire);
+            if (entry != nullptr and not entry->node.IsReady()) {
+                keys.emplace_back(entry->node.GetKey());
+            }
+        }
+        return keys;
+    }
+
+    /// \brief Remove all keys and destroy all nodes. The nodes are destroyed
+    /// in parallel tasks. Must not be called concurrently to any other method.
+    void Clear(gsl::not_null<TaskSystem*> const& ts) {
+        for (auto& chunk : arena_.Release()) {
+            ts->QueueTask([chunk = std::move(chunk)]() mutable {
+                chunk.reset();
+            });
+        }
+        tables_.clear();
+        table_ = NewTable(InitialCapacity(0));
+        size_ = 0;
+    }
+
+  private:
+    struct Entry {
+        Entry(std::size_t h, KeyT const& key) : hash{h}, node{key} {}
+        std::size_t const hash;
+        Node node;
+    };
+
+    struct Table {
+        explicit Table(std::size_t capacity)
+            : mask{capacity - 1}, slots(capacity) {}
+        std::size_t const mask;
+        std::vector<std::atomic<Entry*>> slots;
+    };
+
+    // Lock-free bump allocator for entries. Chunk k has space for
+    // kFirstChunkSize * 2^k entries, so that the index of an entry determines
+    // its chunk and position without any further bookkeeping.
+    class Arena {
+      public:
+        using Chunk = std::unique_ptr<std::optional<Entry>[]>;
+
+        Arena() = default;
+        Arena(Arena const&) = delete;
+        Arena(Arena&&) = delete;
+        auto operator=(Arena const&) -> Arena& = delete;
+        auto operator=(Arena&&) -> Arena& = delete;
+        ~Arena() { static_cast<void>(Release()); }
+
+        [[nodiscard]] auto Emplace(std::size_t hash, KeyT const& key)
+            -> Entry* {
+            auto const index = next_++;
+            auto const chunk = static_cast<std::size_t>(
+                std::bit_width(index / kFirstChunkSize + 1) - 1);
+            auto const offset = index - (kFirstChunkSize << chunk) +
+                                kFirstChunkSize;
+            auto* entries = chunks_.at(chunk).load(std::memory_order_acquire);
+            if (entries == nullptr) {
+                auto fresh = std::make_unique<std::optional<Entry>[]>(
+                    kFirstChunkSize << chunk);
+                if (chunks_.at(chunk).compare_exchange_strong(
+                        entries,
+                        fresh.get(),
+                        std::memory_order_acq_rel,
+                        std::memory_order_acquire)) {
+                    entries = fresh.release();
+                }
+            }
+            return &entries[offset].emplace(hash, key);
+        }
+
+        /// \brief Hand out ownership of all chunks and reset the arena. Not
+        /// thread-safe.
+        [[nodiscard]] auto Release() -> std::vector<Chunk> {
+            std::vector<Chunk> chunks{};
+            for (auto& chunk : chunks_) {
+                if (auto* entries = chunk.exchange(nullptr)) {
+                    chunks.emplace_back(entries);
+                }
+            }
+            next_ = 0;
+            return chunks;
+        }
+
+      private:
+        static constexpr std::size_t kFirstChunkSize = 256;
+        static constexpr std::size_t kMaxChunks = 48;
+        std::array<std::atomic<std::optional<Entry>*>, kMaxChunks> chunks_{};
+        std::atomic<std::size_t> next_{0};
+    };
+
+    // Tables are grown at a load factor of 1/2. Insertions are rejected above
+    // 3/4, such that probing always terminates even if many threads insert
+    // concurrently before the table is grown.
+    static constexpr std::size_t kMinCapacity = 1024;
+    static constexpr std::size_t kSlotsPerJob = 64;
+
+    Arena arena_;
+    std::vector<std::unique_ptr<Table>> tables_;
+    std::atomic<Table*> table_;
+    std::atomic<std::size_t> size_{0};
+    std::shared_mutex resize_mutex_;
+
+    [[nodiscard]] static auto InitialCapacity(std::size_t jobs)
+        -> std::size_t {
+        if (jobs == 0) {
+            jobs = std::max(1U, std::thread::hardware_concurrency());
+        }
+        return std::bit_ceil(std::max(kMinCapacity, jobs * kSlotsPerJob));
+    }
+
+    [[nodiscard]] auto NewTable(std::size_t capacity) -> Table* {
+        return tables_.emplace_back(std::make_unique<Table>(capacity)).get();
+    }
+
+    [[nodiscard]] static auto Find(Table const* table,
+                                   std::size_t hash,
+                                   KeyT const& key) -> NodePtr {
+        for (auto i = hash & table->mask;; i = (i + 1) & table->mask) {
+            auto* entry = table->slots[i].load(std::memory_order_acquire);
+            if (entry == nullptr) {
+                return nullptr;
+            }
+            if (entry->hash == hash and entry->node.GetKey() == key) {
+                return &entry->node;
+            }
+        }
+    }
+
+    [[nodiscard]] auto AddKey(std::size_t hash, KeyT const& key) -> NodePtr {
+        Entry* new_entry{nullptr};
+        while (true) {
+            {
+                std::shared_lock sl{resize_mutex_};
+                auto* table = table_.load(std::memory_order_relaxed);
+                auto const capacity = table->mask + 1;
+                if (size_ * 4 < capacity * 3) {
+                    for (auto i = hash & table->mask;;
+                         i = (i + 1) & table->mask) {
+                        auto& slot = table->slots[i];
+                        auto* entry = slot.load(std::memory_order_acquire);
+                        if (entry == nullptr) {
+                            if (new_entry == nullptr) {
+                                new_entry = arena_.Emplace(hash, key);
+                            }
+                            if (slot.compare_exchange_strong(
+                                    entry,
+                                    new_entry,
+                                    std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+                                if (++size_ * 2 > capacity) {
+                                    sl.unlock();
+                                    Grow(table);
+                                }
+                                return &new_entry->node;
+                            }
+                            // lost the race for this slot, entry is the winner
+                        }
+                        if (entry->hash == hash and
+                            entry->node.GetKey() == key) {
+                            // Any entry we created stays unused in the arena.
+                            return &entry->node;
+                        }
+                    }
+                }
+            }
+            Grow(table_.load(std::memory_order_relaxed));
+        }
+    }
+
+    // Replace the given table by one of twice the size, unless another thread
+    // did so already.
+    void Grow(gsl::not_null<Table*> const& table) {
+        std::unique_lock ul{resize_mutex_};
+        if (table_.load(std::memory_order_relaxed) != table) {
+            return;
+        }
+        auto* new_table = NewTable((table->mask + 1) * 2);
+        for (auto const& slot : table->slots) {
+            auto* entry = slot.load(std::memory_order_relaxed);
+            if (entry == nullptr) {
+                continue;
+            }
+            for (auto i = entry->hash & new_table->mask;;
+                 i = (i + 1) & new_table->mask) {
+                if (new_table->slots[i].load(std::memory_order_relaxed) ==
+                    nullptr) {
+                    new_table->slots[i].store(entry,
+                                              std::memory_order_relaxed);
+                    break;
+                }
+            }
+        }
+        table_.store(new_table, std::memory_order_release);
+    }
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_MULTITHREADING_CONCURRENT_ASYNC_MAP_HPP
@@ -15,23 +15,69 @@
 #ifndef INCLUDED_SRC_BUILDTOOL_MULTITHREADING_TASK_HPP
 #define INCLUDED_SRC_BUILDTOOL_MULTITHREADING_TASK_HPP
 
+#include <array>
+#include <cstddef>
 #include <functional>
-#include <utility>  // std::move
+#include <new>
+#include <type_traits>
+#include <utility>  // std::move, std::forward, std::exchange
 
+#include "gsl/gsl"
+
+// Move-only type-erased callable without arguments. Callables that fit into
+// the inline buffer of kInlineSize bytes (and are nothrow movable) are stored
+// in place, so that creating, queueing, and running a task does not require
+// any extra heap allocation; larger callables are stored on the heap.
 class Task {
   public:
-    using TaskFunc = std::function<void()>;
+    static constexpr std::size_t kInlineSize = 64;
 
     Task() noexcept = default;
 
-    // NOLINTNEXTLINE(modernize-pass-by-value)
-    explicit Task(TaskFunc const& function) noexcept : f_{function} {}
-    explicit Task(TaskFunc&& function) noexcept : f_{std::move(function)} {}
+    template <typename Function>
+        requires(not std::is_same_v<std::remove_cvref_t<Function>, Task> and
+                 std::is_invocable_v<std::decay_t<Function>&>)
+    // NOLINTNEXTLINE(bugprone-forwarding-reference-overload)
+    explicit Task(Function&& function) {
+        using Callable = std::decay_t<Function>;
+        if constexpr (std::is_pointer_v<Callable> or
+                      std::is_member_pointer_v<Callable> or
+                      IsStdFunction<Callable>::value) {
+            if (not function) {
+                return;  // empty task
+            }
+        }
+        if constexpr (kStoredInline<Callable>) {
+            ::new (Storage()) Callable(std::forward<Function>(function));
+            vtable_ = &kInlineVTable<Callable>;
+        }
+        else {
+            ::new (Storage()) Callable*(
+                new Callable(std::forward<Function>(function)));
+            vtable_ = &kHeapVTable<Callable>;
+        }
+    }
+
+    Task(Task const&) = delete;
+    Task(Task&& other) noexcept { MoveFrom(&other); }
+    ~Task() { Reset(); }
+
+    auto operator=(Task const&) -> Task& = delete;
+    auto operator=(Task&& other) noexcept -> Task& {
+        if (this != &other) {
+            Reset();
+            MoveFrom(&other);
+        }
+        return *this;
+    }
 
-    void operator()() { f_(); }
+    void operator()() {
+        Expects(vtable_ != nullptr);
+        vtable_->invoke(Storage());
+    }
 
-    // To be able to discern whether the internal f_ has been set or not,
-    // allowing us to write code such as:
+    // To be able to discern whether the internal callable has been set or
+    // not, allowing us to write code such as:
     /*
     Task t;
     while (!t) {
@@ -43,10 +89,77 @@ class Task {
     // (**) we can now surely execute the task (and be sure it won't throw any
     // exception) (for the sake of the example, imagine we are sure that the
     // queue wasn't empty, otherwise this would be an infinite loop)
-    explicit operator bool() const noexcept { return f_.operator bool(); }
+    explicit operator bool() const noexcept { return vtable_ != nullptr; }
 
   private:
-    TaskFunc f_;
+    struct VTable {
+        void (*invoke)(void* storage);
+        // move-construct into dst and destroy src
+        void (*relocate)(void* dst, void* src) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename T>
+    struct IsStdFunction : std::false_type {};
+    template <typename R, typename... Args>
+    struct IsStdFunction<std::function<R(Args...)>> : std::true_type {};
+
+    template <typename Callable>
+    static constexpr bool kStoredInline =
+        sizeof(Callable) <= kInlineSize and
+        alignof(Callable) <= alignof(std::max_align_t) and
+        std::is_nothrow_move_constructible_v<Callable>;
+
+    template <typename Callable>
+    static constexpr VTable kInlineVTable{
+        .invoke =
+            [](void* storage) {
+                std::invoke(*std::launder(static_cast<Callable*>(storage)));
+            },
+        .relocate =
+            [](void* dst, void* src) noexcept {
+                auto* callable = std::launder(static_cast<Callable*>(src));
+                ::new (dst) Callable(std::move(*callable));
+                callable->~Callable();
+            },
+        .destroy =
+            [](void* storage) noexcept {
+                std::launder(static_cast<Callable*>(storage))->~Callable();
+            }};
+
+    template <typename Callable>
+    static constexpr VTable kHeapVTable{
+        .invoke =
+            [](void* storage) {
+                std::invoke(**std::launder(static_cast<Callable**>(storage)));
+            },
+        .relocate =
+            [](void* dst, void* src) noexcept {
+                ::new (dst)
+                    Callable*(*std::launder(static_cast<Callable**>(src)));
+            },
+        .destroy =
+            [](void* storage) noexcept {
+                delete *std::launder(static_cast<Callable**>(storage));
+            }};
+
+    alignas(std::max_align_t) std::array<std::byte, kInlineSize> storage_{};
+    VTable const* vtable_{nullptr};
+
+    [[nodiscard]] auto Storage() noexcept -> void* { return storage_.data(); }
+
+    void MoveFrom(Task* other) noexcept {
+        if (other->vtable_ != nullptr) {
+            other->vtable_->relocate(Storage(), other->Storage());
+            vtable_ = std::exchange(other->vtable_, nullptr);
+        }
+    }
+
+    void Reset() noexcept {
+        if (vtable_ != nullptr) {
+            std::exchange(vtable_, nullptr)->destroy(Storage());
+        }
+    }
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_MULTITHREADING_TASK_HPP
@@ -14,18 +14,70 @@
 
 #include "src/buildtool/multithreading/task_system.hpp"
 
-#include <optional>
+#include <new>
 
 #include "gsl/gsl"
-#include "src/buildtool/multithreading/task.hpp"
+
+namespace {
+
+// The task system and worker index the current thread belongs to, if any.
+struct WorkerContext {
+    TaskSystem const* system{nullptr};
+    std::size_t index{0};
+};
+
+thread_local WorkerContext current_worker{};
+
+// Per-thread cache of memory for task nodes. Tasks run by a worker are mostly
+// queued by the same worker, so nodes are typically recycled locally.
+class TaskNodeCache {
+  public:
+    TaskNodeCache() { free_.reserve(kMaxCachedNodes); }
+    TaskNodeCache(TaskNodeCache const&) = delete;
+    TaskNodeCache(TaskNodeCache&&) = delete;
+    auto operator=(TaskNodeCache const&) -> TaskNodeCache& = delete;
+    auto operator=(TaskNodeCache&&) -> TaskNodeCache& = delete;
+    ~TaskNodeCache() {
+        for (auto* node : free_) {
+            ::operator delete(node);
+        }
+    }
+
+    [[nodiscard]] auto Allocate() -> void* {
+        if (free_.empty()) {
+            return ::operator new(sizeof(Task));
+        }
+        auto* node = free_.back();
+        free_.pop_back();
+        return node;
+    }
+
+    void Deallocate(void* node) noexcept {
+        if (free_.size() < kMaxCachedNodes) {
+            free_.push_back(node);  // no reallocation, capacity is reserved
+            return;
+        }
+        ::operator delete(node);
+    }
+
+  private:
+    static constexpr std::size_t kMaxCachedNodes = 1024;
+    std::vector<void*> free_;
+};
+
+thread_local TaskNodeCache task_node_cache{};
+
+}  // namespace
 
 TaskSystem::TaskSystem() : TaskSystem(std::thread::hardware_concurrency()) {}
 
 TaskSystem::TaskSystem(std::size_t number_of_threads)
     : thread_count_{std::max(std::size_t{1}, number_of_threads)},
       total_workload_{thread_count_} {
+    deques_.reserve(thread_count_);
     for (std::size_t index = 0; index < thread_count_; ++index) {
-        queues_.emplace_back(&total_workload_);
+        deques_.emplace_back(
+            std::make_unique<WorkStealingDeque<Task, TaskDeleter>>());
     }
     for (std::size_t index = 0; index < thread_count_; ++index) {
         threads_.emplace_back([&, index]() { Run(index); });
@@ -46,9 +98,10 @@ void TaskSystem::Shutdown() noexcept {
     // the task queues (workload) are not yet empty and someone is still waiting
     // on this counter to become zero.
     total_workload_.Abort();
-    for (auto& q : queues_) {
-        q.done();
+    {
+        std::unique_lock lock{sleep_mutex_};
     }
+    sleep_cv_.notify_all();
 }
 
 void TaskSystem::Finish() noexcept {
@@ -60,25 +113,96 @@ void TaskSystem::Finish() noexcept {
     total_workload_.WaitForZero();
 }
 
+void TaskSystem::TaskDeleter::operator()(Task* task) const noexcept {
+    task->~Task();
+    task_node_cache.Deallocate(task);
+}
+
+void TaskSystem::Enqueue(Task&& t) noexcept {
+    TaskPtr task{::new (task_node_cache.Allocate()) Task{std::move(t)}};
+    total_workload_.Increment();
+    ++queued_;
+    if (current_worker.system == this) {
+        deques_[current_worker.index]->Push(std::move(task));
+    }
+    else {
+        std::unique_lock lock{injected_mutex_};
+        injected_.emplace_back(std::move(task));
+    }
+    // Pairs with the check of queued_ in WaitForWork(): either the sleeper
+    // sees the new task, or we see the sleeper and wake it up.
+    if (sleeping_ > 0) {
+        {
+            std::unique_lock lock{sleep_mutex_};
+        }
+        sleep_cv_.notify_one();
+    }
+}
+
+auto TaskSystem::TryPopInjected() noexcept -> TaskPtr {
+    std::unique_lock lock{injected_mutex_};
+    if (injected_.empty()) {
+        return nullptr;
+    }
+    auto task = std::move(injected_.front());
+    injected_.pop_front();
+    return task;
+}
+
+auto TaskSystem::TryGetTask(std::size_t idx) noexcept -> TaskPtr {
+    if (auto task = deques_[idx]->Pop()) {
+        return task;
+    }
+    if (auto task = TryPopInjected()) {
+        return task;
+    }
+    for (std::size_t attempt = 0; attempt < kNumberOfStealAttempts;
+         ++attempt) {
+        for (std::size_t i = 1; i < thread_count_; ++i) {
+            auto& victim = deques_[(idx + i) % thread_count_];
+            if (victim->Empty()) {
+                continue;
+            }
+            if (auto task = victim->Steal()) {
+                return task;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void TaskSystem::WaitForWork() noexcept {
+    std::unique_lock lock{sleep_mutex_};
+    ++sleeping_;
+    auto there_is_work_or_we_are_done = [this]() {
+        return queued_ > 0 or shutdown_;
+    };
+    if (not there_is_work_or_we_are_done()) {
+        total_workload_.Decrement();
+        sleep_cv_.wait(lock, there_is_work_or_we_are_done);
+        total_workload_.Increment();
+    }
+    --sleeping_;
+}
+
 void TaskSystem::Run(std::size_t idx) {
     Expects(thread_count_ > 0);
+    current_worker = WorkerContext{.system = this, .index = idx};
 
     while (not shutdown_) {
-        std::optional<Task> t{};
-        for (std::size_t i = 0; i < thread_count_; ++i) {
-            t = queues_[(idx + i) % thread_count_].try_pop();
-            if (t) {
-                break;
-            }
+        auto t = TryGetTask(idx);
+        if (not t) {
+            WaitForWork();
+            continue;
         }
+        --queued_;
+        total_workload_.Decrement();
 
-        // NOLINTNEXTLINE(clang-analyzer-core.DivideZero)
-        t = t ? t : queues_[idx % thread_count_].pop();
-
-        if (not t or shutdown_) {
+        if (shutdown_) {
             break;
         }
 
         (*t)();
     }
+    current_worker = WorkerContext{};
 }
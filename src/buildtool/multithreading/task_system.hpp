@@ -17,12 +17,18 @@
 
 #include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <utility>  // std::forward
 #include <vector>
 
-#include "src/buildtool/multithreading/notification_queue.hpp"
+#include "src/buildtool/multithreading/task.hpp"
+#include "src/buildtool/multithreading/waitable_zero_counter.hpp"
+#include "src/buildtool/multithreading/work_stealing_deque.hpp"
 
 class TaskSystem {
   public:
@@ -38,26 +44,19 @@ class TaskSystem {
     auto operator=(TaskSystem const&) -> TaskSystem& = delete;
     auto operator=(TaskSystem&&) -> TaskSystem& = delete;
 
-    // Destructor calls sets to "done" all notification queues and joins the
-    // threads. Note that joining the threads will wait until the Run method
-    // they are running is finished
+    // Destructor waits for all tasks to finish, wakes up all sleeping
+    // threads, and joins them. Note that joining the threads will wait until
+    // the Run method they are running is finished
     ~TaskSystem();
 
-    // Queue a task. Task will be added to the first notification queue that is
-    // found to be unlocked or, if none is found (after kNumberOfAttemps
-    // iterations), to the one in `index+1` position waiting until it's
-    // unlocked.
+    // Queue a task. If called from one of this task system's worker threads,
+    // the task is pushed to the bottom of that worker's own deque, which it
+    // pops from in LIFO order (depth-first, cache-warm). Otherwise, the task is
+    // added to a shared injection queue. Idle workers steal from the top of
+    // other workers' deques (FIFO), so long queues get drained by all threads.
     template <typename FunctionType>
     void QueueTask(FunctionType&& f) noexcept {
-        auto idx = index_++;
-
-        for (std::size_t i = 0; i < thread_count_ * kNumberOfAttempts; ++i) {
-            if (queues_[(idx + i) % thread_count_].try_push(
-                    std::forward<FunctionType>(f))) {
-                return;
-            }
-        }
-        queues_[idx % thread_count_].push(std::forward<FunctionType>(f));
+        Enqueue(Task{std::forward<FunctionType>(f)});
     }
 
     [[nodiscard]] auto NumberOfThreads() const noexcept -> std::size_t {
@@ -71,16 +70,39 @@ class TaskSystem {
     void Finish() noexcept;
 
   private:
+    // Queued tasks are stored in nodes recycled via a thread-local cache, so
+    // that queueing a task does not need a heap allocation in the steady state.
+    struct TaskDeleter {
+        void operator()(Task* task) const noexcept;
+    };
+    using TaskPtr = std::unique_ptr<Task, TaskDeleter>;
+
     std::size_t const thread_count_{
         std::max(1U, std::thread::hardware_concurrency())};
     std::vector<std::thread> threads_;
-    std::vector<NotificationQueue> queues_;
-    std::atomic<std::size_t> index_{0};
+    // One deque per worker; only the owning worker pushes and pops, others
+    // steal.
+    std::vector<std::unique_ptr<WorkStealingDeque<Task, TaskDeleter>>> deques_;
+    // Tasks queued from outside of the worker threads.
+    std::deque<TaskPtr> injected_;
+    std::mutex injected_mutex_;
+    // Number of tasks in all deques and the injection queue. Incremented
+    // before a task becomes visible, decremented after it was taken.
+    std::atomic<std::size_t> queued_{0};
+    // Sleeping workers wait on sleep_cv_ until queued_ becomes non-zero.
+    std::atomic<std::size_t> sleeping_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
     std::atomic<bool> shutdown_ = false;
+    // Number of active threads _and_ number of queued tasks.
     WaitableZeroCounter total_workload_;
 
-    static constexpr std::size_t kNumberOfAttempts = 5;
+    static constexpr std::size_t kNumberOfStealAttempts = 2;
 
+    void Enqueue(Task&& task) noexcept;
+    [[nodiscard]] auto TryGetTask(std::size_t idx) noexcept -> TaskPtr;
+    [[nodiscard]] auto TryPopInjected() noexcept -> TaskPtr;
+    void WaitForWork() noexcept;
     void Run(std::size_t idx);
 };
 
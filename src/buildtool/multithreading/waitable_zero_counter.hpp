@@ -0,0 +1,62 @@
+// Copyright 2022 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_MULTITHREADING_WAITABLE_ZERO_COUNTER_HPP
+#define INCLUDED_SRC_BUILDTOOL_MULTITHREADING_WAITABLE_ZERO_COUNTER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+
+// Counter that can block the caller until it reaches zero.
+class WaitableZeroCounter {
+  public:
+    explicit WaitableZeroCounter(std::size_t init = 0) : count_{init} {}
+
+    void Decrement() {
+        std::shared_lock lock{mutex_};
+        if (--count_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+    void Increment() { ++count_; }
+
+    void WaitForZero() {
+        while (not IsZero()) {  // loop to protect against spurious wakeups
+            std::unique_lock lock{mutex_};
+            cv_.wait(lock, [this] { return IsZero(); });
+        }
+    }
+
+    void Abort() {
+        std::shared_lock lock{mutex_};
+        done_ = true;
+        cv_.notify_all();
+    }
+
+  private:
+    std::shared_mutex mutex_;
+    std::condition_variable_any cv_;
+    std::atomic<std::size_t> count_;
+    std::atomic<bool> done_ = false;
+
+    [[nodiscard]] auto IsZero() noexcept -> bool {
+        return count_ == 0 or done_;
+    }
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_MULTITHREADING_WAITABLE_ZERO_COUNTER_HPP
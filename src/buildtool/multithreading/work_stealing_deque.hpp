@@ -0,0 +1,179 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_MULTITHREADING_WORK_STEALING_DEQUE_HPP
+#define INCLUDED_SRC_BUILDTOOL_MULTITHREADING_WORK_STEALING_DEQUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>  // std::move
+#include <vector>
+
+#include "gsl/gsl"
+
+/// \brief Lock-free single-owner, multi-thief deque (Chase-Lev).
+/// Only the owning thread may call \ref Push and \ref Pop, which operate on
+/// the bottom end of the deque (LIFO). Any thread may call \ref Steal, which
+/// takes from the top end (FIFO). Elements are owned by the deque while
+/// queued and are handed out as unique pointers (using the given deleter).
+/// The memory orderings follow "Correct and Efficient Work-Stealing for Weak
+/// Memory Models" (Lê, Pop, Cohen, Zappa Nardelli; PPoPP 2013).
+template <typename T, typename Deleter = std::default_delete<T>>
+class WorkStealingDeque {
+  public:
+    using Ptr = std::unique_ptr<T, Deleter>;
+
+    explicit WorkStealingDeque(std::size_t initial_capacity = kDefaultCapacity)
+        : array_{MakeArray(initial_capacity)} {}
+
+    WorkStealingDeque(WorkStealingDeque const&) = delete;
+    WorkStealingDeque(WorkStealingDeque&&) = delete;
+    auto operator=(WorkStealingDeque const&) -> WorkStealingDeque& = delete;
+    auto operator=(WorkStealingDeque&&) -> WorkStealingDeque& = delete;
+
+    ~WorkStealingDeque() {
+        // No concurrent access is possible anymore, so just drain.
+        while (Pop() != nullptr) {
+        }
+    }
+
+    /// \brief Add element to the bottom end. Owner thread only.
+    void Push(Ptr elem) {
+        auto const b = bottom_.load(std::memory_order_relaxed);
+        auto const t = top_.load(std::memory_order_acquire);
+        auto* a = array_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<std::int64_t>(a->Capacity()) - 1) {
+            a = Grow(a, t, b);
+        }
+        a->Put(b, elem.release());
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /// \brief Take element from the bottom end. Owner thread only.
+    /// \returns nullptr if the deque is empty.
+    [[nodiscard]] auto Pop() noexcept -> Ptr {
+        auto const b = bottom_.load(std::memory_order_relaxed) - 1;
+        auto* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* elem = a->Get(b);
+        if (t == b) {
+            // last element, race against thieves
+            if (not top_.compare_exchange_strong(t,
+                                                 t + 1,
+                                                 std::memory_order_seq_cst,
+                                                 std::memory_order_relaxed)) {
+                elem = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return Ptr{elem};
+    }
+
+    /// \brief Take element from the top end. Can be called by any thread.
+    /// \returns nullptr if the deque is empty or the race for the top element
+    /// was lost.
+    [[nodiscard]] auto Steal() noexcept -> Ptr {
+        auto t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto const b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        auto* a = array_.load(std::memory_order_acquire);
+        T* elem = a->Get(t);
+        if (not top_.compare_exchange_strong(t,
+                                             t + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return Ptr{elem};
+    }
+
+    /// \brief Approximate check for emptiness, e.g., to select a victim.
+    [[nodiscard]] auto Empty() const noexcept -> bool {
+        return bottom_.load(std::memory_order_relaxed) <=
+               top_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    static constexpr std::size_t kDefaultCapacity = 256;
+
+    // Fixed-size ring buffer. Slots are atomic, as thieves might read a slot
+    // concurrently to the owner writing it (the thief's CAS on top_ will fail
+    // in that case, discarding the value read).
+    class Array {
+      public:
+        explicit Array(std::size_t capacity)
+            : mask_{capacity - 1}, slots_(capacity) {}
+
+        [[nodiscard]] auto Capacity() const noexcept -> std::size_t {
+            return mask_ + 1;
+        }
+
+        void Put(std::int64_t i, T* elem) noexcept {
+            slots_[static_cast<std::size_t>(i) & mask_].store(
+                elem, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] auto Get(std::int64_t i) const noexcept -> T* {
+            return slots_[static_cast<std::size_t>(i) & mask_].load(
+                std::memory_order_relaxed);
+        }
+
+      private:
+        std::size_t mask_;
+        std::vector<std::atomic<T*>> slots_;
+    };
+
+    // Arrays are never freed while the deque is alive, as thieves might still
+    // read from an array that was already replaced. Only the owner modifies
+    // this list. Must be declared before array_.
+    std::vector<std::unique_ptr<Array>> arrays_;
+    alignas(64) std::atomic<std::int64_t> top_{0};
+    alignas(64) std::atomic<std::int64_t> bottom_{0};
+    alignas(64) std::atomic<Array*> array_;
+
+    [[nodiscard]] auto MakeArray(std::size_t capacity) -> Array* {
+        // round up to the next power of two
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1U;
+        }
+        return arrays_.emplace_back(std::make_unique<Array>(size)).get();
+    }
+
+    [[nodiscard]] auto Grow(gsl::not_null<Array*> const& old,
+                            std::int64_t top,
+                            std::int64_t bottom) -> Array* {
+        auto* a = MakeArray(old->Capacity() * 2);
+        for (auto i = top; i < bottom; ++i) {
+            a->Put(i, old->Get(i));
+        }
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_MULTITHREADING_WORK_STEALING_DEQUE_HPP
@@ -0,0 +1,131 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/profile/action_timings.hpp"
+
+#include <exception>
+#include <mutex>
+
+#include "nlohmann/json.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/buildtool/logging/log_level.hpp"
+#include "src/buildtool/logging/logger.hpp"
+#include "src/utils/cpp/tmp_dir.hpp"
+
+namespace {
+
+[[nodiscard]] auto ReadTimings(std::filesystem::path const& file) noexcept
+    -> std::unordered_map<std::string, double> {
+    std::unordered_map<std::string, double> timings{};
+    if (not FileSystemManager::IsFile(file)) {
+        return timings;
+    }
+    try {
+        auto content = FileSystemManager::ReadFile(file);
+        if (not content) {
+            return timings;
+        }
+        auto json = nlohmann::json::parse(*content);
+        for (auto const& [id, seconds] : json.items()) {
+            if (seconds.is_number()) {
+                timings.emplace(id, seconds.get<double>());
+            }
+        }
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Debug,
+                    "Ignoring malformed action timings {}:\n{}",
+                    file.string(),
+                    e.what());
+        timings.clear();
+    }
+    return timings;
+}
+
+}  // namespace
+
+ActionTimings::ActionTimings(
+    gsl::not_null<StorageConfig const*> const& storage_config) noexcept
+    : storage_config_{storage_config},
+      known_{ReadTimings(storage_config_->ActionTimingsFile())} {}
+
+auto ActionTimings::Get(std::string const& action_id) const noexcept
+    -> std::optional<double> {
+    std::shared_lock lock{mutex_};
+    if (auto it = noted_.find(action_id); it != noted_.end()) {
+        return it->second;
+    }
+    if (auto it = known_.find(action_id); it != known_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+auto ActionTimings::Mean() const noexcept -> std::optional<double> {
+    std::shared_lock lock{mutex_};
+    if (known_.empty()) {
+        return std::nullopt;
+    }
+    double sum{};
+    for (auto const& [id, seconds] : known_) {
+        sum += seconds;
+    }
+    return sum / static_cast<double>(known_.size());
+}
+
+void ActionTimings::Note(std::string const& action_id,
+                         double seconds) noexcept {
+    try {
+        std::unique_lock lock{mutex_};
+        noted_[action_id] = seconds;
+    } catch (...) {
+        // timings are best effort only
+    }
+}
+
+auto ActionTimings::Save() const noexcept -> bool {
+    std::shared_lock lock{mutex_};
+    if (noted_.empty()) {
+        return true;
+    }
+    auto const file = storage_config_->ActionTimingsFile();
+    try {
+        auto json = nlohmann::json::object();
+        for (auto const& [id, seconds] : noted_) {
+            json[id] = seconds;
+        }
+        for (auto const& [id, seconds] : ReadTimings(file)) {
+            if (json.size() >= kMaxEntries) {
+                break;
+            }
+            if (not json.contains(id)) {
+                json[id] = seconds;
+            }
+        }
+
+        // write safely, so use the rename trick
+        auto tmp_dir = storage_config_->CreateTypedTmpDir("action-timings");
+        if (not tmp_dir) {
+            return false;
+        }
+        auto tmp_file = tmp_dir->GetPath() / "action-timings";
+        return FileSystemManager::WriteFile(json.dump(), tmp_file) and
+               FileSystemManager::Rename(tmp_file, file);
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Debug,
+                    "Failed to save action timings {}:\n{}",
+                    file.string(),
+                    e.what());
+        return false;
+    }
+}
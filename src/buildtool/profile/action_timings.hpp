@@ -0,0 +1,63 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_PROFILE_ACTION_TIMINGS_HPP
+#define INCLUDED_SRC_BUILDTOOL_PROFILE_ACTION_TIMINGS_HPP
+
+#include <cstddef>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "gsl/gsl"
+#include "src/buildtool/storage/config.hpp"
+
+/// \brief Persistent store of the execution times of actions, keyed by action
+/// identifier. Used to estimate the duration of actions in later builds. The
+/// store is best effort: a missing or malformed file results in an empty
+/// store, and concurrent builds saving to the same file may lose updates of
+/// each other. Get and Note are thread-safe.
+class ActionTimings {
+  public:
+    /// \brief Load the timings recorded in the local build root, if any.
+    explicit ActionTimings(
+        gsl::not_null<StorageConfig const*> const& storage_config) noexcept;
+
+    /// \brief Recorded execution time of an action in seconds, if known.
+    [[nodiscard]] auto Get(std::string const& action_id) const noexcept
+        -> std::optional<double>;
+
+    /// \brief Mean of all known execution times in seconds, if any.
+    [[nodiscard]] auto Mean() const noexcept -> std::optional<double>;
+
+    /// \brief Record the execution time of an action in seconds.
+    void Note(std::string const& action_id, double seconds) noexcept;
+
+    /// \brief Write the timings noted so far back to the file. The file is
+    /// re-read before, to not discard timings saved by concurrent builds. If
+    /// the store exceeds its maximal size, timings not noted by this
+    /// instance are dropped.
+    [[nodiscard]] auto Save() const noexcept -> bool;
+
+  private:
+    static constexpr std::size_t kMaxEntries = std::size_t{1} << 16U;
+
+    gsl::not_null<StorageConfig const*> storage_config_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, double> known_;
+    std::unordered_map<std::string, double> noted_;
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_PROFILE_ACTION_TIMINGS_HPP
@@ -0,0 +1,236 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/profile/profile.hpp"
+
+#include <sys/resource.h>
+
+#include <exception>
+#include <fstream>
+
+#include "src/buildtool/logging/log_level.hpp"
+#include "src/buildtool/logging/logger.hpp"
+
+namespace {
+
+[[nodiscard]] auto Seconds(Profile::Clock::duration d) noexcept -> double {
+    return std::chrono::duration<double>(d).count();
+}
+
+[[nodiscard]] auto Seconds(timeval const& tv) noexcept -> double {
+    return static_cast<double>(tv.tv_sec) +
+           (static_cast<double>(tv.tv_usec) / 1e6);
+}
+
+[[nodiscard]] auto PhaseName(Profile::ActionPhase phase) noexcept
+    -> char const* {
+    switch (phase) {
+        case Profile::ActionPhase::kStaging:
+            return "staging";
+        case Profile::ActionPhase::kUpload:
+            return "upload";
+        case Profile::ActionPhase::kExecution:
+            return "execution";
+        case Profile::ActionPhase::kCollection:
+            return "collection";
+    }
+    return "unknown";
+}
+
+// CPU time consumed by this process and by all of its waited-for children
+// (i.e., locally executed actions).
+[[nodiscard]] auto ProcessCpuTime() -> nlohmann::json {
+    auto cpu = nlohmann::json::object();
+    struct rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        cpu["user"] = Seconds(usage.ru_utime);
+        cpu["system"] = Seconds(usage.ru_stime);
+    }
+    if (getrusage(RUSAGE_CHILDREN, &usage) == 0) {
+        cpu["children user"] = Seconds(usage.ru_utime);
+        cpu["children system"] = Seconds(usage.ru_stime);
+    }
+    return cpu;
+}
+
+}  // namespace
+
+void Profile::NoteAnalysisStart(
+    BuildMaps::Target::ConfiguredTarget const& target) noexcept {
+    auto now = Clock::now();
+    try {
+        std::unique_lock lock{mutex_};
+        analysis_.emplace(target, AnalysisData{.start = now, .end = {}});
+    } catch (...) {
+        // profiling is best effort only
+    }
+}
+
+void Profile::NoteAnalysisEnd(
+    BuildMaps::Target::ConfiguredTarget const& target) noexcept {
+    auto now = Clock::now();
+    std::unique_lock lock{mutex_};
+    if (auto it = analysis_.find(target); it != analysis_.end()) {
+        it->second.end = now;
+    }
+}
+
+void Profile::NoteActionQueued(std::string const& action_id) noexcept {
+    auto now = Clock::now();
+    try {
+        std::unique_lock lock{mutex_};
+        actions_[action_id].queued = now;
+    } catch (...) {
+        // profiling is best effort only
+    }
+}
+
+void Profile::NoteActionStarted(std::string const& action_id) noexcept {
+    auto now = Clock::now();
+    try {
+        std::unique_lock lock{mutex_};
+        actions_[action_id].started = now;
+    } catch (...) {
+        // profiling is best effort only
+    }
+}
+
+void Profile::NoteActionPhase(std::string const& action_id,
+                              ActionPhase phase,
+                              Clock::time_point start) noexcept {
+    auto duration = Clock::now() - start;
+    try {
+        std::unique_lock lock{mutex_};
+        actions_[action_id].phases[phase] += duration;
+    } catch (...) {
+        // profiling is best effort only
+    }
+}
+
+void Profile::NoteActionCompleted(
+    std::string const& action_id,
+    bool cached,
+    int exit_code,
+    std::map<std::string, std::size_t> output_sizes) noexcept {
+    try {
+        std::unique_lock lock{mutex_};
+        auto& data = actions_[action_id];
+        data.cached = cached;
+        data.exit_code = exit_code;
+        data.output_sizes = std::move(output_sizes);
+    } catch (...) {
+        // profiling is best effort only
+    }
+}
+
+void Profile::NoteActionResourceUsage(std::string const& action_id,
+                                      ResourceUsage const& usage) noexcept {
+    try {
+        std::unique_lock lock{mutex_};
+        actions_[action_id].resource_usage = usage;
+    } catch (...) {
+        // profiling is best effort only
+    }
+}
+
+void Profile::Write(gsl::not_null<Progress*> const& progress) const noexcept {
+    try {
+        auto profile = ToJson(progress);
+        std::ofstream os(output_file_);
+        os << profile.dump(2) << std::endl;
+        if (not os.good()) {
+            Logger::Log(LogLevel::Warning,
+                        "Failed to write profile to {}",
+                        output_file_.string());
+        }
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Warning,
+                    "Failed to write profile to {}:\n{}",
+                    output_file_.string(),
+                    e.what());
+    }
+}
+
+auto Profile::ToJson(gsl::not_null<Progress*> const& progress) const
+    -> nlohmann::json {
+    std::unique_lock lock{mutex_};
+    auto const& origin_map = progress->OriginMap();
+
+    auto analysis = nlohmann::json::array();
+    for (auto const& [target, data] : analysis_) {
+        auto entry = nlohmann::json{{"target", target.target.ToJson()},
+                                    {"config", target.config.ToJson()},
+                                    {"start", Offset(data.start)}};
+        if (data.end) {
+            entry["end"] = Offset(*data.end);
+            entry["duration"] = Seconds(*data.end - data.start);
+        }
+        analysis.emplace_back(std::move(entry));
+    }
+
+    auto actions = nlohmann::json::object();
+    for (auto const& [id, data] : actions_) {
+        auto entry = nlohmann::json::object();
+        auto origins = nlohmann::json::array();
+        if (auto it = origin_map.find(id); it != origin_map.end()) {
+            for (auto const& [ct, count] : it->second) {
+                origins.push_back(
+                    nlohmann::json{{"target", ct.target.ToJson()},
+                                   {"subtask", count},
+                                   {"config", ct.config.ToJson()}});
+            }
+        }
+        entry["origins"] = std::move(origins);
+        if (data.cached) {
+            entry["cached"] = *data.cached;
+        }
+        if (data.exit_code) {
+            entry["exit code"] = *data.exit_code;
+        }
+        auto durations = nlohmann::json::object();
+        if (data.queued and data.started) {
+            durations["queue"] = Seconds(*data.started - *data.queued);
+        }
+        for (auto const& [phase, duration] : data.phases) {
+            durations[PhaseName(phase)] = Seconds(duration);
+        }
+        entry["durations"] = std::move(durations);
+        if (data.started) {
+            entry["start"] = Offset(*data.started);
+        }
+        if (not data.output_sizes.empty()) {
+            entry["output sizes"] = data.output_sizes;
+        }
+        if (data.resource_usage) {
+            auto const& usage = *data.resource_usage;
+            entry["resource usage"] = nlohmann::json{
+                {"user", Seconds(usage.user_time)},
+                {"system", Seconds(usage.system_time)},
+                {"max rss kib", usage.max_rss_kib},
+                {"input blocks", usage.input_blocks},
+                {"output blocks", usage.output_blocks},
+                {"spawn", Seconds(usage.spawn_time)}};
+        }
+        actions[id] = std::move(entry);
+    }
+
+    return nlohmann::json{{"wall time", Offset(Clock::now())},
+                          {"cpu time", ProcessCpuTime()},
+                          {"analysis", std::move(analysis)},
+                          {"actions", std::move(actions)}};
+}
+
+auto Profile::Offset(Clock::time_point t) const noexcept -> double {
+    return Seconds(t - start_);
+}
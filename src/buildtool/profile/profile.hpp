@@ -0,0 +1,115 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_PROFILE_PROFILE_HPP
+#define INCLUDED_SRC_BUILDTOOL_PROFILE_PROFILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "gsl/gsl"
+#include "nlohmann/json.hpp"
+#include "src/buildtool/build_engine/target_map/configured_target.hpp"
+#include "src/buildtool/common/resource_usage.hpp"
+#include "src/buildtool/progress_reporting/progress.hpp"
+
+/// \brief Collects timing information of a build, to be written as JSON file
+/// on request (--profile). All Note* methods are thread-safe and intended to
+/// be called from the tasks of the analysis and the execution phase. Times
+/// are reported in seconds, relative to the construction of the profile.
+class Profile {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// \brief Phases of processing a single action.
+    enum class ActionPhase : std::uint8_t {
+        kStaging,     ///< creating and uploading the input root
+        kUpload,      ///< syncing the input root to a dispatch endpoint
+        kExecution,   ///< executing the action (or looking it up in cache)
+        kCollection,  ///< obtaining the outputs and storing their infos
+    };
+
+    explicit Profile(std::filesystem::path output_file) noexcept
+        : output_file_{std::move(output_file)}, start_{Clock::now()} {}
+
+    void NoteAnalysisStart(
+        BuildMaps::Target::ConfiguredTarget const& target) noexcept;
+    void NoteAnalysisEnd(
+        BuildMaps::Target::ConfiguredTarget const& target) noexcept;
+
+    /// \brief Note that the action became ready and was queued for processing.
+    void NoteActionQueued(std::string const& action_id) noexcept;
+
+    /// \brief Note that processing of a queued action has started.
+    void NoteActionStarted(std::string const& action_id) noexcept;
+
+    /// \brief Note the end of a phase of an action that began at start.
+    void NoteActionPhase(std::string const& action_id,
+                         ActionPhase phase,
+                         Clock::time_point start) noexcept;
+
+    /// \brief Note the result of an action.
+    /// \param output_sizes Size of each output, keyed by output path.
+    void NoteActionCompleted(
+        std::string const& action_id,
+        bool cached,
+        int exit_code,
+        std::map<std::string, std::size_t> output_sizes) noexcept;
+
+    /// \brief Note the resource usage of an executed action.
+    void NoteActionResourceUsage(std::string const& action_id,
+                                 ResourceUsage const& usage) noexcept;
+
+    /// \brief Write the collected data. The origins of the actions are taken
+    /// from the given progress, which therefore must not be modified
+    /// concurrently.
+    void Write(gsl::not_null<Progress*> const& progress) const noexcept;
+
+  private:
+    struct AnalysisData {
+        Clock::time_point start;
+        std::optional<Clock::time_point> end;
+    };
+
+    struct ActionData {
+        std::optional<Clock::time_point> queued;
+        std::optional<Clock::time_point> started;
+        std::map<ActionPhase, Clock::duration> phases;
+        std::optional<bool> cached;
+        std::optional<int> exit_code;
+        std::map<std::string, std::size_t> output_sizes;
+        std::optional<ResourceUsage> resource_usage;
+    };
+
+    std::filesystem::path output_file_;
+    Clock::time_point start_;
+    mutable std::mutex mutex_;
+    std::unordered_map<BuildMaps::Target::ConfiguredTarget, AnalysisData>
+        analysis_;
+    std::unordered_map<std::string, ActionData> actions_;
+
+    [[nodiscard]] auto ToJson(gsl::not_null<Progress*> const& progress) const
+        -> nlohmann::json;
+    [[nodiscard]] auto Offset(Clock::time_point t) const noexcept -> double;
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_PROFILE_PROFILE_HPP
@@ -151,6 +151,8 @@ auto ServeServerImpl::Run(
             StorageConfig::Builder{}
                 .SetBuildRoot(local_context->storage_config->build_root)
                 .SetHashType(HashFunction::Type::GitSHA1)
+                .SetChunkingProfile(
+                    local_context->storage_config->chunking_profile)
                 .Build();
         if (not config) {
             Logger::Log(LogLevel::Error, config.error());
@@ -163,7 +163,8 @@ auto TargetService::CreateRemoteExecutionConfig(
         .remote_address = remote_context_.exec_config->remote_address,
         .dispatch = *std::move(res),
         .cache_address = remote_context_.exec_config->cache_address,
-        .platform_properties = std::move(platform_properties)};
+        .platform_properties = std::move(platform_properties),
+        .compression_level = remote_context_.exec_config->compression_level};
 }
 
 auto TargetService::ServeTarget(
@@ -16,9 +16,16 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
+#include <fstream>
+#include <map>
 #include <optional>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 #include "src/buildtool/common/artifact_digest_factory.hpp"
@@ -30,6 +37,8 @@
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
 #include "src/buildtool/storage/compactification_task.hpp"
+#include "src/buildtool/storage/file_chunker.hpp"
+#include "src/buildtool/storage/large_object_cas.hpp"
 #include "src/utils/cpp/hex_string.hpp"
 
 namespace {
@@ -72,6 +81,26 @@ template <ObjectType kType>
 [[nodiscard]] auto SplitLarge(CompactificationTask const& task,
                               std::filesystem::path const& key) noexcept
     -> bool;
+
+/// \brief Check whether a file looks like compressed or encrypted content,
+/// which does not deduplicate. The byte entropy of a few samples of the file
+/// is checked to be close to the maximum of 8 bits per byte.
+[[nodiscard]] auto IsIncompressible(std::filesystem::path const& path) noexcept
+    -> bool;
+
+/// \brief Statistics of the large objects split with one chunking profile.
+struct DeduplicationStats final {
+    std::size_t objects = 0;
+    std::uint64_t total_size = 0;
+    std::uint64_t chunks_size = 0;
+    std::unordered_set<std::string> chunks;
+};
+
+/// \brief Add the large entries of a large storage to the statistics.
+[[nodiscard]] auto CollectDeduplicationStats(
+    std::filesystem::path const& large_root,
+    HashFunction::Type hash_type,
+    std::map<ChunkingProfile, DeduplicationStats>* stats) noexcept -> bool;
 }  // namespace
 
 auto Compactifier::RemoveInvalid(LocalCAS<false> const& cas) noexcept -> bool {
@@ -141,6 +170,40 @@ auto Compactifier::SplitLarge(LocalCAS<false> const& cas,
     return CompactifyConcurrently(task);
 }
 
+auto Compactifier::ReportDeduplication(LocalCAS<false> const& cas) noexcept
+    -> bool {
+    auto const hash_type = cas.GetHashFunction().GetType();
+    static constexpr bool kLarge = true;
+    auto const& file_root = cas.StorageRoot(ObjectType::File, kLarge);
+    auto const& tree_root = cas.StorageRoot(ObjectType::Tree, kLarge);
+
+    // In compatible mode, large trees are stored with large files.
+    std::map<ChunkingProfile, DeduplicationStats> stats;
+    bool success = CollectDeduplicationStats(file_root, hash_type, &stats);
+    if (tree_root != file_root) {
+        success = CollectDeduplicationStats(tree_root, hash_type, &stats) and
+                  success;
+    }
+
+    for (auto const& [profile, profile_stats] : stats) {
+        Logger::Log(
+            LogLevel::Info,
+            "Compactification: {} large objects of {} bytes split with "
+            "chunking profile \"{}\" into {} distinct chunks of {} bytes "
+            "(deduplication ratio {:.2f})",
+            profile_stats.objects,
+            profile_stats.total_size,
+            ToString(profile),
+            profile_stats.chunks.size(),
+            profile_stats.chunks_size,
+            profile_stats.chunks_size == 0
+                ? 1.0
+                : static_cast<double>(profile_stats.total_size) /
+                      static_cast<double>(profile_stats.chunks_size));
+    }
+    return success;
+}
+
 namespace {
 template <ObjectType kType>
 [[nodiscard]] auto RemoveInvalid(CompactificationTask const& task,
@@ -269,6 +332,15 @@ template <ObjectType kType>
         return true;
     }
 
+    // Content that does not deduplicate is kept as is; splitting it would
+    // only add the overhead of the chunks.
+    if (IsIncompressible(path)) {
+        task.Log(LogLevel::Debug,
+                 "{} is not compactified, its content does not deduplicate.",
+                 path.string());
+        return true;
+    }
+
     // Calculate the digest for the entry:
     auto const digest = ArtifactDigestFactory::HashFileAs<kType>(
         task.cas.GetHashFunction(), path);
@@ -307,4 +379,105 @@ template <ObjectType kType>
     }
     return true;
 }
+
+auto IsIncompressible(std::filesystem::path const& path) noexcept -> bool {
+    // Samples are taken from the beginning, the middle, and the end of the
+    // file, to not be fooled by headers or trailers of archives.
+    static constexpr std::size_t kSampleSize = std::size_t{64} << 10U;
+    static constexpr std::size_t kSamples = 3;
+    static constexpr double kMaxEntropy = 7.9;  // bits per byte
+    try {
+        auto const size = std::filesystem::file_size(path);
+        if (size < kSampleSize * kSamples) {
+            return false;
+        }
+        std::ifstream stream{path, std::ios::binary};
+        std::array<std::size_t, 256> counts{};
+        std::string sample(kSampleSize, '\0');
+        for (std::size_t i = 0; i < kSamples; ++i) {
+            auto const offset = (size - kSampleSize) / (kSamples - 1) * i;
+            stream.seekg(static_cast<std::streamoff>(offset));
+            if (not stream.read(sample.data(),
+                                static_cast<std::streamsize>(kSampleSize))) {
+                return false;
+            }
+            for (auto c : sample) {
+                ++counts.at(static_cast<std::uint8_t>(c));
+            }
+        }
+
+        double entropy = 0.0;
+        auto const total = static_cast<double>(kSampleSize * kSamples);
+        for (auto count : counts) {
+            if (count != 0) {
+                auto const p = static_cast<double>(count) / total;
+                entropy -= p * std::log2(p);
+            }
+        }
+        return entropy >= kMaxEntropy;
+    } catch (...) {
+        return false;
+    }
+}
+
+auto CollectDeduplicationStats(
+    std::filesystem::path const& large_root,
+    HashFunction::Type hash_type,
+    std::map<ChunkingProfile, DeduplicationStats>* stats) noexcept -> bool {
+    if (not FileSystemManager::IsDirectory(large_root)) {
+        return true;
+    }
+
+    bool success = true;
+    FileSystemManager::ReadDirEntryFunc read_entry =
+        [&success, hash_type, stats](std::filesystem::path const& path,
+                                     ObjectType type) -> bool {
+        if (IsTreeObject(type)) {
+            return true;
+        }
+        auto const content = FileSystemManager::ReadFile(path);
+        auto entry = content ? LargeObjectEntry::Parse(*content, hash_type)
+                             : std::nullopt;
+        if (not entry) {
+            Logger::Log(LogLevel::Warning,
+                        "Compactification: Failed to read large entry {}",
+                        path.string());
+            success = false;
+            return true;
+        }
+        try {
+            auto& profile_stats = (*stats)[entry->profile];
+            ++profile_stats.objects;
+            for (auto const& part : entry->parts) {
+                profile_stats.total_size += part.size();
+                if (profile_stats.chunks.emplace(part.hash()).second) {
+                    profile_stats.chunks_size += part.size();
+                }
+            }
+        } catch (std::exception const& e) {
+            Logger::Log(LogLevel::Warning,
+                        "Compactification: Failed to count {}:\n{}",
+                        path.string(),
+                        e.what());
+            success = false;
+        }
+        return true;
+    };
+
+    FileSystemManager::ReadDirEntryFunc read_key =
+        [&large_root, &read_entry](std::filesystem::path const& key,
+                                   ObjectType type) -> bool {
+        if (not IsTreeObject(type)) {
+            return true;
+        }
+        auto const directory = large_root / key;
+        return FileSystemManager::ReadDirectory(
+            directory,
+            [&directory, &read_entry](std::filesystem::path const& file,
+                                      ObjectType type) {
+                return read_entry(directory / file, type);
+            });
+    };
+    return FileSystemManager::ReadDirectory(large_root, read_key) and success;
+}
 }  // namespace
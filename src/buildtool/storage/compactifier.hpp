@@ -45,6 +45,14 @@ class Compactifier final {
     /// entries larger than the compactification threshold afterwards.
     [[nodiscard]] static auto SplitLarge(LocalCAS<false> const& cas,
                                          size_t threshold) noexcept -> bool;
+
+    /// \brief Report, for each chunking profile, how well the large objects
+    /// split with that profile deduplicate, i.e., the ratio of their total
+    /// size to the size of their distinct chunks.
+    /// \param local_cas      Storage to be inspected.
+    /// \return               True if all large entries could be read.
+    [[nodiscard]] static auto ReportDeduplication(
+        LocalCAS<false> const& cas) noexcept -> bool;
 };
 
 #endif  // INCLUDED_SRC_BUILDTOOL_STORAGE_COMPACTIFIER_HPP
@@ -32,6 +32,7 @@
 #include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/storage/backend_description.hpp"
+#include "src/buildtool/storage/file_chunker.hpp"
 #include "src/utils/cpp/expected.hpp"
 #include "src/utils/cpp/gsl.hpp"
 #include "src/utils/cpp/tmp_dir.hpp"
@@ -47,6 +48,7 @@ struct GenerationConfig final {
     std::filesystem::path const cas_large_t;
     std::filesystem::path const action_cache;
     std::filesystem::path const target_cache;
+    std::filesystem::path const materialised_trees;
 };
 
 struct StorageConfig final {
@@ -69,6 +71,9 @@ struct StorageConfig final {
     // Hash of the execution backend description
     std::string const backend_description_id = DefaultBackendDescriptionId();
 
+    // Chunking profile used for splitting large objects.
+    ChunkingProfile const chunking_profile = ChunkingProfile::Default;
+
     /// \brief Root directory of all storage generations.
     [[nodiscard]] auto CacheRoot() const noexcept -> std::filesystem::path {
         return build_root / "protocol-dependent";
@@ -119,6 +124,22 @@ struct StorageConfig final {
         return EphemeralRoot() / "exec_root";
     }
 
+    /// \brief File recording the execution times of previously executed
+    /// actions. Not part of any generation, as it is only used as a hint.
+    [[nodiscard]] auto ActionTimingsFile() const noexcept
+        -> std::filesystem::path {
+        return CacheRoot() / "action-timings";
+    }
+
+    /// \brief File caching the digests of files of file-system roots. Not
+    /// part of any generation, as entries are validated against the file
+    /// system before use.
+    [[nodiscard]] auto FileHashCacheFile() const noexcept
+        -> std::filesystem::path {
+        bool const native = ProtocolTraits::IsNative(hash_function.GetType());
+        return UpdatePathForCompatibility(CacheRoot() / "file-hashes", native);
+    }
+
     /// \brief Create a tmp directory with controlled lifetime for specific
     /// operations (archive, zip, file, distdir checkouts; fetch; update).
     [[nodiscard]] auto CreateTypedTmpDir(std::string const& type) const noexcept
@@ -142,7 +163,8 @@ struct StorageConfig final {
             .cas_large_f = cache_dir / "cas-large-f",
             .cas_large_t = cache_dir / (native ? "cas-large-t" : "cas-large-f"),
             .action_cache = cache_dir / "ac",
-            .target_cache = cache_dir / "tc"};
+            .target_cache = cache_dir / "tc",
+            .materialised_trees = cache_dir / "trees"};
     };
 
   private:
@@ -184,6 +206,12 @@ class StorageConfig::Builder final {
         return *this;
     }
 
+    /// \brief Specify the chunking profile for splitting large objects
+    auto SetChunkingProfile(ChunkingProfile value) noexcept -> Builder& {
+        chunking_profile_ = value;
+        return *this;
+    }
+
     auto SetRemoteExecutionArgs(std::optional<ServerAddress> address,
                                 ExecutionProperties properties,
                                 std::vector<DispatchEndpoint> dispatch) noexcept
@@ -241,13 +269,16 @@ class StorageConfig::Builder final {
             .build_root = std::move(build_root),
             .num_generations = num_generations,
             .hash_function = hash_function,
-            .backend_description_id = std::move(backend_description_id)};
+            .backend_description_id = std::move(backend_description_id),
+            .chunking_profile =
+                chunking_profile_.value_or(default_config.chunking_profile)};
     }
 
   private:
     std::optional<std::filesystem::path> build_root_;
     std::optional<std::size_t> num_generations_;
     std::optional<HashFunction::Type> hash_type_;
+    std::optional<ChunkingProfile> chunking_profile_;
 
     // Fields for computing remote execution backend description
     std::optional<ServerAddress> remote_address_;
@@ -14,10 +14,16 @@
 
 #include "src/buildtool/storage/file_chunker.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cerrno>
+#include <cstring>
 #include <random>
+#include <tuple>
+#include <utility>
 
-#include "gsl/gsl"
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace {
 
@@ -31,8 +37,140 @@ constexpr std::uint32_t kRandomTableSize{256};
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 std::array<std::uint64_t, kRandomTableSize> gear_table{};
 
+// Minimal size of the read buffer, which holds at least two maximal chunks, so
+// that the file is read in large blocks also for small chunks.
+constexpr std::size_t kMinBufferSize{std::size_t{4} << 20U};
+
+// Targeted average chunk sizes of the chunking profiles.
+constexpr std::uint32_t kDefaultAverageChunkSize{1024 * 128};  // 128 KB
+constexpr std::uint32_t kSmallAverageChunkSize{1024 * 16};     // 16 KB
+constexpr std::uint32_t kLargeAverageChunkSize{1024 * 1024};   // 1 MB
+
+[[nodiscard]] auto AverageChunkSize(ChunkingProfile profile) noexcept
+    -> std::uint32_t {
+    switch (profile) {
+        case ChunkingProfile::Small:
+            return kSmallAverageChunkSize;
+        case ChunkingProfile::Large:
+            return kLargeAverageChunkSize;
+        case ChunkingProfile::Default:
+            break;
+    }
+    return kDefaultAverageChunkSize;
+}
+
+// Number of bytes processed per iteration of the unrolled boundary scan.
+constexpr std::size_t kUnroll{8};
+
+/// @brief Roll the gear hash over the bytes data[kOffsets...] in order, until
+/// the masked bits of the hash are all '0'.
+/// @return The offset of the boundary or kUnroll if there is none.
+template <std::uint64_t kMask, std::size_t... kOffsets>
+[[nodiscard]] auto ScanBlock(
+    unsigned char const* data,
+    std::uint64_t* fp,
+    std::index_sequence<kOffsets...> /*unused*/) noexcept -> std::size_t {
+    auto const* table = gear_table.data();
+    auto hash = *fp;
+    std::size_t found = kUnroll;
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::ignore = ((hash = (hash << 1U) + table[data[kOffsets]],
+                    (hash & kMask) == 0 and (found = kOffsets, true)) or
+                   ...);
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    *fp = hash;
+    return found;
+}
+
+/// @brief Roll the gear hash over data[*pos, end) until the masked bits of the
+/// hash are all '0'. The table is indexed by bytes, so no bounds checks are
+/// needed, and the loop is unrolled by hand, as the compiler does not unroll
+/// a loop with an early exit.
+/// @return True if a boundary was found, which is then at *pos.
+template <std::uint64_t kMask>
+[[nodiscard]] auto ScanBoundary(unsigned char const* data,
+                                std::size_t end,
+                                std::size_t* pos,
+                                std::uint64_t* fp) noexcept -> bool {
+    auto i = *pos;
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    for (; i + kUnroll <= end; i += kUnroll) {
+        auto const offset = ScanBlock<kMask>(
+            data + i, fp, std::make_index_sequence<kUnroll>{});
+        if (offset < kUnroll) {
+            *pos = i + offset;
+            return true;
+        }
+    }
+    for (; i < end; ++i) {
+        if (ScanBlock<kMask>(data + i, fp, std::index_sequence<0>{}) == 0) {
+            *pos = i;
+            return true;
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    *pos = i;
+    return false;
+}
+
 }  // namespace
 
+auto ToString(ChunkingProfile profile) noexcept -> std::string {
+    switch (profile) {
+        case ChunkingProfile::Small:
+            return "small";
+        case ChunkingProfile::Large:
+            return "large";
+        case ChunkingProfile::Default:
+            break;
+    }
+    return "default";
+}
+
+auto ChunkingProfileFromString(std::string const& name) noexcept
+    -> std::optional<ChunkingProfile> {
+    for (auto profile : {ChunkingProfile::Default,
+                         ChunkingProfile::Small,
+                         ChunkingProfile::Large}) {
+        if (ToString(profile) == name) {
+            return profile;
+        }
+    }
+    return std::nullopt;
+}
+
+auto ChunkingProfileNames() noexcept -> std::vector<std::string> {
+    return {ToString(ChunkingProfile::Default),
+            ToString(ChunkingProfile::Small),
+            ToString(ChunkingProfile::Large)};
+}
+
+FileChunker::FileChunker(std::filesystem::path const& path,
+                         ChunkingProfile profile)
+    // According to section 4.1 of the paper
+    // https://ieeexplore.ieee.org/document/9055082, maximum and minimum
+    // chunk sizes are configured to the 8x and the 1/4x of the average
+    // chunk size.
+    : min_chunk_size_(AverageChunkSize(profile) >> 2U),
+      average_chunk_size_(AverageChunkSize(profile)),
+      max_chunk_size_(AverageChunkSize(profile) << 3U),
+      fd_{::open(path.c_str(), O_RDONLY | O_CLOEXEC)} {
+    if (fd_ >= 0) {
+        ::posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    // The buffer size needs to be at least max_chunk_size_ large, otherwise
+    // max_chunk_size_ is not fully exhausted and the buffer size determines
+    // the maximum chunk size.
+    buffer_.resize(
+        std::max(std::size_t{max_chunk_size_} << 1U, kMinBufferSize));
+}
+
+FileChunker::~FileChunker() noexcept {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
 auto FileChunker::Initialize(std::uint32_t seed) noexcept -> void {
     std::mt19937_64 gen64(seed);
     for (auto& item : gear_table) {
@@ -41,33 +179,31 @@ auto FileChunker::Initialize(std::uint32_t seed) noexcept -> void {
 }
 
 auto FileChunker::IsOpen() const noexcept -> bool {
-    return stream_.is_open();
+    return fd_ >= 0;
 }
 
 auto FileChunker::Finished() const noexcept -> bool {
-    return stream_.eof() and pos_ == size_;
+    return eof_ and not failed_ and pos_ == size_;
 }
 
-auto FileChunker::NextChunk() noexcept -> std::optional<std::string> {
-    // Handle failed past read attempts from the stream.
-    if (not stream_.good() and not stream_.eof()) {
+auto FileChunker::NextChunk() noexcept -> std::optional<std::string_view> {
+    // Handle failed past read attempts from the file.
+    if (failed_) {
         return std::nullopt;
     }
 
     // Ensure that at least max_chunk_size bytes are in the buffer, except if
     // end-of-file is reached.
     auto remaining = size_ - pos_;
-    if (remaining < max_chunk_size_ and not stream_.eof()) {
+    if (remaining < max_chunk_size_ and not eof_) {
         // Move the remaining bytes of the buffer to the front.
-        buffer_.copy(buffer_.data(), remaining, pos_);
-        auto ssize = static_cast<std::streamsize>(buffer_.size() - remaining);
-        // Fill the buffer with stream content.
-        stream_.read(&buffer_[remaining], ssize);
-        if (not stream_.good() and not stream_.eof()) {
+        std::memmove(buffer_.data(), buffer_.data() + pos_, remaining);
+        size_ = remaining;
+        pos_ = 0;
+        // Fill the buffer with file content.
+        if (not FillBuffer()) {
             return std::nullopt;
         }
-        size_ = static_cast<std::size_t>(stream_.gcount()) + remaining;
-        pos_ = 0;
     }
 
     // Handle finished chunking.
@@ -76,18 +212,38 @@ auto FileChunker::NextChunk() noexcept -> std::optional<std::string> {
     }
 
     auto off = NextChunkBoundary();
-    auto chunk = buffer_.substr(pos_, off);
+    auto chunk = std::string_view{buffer_}.substr(pos_, off);
     pos_ += off;
     return chunk;
 }
 
+auto FileChunker::FillBuffer() noexcept -> bool {
+    while (size_ < buffer_.size()) {
+        auto const count =
+            ::read(fd_, buffer_.data() + size_, buffer_.size() - size_);
+        if (count < 0 and errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            failed_ = true;
+            return false;
+        }
+        if (count == 0) {
+            eof_ = true;
+            break;
+        }
+        size_ += static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
 // Implementation of the FastCDC data deduplication algorithm described in
 // algorithm 2 of the paper https://ieeexplore.ieee.org/document/9055082.
 auto FileChunker::NextChunkBoundary() noexcept -> std::size_t {
     auto n = size_ - pos_;
-    auto fp = 0ULL;
-    auto i = min_chunk_size_;
-    auto normal_size = average_chunk_size_;
+    auto fp = std::uint64_t{0};
+    auto i = std::size_t{min_chunk_size_};
+    auto normal_size = std::size_t{average_chunk_size_};
     if (n <= min_chunk_size_) {
         return n;
     }
@@ -97,19 +253,13 @@ auto FileChunker::NextChunkBoundary() noexcept -> std::size_t {
     else if (n <= normal_size) {
         normal_size = n;
     }
-    for (; i < normal_size; i++) {
-        fp = (fp << 1U) +
-             gsl::at(gear_table, static_cast<std::uint8_t>(buffer_[pos_ + i]));
-        if ((fp & kMaskS) == 0) {
-            return i;  // if the masked bits are all '0'
-        }
-    }
-    for (; i < n; i++) {
-        fp = (fp << 1U) +
-             gsl::at(gear_table, static_cast<std::uint8_t>(buffer_[pos_ + i]));
-        if ((fp & kMaskL) == 0) {
-            return i;  // if the masked bits are all '0'
-        }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    auto const* data = reinterpret_cast<unsigned char const*>(buffer_.data());
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    data += pos_;
+    if (ScanBoundary<kMaskS>(data, normal_size, &i, &fp)) {
+        return i;  // if the masked bits are all '0'
     }
-    return i;
+    std::ignore = ScanBoundary<kMaskL>(data, n, &i, &fp);
+    return i;  // a boundary or the maximal chunk size
 }
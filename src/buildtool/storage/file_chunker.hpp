@@ -18,9 +18,30 @@
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
-#include <fstream>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Parameters of the content-defined chunking of large objects. Small
+/// chunks deduplicate well for content changing in small places, e.g.,
+/// binaries, while large chunks cause less overhead for content that hardly
+/// deduplicates at all.
+enum class ChunkingProfile : std::uint8_t {
+    Default,  // average chunk size of 128 KB
+    Small,    // average chunk size of 16 KB
+    Large     // average chunk size of 1 MB
+};
+
+/// @brief Name of a chunking profile, as used on the command line.
+[[nodiscard]] auto ToString(ChunkingProfile profile) noexcept -> std::string;
+
+/// @brief Chunking profile of the given name, if there is one.
+[[nodiscard]] auto ChunkingProfileFromString(std::string const& name) noexcept
+    -> std::optional<ChunkingProfile>;
+
+/// @brief Names of all chunking profiles.
+[[nodiscard]] auto ChunkingProfileNames() noexcept -> std::vector<std::string>;
 
 /// @brief This class provides content-defined chunking for a file stream. It
 /// allows to split a file stream into variable-sized chunks based on its data
@@ -30,33 +51,22 @@
 /// concatenated in order.
 ///
 /// A read buffer is used to progressively process the file content instead of
-/// reading the entire file content in memory.
+/// reading the entire file content in memory. The buffer holds several maximal
+/// chunks, so that the file is read in large blocks and the rest of the
+/// buffer only rarely has to be moved to its front.
 class FileChunker {
-    static constexpr std::uint32_t kAverageChunkSize{1024 * 128};  // 128 KB
     static constexpr std::uint32_t kDefaultSeed{0};
 
   public:
     /// @brief Create an instance of the file chunker for a given file.
-    /// @param path                 The path to the file to be splitted.
-    /// @param average_chunk_size   Targeted average chunk size in bytes
-    ///                             (default: 8 KB).
-    explicit FileChunker(std::filesystem::path const& path)
-        // According to section 4.1 of the paper
-        // https://ieeexplore.ieee.org/document/9055082, maximum and minimum
-        // chunk sizes are configured to the 8x and the 1/4x of the average
-        // chunk size.
-        : min_chunk_size_(kAverageChunkSize >> 2U),
-          average_chunk_size_(kAverageChunkSize),
-          max_chunk_size_(kAverageChunkSize << 3U),
-          stream_{path, std::ios::in | std::ios::binary} {
-        // The buffer size needs to be at least max_chunk_size_ large, otherwise
-        // max_chunk_size_ is not fully exhausted and the buffer size determines
-        // the maximum chunk size.
-        buffer_.resize(max_chunk_size_ << 1U);
-    }
+    /// @param path     The path to the file to be splitted.
+    /// @param profile  The chunking profile determining the targeted average
+    ///                 chunk size.
+    explicit FileChunker(std::filesystem::path const& path,
+                         ChunkingProfile profile = ChunkingProfile::Default);
 
     FileChunker() noexcept = delete;
-    ~FileChunker() noexcept = default;
+    ~FileChunker() noexcept;
     FileChunker(FileChunker const& other) noexcept = delete;
     FileChunker(FileChunker&& other) noexcept = delete;
     auto operator=(FileChunker const& other) noexcept = delete;
@@ -71,8 +81,10 @@ class FileChunker {
     [[nodiscard]] auto Finished() const noexcept -> bool;
 
     /// @brief Fetch the next chunk from the file stream.
-    /// @return The next chunk of the file stream.
-    [[nodiscard]] auto NextChunk() noexcept -> std::optional<std::string>;
+    /// @return The next chunk of the file stream, which points into the read
+    /// buffer and is only valid until the next call.
+    [[nodiscard]] auto NextChunk() noexcept
+        -> std::optional<std::string_view>;
 
     /// @brief Initialize random number table used by the chunking algorithm.
     /// @param seed Some random seed.
@@ -83,10 +95,16 @@ class FileChunker {
     const std::uint32_t min_chunk_size_{};
     const std::uint32_t average_chunk_size_{};
     const std::uint32_t max_chunk_size_{};
-    std::ifstream stream_;  // File stream to be splitted.
-    std::string buffer_;    // Buffer for the file content.
-    std::size_t size_{0};   // Current size of the buffer.
-    std::size_t pos_{0};    // Current read position within the buffer.
+    int fd_{-1};           // File descriptor of the file to be splitted.
+    bool eof_{false};      // End of the file reached.
+    bool failed_{false};   // Reading from the file failed.
+    std::string buffer_;   // Buffer for the file content.
+    std::size_t size_{0};  // Current size of the buffer.
+    std::size_t pos_{0};   // Current read position within the buffer.
+
+    /// @brief Fill the buffer after its current content from the file.
+    /// @return False if reading from the file failed.
+    [[nodiscard]] auto FillBuffer() noexcept -> bool;
 
     /// @brief Find the next chunk boundary from the current read position
     /// within the buffer.
@@ -0,0 +1,269 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/storage/file_hash_cache.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <sys/stat.h>
+
+#include "fmt/core.h"
+#include "src/buildtool/common/artifact_digest_factory.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/buildtool/file_system/object_type.hpp"
+#include "src/buildtool/logging/log_level.hpp"
+#include "src/buildtool/logging/logger.hpp"
+#include "src/utils/cpp/tmp_dir.hpp"
+
+namespace {
+
+// Files with a timestamp closer than this to the time of hashing are not
+// cached, as a subsequent change might not alter their timestamps.
+constexpr auto kRacyWindow = std::chrono::seconds{2};
+
+[[nodiscard]] auto ToNanoseconds(struct timespec const& time) noexcept
+    -> std::int64_t {
+    constexpr std::int64_t kNanosecondsPerSecond = 1000000000;
+    return static_cast<std::int64_t>(time.tv_sec) * kNanosecondsPerSecond +
+           static_cast<std::int64_t>(time.tv_nsec);
+}
+
+[[nodiscard]] auto StatFile(std::filesystem::path const& path) noexcept
+    -> std::optional<FileHashCache::FileState> {
+    struct stat info{};
+    if (::stat(path.c_str(), &info) != 0 or not S_ISREG(info.st_mode)) {
+        return std::nullopt;
+    }
+    return FileHashCache::FileState{
+        .device = static_cast<std::uint64_t>(info.st_dev),
+        .inode = static_cast<std::uint64_t>(info.st_ino),
+        .size = static_cast<std::uint64_t>(info.st_size),
+        .mtime_ns = ToNanoseconds(info.st_mtim),
+        .ctime_ns = ToNanoseconds(info.st_ctim)};
+}
+
+[[nodiscard]] auto IsRacy(FileHashCache::FileState const& state,
+                          std::int64_t now_ns) noexcept -> bool {
+    auto const window =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(kRacyWindow)
+            .count();
+    return now_ns - std::max(state.mtime_ns, state.ctime_ns) < window;
+}
+
+[[nodiscard]] auto Now() noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+/// \brief Parse the next space-separated number of a line.
+template <class T>
+[[nodiscard]] auto ParseNumber(std::string_view* line) noexcept
+    -> std::optional<T> {
+    T value{};
+    auto const* end = line->data() + line->size();
+    auto [ptr, ec] = std::from_chars(line->data(), end, value);
+    if (ec != std::errc{} or ptr == end or *ptr != ' ') {
+        return std::nullopt;
+    }
+    line->remove_prefix(static_cast<std::size_t>(ptr - line->data()) + 1);
+    return value;
+}
+
+/// \brief Parse a line "<dev> <ino> <size> <mtime> <ctime> <hash> <path>".
+[[nodiscard]] auto ParseEntry(std::string_view line) noexcept
+    -> std::optional<std::pair<std::string, FileHashCache::Entry>> {
+    auto device = ParseNumber<std::uint64_t>(&line);
+    auto inode = ParseNumber<std::uint64_t>(&line);
+    auto size = ParseNumber<std::uint64_t>(&line);
+    auto mtime = ParseNumber<std::int64_t>(&line);
+    auto ctime = ParseNumber<std::int64_t>(&line);
+    auto const space = line.find(' ');
+    if (not device or not inode or not size or not mtime or not ctime or
+        space == std::string_view::npos or space == 0 or
+        space + 1 == line.size()) {
+        return std::nullopt;
+    }
+    return std::pair{
+        std::string{line.substr(space + 1)},
+        FileHashCache::Entry{.state = {.device = *device,
+                                       .inode = *inode,
+                                       .size = *size,
+                                       .mtime_ns = *mtime,
+                                       .ctime_ns = *ctime},
+                             .hash = std::string{line.substr(0, space)}}};
+}
+
+[[nodiscard]] auto ReadEntries(std::filesystem::path const& file) noexcept
+    -> std::unordered_map<std::string, FileHashCache::Entry> {
+    std::unordered_map<std::string, FileHashCache::Entry> entries{};
+    if (not FileSystemManager::IsFile(file)) {
+        return entries;
+    }
+    try {
+        auto content = FileSystemManager::ReadFile(file);
+        if (not content) {
+            return entries;
+        }
+        auto remaining = std::string_view{*content};
+        while (not remaining.empty()) {
+            auto const newline = remaining.find('\n');
+            if (newline == std::string_view::npos) {
+                break;  // ignore truncated last line
+            }
+            if (auto entry = ParseEntry(remaining.substr(0, newline))) {
+                entries.insert_or_assign(std::move(entry->first),
+                                         std::move(entry->second));
+            }
+            remaining.remove_prefix(newline + 1);
+        }
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Debug,
+                    "Ignoring malformed file hash cache {}:\n{}",
+                    file.string(),
+                    e.what());
+        entries.clear();
+    }
+    return entries;
+}
+
+void AppendEntry(std::string const& path,
+                 FileHashCache::Entry const& entry,
+                 std::string* out) {
+    fmt::format_to(std::back_inserter(*out),
+                   "{} {} {} {} {} {} {}\n",
+                   entry.state.device,
+                   entry.state.inode,
+                   entry.state.size,
+                   entry.state.mtime_ns,
+                   entry.state.ctime_ns,
+                   entry.hash,
+                   path);
+}
+
+}  // namespace
+
+FileHashCache::FileHashCache(
+    gsl::not_null<StorageConfig const*> const& storage_config) noexcept
+    : storage_config_{storage_config},
+      known_{ReadEntries(storage_config_->FileHashCacheFile())} {}
+
+auto FileHashCache::HashFile(std::filesystem::path const& path) noexcept
+    -> std::optional<ArtifactDigest> {
+    auto const hash_type = storage_config_->hash_function.GetType();
+    try {
+        auto const key = path.string();
+        auto const state = StatFile(path);
+        if (not state) {
+            return std::nullopt;
+        }
+        {
+            std::shared_lock lock{mutex_};
+            Entry const* cached = nullptr;
+            bool const is_used = used_.contains(key);
+            if (is_used) {
+                cached = &used_.at(key);
+            }
+            else if (auto it = known_.find(key); it != known_.end()) {
+                cached = &it->second;
+            }
+            if (cached != nullptr and cached->state == *state) {
+                auto digest = ArtifactDigestFactory::Create(
+                    hash_type,
+                    cached->hash,
+                    static_cast<std::size_t>(state->size),
+                    /*is_tree=*/false);
+                if (digest) {
+                    if (not is_used) {
+                        auto entry = *cached;
+                        lock.unlock();
+                        std::unique_lock write_lock{mutex_};
+                        used_.insert_or_assign(key, std::move(entry));
+                    }
+                    return *std::move(digest);
+                }
+            }
+        }
+
+        auto const now = Now();
+        auto digest = ArtifactDigestFactory::HashFileAs<ObjectType::File>(
+            storage_config_->hash_function, path);
+        if (not digest) {
+            return std::nullopt;
+        }
+        // Only cache the digest if the file did not change while hashing.
+        if (digest->size() == state->size and not IsRacy(*state, now) and
+            key.find('\n') == std::string::npos and StatFile(path) == state) {
+            std::unique_lock lock{mutex_};
+            used_.insert_or_assign(
+                key, Entry{.state = *state, .hash = digest->hash()});
+        }
+        return digest;
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Debug,
+                    "Failed to hash file {}:\n{}",
+                    path.string(),
+                    e.what());
+        return std::nullopt;
+    }
+}
+
+auto FileHashCache::Save() const noexcept -> bool {
+    std::shared_lock lock{mutex_};
+    if (used_.empty()) {
+        return true;
+    }
+    auto const file = storage_config_->FileHashCacheFile();
+    try {
+        std::string content{};
+        std::size_t count = 0;
+        for (auto const& [path, entry] : used_) {
+            AppendEntry(path, entry, &content);
+            ++count;
+        }
+        for (auto const& [path, entry] : ReadEntries(file)) {
+            if (count >= kMaxEntries) {
+                break;
+            }
+            if (not used_.contains(path)) {
+                AppendEntry(path, entry, &content);
+                ++count;
+            }
+        }
+
+        // write safely, so use the rename trick
+        auto tmp_dir = storage_config_->CreateTypedTmpDir("file-hashes");
+        if (not tmp_dir) {
+            return false;
+        }
+        auto tmp_file = tmp_dir->GetPath() / "file-hashes";
+        return FileSystemManager::CreateDirectory(file.parent_path()) and
+               FileSystemManager::WriteFile(content, tmp_file) and
+               FileSystemManager::Rename(tmp_file, file);
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Debug,
+                    "Failed to save file hash cache {}:\n{}",
+                    file.string(),
+                    e.what());
+        return false;
+    }
+}
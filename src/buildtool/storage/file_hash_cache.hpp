@@ -0,0 +1,84 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_BUILDTOOL_STORAGE_FILE_HASH_CACHE_HPP
+#define INCLUDED_SRC_BUILDTOOL_STORAGE_FILE_HASH_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "gsl/gsl"
+#include "src/buildtool/common/artifact_digest.hpp"
+#include "src/buildtool/storage/config.hpp"
+
+/// \brief Persistent cache of the digests of files in the local file system,
+/// used for files of file-system roots, which otherwise would be hashed again
+/// in every build. Entries are keyed by path and validated against the
+/// device, inode, size, modification and status change time of the file;
+/// any mismatch causes the file to be hashed again. Files changed too
+/// recently to be told apart from a later change by their timestamps are not
+/// cached. Like ActionTimings, the cache is best effort: a missing or
+/// malformed file results in an empty cache, and concurrent builds saving to
+/// the same file may lose entries of each other. HashFile is thread-safe.
+class FileHashCache final {
+  public:
+    /// \brief Load the cache of the local build root for the configured hash
+    /// function, if any.
+    explicit FileHashCache(
+        gsl::not_null<StorageConfig const*> const& storage_config) noexcept;
+
+    /// \brief Digest of a regular file, as blob. Taken from the cache, if the
+    /// file is unchanged since it was hashed, otherwise the file is hashed.
+    /// \returns The digest or std::nullopt if the file cannot be read.
+    [[nodiscard]] auto HashFile(std::filesystem::path const& path) noexcept
+        -> std::optional<ArtifactDigest>;
+
+    /// \brief Write the entries used by this instance back to the file. The
+    /// file is re-read before, to not discard entries saved by concurrent
+    /// builds. If the cache exceeds its maximal size, entries not used by
+    /// this instance are dropped.
+    [[nodiscard]] auto Save() const noexcept -> bool;
+
+    /// \brief Stat data identifying the state of a file.
+    struct FileState {
+        std::uint64_t device{};
+        std::uint64_t inode{};
+        std::uint64_t size{};
+        std::int64_t mtime_ns{};
+        std::int64_t ctime_ns{};
+
+        [[nodiscard]] auto operator==(FileState const&) const -> bool =
+                                                                    default;
+    };
+
+    struct Entry {
+        FileState state;
+        std::string hash;
+    };
+
+  private:
+    static constexpr std::size_t kMaxEntries = std::size_t{1} << 20U;
+
+    gsl::not_null<StorageConfig const*> storage_config_;
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, Entry> known_;
+    std::unordered_map<std::string, Entry> used_;
+};
+
+#endif  // INCLUDED_SRC_BUILDTOOL_STORAGE_FILE_HASH_CACHE_HPP
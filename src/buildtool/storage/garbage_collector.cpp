@@ -18,10 +18,18 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
+#include <map>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <vector>
 
+#include <sys/stat.h>
+
 #include "fmt/core.h"
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/execution_api/common/execution_common.hpp"
@@ -35,10 +43,45 @@
 
 namespace {
 
-auto RemoveDirs(const std::vector<std::filesystem::path>& directories) -> bool {
+/// \brief Directories of the read-only trees materialised for local execution,
+/// relative to the root of a generation.
+[[nodiscard]] auto MaterialisedTreeDirs(StorageConfig const& storage_config)
+    -> std::optional<std::vector<std::filesystem::path>> {
+    static constexpr std::array kHashes = {HashFunction::Type::GitSHA1,
+                                           HashFunction::Type::PlainSHA256};
+    auto builder = StorageConfig::Builder{}
+                       .SetBuildRoot(storage_config.build_root)
+                       .SetNumGenerations(storage_config.num_generations);
+    std::vector<std::filesystem::path> dirs{};
+    for (auto hash_type : kHashes) {
+        auto const config = builder.SetHashType(hash_type).Build();
+        if (not config) {
+            Logger::Log(LogLevel::Error, config.error());
+            return std::nullopt;
+        }
+        auto const trees = config->CreateGenerationConfig(0).materialised_trees;
+        dirs.emplace_back(
+            trees.lexically_relative(config->GenerationCacheRoot(0)));
+    }
+    return dirs;
+}
+
+/// \brief Remove directories; former generations among them may contain
+/// read-only materialised trees, which are made writable first.
+auto RemoveDirs(const std::vector<std::filesystem::path>& directories,
+                const std::vector<std::filesystem::path>& tree_dirs) -> bool {
     bool success = true;
     for (auto const& d : directories) {
         if (FileSystemManager::IsDirectory(d)) {
+            for (auto const& tree_dir : tree_dirs) {
+                if (FileSystemManager::IsDirectory(d / tree_dir) and
+                    not FileSystemManager::SetDirectoriesWritable(
+                        d / tree_dir, /*writable=*/true)) {
+                    Logger::Log(LogLevel::Warning,
+                                "Failed to make trees in {} writable",
+                                (d / tree_dir).string());
+                }
+            }
             if (not FileSystemManager::RemoveDirectory(d,
                                                        /*recursively=*/true)) {
                 Logger::Log(LogLevel::Warning,
@@ -52,6 +95,268 @@ auto RemoveDirs(const std::vector<std::filesystem::path>& directories) -> bool {
     return success;
 }
 
+/// \brief A file of the storage generations. Hard links to the same file share
+/// their disk space, so files are identified by device and inode.
+struct CachedFile final {
+    std::uintmax_t size{};
+    std::int64_t ctime_ns{};
+    std::uintmax_t nlink{};
+    // Youngest generation holding a link to the file.
+    std::size_t generation{};
+    // Number of links found in the storage generations.
+    std::size_t links{};
+    // Links in object storages, which are moved out when evicting the file.
+    std::vector<std::filesystem::path> evictable;
+};
+
+using FileId = std::pair<std::uintmax_t, std::uintmax_t>;
+
+[[nodiscard]] auto FormatSize(std::uintmax_t size) -> std::string {
+    static constexpr std::array kUnits{"B", "KiB", "MiB", "GiB", "TiB"};
+    static constexpr double kUnit = 1024.0;
+    auto value = static_cast<double>(size);
+    std::size_t unit = 0;
+    while (value >= kUnit and unit + 1 < kUnits.size()) {
+        value /= kUnit;
+        ++unit;
+    }
+    return fmt::format("{:.1f} {}", value, kUnits.at(unit));
+}
+
+[[nodiscard]] auto ChangeTimeNs(struct stat const& info) -> std::int64_t {
+    static constexpr std::int64_t kNanosecondsPerSecond = 1000000000;
+    return static_cast<std::int64_t>(info.st_ctim.tv_sec) *
+               kNanosecondsPerSecond +
+           static_cast<std::int64_t>(info.st_ctim.tv_nsec);
+}
+
+/// \brief Record all regular files below a generation root.
+/// \param object_roots    Object storages of that generation, whose files
+/// can be evicted.
+[[nodiscard]] auto ScanGeneration(std::filesystem::path const& root,
+                                  std::size_t generation,
+                                  std::vector<std::filesystem::path> const&
+                                      object_roots,
+                                  std::map<FileId, CachedFile>* files) noexcept
+    -> bool {
+    if (not FileSystemManager::IsDirectory(root)) {
+        return true;
+    }
+    try {
+        for (auto const& entry :
+             std::filesystem::recursive_directory_iterator{root}) {
+            struct stat info{};
+            if (::lstat(entry.path().c_str(), &info) != 0 or
+                not S_ISREG(info.st_mode)) {
+                continue;
+            }
+            auto [it, inserted] = files->try_emplace(
+                FileId{static_cast<std::uintmax_t>(info.st_dev),
+                       static_cast<std::uintmax_t>(info.st_ino)});
+            auto& file = it->second;
+            if (inserted) {
+                file.size = static_cast<std::uintmax_t>(info.st_size);
+                file.ctime_ns = ChangeTimeNs(info);
+                file.nlink = static_cast<std::uintmax_t>(info.st_nlink);
+                file.generation = generation;
+            }
+            file.generation = std::min(file.generation, generation);
+            ++file.links;
+            // Object storages are sharded into directories of two letters.
+            auto const storage = entry.path().parent_path().parent_path();
+            if (std::find(object_roots.begin(), object_roots.end(), storage) !=
+                object_roots.end()) {
+                file.evictable.emplace_back(entry.path());
+            }
+        }
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Error,
+                    "Failed to scan generation {}:\n{}",
+                    root.string(),
+                    e.what());
+        return false;
+    }
+    return true;
+}
+
+/// \brief Objects selected for eviction, with the links to move out of the
+/// object storages.
+struct ColdObjects final {
+    std::vector<std::pair<FileId, CachedFile>> files;
+    // Size of the generations kept, and size of the selected objects.
+    std::uintmax_t total{};
+    std::uintmax_t selected{};
+};
+
+/// \brief Select cold objects to evict, least recently used first, such that
+/// the generations do not exceed the target size anymore. Expects to hold a
+/// shared lock, as the selection is done before rotating the generations. The
+/// generation dropped by an upcoming rotation does not count. Objects of the
+/// youngest generation are only selected when rotating, as they become part of
+/// an older generation then and are checked again when uplinked.
+[[nodiscard]] auto SelectColdObjects(StorageConfig const& storage_config,
+                                     CacheSizeLimits const& size_limits,
+                                     bool rotate) noexcept
+    -> std::optional<ColdObjects> {
+    // Objects are evicted from the storages of both, native and compatible
+    // protocol; all other files of the generations only count for the size.
+    static constexpr std::array kHashes = {HashFunction::Type::GitSHA1,
+                                           HashFunction::Type::PlainSHA256};
+    auto builder = StorageConfig::Builder{}
+                       .SetBuildRoot(storage_config.build_root)
+                       .SetNumGenerations(storage_config.num_generations);
+    std::vector<std::vector<std::filesystem::path>> object_roots(
+        storage_config.num_generations);
+    for (auto hash_type : kHashes) {
+        auto const config = builder.SetHashType(hash_type).Build();
+        if (not config) {
+            Logger::Log(LogLevel::Error, config.error());
+            return std::nullopt;
+        }
+        for (std::size_t i = 0; i < config->num_generations; ++i) {
+            auto const gen_config = config->CreateGenerationConfig(i);
+            object_roots[i].emplace_back(gen_config.cas_f);
+            object_roots[i].emplace_back(gen_config.cas_x);
+            object_roots[i].emplace_back(gen_config.cas_t);
+        }
+    }
+
+    std::map<FileId, CachedFile> files;
+    for (std::size_t i = 0; i < storage_config.num_generations; ++i) {
+        if (not ScanGeneration(storage_config.GenerationCacheRoot(i),
+                               i,
+                               object_roots[i],
+                               &files)) {
+            return std::nullopt;
+        }
+    }
+
+    // Every file counts once, for the youngest generation linking to it. Files
+    // only linked from the oldest generation are removed by the rotation.
+    auto const kept = rotate ? storage_config.num_generations - 1
+                             : storage_config.num_generations;
+    std::vector<std::uintmax_t> sizes(storage_config.num_generations);
+    for (auto const& [id, file] : files) {
+        sizes[file.generation] += file.size;
+    }
+    ColdObjects cold{};
+    for (std::size_t i = 0; i < sizes.size(); ++i) {
+        Logger::Log(LogLevel::Info,
+                    "Generation {} of the local cache: {}{}",
+                    i,
+                    FormatSize(sizes[i]),
+                    i < kept ? "" : " (removed by rotation)");
+        if (i < kept) {
+            cold.total += sizes[i];
+        }
+    }
+    if (cold.total <= size_limits.max_size) {
+        Logger::Log(LogLevel::Info,
+                    "Local cache of {} is within its maximal size of {}",
+                    FormatSize(cold.total),
+                    FormatSize(size_limits.max_size));
+        return cold;
+    }
+
+    // Only files not linked from anywhere else free their disk space. Without
+    // rotation, files linked from the youngest generation stay in use.
+    std::vector<std::map<FileId, CachedFile>::value_type const*> candidates;
+    for (auto const& entry : files) {
+        auto const& file = entry.second;
+        if ((rotate or file.generation > 0) and file.generation < kept and
+            not file.evictable.empty() and
+            file.evictable.size() == file.links and file.links == file.nlink) {
+            candidates.emplace_back(&entry);
+        }
+    }
+    std::sort(candidates.begin(),
+              candidates.end(),
+              [](auto const* lhs, auto const* rhs) {
+                  return std::pair{rhs->second.generation,
+                                   lhs->second.ctime_ns} <
+                         std::pair{lhs->second.generation,
+                                   rhs->second.ctime_ns};
+              });
+    for (auto const* entry : candidates) {
+        if (cold.total - cold.selected <= size_limits.target_size) {
+            break;
+        }
+        cold.selected += entry->second.size;
+        cold.files.emplace_back(*entry);
+    }
+    return cold;
+}
+
+/// \brief Check that a file was not linked, unlinked, or replaced since it
+/// was scanned, e.g., by uplinking it or by another garbage collection.
+[[nodiscard]] auto IsUnchanged(FileId const& id,
+                               CachedFile const& file) noexcept -> bool {
+    return std::all_of(
+        file.evictable.begin(),
+        file.evictable.end(),
+        [&id, &file](std::filesystem::path const& path) {
+            struct stat info{};
+            if (::lstat(path.c_str(), &info) != 0) {
+                return false;
+            }
+            return FileId{static_cast<std::uintmax_t>(info.st_dev),
+                          static_cast<std::uintmax_t>(info.st_ino)} == id and
+                   ChangeTimeNs(info) == file.ctime_ns;
+        });
+}
+
+/// \brief Move the selected objects out of the object storages. Expects to
+/// hold the exclusive lock. Objects changed since their selection are kept.
+[[nodiscard]] auto EvictColdObjects(
+    ColdObjects const& cold,
+    CacheSizeLimits const& size_limits,
+    std::filesystem::path const& remove_me_dir) noexcept -> bool {
+    if (cold.total <= size_limits.max_size) {
+        return true;
+    }
+    if (not cold.files.empty() and
+        not FileSystemManager::CreateDirectory(remove_me_dir)) {
+        Logger::Log(LogLevel::Error,
+                    "Failed to create directory {}",
+                    remove_me_dir.string());
+        return false;
+    }
+    std::uintmax_t evicted = 0;
+    std::size_t count = 0;
+    for (auto const& [id, file] : cold.files) {
+        if (not IsUnchanged(id, file)) {
+            continue;
+        }
+        bool moved = true;
+        for (auto const& path : file.evictable) {
+            auto const target = remove_me_dir / std::to_string(count++);
+            if (not FileSystemManager::Rename(path, target)) {
+                Logger::Log(LogLevel::Warning,
+                            "Failed to rename {} to {}",
+                            path.string(),
+                            target.string());
+                moved = false;
+            }
+        }
+        if (moved) {
+            evicted += file.size;
+        }
+    }
+
+    Logger::Log(LogLevel::Info,
+                "Evicted {} of cold objects from the local cache of {}",
+                FormatSize(evicted),
+                FormatSize(cold.total));
+    if (cold.total - evicted > size_limits.target_size) {
+        Logger::Log(LogLevel::Warning,
+                    "Local cache of {} still exceeds its target size of {}; "
+                    "the remaining files cannot be evicted.",
+                    FormatSize(cold.total - evicted),
+                    FormatSize(size_limits.target_size));
+    }
+    return true;
+}
+
 }  // namespace
 
 auto GarbageCollector::SharedLock(StorageConfig const& storage_config) noexcept
@@ -71,7 +376,8 @@ auto GarbageCollector::LockFilePath(
 
 auto GarbageCollector::TriggerGarbageCollection(
     StorageConfig const& storage_config,
-    bool no_rotation) noexcept -> bool {
+    bool no_rotation,
+    std::optional<CacheSizeLimits> const& size_limits) noexcept -> bool {
     std::string const remove_me = "remove-me";
 
     auto pid = CreateProcessUniqueId();
@@ -79,7 +385,12 @@ auto GarbageCollector::TriggerGarbageCollection(
         return false;
     }
     auto remove_me_prefix = remove_me + *pid + std::string{"-"};
+    auto const tree_dirs = MaterialisedTreeDirs(storage_config);
+    if (not tree_dirs) {
+        return false;
+    }
     std::vector<std::filesystem::path> to_remove{};
+    std::optional<ColdObjects> cold{};
 
     // With a shared lock, we can remove all directories with the given prefix,
     // as we own the process id.
@@ -98,12 +409,24 @@ auto GarbageCollector::TriggerGarbageCollection(
                 to_remove.emplace_back(entry.path());
             }
         }
-        if (not RemoveDirs(to_remove)) {
+        if (not RemoveDirs(to_remove, *tree_dirs)) {
             Logger::Log(LogLevel::Error,
                         "Failed to clean up left-over directories under my "
                         "pid. Will not continue");
             return false;
         }
+
+        // Scanning the generations is expensive, so cold objects are selected
+        // while concurrent builds may still proceed.
+        if (size_limits) {
+            cold = SelectColdObjects(
+                storage_config, *size_limits, /*rotate=*/not no_rotation);
+            if (not cold) {
+                Logger::Log(LogLevel::Error,
+                            "Failed to scan the generations of the cache.");
+                return false;
+            }
+        }
     }
 
     to_remove.clear();
@@ -173,6 +496,23 @@ auto GarbageCollector::TriggerGarbageCollection(
             return false;
         }
 
+        // Evict cold objects, if the cache exceeds its budget. Eviction must
+        // take place before rotating generations, as objects are selected for
+        // the generations as they are before rotation. Evicted objects are
+        // moved out of the storage while holding the exclusive lock, so
+        // concurrent builds never see a partially removed object.
+        if (cold and size_limits) {
+            auto remove_me_dir =
+                storage_config.CacheRoot() /
+                fmt::format("{}{}", remove_me_prefix, remove_me_counter++);
+            to_remove.emplace_back(remove_me_dir);
+            if (not EvictColdObjects(*cold, *size_limits, remove_me_dir)) {
+                Logger::Log(LogLevel::Error,
+                            "Failed to evict cold objects from the cache.");
+                return false;
+            }
+        }
+
         // Rotate generations unless told not to do so
         if (not no_rotation) {
             auto remove_me_dir =
@@ -209,7 +549,7 @@ auto GarbageCollector::TriggerGarbageCollection(
                         "Failed to get a shared lock the local build root");
             return false;
         }
-        success = RemoveDirs(to_remove);
+        success = RemoveDirs(to_remove, *tree_dirs);
     }
 
     return success;
@@ -222,7 +562,8 @@ auto GarbageCollector::Compactify(StorageConfig const& storage_config,
                                            HashFunction::Type::PlainSHA256};
     auto builder = StorageConfig::Builder{}
                        .SetBuildRoot(storage_config.build_root)
-                       .SetNumGenerations(storage_config.num_generations);
+                       .SetNumGenerations(storage_config.num_generations)
+                       .SetChunkingProfile(storage_config.chunking_profile);
 
     return std::all_of(
         kHashes.begin(),
@@ -234,9 +575,15 @@ auto GarbageCollector::Compactify(StorageConfig const& storage_config,
             }
 
             auto const storage = ::Generation::Create(&*config);
-            return Compactifier::RemoveInvalid(storage.CAS()) and
-                   Compactifier::RemoveSpliced(storage.CAS()) and
-                   Compactifier::SplitLarge(storage.CAS(), threshold);
+            if (not Compactifier::RemoveInvalid(storage.CAS()) or
+                not Compactifier::RemoveSpliced(storage.CAS()) or
+                not Compactifier::SplitLarge(storage.CAS(), threshold)) {
+                return false;
+            }
+            // The report is informative only, so unreadable entries do not
+            // fail the compactification.
+            std::ignore = Compactifier::ReportDeduplication(storage.CAS());
+            return true;
         });
 }
 
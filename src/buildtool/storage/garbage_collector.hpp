@@ -16,22 +16,39 @@
 #define INCLUDED_SRC_BUILDTOOL_STORAGE_GARBAGE_COLLECTOR_HPP
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 
 #include "src/buildtool/storage/config.hpp"
 #include "src/utils/cpp/file_locking.hpp"
 
+/// \brief Disk budget of the local cache. If the storage generations exceed
+/// max_size bytes, cold objects are evicted until they do not exceed
+/// target_size bytes anymore.
+struct CacheSizeLimits final {
+    std::uintmax_t max_size{};
+    std::uintmax_t target_size{};
+};
+
 /// \brief Global garbage collector implementation.
 /// Responsible for deleting oldest generation.
 class GarbageCollector {
   public:
     /// \brief Trigger garbage collection; unless no_rotation is given, this
     /// will include rotation of generations and deleting the oldest generation.
+    /// If size limits are given, cold objects are evicted before rotating,
+    /// until the cache fits into the budget; objects of the youngest generation
+    /// only if rotating. Objects are evicted least recently used first: older
+    /// generations before younger ones, and within a generation in the order
+    /// they were last stored or uplinked, as told by the status change time of
+    /// their (hard linked) files.
     /// \returns true on success.
     [[nodiscard]] auto static TriggerGarbageCollection(
         StorageConfig const& storage_config,
-        bool no_rotation = false) noexcept -> bool;
+        bool no_rotation = false,
+        std::optional<CacheSizeLimits> const& size_limits =
+            std::nullopt) noexcept -> bool;
 
     /// \brief Acquire shared lock to prevent garbage collection from running.
     /// \param storage_config   Storage to be locked.
@@ -25,9 +25,11 @@
 
 #include "gsl/gsl"
 #include "src/buildtool/common/artifact_digest.hpp"
+#include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/file_system/file_storage.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/file_chunker.hpp"
 #include "src/buildtool/storage/uplinker.hpp"
 #include "src/utils/cpp/expected.hpp"
 #include "src/utils/cpp/tmp_dir.hpp"
@@ -93,10 +95,29 @@ class LargeObject final {
     std::filesystem::path path_;
 };
 
+/// \brief Content of a large entry: the parts a large object is composed of and
+/// the chunking profile they were obtained with. Entries of the default profile
+/// are stored as plain list of parts, as they were before profiles existed.
+struct LargeObjectEntry final {
+    ChunkingProfile profile = ChunkingProfile::Default;
+    std::vector<ArtifactDigest> parts;
+
+    /// \brief Parse the content of a large entry.
+    /// \returns The entry or std::nullopt if the content is malformed.
+    [[nodiscard]] static auto Parse(std::string const& content,
+                                    HashFunction::Type hash_type) noexcept
+        -> std::optional<LargeObjectEntry>;
+
+    /// \brief Serialize the entry to be stored in the large storage.
+    [[nodiscard]] auto ToString() const noexcept -> std::optional<std::string>;
+};
+
 /// \brief Stores auxiliary information for reconstructing large objects.
 /// The entries are keyed by the hash of the spliced result and the value of an
 /// entry is the concatenation of the hashes of chunks the large object is
-/// composed of.
+/// composed of. New objects are split with the chunking profile of the storage
+/// configuration, which is recorded in the entry; existing entries are used
+/// regardless of the profile they were created with.
 template <bool kDoGlobalUplink, ObjectType kType>
 class LargeObjectCAS final {
   public:
@@ -17,9 +17,15 @@
 
 // IWYU pragma: private, include "src/buildtool/storage/large_object_cas.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdlib>
+#include <deque>
 #include <fstream>
+#include <mutex>
+#include <thread>
 
 #include "fmt/core.h"
 #include "nlohmann/json.hpp"
@@ -27,6 +33,7 @@
 #include "src/buildtool/common/protocol_traits.hpp"
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/buildtool/multithreading/task_system.hpp"
 #include "src/buildtool/storage/file_chunker.hpp"
 #include "src/buildtool/storage/large_object_cas.hpp"
 #include "src/buildtool/storage/local_cas.hpp"
@@ -34,8 +41,75 @@
 namespace {
 inline constexpr std::size_t kHashIndex = 0;
 inline constexpr std::size_t kSizeIndex = 1;
+inline constexpr auto kProfileKey = "profile";
+inline constexpr auto kPartsKey = "parts";
+
+// Objects of at least that size are split by multiple threads.
+inline constexpr std::size_t kParallelSplitThreshold = std::size_t{4} << 20U;
+inline constexpr unsigned kMaxSplitJobs = 8;
+// Number of chunks per job that are read but not yet stored.
+inline constexpr std::size_t kMaxChunksInFlight = 4;
 }  // namespace
 
+inline auto LargeObjectEntry::Parse(std::string const& content,
+                                    HashFunction::Type hash_type) noexcept
+    -> std::optional<LargeObjectEntry> {
+    try {
+        auto const j = nlohmann::json::parse(content);
+        LargeObjectEntry entry{};
+        auto const* j_parts = &j;
+        if (j.is_object()) {
+            auto profile = ChunkingProfileFromString(
+                j.at(kProfileKey).template get<std::string>());
+            if (not profile) {
+                return std::nullopt;
+            }
+            entry.profile = *profile;
+            j_parts = &j.at(kPartsKey);
+        }
+        if (not j_parts->is_array()) {
+            return std::nullopt;
+        }
+
+        entry.parts.reserve(j_parts->size());
+        for (auto const& j_part : *j_parts) {
+            auto digest = ArtifactDigestFactory::Create(
+                hash_type,
+                j_part.at(kHashIndex).template get<std::string>(),
+                j_part.at(kSizeIndex).template get<std::size_t>(),
+                /*is_tree=*/false);
+            if (not digest) {
+                return std::nullopt;
+            }
+            entry.parts.emplace_back(*std::move(digest));
+        }
+        return entry;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+inline auto LargeObjectEntry::ToString() const noexcept
+    -> std::optional<std::string> {
+    try {
+        auto j_parts = nlohmann::json::array();
+        for (auto const& part : parts) {
+            auto& j_part = j_parts.emplace_back();
+            j_part[kHashIndex] = part.hash();
+            j_part[kSizeIndex] = part.size();
+        }
+        if (profile == ChunkingProfile::Default) {
+            return j_parts.dump();
+        }
+        auto j = nlohmann::json::object();
+        j[kProfileKey] = ::ToString(profile);
+        j[kPartsKey] = std::move(j_parts);
+        return j.dump();
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
 template <bool kDoGlobalUplink, ObjectType kType>
 auto LargeObjectCAS<kDoGlobalUplink, kType>::GetEntryPath(
     ArtifactDigest const& digest) const noexcept
@@ -69,29 +143,16 @@ auto LargeObjectCAS<kDoGlobalUplink, kType>::ReadEntry(
         return std::nullopt;
     }
 
-    std::vector<ArtifactDigest> parts;
-    try {
-        std::ifstream stream(*file_path);
-        nlohmann::json j = nlohmann::json::parse(stream);
-        parts.reserve(j.size());
-
-        auto const hash_type = local_cas_.GetHashFunction().GetType();
-        for (auto const& j_part : j) {
-            auto digest = ArtifactDigestFactory::Create(
-                hash_type,
-                j_part.at(kHashIndex).template get<std::string>(),
-                j_part.at(kSizeIndex).template get<std::size_t>(),
-                /*is_tree=*/false);
-            if (not digest) {
-                return std::nullopt;
-            }
-
-            parts.emplace_back(*std::move(digest));
-        }
-    } catch (...) {
+    auto const content = FileSystemManager::ReadFile(*file_path);
+    if (not content) {
         return std::nullopt;
     }
-    return parts;
+    auto entry = LargeObjectEntry::Parse(
+        *content, local_cas_.GetHashFunction().GetType());
+    if (not entry) {
+        return std::nullopt;
+    }
+    return std::move(entry->parts);
 }
 
 template <bool kDoGlobalUplink, ObjectType kType>
@@ -110,17 +171,11 @@ auto LargeObjectCAS<kDoGlobalUplink, kType>::WriteEntry(
         return false;
     }
 
-    nlohmann::json j;
-    try {
-        for (auto const& part : parts) {
-            auto& j_part = j.emplace_back();
-            j_part[kHashIndex] = part.hash();
-            j_part[kSizeIndex] = part.size();
-        }
-    } catch (...) {
-        return false;
-    }
-    return file_store_.AddFromBytes(digest.hash(), j.dump());
+    auto const content =
+        LargeObjectEntry{.profile = storage_config_.chunking_profile,
+                         .parts = parts}
+            .ToString();
+    return content and file_store_.AddFromBytes(digest.hash(), *content);
 }
 
 template <bool kDoGlobalUplink, ObjectType kType>
@@ -150,27 +205,86 @@ auto LargeObjectCAS<kDoGlobalUplink, kType>::Split(ArtifactDigest const& digest)
     }
 
     // Split file into chunks:
-    FileChunker chunker{*file_path};
+    FileChunker chunker{*file_path, storage_config_.chunking_profile};
     if (not chunker.IsOpen()) {
         return unexpected{
             LargeObjectError{LargeObjectErrorCode::Internal,
                              fmt::format("could not split {}", digest.hash())}};
     }
 
-    std::vector<ArtifactDigest> parts;
+    // Chunk boundaries are found sequentially, but the chunks of large objects
+    // are hashed and stored by a pool of workers. The number of chunks in
+    // flight is bounded to limit memory usage; the order of parts is kept by
+    // storing the digests in slots reserved in the order of the chunks.
+    std::deque<std::optional<ArtifactDigest>> slots;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t in_flight = 0;
+    std::atomic<bool> failed = false;
+    std::optional<TaskSystem> workers;  // destroyed first, joining all tasks
     try {
+        if (digest.size() >= kParallelSplitThreshold) {
+            workers.emplace(std::clamp(std::thread::hardware_concurrency(),
+                                       1U,
+                                       kMaxSplitJobs));
+        }
         while (auto chunk = chunker.NextChunk()) {
-            auto part = local_cas_.StoreBlob(*chunk, /*is_executable=*/false);
-            if (not part) {
-                return unexpected{LargeObjectError{
-                    LargeObjectErrorCode::Internal, "could not store a part."}};
+            auto& slot = slots.emplace_back();
+            if (not workers) {
+                slot = local_cas_.StoreBlob(std::string{*chunk},
+                                            /*is_executable=*/false);
+                if (not slot) {
+                    break;
+                }
+                continue;
             }
-            parts.emplace_back(*std::move(part));
+            {
+                std::unique_lock lock{mutex};
+                cv.wait(lock, [&]() {
+                    return in_flight < kMaxChunksInFlight * kMaxSplitJobs;
+                });
+                ++in_flight;
+            }
+            if (failed) {
+                break;
+            }
+            workers->QueueTask([this,
+                                &mutex,
+                                &cv,
+                                &in_flight,
+                                &failed,
+                                slot = &slot,
+                                chunk = std::string{*chunk}]() {
+                *slot = local_cas_.StoreBlob(chunk, /*is_executable=*/false);
+                if (not *slot) {
+                    failed = true;
+                }
+                {
+                    std::unique_lock lock{mutex};
+                    --in_flight;
+                }
+                cv.notify_one();
+            });
+        }
+        if (workers) {
+            workers->Finish();
         }
     } catch (...) {
         return unexpected{LargeObjectError{LargeObjectErrorCode::Internal,
                                            "an unknown error occured."}};
     }
+
+    std::vector<ArtifactDigest> parts;
+    parts.reserve(slots.size());
+    for (auto& slot : slots) {
+        if (not slot) {
+            return unexpected{LargeObjectError{LargeObjectErrorCode::Internal,
+                                               "could not store a part."}};
+        }
+        parts.emplace_back(*std::move(slot));
+    }
+
+    // Reading may have failed after some of the chunks were stored already:
     if (not chunker.Finished()) {
         return unexpected{
             LargeObjectError{LargeObjectErrorCode::Internal,
@@ -15,11 +15,14 @@
 #ifndef INCLUDED_SRC_BUILDTOOL_STORAGE_LOCAL_CAS_HPP
 #define INCLUDED_SRC_BUILDTOOL_STORAGE_LOCAL_CAS_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
 #include <type_traits>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "gsl/gsl"
@@ -131,6 +134,71 @@ class LocalCAS {
         return cas_tree_.StoreBlobFromBytes(bytes);
     }
 
+    /// \brief Store blob with already verified digest from file path.
+    /// \tparam kOwner          Indicates ownership for optimization (hardlink).
+    /// \param digest           The digest the file content was verified for.
+    /// \param file_path        The path of the file to store as blob.
+    /// \param is_executable    Store blob with executable permissions.
+    /// \returns Digest of the stored blob or nullopt otherwise.
+    template <bool kOwner = false>
+    [[nodiscard]] auto StoreVerifiedBlob(ArtifactDigest const& digest,
+                                         std::filesystem::path const& file_path,
+                                         bool is_executable) const noexcept
+        -> std::optional<ArtifactDigest> {
+        return is_executable ? cas_exec_.StoreVerifiedBlobFromFile(
+                                   digest, file_path, kOwner)
+                             : cas_file_.StoreVerifiedBlobFromFile(
+                                   digest, file_path, kOwner);
+    }
+
+    /// \brief Store blob with already verified digest from bytes.
+    /// \param digest           The digest the bytes were verified for.
+    /// \param bytes            The bytes to create the blob from.
+    /// \param is_executable    Store blob with executable permissions.
+    /// \returns Digest of the stored blob or nullopt otherwise.
+    [[nodiscard]] auto StoreVerifiedBlob(ArtifactDigest const& digest,
+                                         std::string const& bytes,
+                                         bool is_executable = false)
+        const noexcept -> std::optional<ArtifactDigest> {
+        return is_executable
+                   ? cas_exec_.StoreVerifiedBlobFromBytes(digest, bytes)
+                   : cas_file_.StoreVerifiedBlobFromBytes(digest, bytes);
+    }
+
+    /// \brief Store tree with already verified digest from file path.
+    /// \tparam kOwner          Indicates ownership for optimization (hardlink).
+    /// \param digest       The digest the file content was verified for.
+    /// \param file_path    The path of the file to store as tree.
+    /// \returns Digest of the stored tree or nullopt otherwise.
+    template <bool kOwner = false>
+    [[nodiscard]] auto StoreVerifiedTree(
+        ArtifactDigest const& digest,
+        std::filesystem::path const& file_path) const noexcept
+        -> std::optional<ArtifactDigest> {
+        return cas_tree_.StoreVerifiedBlobFromFile(digest, file_path, kOwner);
+    }
+
+    /// \brief Store tree with already verified digest from bytes.
+    /// \param digest   The digest the bytes were verified for.
+    /// \param bytes    The bytes to create the tree from.
+    /// \returns Digest of the stored tree or nullopt otherwise.
+    [[nodiscard]] auto StoreVerifiedTree(ArtifactDigest const& digest,
+                                         std::string const& bytes)
+        const noexcept -> std::optional<ArtifactDigest> {
+        return cas_tree_.StoreVerifiedBlobFromBytes(digest, bytes);
+    }
+
+    /// \brief Store many files as blobs. Small files are read and hashed
+    /// together, see HashFunction::HashBlobsData, larger ones one by one.
+    /// \tparam kOwner          Indicates ownership for optimization (hardlink).
+    /// \param files            Paths of the files and their x-bits.
+    /// \returns Digests of the stored blobs, in the order of the given files,
+    /// or nullopt if any file could not be stored.
+    template <bool kOwner = false>
+    [[nodiscard]] auto StoreBlobs(
+        std::vector<std::pair<std::filesystem::path, bool>> const& files)
+        const noexcept -> std::optional<std::vector<ArtifactDigest>>;
+
     /// \brief Obtain blob path from digest with x-bit.
     /// Performs a synchronization if blob is only available with inverse x-bit.
     /// \param digest           Digest of the blob to lookup.
@@ -280,6 +348,14 @@ class LocalCAS {
         ArtifactDigest const& digest) const noexcept -> bool;
 
   private:
+    // Files of at most this size are hashed together when storing many blobs.
+    static constexpr std::uintmax_t kMaxBatchedBlobSize = std::uintmax_t{64}
+                                                          << 10U;
+    // Bytes read into memory at most for hashing a batch of blobs.
+    static constexpr std::size_t kMaxBatchBytes = std::size_t{64} << 20U;
+    // Threads to hash a batch of blobs with at most.
+    static constexpr std::size_t kMaxBatchHashJobs = 8;
+
     ObjectCAS<ObjectType::File> cas_file_;
     ObjectCAS<ObjectType::Executable> cas_exec_;
     ObjectCAS<ObjectType::Tree> cas_tree_;
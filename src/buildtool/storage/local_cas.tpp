@@ -18,15 +18,96 @@
 // IWYU pragma: private, include "src/buildtool/storage/local_cas.hpp"
 
 #include <cstddef>
+#include <exception>
+#include <string_view>
+#include <system_error>
 #include <utility>  // std::move
 
 #include "fmt/core.h"
 #include "src/buildtool/common/artifact_digest_factory.hpp"
 #include "src/buildtool/common/bazel_types.hpp"
+#include "src/buildtool/crypto/hash_info.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/git_repo.hpp"
 #include "src/buildtool/logging/log_level.hpp"
+#include "src/buildtool/logging/logger.hpp"
 #include "src/buildtool/storage/local_cas.hpp"
 
+template <bool kDoGlobalUplink>
+template <bool kOwner>
+auto LocalCAS<kDoGlobalUplink>::StoreBlobs(
+    std::vector<std::pair<std::filesystem::path, bool>> const& files)
+    const noexcept -> std::optional<std::vector<ArtifactDigest>> {
+    try {
+        std::vector<ArtifactDigest> digests(files.size());
+
+        // Indices and contents of the small files read, but not yet stored.
+        std::vector<std::size_t> batch{};
+        std::vector<std::string> contents{};
+        std::size_t batch_bytes{};
+        auto const store_batch =
+            [this, &files, &digests, &batch, &contents]() -> bool {
+            auto const hashes = hash_function_.HashBlobsData(
+                std::vector<std::string_view>(contents.begin(), contents.end()),
+                kMaxBatchHashJobs);
+            for (std::size_t k{}; k < batch.size(); ++k) {
+                auto hash_info = HashInfo::Create(hash_function_.GetType(),
+                                                  hashes[k].HexString(),
+                                                  /*is_tree=*/false);
+                if (not hash_info) {
+                    return false;
+                }
+                auto const& [path, is_executable] = files[batch[k]];
+                auto digest = StoreVerifiedBlob<kOwner>(
+                    ArtifactDigest{*std::move(hash_info), contents[k].size()},
+                    path,
+                    is_executable);
+                if (not digest) {
+                    return false;
+                }
+                digests[batch[k]] = *std::move(digest);
+            }
+            batch.clear();
+            contents.clear();
+            return true;
+        };
+
+        for (std::size_t i{}; i < files.size(); ++i) {
+            auto const& [path, is_executable] = files[i];
+            std::error_code ec{};
+            auto const size = std::filesystem::file_size(path, ec);
+            if (ec or size > kMaxBatchedBlobSize) {
+                auto digest = StoreBlob<kOwner>(path, is_executable);
+                if (not digest) {
+                    return std::nullopt;
+                }
+                digests[i] = *std::move(digest);
+                continue;
+            }
+            auto content = FileSystemManager::ReadFile(path);
+            if (not content) {
+                return std::nullopt;
+            }
+            batch_bytes += content->size();
+            batch.emplace_back(i);
+            contents.emplace_back(*std::move(content));
+            if (batch_bytes >= kMaxBatchBytes) {
+                if (not store_batch()) {
+                    return std::nullopt;
+                }
+                batch_bytes = 0;
+            }
+        }
+        if (not batch.empty() and not store_batch()) {
+            return std::nullopt;
+        }
+        return digests;
+    } catch (std::exception const& e) {
+        Logger::Log(LogLevel::Error, "Failed to store blobs:\n{}", e.what());
+        return std::nullopt;
+    }
+}
+
 template <bool kDoGlobalUplink>
 template <bool kIsLocalGeneration>
     requires(kIsLocalGeneration)
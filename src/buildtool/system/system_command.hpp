@@ -16,24 +16,38 @@
 #define INCLUDED_SRC_BUILDTOOL_SYSTEM_SYSTEM_COMMAND_HPP
 
 #ifdef __unix__
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
 #else
 #error "Non-unix is not supported yet"
 #endif
 
 #include <algorithm>  // for transform
 #include <cerrno>     // for errno
-#include <cstdio>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
 #include <cstdlib>  // for EXIT_FAILURE, WEXITSTATUS, WIFEXITED, WIFSIGNALED, WTERMSIG
 #include <cstring>     // for strerror()
 #include <filesystem>  // for path, operator/
 #include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>  // std::move
 #include <vector>
 
@@ -51,6 +65,16 @@ class SystemCommand {
     /// \brief Create execution system with name.
     explicit SystemCommand(std::string name) : logger_{std::move(name)} {}
 
+    /// \brief Outcome of a command run to completion or killed.
+    struct Result {
+        int exit_code{};
+        bool timed_out{};  // killed after exceeding its timeout
+        // Resource usage of the command and all descendants it waited for.
+        struct rusage usage{};
+        // Time from creating the process until the command was executed.
+        std::chrono::microseconds spawn_time{};
+    };
+
     /// \brief Execute command and arguments.
     /// Stdout and stderr can be read from files named 'stdout' and 'stderr'
     /// created in `outdir`. Those files must not exist before the execution.
@@ -64,6 +88,29 @@ class SystemCommand {
                                std::filesystem::path const& cwd,
                                std::filesystem::path const& outdir) noexcept
         -> std::optional<int> {
+        if (auto result = Run(std::move(argv),
+                              std::move(env),
+                              cwd,
+                              outdir,
+                              /*timeout=*/std::nullopt)) {
+            return result->exit_code;
+        }
+        return std::nullopt;
+    }
+
+    /// \brief Execute command and arguments like Execute, but report the
+    /// resource usage of the command. If a timeout is given, the command is
+    /// run in a process group of its own, which is killed entirely once the
+    /// timeout is exceeded.
+    /// \returns The outcome of the command, or std::nullopt on execution
+    /// error.
+    [[nodiscard]] auto Run(
+        std::vector<std::string> argv,
+        std::map<std::string, std::string> env,
+        std::filesystem::path const& cwd,
+        std::filesystem::path const& outdir,
+        std::optional<std::chrono::milliseconds> timeout) noexcept
+        -> std::optional<Result> {
         if (not FileSystemManager::IsDirectory(outdir)) {
             logger_.Emit(LogLevel::Error,
                          "Output directory does not exist {}",
@@ -86,22 +133,63 @@ class SystemCommand {
                            return name_value.first + "=" + name_value.second;
                        });
         std::vector<char*> envp = UnwrapStrings(&env_string);
-        return ExecuteCommand(cmd.data(), envp.data(), cwd, outdir);
+        return ExecuteCommand(cmd.data(), envp.data(), cwd, outdir, timeout);
     }
 
   private:
     Logger logger_;
 
-    /// \brief Open file exclusively as write-only.
+    /// \brief State shared with the child process between its creation and
+    /// the execution of the command. Everything is prepared by the parent, as
+    /// the child runs in the memory of the parent and must not allocate.
+    struct ChildSetup {
+        char* const* cmd{};
+        char* const* envp{};
+        char const* cwd{};
+        int in_fd{};
+        int out_fd{};
+        int err_fd{};
+        bool own_group{};
+        sigset_t sigmask{};  // signal mask to restore before executing
+        int error{};         // errno of the failed setup, set by the child
+    };
+
+    /// \brief Stack size of the child process until it executed the command,
+    /// in addition to the space needed for a copy of argv by execvpe.
+    static constexpr std::size_t kChildStackSize = std::size_t{64} << 10U;
+
+    /// \brief Create file exclusively as write-only. The descriptor is not
+    /// inherited by commands and does not collide with stdin, stdout, and
+    /// stderr, which it is redirected to.
+    /// \returns The file descriptor or -1 on failure.
     [[nodiscard]] static auto OpenFile(
-        std::filesystem::path const& file_path) noexcept {
-        static auto file_closer = [](gsl::owner<FILE*> f) {
-            if (f != nullptr) {
-                std::fclose(f);
-            }
-        };
-        return std::unique_ptr<FILE, decltype(file_closer)>(
-            std::fopen(file_path.c_str(), "wx"), file_closer);
+        std::filesystem::path const& file_path) noexcept -> int {
+        constexpr ::mode_t kMode = 0666;
+        return AboveStdio(::open(file_path.c_str(),
+                                 O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                                 kMode));
+    }
+
+    /// \brief Move a file descriptor out of the range of stdin, stdout, and
+    /// stderr, so that redirecting them cannot clobber it.
+    [[nodiscard]] static auto AboveStdio(int fd) noexcept -> int {
+        if (fd < 0 or fd > STDERR_FILENO) {
+            return fd;
+        }
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        int const moved = ::fcntl(fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+        ::close(fd);
+        return moved;
+    }
+
+    /// \brief Descriptor of /dev/null, shared by all commands as stdin.
+    /// \returns The file descriptor or -1 if /dev/null cannot be opened.
+    [[nodiscard]] static auto DevNull() noexcept -> int {
+        // some executables require an open (possibly seekable) stdin, which
+        // /dev/null is; it is opened only once for the entire process.
+        static int const kFd =
+            AboveStdio(::open("/dev/null", O_RDONLY | O_CLOEXEC));
+        return kFd;
     }
 
     /// \brief Execute command and arguments.
@@ -109,19 +197,24 @@ class SystemCommand {
     /// \param envp     Environment variables as char pointer array.
     /// \param cwd      Working directory for execution.
     /// \param outdir   Directory for storing stdout/stderr files.
-    /// \returns ExecOutput if command was successfully submitted to the system.
+    /// \param timeout  Time after which the command is killed, if any.
+    /// \returns Result if command was successfully submitted to the system.
     /// \returns std::nullopt on internal failure.
     [[nodiscard]] auto ExecuteCommand(
         char* const* cmd,
         char* const* envp,
         std::filesystem::path const& cwd,
-        std::filesystem::path const& outdir) noexcept -> std::optional<int> {
+        std::filesystem::path const& outdir,
+        std::optional<std::chrono::milliseconds> timeout) noexcept
+        -> std::optional<Result> {
         auto stdout_file = outdir / "stdout";
         auto stderr_file = outdir / "stderr";
-        if (auto const out = OpenFile(stdout_file)) {
-            if (auto const err = OpenFile(stderr_file)) {
-                if (auto retval = ForkAndExecute(
-                        cmd, envp, cwd, fileno(out.get()), fileno(err.get()))) {
+        if (int const out = OpenFile(stdout_file); out != -1) {
+            auto const close_out = gsl::finally([out]() { ::close(out); });
+            if (int const err = OpenFile(stderr_file); err != -1) {
+                auto const close_err = gsl::finally([err]() { ::close(err); });
+                if (auto retval =
+                        SpawnAndWait(cmd, envp, cwd, out, err, timeout)) {
                     return retval;
                 }
             }
@@ -142,69 +235,86 @@ class SystemCommand {
         return std::nullopt;
     }
 
-    /// \brief Fork process and exec command.
+    /// \brief Spawn a child process executing the command and wait for it.
     /// \param cmd      Command arguments as char pointer array.
     /// \param envp     Environment variables as char pointer array.
     /// \param cwd      Working directory for execution.
     /// \param out_fd   File descriptor to standard output file.
     /// \param err_fd   File descriptor to standard erro file.
-    /// \returns return code if command was successfully submitted to system.
-    /// \returns std::nullopt if fork or exec failed.
-    [[nodiscard]] auto ForkAndExecute(char* const* cmd,
-                                      char* const* envp,
-                                      std::filesystem::path const& cwd,
-                                      int out_fd,
-                                      int err_fd) const noexcept
-        -> std::optional<int> {
-        auto const* cwd_cstr = cwd.c_str();
-
-        // some executables require an open (possibly seekable) stdin, and
-        // therefore, we use an open temporary file that does not appear on the
-        // file system and will be removed automatically once the descriptor is
-        // closed.
-        gsl::owner<FILE*> in_file = std::tmpfile();
-        auto in_fd = fileno(in_file);
-
-        // fork child process
-        pid_t pid = ::fork();
-        if (-1 == pid) {
+    /// \param timeout  Time after which the process group is killed, if any.
+    /// \returns Result if command was successfully submitted to system.
+    /// \returns std::nullopt if the child process could not be created.
+    [[nodiscard]] auto SpawnAndWait(
+        char* const* cmd,
+        char* const* envp,
+        std::filesystem::path const& cwd,
+        int out_fd,
+        int err_fd,
+        std::optional<std::chrono::milliseconds> timeout) const noexcept
+        -> std::optional<Result> {
+        ChildSetup setup{.cmd = cmd,
+                         .envp = envp,
+                         .cwd = cwd.c_str(),
+                         .in_fd = DevNull(),
+                         .out_fd = out_fd,
+                         .err_fd = err_fd,
+                         .own_group = timeout.has_value()};
+        if (setup.in_fd == -1) {
             logger_.Emit(LogLevel::Error,
-                         "Failed to execute '{}': cannot fork a child process.",
+                         "Failed to execute '{}': cannot open /dev/null.",
                          *cmd);
             return std::nullopt;
         }
 
-        // dispatch child/parent process
-        if (pid == 0) {
-            ::chdir(cwd_cstr);
-
-            // redirect and close fds
-            ::dup2(in_fd, STDIN_FILENO);
-            ::dup2(out_fd, STDOUT_FILENO);
-            ::dup2(err_fd, STDERR_FILENO);
-            ::close(in_fd);
-            ::close(out_fd);
-            ::close(err_fd);
-
-            // execute command in child process and exit
-            ::execvpe(*cmd, cmd, envp);
-
-            // report error and terminate child process if ::execvp did not exit
-            // NOLINTNEXTLINE
-            printf("Failed to execute '%s' with error: %s\n",
-                   *cmd,
-                   strerror(errno));
+        auto const start = std::chrono::steady_clock::now();
+        pid_t const pid = Spawn(&setup);
+        if (-1 == pid) {
+            logger_.Emit(LogLevel::Error,
+                         "Failed to execute '{}': cannot create a child "
+                         "process: {}",
+                         *cmd,
+                         strerror(errno));
+            return std::nullopt;
+        }
 
-            System::ExitWithoutCleanup(EXIT_FAILURE);
+        Result result{};
+        result.spawn_time =
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+        if (setup.error != 0) {
+            // the child exits with failure, report the reason like the
+            // command would have done
+            auto const message = std::string{"Failed to execute '"} + *cmd +
+                                 "' with error: " + strerror(setup.error) +
+                                 "\n";
+            if (::write(err_fd, message.data(), message.size()) < 0) {
+                logger_.Emit(LogLevel::Debug,
+                             "Failed to execute '{}' with error: {}",
+                             *cmd,
+                             strerror(setup.error));
+            }
         }
 
-        ::close(in_fd);
+        if (timeout) {
+            // also set the process group from the parent, so that it is in
+            // place before killing, whichever process runs first
+            ::setpgid(pid, pid);
+            if (not WaitForExit(pid,
+                                std::chrono::steady_clock::now() + *timeout)) {
+                logger_.Emit(LogLevel::Debug,
+                             "Killing '{}' after timeout of {}ms",
+                             *cmd,
+                             timeout->count());
+                ::kill(-pid, SIGKILL);
+                result.timed_out = true;
+            }
+        }
 
         // wait for child to finish and obtain return value
         int status{};
         std::optional<int> retval{std::nullopt};
         while (not retval) {
-            if (::waitpid(pid, &status, 0) == -1) {
+            if (::wait4(pid, &status, 0, &result.usage) == -1) {
                 // this should never happen
                 logger_.Emit(LogLevel::Error,
                              "Waiting for child failed with: {}",
@@ -225,7 +335,167 @@ class SystemCommand {
             // continue waitpid() in case we got STOPSIG from child
         }
 
-        return retval;
+        if (not retval) {
+            return std::nullopt;
+        }
+        result.exit_code = *retval;
+        return result;
+    }
+
+    /// \brief Create a child process running ExecChild. On Linux, the child
+    /// shares the memory of the parent until it executed the command, like
+    /// posix_spawn does, instead of copying the page tables of this possibly
+    /// large process; the parent thread is suspended meanwhile. All signals
+    /// are blocked during creation, so that no handler of the parent runs in
+    /// the child.
+    /// \returns The pid of the child or -1 on failure, with errno set.
+    [[nodiscard]] static auto Spawn(
+        gsl::not_null<ChildSetup*> const& setup) noexcept -> pid_t {
+        sigset_t all{};
+        ::sigfillset(&all);
+        ::pthread_sigmask(SIG_SETMASK, &all, &setup->sigmask);
+        pid_t pid = -1;
+#ifdef __linux__
+        std::size_t argc = 0;
+        while (setup->cmd[argc] != nullptr) {  // NOLINT
+            ++argc;
+        }
+        constexpr std::size_t kPageSize = 4096;
+        auto const stack_size =
+            (kChildStackSize + (argc + 2) * sizeof(char*) + kPageSize - 1) /
+            kPageSize * kPageSize;
+        void* stack = ::mmap(nullptr,
+                             stack_size,
+                             PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK,
+                             -1,
+                             0);
+        if (stack != MAP_FAILED) {
+            // the stack grows downwards on all supported architectures
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+            pid = ::clone(&ExecChild,
+                          static_cast<char*>(stack) + stack_size,  // NOLINT
+                          CLONE_VM | CLONE_VFORK | SIGCHLD,        // NOLINT
+                          setup.get());
+            int const error = errno;
+            ::munmap(stack, stack_size);
+            errno = error;
+        }
+#else
+        pid = ::fork();
+        if (pid == 0) {
+            ExecChild(setup.get());
+        }
+#endif
+        int const error = errno;
+        ::pthread_sigmask(SIG_SETMASK, &setup->sigmask, nullptr);
+        errno = error;
+        return pid;
+    }
+
+    /// \brief Body of the child process, setting up its environment and
+    /// executing the command. As it runs in the memory of the parent, only
+    /// async-signal-safe functions may be called.
+    static auto ExecChild(void* arg) noexcept -> int {
+        auto* setup = static_cast<ChildSetup*>(arg);
+
+        // handlers of the parent must not run in the child, so reset them
+        // before unblocking signals again
+        for (int sig = 1; sig < NSIG; ++sig) {
+            struct sigaction action{};
+            if (::sigaction(sig, nullptr, &action) == 0 and
+                action.sa_handler != SIG_IGN and  // NOLINT
+                action.sa_handler != SIG_DFL) {   // NOLINT
+                action.sa_handler = SIG_DFL;      // NOLINT
+                action.sa_flags = 0;
+                ::sigaction(sig, &action, nullptr);
+            }
+        }
+
+        if (setup->own_group) {
+            // lead a process group of its own, to be killed as a whole; as
+            // it does not receive signals of the terminal any more, make sure
+            // it does not survive us.
+            ::setpgid(0, 0);
+#ifdef __linux__
+            ::prctl(PR_SET_PDEATHSIG, SIGKILL);  // NOLINT
+#endif
+        }
+
+        // redirect fds; the originals are closed on exec
+        if (::chdir(setup->cwd) == 0 and
+            ::dup2(setup->in_fd, STDIN_FILENO) != -1 and
+            ::dup2(setup->out_fd, STDOUT_FILENO) != -1 and
+            ::dup2(setup->err_fd, STDERR_FILENO) != -1 and
+            ::sigprocmask(SIG_SETMASK, &setup->sigmask, nullptr) == 0) {
+            // execute command in child process
+            ::execvpe(*setup->cmd, setup->cmd, setup->envp);
+        }
+
+        // report error to the parent and terminate child process
+        setup->error = errno;
+        System::ExitWithoutCleanup(EXIT_FAILURE);
+        return EXIT_FAILURE;
+    }
+
+    /// \brief Wait until a child process terminated or the deadline passed,
+    /// without reaping the child.
+    /// \returns Whether the child terminated before the deadline.
+    [[nodiscard]] static auto WaitForExit(
+        pid_t pid,
+        std::chrono::steady_clock::time_point deadline) noexcept -> bool {
+        using std::chrono::milliseconds;
+        auto const remaining = [deadline]() -> milliseconds {
+            auto const left = std::chrono::ceil<milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+            return std::max(left, milliseconds::zero());
+        };
+#ifdef SYS_pidfd_open
+        // a pidfd becomes readable once the process terminated
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-vararg)
+        int const pidfd = static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+        if (pidfd >= 0) {
+            std::optional<bool> exited{};
+            while (not exited) {
+                pollfd fd{.fd = pidfd, .events = POLLIN, .revents = 0};
+                auto const wait_ms = std::min<milliseconds::rep>(
+                    remaining().count(), std::numeric_limits<int>::max());
+                auto const ret = ::poll(&fd, 1, static_cast<int>(wait_ms));
+                if (ret > 0) {
+                    exited = true;
+                }
+                else if (ret == 0 and remaining() == milliseconds::zero()) {
+                    exited = false;
+                }
+                else if (ret < 0 and errno != EINTR) {
+                    break;  // fall back to polling
+                }
+            }
+            ::close(pidfd);
+            if (exited) {
+                return *exited;
+            }
+        }
+#endif
+        // poll the state of the child with increasing intervals
+        constexpr auto kMaxInterval = milliseconds{100};
+        auto interval = milliseconds{1};
+        while (true) {
+            siginfo_t info{};
+            if (::waitid(P_PID,
+                         static_cast<id_t>(pid),
+                         &info,
+                         WEXITED | WNOHANG | WNOWAIT) != 0 or  // NOLINT
+                info.si_pid == pid) {
+                return true;
+            }
+            auto const left = remaining();
+            if (left == milliseconds::zero()) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::min(interval, left));
+            interval = std::min(interval * 2, kMaxInterval);
+        }
     }
 
     static auto UnwrapStrings(std::vector<std::string>* v) noexcept
@@ -75,7 +75,7 @@
     std::map<std::string, std::string> env{};
     auto repo_desc_env = repo_desc->Get("env", Expression::none_t{});
     if (repo_desc_env.IsNotNull() and repo_desc_env->IsMap()) {
-        for (auto const& envar : repo_desc_env->Map().Items()) {
+        for (auto const& envar : repo_desc_env->Map()) {
             if (envar.second.IsNotNull() and envar.second->IsString()) {
                 env.insert({envar.first, envar.second->String()});
             }
@@ -0,0 +1,115 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/cpp/chunked_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <system_error>
+#include <utility>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "fmt/core.h"
+
+auto ChunkedReader::FromFile(std::size_t chunk_size,
+                             std::filesystem::path const& path)
+    -> expected<ChunkedReader, std::string> {
+    if (chunk_size == 0) {
+        return unexpected<std::string>{"Chunk size must be greater than 0."};
+    }
+    auto closer = [](gsl::owner<std::FILE*> file) -> void {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    };
+    auto file =
+        std::shared_ptr<std::FILE>{std::fopen(path.c_str(), "rb"), closer};
+    if (not file) {
+        return unexpected{fmt::format("Failed to open {}: {}",
+                                      path.string(),
+                                      std::strerror(errno))};
+    }
+    std::error_code ec{};
+    auto const size = std::filesystem::file_size(path, ec);
+    if (ec) {
+        return unexpected{fmt::format("Failed to determine size of {}: {}",
+                                      path.string(),
+                                      ec.message())};
+    }
+    return ChunkedReader{chunk_size,
+                         static_cast<std::size_t>(size),
+                         /*data=*/nullptr,
+                         std::move(file)};
+}
+
+auto ChunkedReader::FromMemory(
+    std::size_t chunk_size,
+    gsl::not_null<std::shared_ptr<std::string const>> const& data)
+    -> expected<ChunkedReader, std::string> {
+    if (chunk_size == 0) {
+        return unexpected<std::string>{"Chunk size must be greater than 0."};
+    }
+    return ChunkedReader{
+        chunk_size, data->size(), data.get(), /*file=*/nullptr};
+}
+
+auto ChunkedReader::ReadChunk(std::size_t offset) noexcept
+    -> expected<std::string_view, std::string> {
+    if (offset >= content_size_) {
+        return std::string_view{};
+    }
+    auto const size = std::min(chunk_size_, content_size_ - offset);
+    if (data_) {
+        return std::string_view{*data_}.substr(offset, size);
+    }
+    try {
+        buffer_.resize(size);
+        std::size_t pos = 0;
+        while (pos < size) {
+            auto const read = ::pread(::fileno(file_.get()),
+                                      buffer_.data() + pos,
+                                      size - pos,
+                                      static_cast<off_t>(offset + pos));
+            if (read < 0 and errno == EINTR) {
+                continue;
+            }
+            if (read <= 0) {
+                return unexpected{
+                    fmt::format("Failed to read {} bytes at offset {}: {}",
+                                size - pos,
+                                offset + pos,
+                                read < 0 ? std::strerror(errno)
+                                         : "unexpected end of file")};
+            }
+            pos += static_cast<std::size_t>(read);
+        }
+        return std::string_view{buffer_};
+    } catch (std::exception const& e) {
+        return unexpected{fmt::format(
+            "Failed to read chunk at offset {}: {}", offset, e.what())};
+    }
+}
+
+ChunkedReader::ChunkedReader(std::size_t chunk_size,
+                             std::size_t content_size,
+                             std::shared_ptr<std::string const> data,
+                             std::shared_ptr<std::FILE> file) noexcept
+    : chunk_size_{chunk_size},
+      content_size_{content_size},
+      data_{std::move(data)},
+      file_{std::move(file)} {}
@@ -0,0 +1,70 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_UTILS_CPP_CHUNKED_READER_HPP
+#define INCLUDED_SRC_UTILS_CPP_CHUNKED_READER_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "gsl/gsl"
+#include "src/utils/cpp/expected.hpp"
+
+/// \brief Reads content in chunks of bounded size at arbitrary offsets. The
+/// content is either kept in memory or read from a file on demand, so that
+/// at most a single chunk of a file is in memory at any time.
+class ChunkedReader final {
+  public:
+    /// \brief Create a reader for the content of a file. The file is kept
+    /// open for the lifetime of the reader.
+    [[nodiscard]] static auto FromFile(std::size_t chunk_size,
+                                       std::filesystem::path const& path)
+        -> expected<ChunkedReader, std::string>;
+
+    /// \brief Create a reader for content in memory.
+    [[nodiscard]] static auto FromMemory(
+        std::size_t chunk_size,
+        gsl::not_null<std::shared_ptr<std::string const>> const& data)
+        -> expected<ChunkedReader, std::string>;
+
+    /// \brief Size of the entire content.
+    [[nodiscard]] auto GetContentSize() const noexcept -> std::size_t {
+        return content_size_;
+    }
+
+    /// \brief Read the chunk starting at the given offset.
+    /// \returns The chunk, which is empty if offset is at or beyond the end
+    /// of the content, or an error message on read failure. The returned view
+    /// is valid until the next call to ReadChunk.
+    [[nodiscard]] auto ReadChunk(std::size_t offset) noexcept
+        -> expected<std::string_view, std::string>;
+
+  private:
+    std::size_t chunk_size_;
+    std::size_t content_size_;
+    std::shared_ptr<std::string const> data_;  // content in memory
+    std::shared_ptr<std::FILE> file_;          // content in file
+    std::string buffer_;                       // last chunk read from file
+
+    ChunkedReader(std::size_t chunk_size,
+                  std::size_t content_size,
+                  std::shared_ptr<std::string const> data,
+                  std::shared_ptr<std::FILE> file) noexcept;
+};
+
+#endif  // INCLUDED_SRC_UTILS_CPP_CHUNKED_READER_HPP
@@ -0,0 +1,209 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/cpp/deflate.hpp"
+
+#include <exception>
+#include <utility>
+
+#include "fmt/core.h"
+#include "gsl/gsl"
+
+extern "C" {
+#include <zlib.h>
+}
+
+namespace {
+// Negative window bits select raw DEFLATE without zlib header and trailer.
+constexpr int kRawDeflateWindowBits = -15;
+constexpr int kMemLevel = 8;
+constexpr std::size_t kCompressChunkSize = 64UL * 1024;
+
+[[nodiscard]] auto ErrorMessage(z_stream const& stream,
+                                int ret) -> std::string {
+    return stream.msg != nullptr ? std::string{stream.msg}
+                                 : fmt::format("zlib error {}", ret);
+}
+}  // namespace
+
+struct DeflateCompressor::Stream final : z_stream {};
+struct DeflateDecompressor::Stream final : z_stream {};
+
+void DeflateCompressor::StreamDeleter::operator()(
+    Stream* stream) const noexcept {
+    if (stream != nullptr) {
+        ::deflateEnd(stream);
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+        delete stream;
+    }
+}
+
+void DeflateDecompressor::StreamDeleter::operator()(
+    Stream* stream) const noexcept {
+    if (stream != nullptr) {
+        ::inflateEnd(stream);
+        // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+        delete stream;
+    }
+}
+
+auto DeflateCompressor::Create(int level) noexcept
+    -> expected<DeflateCompressor, std::string> {
+    if (level < kMinLevel or level > kMaxLevel) {
+        return unexpected{fmt::format(
+            "Compression level must be in [{}, {}], but got {}.",
+            kMinLevel,
+            kMaxLevel,
+            level)};
+    }
+    try {
+        auto stream = std::unique_ptr<Stream, StreamDeleter>{new Stream{}};
+        auto const ret = ::deflateInit2(stream.get(),
+                                        level,
+                                        Z_DEFLATED,
+                                        kRawDeflateWindowBits,
+                                        kMemLevel,
+                                        Z_DEFAULT_STRATEGY);
+        if (ret != Z_OK) {
+            auto msg = ErrorMessage(*stream, ret);
+            // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+            delete stream.release();  // not initialized, do not call deflateEnd
+            return unexpected{
+                fmt::format("Failed to initialize compression: {}", msg)};
+        }
+        return DeflateCompressor{std::move(stream)};
+    } catch (std::exception const& ex) {
+        return unexpected{
+            fmt::format("Failed to initialize compression: {}", ex.what())};
+    }
+}
+
+auto DeflateCompressor::Compress(std::string_view input, bool finish) noexcept
+    -> expected<std::string, std::string> {
+    try {
+        // zlib does not modify the input, but its interface is not const
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        stream_->next_in = reinterpret_cast<Bytef*>(
+            const_cast<char*>(input.data()));  // NOLINT
+        stream_->avail_in = gsl::narrow<uInt>(input.size());
+
+        std::string output{};
+        auto const flush = finish ? Z_FINISH : Z_NO_FLUSH;
+        int ret = Z_OK;
+        do {  // NOLINT(cppcoreguidelines-avoid-do-while)
+            auto const pos = output.size();
+            output.resize(pos + kCompressChunkSize);
+            stream_->next_out =
+                reinterpret_cast<Bytef*>(&output[pos]);  // NOLINT
+            stream_->avail_out = gsl::narrow<uInt>(kCompressChunkSize);
+            ret = ::deflate(stream_.get(), flush);
+            if (ret == Z_STREAM_ERROR) {
+                return unexpected{fmt::format("Failed to compress: {}",
+                                              ErrorMessage(*stream_, ret))};
+            }
+            output.resize(pos + kCompressChunkSize - stream_->avail_out);
+            // more output is pending as long as the output buffer was filled
+        } while (stream_->avail_out == 0);
+        if (finish and ret != Z_STREAM_END) {
+            return unexpected<std::string>{
+                "Failed to compress: stream not finished"};
+        }
+        return output;
+    } catch (std::exception const& ex) {
+        return unexpected{fmt::format("Failed to compress: {}", ex.what())};
+    }
+}
+
+DeflateCompressor::DeflateCompressor(
+    std::unique_ptr<Stream, StreamDeleter> stream) noexcept
+    : stream_{std::move(stream)} {}
+
+auto DeflateDecompressor::Create(std::size_t chunk_size) noexcept
+    -> expected<DeflateDecompressor, std::string> {
+    if (chunk_size == 0) {
+        return unexpected<std::string>{"Chunk size must be greater than 0."};
+    }
+    try {
+        auto stream = std::unique_ptr<Stream, StreamDeleter>{new Stream{}};
+        auto const ret = ::inflateInit2(stream.get(), kRawDeflateWindowBits);
+        if (ret != Z_OK) {
+            auto msg = ErrorMessage(*stream, ret);
+            // NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+            delete stream.release();  // not initialized, do not call inflateEnd
+            return unexpected{
+                fmt::format("Failed to initialize decompression: {}", msg)};
+        }
+        return DeflateDecompressor{std::move(stream), chunk_size};
+    } catch (std::exception const& ex) {
+        return unexpected{
+            fmt::format("Failed to initialize decompression: {}", ex.what())};
+    }
+}
+
+auto DeflateDecompressor::Decompress(std::string_view input,
+                                     Sink const& sink) noexcept
+    -> std::optional<std::string> {
+    if (finished_) {
+        if (input.empty()) {
+            return std::nullopt;
+        }
+        return "Failed to decompress: data after end of stream";
+    }
+    try {
+        // zlib does not modify the input, but its interface is not const
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        stream_->next_in = reinterpret_cast<Bytef*>(
+            const_cast<char*>(input.data()));  // NOLINT
+        stream_->avail_in = gsl::narrow<uInt>(input.size());
+
+        auto chunk = std::string(chunk_size_, '\0');
+        do {  // NOLINT(cppcoreguidelines-avoid-do-while)
+            stream_->next_out =
+                reinterpret_cast<Bytef*>(chunk.data());  // NOLINT
+            stream_->avail_out = gsl::narrow<uInt>(chunk_size_);
+            auto const ret = ::inflate(stream_.get(), Z_NO_FLUSH);
+            if (ret != Z_OK and ret != Z_STREAM_END and ret != Z_BUF_ERROR) {
+                return fmt::format("Failed to decompress: {}",
+                                   ErrorMessage(*stream_, ret));
+            }
+            auto const produced = chunk_size_ - stream_->avail_out;
+            if (produced > 0) {
+                chunk.resize(produced);
+                if (not sink(chunk)) {
+                    return "Failed to decompress: output not consumed";
+                }
+                chunk.resize(chunk_size_);
+            }
+            if (ret == Z_STREAM_END) {
+                finished_ = true;
+                if (stream_->avail_in != 0) {
+                    return "Failed to decompress: data after end of stream";
+                }
+                break;
+            }
+            if (ret == Z_BUF_ERROR) {
+                break;  // no progress possible, more input needed
+            }
+            // continue as long as the output buffer was filled
+        } while (stream_->avail_out == 0 or stream_->avail_in != 0);
+        return std::nullopt;
+    } catch (std::exception const& ex) {
+        return fmt::format("Failed to decompress: {}", ex.what());
+    }
+}
+
+DeflateDecompressor::DeflateDecompressor(
+    std::unique_ptr<Stream, StreamDeleter> stream,
+    std::size_t chunk_size) noexcept
+    : stream_{std::move(stream)}, chunk_size_{chunk_size} {}
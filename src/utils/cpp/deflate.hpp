@@ -0,0 +1,102 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INCLUDED_SRC_UTILS_CPP_DEFLATE_HPP
+#define INCLUDED_SRC_UTILS_CPP_DEFLATE_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "src/utils/cpp/expected.hpp"
+
+/// \brief Streaming compression to the raw DEFLATE format (RFC 1951).
+class DeflateCompressor final {
+  public:
+    static constexpr int kMinLevel = 1;
+    static constexpr int kMaxLevel = 9;
+    static constexpr int kDefaultLevel = 6;
+
+    /// \brief Create a compressor for the given compression level, ranging
+    /// from kMinLevel (fastest) to kMaxLevel (best compression).
+    [[nodiscard]] static auto Create(int level) noexcept
+        -> expected<DeflateCompressor, std::string>;
+
+    /// \brief Compress the next part of the input.
+    /// \param input    The next part of the input.
+    /// \param finish   Whether this is the last part of the input, in which
+    /// case all pending output is flushed.
+    /// \returns The compressed output available so far, which might be empty,
+    /// or an error message.
+    [[nodiscard]] auto Compress(std::string_view input, bool finish) noexcept
+        -> expected<std::string, std::string>;
+
+  private:
+    struct Stream;
+    struct StreamDeleter {
+        void operator()(Stream* stream) const noexcept;
+    };
+    // zlib streams must not be moved after initialization
+    std::unique_ptr<Stream, StreamDeleter> stream_;
+
+    explicit DeflateCompressor(
+        std::unique_ptr<Stream, StreamDeleter> stream) noexcept;
+};
+
+/// \brief Streaming decompression from the raw DEFLATE format (RFC 1951).
+/// The output is produced in chunks of bounded size, so that small input
+/// cannot cause arbitrarily large allocations.
+class DeflateDecompressor final {
+  public:
+    /// \brief Consumer of decompressed output chunks.
+    /// \returns Whether decompression should continue.
+    using Sink = std::function<bool(std::string const&)>;
+
+    static constexpr std::size_t kDefaultChunkSize = 64UL * 1024;
+
+    [[nodiscard]] static auto Create(
+        std::size_t chunk_size = kDefaultChunkSize) noexcept
+        -> expected<DeflateDecompressor, std::string>;
+
+    /// \brief Decompress the next part of the input, passing all output
+    /// produced to the sink.
+    /// \returns An error message on corrupt input or if the sink failed,
+    /// std::nullopt on success.
+    [[nodiscard]] auto Decompress(std::string_view input,
+                                  Sink const& sink) noexcept
+        -> std::optional<std::string>;
+
+    /// \brief Whether the end of the compressed stream was reached.
+    [[nodiscard]] auto IsFinished() const noexcept -> bool {
+        return finished_;
+    }
+
+  private:
+    struct Stream;
+    struct StreamDeleter {
+        void operator()(Stream* stream) const noexcept;
+    };
+    // zlib streams must not be moved after initialization
+    std::unique_ptr<Stream, StreamDeleter> stream_;
+    std::size_t chunk_size_;
+    bool finished_ = false;
+
+    DeflateDecompressor(std::unique_ptr<Stream, StreamDeleter> stream,
+                        std::size_t chunk_size) noexcept;
+};
+
+#endif  // INCLUDED_SRC_UTILS_CPP_DEFLATE_HPP
@@ -14,21 +14,27 @@
 
 #include "src/buildtool/build_engine/expression/expression.hpp"
 
+#include <chrono>
 #include <filesystem>
 #include <functional>
+#include <limits>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/matchers/catch_matchers_all.hpp"
+#include "fmt/core.h"
 #include "nlohmann/json.hpp"
 #include "src/buildtool/build_engine/expression/configuration.hpp"
+#include "src/buildtool/build_engine/expression/evaluator.hpp"
+#include "src/buildtool/build_engine/expression/expression_interner.hpp"
 #include "src/buildtool/build_engine/expression/expression_ptr.hpp"
 #include "src/buildtool/build_engine/expression/function_map.hpp"
 #include "src/buildtool/build_engine/expression/linked_map.hpp"
 #include "src/buildtool/build_engine/expression/target_result.hpp"
 #include "src/buildtool/common/artifact_description.hpp"
+#include "src/buildtool/common/statistics.hpp"
 
 TEST_CASE("Expression access", "[expression]") {  // NOLINT
     using namespace std::string_literals;
@@ -1899,3 +1905,438 @@ TEST_CASE("Expression hash computation", "[expression]") {
         }
     }
 }
+
+TEST_CASE("Expression hash stability", "[expression]") {
+    // Expression hashes identify actions and the nodes of serialized target
+    // results; they must not change between versions.
+    auto identifier = [](std::string const& json) {
+        return Expression::FromJson(nlohmann::json::parse(json))
+            .ToIdentifier();
+    };
+    CHECK(identifier("null") ==
+          "8ce86a6ae65d3692e7305e2c58ac62eebd97d3d943e093f577da25c36988246b");
+    CHECK(identifier("true") ==
+          "e632b7095b0bf32c260fa4c539e9fd7b852d0de454e9be26f24d0d6f91d069d3");
+    CHECK(identifier("42") ==
+          "af9683764878694b9b450606f40785c60a51abe2480a8057c70da44a83928f04");
+    CHECK(identifier("-0.0") ==
+          "79297e5248ac42f3cdd0b67efa012ce0e508e2bde9a56b56299cdee89c0db24a");
+    CHECK(identifier(R"("foo")") ==
+          "eb110d0d617271b6fe2c15130e17710adbbdf0e5ba09553e52a0533b6da2c3f9");
+    CHECK(identifier(R"([1, "a", null])") ==
+          "ad6e1d848d6dd294e7a531ef2e70089cf896cad4b04642a6de59aace266f6dbc");
+    CHECK(identifier(R"({"a": [true], "b": {"c": 1.5}})") ==
+          "f51bdbe59000d7ab2cceee9c3c1a4057fe8e39fd3896d98778c8b6c354b378d3");
+
+    // content is length-prefixed, so boundaries cannot be shifted
+    CHECK(identifier(R"({"ab": "c"})") != identifier(R"({"a": "bc"})"));
+    CHECK(identifier(R"(["ab", "c"])") != identifier(R"(["a", "bc"])"));
+
+    // all NaNs have the same hash
+    auto const nan = ExpressionPtr{std::numeric_limits<double>::quiet_NaN()};
+    auto const neg_nan =
+        ExpressionPtr{-std::numeric_limits<double>::quiet_NaN()};
+    CHECK(nan->ToHash() == neg_nan->ToHash());
+}
+
+TEST_CASE("Expression interning", "[expression]") {
+    auto& interner = ExpressionInterner::Instance();
+
+    SECTION("Equal values read from JSON share one node") {
+        auto const json =
+            R"({"foo": [1, "bar", {"baz": null}], "x": true})"_json;
+        auto const lhs = Expression::FromJson(json);
+        auto const rhs = Expression::FromJson(json);
+        REQUIRE(lhs);
+        REQUIRE(rhs);
+        CHECK(lhs->IsInterned());
+        CHECK(&*lhs == &*rhs);
+        auto const foo = lhs->Get("foo", Expression::none_t{});
+        auto const list =
+            Expression::FromJson(R"([1, "bar", {"baz": null}])"_json);
+        CHECK(&*foo == &*list);
+    }
+
+    SECTION("Interned and non-interned expressions compare by value") {
+        auto const interned = Expression::FromJson(R"(["a", "b"])"_json);
+        auto const other = Expression::FromJson(R"(["a", "c"])"_json);
+        auto const plain = ExpressionPtr{Expression::list_t{
+            ExpressionPtr{std::string{"a"}}, ExpressionPtr{std::string{"b"}}}};
+        CHECK_FALSE(plain->IsInterned());
+        CHECK(interned == plain);
+        CHECK(plain == interned);
+        CHECK_FALSE(interned == other);
+
+        auto const canonical = interner.Intern(plain);
+        CHECK(&*canonical == &*interned);
+    }
+
+    SECTION("Numbers are interned bitwise") {
+        auto const zero = Expression::FromJson("0.0"_json);
+        auto const neg_zero = Expression::FromJson("-0.0"_json);
+        CHECK(zero->IsInterned());
+        CHECK(neg_zero->IsInterned());
+        CHECK_FALSE(&*zero == &*neg_zero);
+        CHECK(zero->ToHash() != neg_zero->ToHash());
+    }
+
+    SECTION("Containers of NaNs are interned to one node") {
+        auto const make_list = [](double number) {
+            return ExpressionPtr{Expression::list_t{ExpressionPtr{number}}};
+        };
+        auto const nan = std::numeric_limits<double>::quiet_NaN();
+        auto const lhs = interner.Intern(make_list(nan));
+        auto const rhs = interner.Intern(make_list(-nan));
+        CHECK(lhs->IsInterned());
+        CHECK(rhs->IsInterned());
+        CHECK(&*lhs == &*rhs);
+        CHECK(lhs == rhs);
+        CHECK(lhs == make_list(nan));
+    }
+
+    SECTION("Pruned configurations are interned") {
+        auto const config = Configuration{Expression::FromJson(
+            R"({"OS": "linux", "ARCH": "x86_64", "DEBUG": true})"_json)};
+        auto const vars = std::vector<std::string>{"ARCH", "OS"};
+        auto const lhs = config.Prune(vars);
+        auto const rhs =
+            config.Update("DEBUG", Expression::kNone).Prune(vars);
+        CHECK(&*lhs.Expr() == &*rhs.Expr());
+        CHECK(lhs == rhs);
+    }
+
+    CHECK(interner.SharedCounter() > 0);
+    CHECK(interner.SharedCounter() <= interner.InternedCounter());
+}
+
+TEST_CASE("Built-in function memoization", "[expression]") {
+    auto env = Configuration{};
+    auto fcts = FunctionMapPtr{};
+    Statistics stats{};
+    Evaluator::SetBuiltinMemoization(1024, &stats);
+
+    SECTION("Equal arguments share the result") {
+        auto const expr = Expression::FromJson(R"(
+            { "type": "nub_right"
+            , "$1": {"type": "++", "$1": [["a", "b"], ["c", "a"]]}
+            })"_json);
+        REQUIRE(expr);
+        auto const first = expr.Evaluate(env, fcts);
+        REQUIRE(first);
+        CHECK(first == Expression::FromJson(R"(["b", "c", "a"])"_json));
+        auto const second = expr.Evaluate(env, fcts);
+        REQUIRE(second);
+        CHECK(&*first == &*second);
+        CHECK(stats.BuiltinMemoHitsCounter() == 2);
+        CHECK(stats.BuiltinMemoMissesCounter() == 2);
+    }
+
+    SECTION("Different arguments are not confused") {
+        auto const expr = Expression::FromJson(R"(
+            { "type": "to_subdir"
+            , "subdir": {"type": "var", "name": "DIR"}
+            , "$1": {"type": "'", "$1": {"foo": "hello"}}
+            })"_json);
+        REQUIRE(expr);
+        auto const lhs =
+            expr.Evaluate(env.Update("DIR", std::string{"x"}), fcts);
+        auto const rhs =
+            expr.Evaluate(env.Update("DIR", std::string{"y"}), fcts);
+        REQUIRE(lhs);
+        REQUIRE(rhs);
+        CHECK(lhs == Expression::FromJson(R"({"x/foo": "hello"})"_json));
+        CHECK(rhs == Expression::FromJson(R"({"y/foo": "hello"})"_json));
+        CHECK(stats.BuiltinMemoHitsCounter() == 0);
+        CHECK(stats.BuiltinMemoMissesCounter() == 2);
+
+        auto const join = Expression::FromJson(R"(
+            {"type": "join", "$1": ["x", "y"], "separator": ","})"_json);
+        auto const join_cmd = Expression::FromJson(R"(
+            {"type": "join_cmd", "$1": ["x", "y"]})"_json);
+        REQUIRE(join);
+        REQUIRE(join_cmd);
+        CHECK(join.Evaluate(env, fcts) == ExpressionPtr{std::string{"x,y"}});
+        CHECK(join_cmd.Evaluate(env, fcts) ==
+              ExpressionPtr{std::string{"'x' 'y'"}});
+        CHECK(stats.BuiltinMemoMissesCounter() == 4);
+    }
+
+    SECTION("Failures are not memoized") {
+        auto const expr = Expression::FromJson(R"(
+            { "type": "map_union"
+            , "$1": {"type": "'", "$1": [{"a": 1}, "not a map"]}
+            })"_json);
+        REQUIRE(expr);
+        CHECK_FALSE(expr.Evaluate(env, fcts, [](auto const& /*unused*/) {}));
+        CHECK_FALSE(expr.Evaluate(env, fcts, [](auto const& /*unused*/) {}));
+        CHECK(stats.BuiltinMemoHitsCounter() == 0);
+        CHECK(stats.BuiltinMemoMissesCounter() == 2);
+    }
+
+    SECTION("Memoization can be disabled") {
+        Evaluator::SetBuiltinMemoization(0, &stats);
+        auto const expr = Expression::FromJson(R"(
+            {"type": "nub_left", "$1": ["a", "b", "a"]})"_json);
+        REQUIRE(expr);
+        auto const first = expr.Evaluate(env, fcts);
+        auto const second = expr.Evaluate(env, fcts);
+        REQUIRE(first);
+        REQUIRE(second);
+        CHECK(first == second);
+        CHECK_FALSE(&*first == &*second);
+        CHECK(stats.BuiltinMemoHitsCounter() == 0);
+        CHECK(stats.BuiltinMemoMissesCounter() == 0);
+    }
+
+    Evaluator::SetBuiltinMemoization(0);
+}
+
+namespace {
+
+/// \brief Body of a rule compiling sources, reading fields of the target.
+auto const kRuleBody = R"(
+    { "type": "let*"
+    , "bindings":
+      [ [ "flags"
+        , { "type": "++"
+          , "$1":
+            [ ["-O2", "-Wall"]
+            , {"type": "var", "name": "CFLAGS", "default": []}
+            ]
+          }
+        ]
+      , ["srcs", {"type": "FIELD", "name": "srcs"}]
+      , [ "hdrs"
+        , { "type": "map_union"
+          , "$1":
+            { "type": "foreach"
+            , "var": "x"
+            , "range": {"type": "FIELD", "name": "hdrs"}
+            , "body":
+              { "type": "singleton_map"
+              , "key": {"type": "var", "name": "x"}
+              , "value": {"type": "var", "name": "x"}
+              }
+            }
+          }
+        ]
+      , [ "defaults"
+        , { "type": "to_subdir"
+          , "subdir": "include"
+          , "$1": {"type": "'", "$1": {"a.h": "a", "b.h": "b"}}
+          }
+        ]
+      , [ "cmd"
+        , { "type": "++"
+          , "$1":
+            [ ["cc", "-c"]
+            , {"type": "var", "name": "flags"}
+            , {"type": "nub_right", "$1": {"type": "var", "name": "srcs"}}
+            ]
+          }
+        ]
+      ]
+    , "body":
+      { "type": "map_union"
+      , "$1":
+        [ {"type": "var", "name": "hdrs"}
+        , {"type": "var", "name": "defaults"}
+        , { "type": "singleton_map"
+          , "key": "cmd"
+          , "value": {"type": "join_cmd", "$1": {"type": "var", "name": "cmd"}}
+          }
+        ]
+      }
+    }
+)";
+
+[[nodiscard]] auto FieldProvider(ExpressionPtr const& fields)
+    -> FunctionMapPtr {
+    return FunctionMap::MakePtr(
+        "FIELD",
+        [fields](SubExprEvaluator&& /*eval*/,
+                 ExpressionPtr const& expr,
+                 Configuration const& /*env*/) {
+            auto const name = expr->Get("name", std::string{});
+            return fields->Get(name->String(), Expression::list_t{});
+        });
+}
+
+}  // namespace
+
+TEST_CASE("Compiled expression evaluation", "[expression]") {
+    using namespace std::string_literals;
+    auto const env = Configuration{Expression::FromJson(
+        R"({"CFLAGS": ["-g"], "DEBUG": true})"_json)};
+    auto const fcts = FieldProvider(Expression::FromJson(
+        R"({"srcs": ["a.c", "b.c", "a.c"], "hdrs": ["x.h", "y.h"]})"_json));
+
+    auto evaluate = [&env](ExpressionPtr const& expr,
+                           FunctionMapPtr const& functions,
+                           std::string* log) {
+        return Evaluator::EvaluateExpression(
+            expr, env, functions, [log](auto const& msg) { *log += msg; });
+    };
+    auto evaluate_compiled = [&env](Evaluator::CompiledExpressionPtr const& c,
+                                    FunctionMapPtr const& functions,
+                                    std::string* log) {
+        return Evaluator::EvaluateExpression(
+            *c, env, functions, [log](auto const& msg) { *log += msg; });
+    };
+
+    SECTION("Same result as uncompiled evaluation") {
+        auto const expr =
+            Expression::FromJson(nlohmann::json::parse(kRuleBody));
+        REQUIRE(expr);
+        auto const compiled = Evaluator::Compile(expr);
+        REQUIRE(compiled);
+        std::string log{};
+        auto const result = evaluate_compiled(compiled, fcts, &log);
+        REQUIRE(result);
+        CHECK(result == evaluate(expr, fcts, &log));
+        CHECK(result == Expression::FromJson(R"(
+            { "x.h": "x.h"
+            , "y.h": "y.h"
+            , "include/a.h": "a"
+            , "include/b.h": "b"
+            , "cmd": "'cc' '-c' '-O2' '-Wall' '-g' 'b.c' 'a.c'"
+            })"_json));
+        CHECK(log.empty());
+    }
+
+    SECTION("Parts independent of the environment are evaluated once") {
+        auto const expr = Expression::FromJson(R"(
+            { "type": "if"
+            , "cond": {"type": "var", "name": "DEBUG"}
+            , "then":
+              { "type": "nub_right"
+              , "$1": {"type": "++", "$1": [["-g", "-O0"], ["-g"]]}
+              }
+            , "else": ["-O2"]
+            })"_json);
+        REQUIRE(expr);
+        auto const compiled = Evaluator::Compile(expr);
+        REQUIRE(compiled);
+        std::string log{};
+        auto const first = evaluate_compiled(compiled, fcts, &log);
+        auto const second = evaluate_compiled(compiled, fcts, &log);
+        REQUIRE(first);
+        REQUIRE(second);
+        CHECK(first == Expression::FromJson(R"(["-O0", "-g"])"_json));
+        CHECK(&*first == &*second);
+    }
+
+    SECTION("Parts never reached are not evaluated") {
+        Statistics stats{};
+        Evaluator::SetBuiltinMemoization(1024, &stats);
+        auto const expr = Expression::FromJson(R"(
+            { "type": "if"
+            , "cond": {"type": "var", "name": "DEBUG"}
+            , "then": {"type": "join_cmd", "$1": ["-g"]}
+            , "else": {"type": "join_cmd", "$1": ["-O2"]}
+            })"_json);
+        REQUIRE(expr);
+        auto const compiled = Evaluator::Compile(expr);
+        REQUIRE(compiled);
+        CHECK(stats.BuiltinMemoMissesCounter() == 0);
+        std::string log{};
+        CHECK(evaluate_compiled(compiled, fcts, &log) ==
+              ExpressionPtr{"'-g'"s});
+        CHECK(evaluate_compiled(compiled, fcts, &log) ==
+              ExpressionPtr{"'-g'"s});
+        CHECK(stats.BuiltinMemoHitsCounter() == 0);
+        CHECK(stats.BuiltinMemoMissesCounter() == 1);
+        Evaluator::SetBuiltinMemoization(0);
+    }
+
+    SECTION("Provider functions shadow built-in functions") {
+        auto const expr = Expression::FromJson(R"(
+            { "type": "join"
+            , "$1": {"type": "++", "$1": [["a"], ["b"]]}
+            })"_json);
+        REQUIRE(expr);
+        auto const compiled = Evaluator::Compile(expr);
+        REQUIRE(compiled);
+        auto const shadowing = FunctionMap::MakePtr(
+            fcts,
+            "++",
+            [](auto&& /*eval*/, auto const& /*expr*/, auto const& /*env*/) {
+                return ExpressionPtr{Expression::list_t{
+                    ExpressionPtr{"shadowed"s}}};
+            });
+        std::string log{};
+        CHECK(evaluate_compiled(compiled, fcts, &log) ==
+              ExpressionPtr{"ab"s});
+        CHECK(evaluate_compiled(compiled, shadowing, &log) ==
+              ExpressionPtr{"shadowed"s});
+        CHECK(evaluate(expr, shadowing, &log) == ExpressionPtr{"shadowed"s});
+    }
+
+    SECTION("Same error messages as uncompiled evaluation") {
+        for (auto const* json : {
+                 R"({"type": "nub_right", "$1": "not a list"})",
+                 R"({"type": "++", "$1": [["a"], {"type": "unknown"}]})",
+                 R"({"type": "join", "$1": [{"no type": "a"}]})",
+                 R"({ "type": "to_subdir"
+                    , "subdir": {"type": "var", "name": "DEBUG"}
+                    , "$1": {"type": "'", "$1": {"a": "b"}}
+                    })"}) {
+            auto const expr =
+                Expression::FromJson(nlohmann::json::parse(json));
+            REQUIRE(expr);
+            auto const compiled = Evaluator::Compile(expr);
+            REQUIRE(compiled);
+            std::string expected{};
+            std::string log{};
+            CHECK_FALSE(evaluate(expr, fcts, &expected));
+            CHECK_FALSE(evaluate_compiled(compiled, fcts, &log));
+            CHECK_FALSE(expected.empty());
+            CHECK(log == expected);
+        }
+    }
+}
+
+TEST_CASE("Compiled expression evaluation speed",
+          "[expression][.benchmark]") {
+    constexpr int kTargets{20000};
+    auto const env = Configuration{Expression::FromJson(
+        R"({"CFLAGS": ["-g"], "OS": "linux", "ARCH": "x86_64"})"_json)};
+    auto const expr = Expression::FromJson(nlohmann::json::parse(kRuleBody));
+    REQUIRE(expr);
+
+    // fields of the targets defined by the rule
+    std::vector<FunctionMapPtr> providers{};
+    providers.reserve(kTargets);
+    for (int i{0}; i < kTargets; ++i) {
+        auto const srcs = nlohmann::json::array(
+            {fmt::format("src_{}.c", i), fmt::format("util_{}.c", i % 7)});
+        auto const hdrs = nlohmann::json::array({fmt::format("inc_{}.h", i)});
+        providers.emplace_back(FieldProvider(Expression::FromJson(
+            nlohmann::json{{"srcs", srcs}, {"hdrs", hdrs}})));
+    }
+    auto const logger = [](auto const& /*unused*/) {};
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto const& fcts : providers) {
+        REQUIRE(Evaluator::EvaluateExpression(expr, env, fcts, logger));
+    }
+    auto const plain_time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    start = std::chrono::steady_clock::now();
+    auto const compiled = Evaluator::Compile(expr);
+    REQUIRE(compiled);
+    for (auto const& fcts : providers) {
+        REQUIRE(Evaluator::EvaluateExpression(*compiled, env, fcts, logger));
+    }
+    auto const compiled_time =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    WARN(fmt::format("{} evaluations of a rule body: {:.1f}ms, compiled "
+                     "{:.1f}ms",
+                     kTargets,
+                     plain_time * 1000,
+                     compiled_time * 1000));
+}
@@ -15,15 +15,20 @@
 #include "src/buildtool/build_engine/expression/linked_map.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <optional>
+#include <random>
 #include <string>
 #include <utility>  // std::move
 #include <vector>
 
 #include "catch2/catch_test_macros.hpp"
+#include "fmt/core.h"
 
 TEST_CASE("Empty map", "[linked_map]") {
     using map_t = LinkedMap<std::string, int>;
@@ -270,3 +275,164 @@ TEST_CASE("Hash computation", "[linked_map]") {
     CHECK_FALSE(upd_hash == 0);
     CHECK_FALSE(upd_hash == map_hash);
 }
+
+TEST_CASE("Random unions", "[linked_map]") {
+    using map_t = LinkedMap<int, int>;
+    using reference_t = std::map<int, int>;
+    constexpr int kMaps{200};
+    constexpr int kKeys{500};
+
+    std::mt19937 gen{42};  // NOLINT
+    std::uniform_int_distribution<int> key_dist{0, kKeys - 1};
+    std::uniform_int_distribution<int> size_dist{0, 20};
+
+    // pool of maps and their expected content
+    std::vector<std::pair<map_t::Ptr, reference_t>> pool{};
+    pool.emplace_back(map_t::MakePtr(map_t::underlying_map_t{}),
+                      reference_t{});
+    for (int i{0}; i < kMaps; ++i) {
+        auto entries = map_t::underlying_map_t{};
+        for (int j = size_dist(gen); j > 0; --j) {
+            entries[key_dist(gen)] = i;
+        }
+        auto const& next = pool[gen() % pool.size()];
+        auto const& content = pool[gen() % pool.size()];
+        auto expected = next.second;
+        for (auto const& [key, value] : content.second) {
+            expected[key] = value;
+        }
+        auto shadowed = map_t::MakePtr(next.first, content.first);
+        pool.emplace_back(shadowed, expected);
+
+        for (auto const& [key, value] : entries) {
+            expected[key] = value;
+        }
+        pool.emplace_back(map_t::MakePtr(shadowed, std::move(entries)),
+                          std::move(expected));
+    }
+
+    for (auto const& [map, expected] : pool) {
+        REQUIRE(map->size() == expected.size());
+        CHECK(std::equal(map->begin(),
+                         map->end(),
+                         expected.begin(),
+                         [](auto const& lhs, auto const& rhs) {
+                             return lhs.first == rhs.first and
+                                    lhs.second == rhs.second;
+                         }));
+        for (int key{0}; key < kKeys; ++key) {
+            auto value = map->Find(key);
+            auto it = expected.find(key);
+            REQUIRE(value.has_value() == (it != expected.end()));
+            if (value) {
+                CHECK(**value == it->second);
+            }
+        }
+    }
+
+    // conflicts are the smallest key with different values
+    for (std::size_t i{0}; i + 1 < pool.size(); i += 7) {  // NOLINT
+        auto const& [lhs, lhs_expected] = pool[i];
+        auto const& [rhs, rhs_expected] = pool[i + 1];
+        std::optional<int> conflict{};
+        for (auto const& [key, value] : lhs_expected) {
+            auto it = rhs_expected.find(key);
+            if (it != rhs_expected.end() and it->second != value) {
+                conflict = key;
+                break;
+            }
+        }
+        auto dup = lhs->FindConflictingDuplicate(*rhs);
+        REQUIRE(dup.has_value() == conflict.has_value());
+        if (dup) {
+            CHECK(dup->get() == *conflict);
+        }
+        CHECK((*lhs == *rhs) == (lhs_expected == rhs_expected));
+    }
+}
+
+namespace {
+
+// Union of maps, dividing the list in halves, like the map_union built-in
+// function of the expression language.
+template <class TMap>
+[[nodiscard]] auto BalancedUnion(std::vector<typename TMap::Ptr> const& maps,
+                                 std::size_t from,
+                                 std::size_t to) -> typename TMap::Ptr {
+    if (to == from + 1) {
+        return maps[from];
+    }
+    auto mid = from + ((to - from) / 2);
+    return TMap::MakePtr(BalancedUnion<TMap>(maps, from, mid),
+                         BalancedUnion<TMap>(maps, mid, to));
+}
+
+[[nodiscard]] auto Seconds(std::chrono::steady_clock::time_point start)
+    -> double {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+}
+
+}  // namespace
+
+TEST_CASE("Large maps", "[linked_map][.benchmark]") {
+    using map_t = LinkedMap<std::string, int>;
+    constexpr int kEntries{100000};
+    constexpr int kPerMap{100};
+    constexpr int kUpdates{1000};
+
+    // runfiles-like keys of 1000 maps, as collected from dependencies
+    std::vector<std::string> keys{};
+    keys.reserve(kEntries);
+    for (int i{0}; i < kEntries; ++i) {
+        keys.emplace_back(
+            fmt::format("some/module/dir_{}/file_{}.hpp", i % kPerMap, i));
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<map_t::Ptr> maps{};
+    for (int i{0}; i < kEntries; i += kPerMap) {
+        auto entries = map_t::underlying_map_t{};
+        for (int j{i}; j < i + kPerMap; ++j) {
+            entries.emplace(keys[j], j);
+        }
+        maps.emplace_back(map_t::MakePtr(std::move(entries)));
+    }
+    auto map = BalancedUnion<map_t>(maps, 0, maps.size());
+    auto const union_time = Seconds(start);
+    REQUIRE(map->size() == kEntries);
+
+    start = std::chrono::steady_clock::now();
+    for (int i{0}; i < kEntries; ++i) {
+        REQUIRE(map->at(keys[i]) == i);
+    }
+    auto const lookup_time = Seconds(start);
+
+    start = std::chrono::steady_clock::now();
+    std::size_t count{};
+    for (auto const& [key, value] : *map) {
+        count += key.size() > 0 ? 1 : 0;
+    }
+    auto const iteration_time = Seconds(start);
+    CHECK(count == kEntries);
+
+    // a chain of single-entry updates, as in repeated configuration updates
+    start = std::chrono::steady_clock::now();
+    for (int i{0}; i < kUpdates; ++i) {
+        map = map_t::MakePtr(map, keys[i], -i);
+    }
+    for (int i{0}; i < kEntries; ++i) {
+        REQUIRE(map->at(keys[i]) == (i < kUpdates ? -i : i));
+    }
+    auto const update_time = Seconds(start);
+
+    WARN(fmt::format(
+        "{} entries: union {:.1f}ms, lookups {:.1f}ms, iteration {:.1f}ms, "
+        "{} updates and lookups {:.1f}ms",
+        kEntries,
+        union_time * 1000,
+        lookup_time * 1000,
+        iteration_time * 1000,
+        kUpdates,
+        update_time * 1000));
+}
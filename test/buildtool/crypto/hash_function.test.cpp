@@ -14,12 +14,46 @@
 
 #include "src/buildtool/crypto/hash_function.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <string>
+#include <string_view>
 #include <utility>  // std::move
+#include <vector>
 
 #include "catch2/catch_test_macros.hpp"
+#include "fmt/core.h"
 #include "src/buildtool/crypto/hasher.hpp"
 
+namespace {
+[[nodiscard]] auto GetTestDir() -> std::filesystem::path {
+    auto* tmp_dir = std::getenv("TEST_TMPDIR");
+    if (tmp_dir != nullptr) {
+        return tmp_dir;
+    }
+    return std::filesystem::current_path() / "test/buildtool/crypto";
+}
+
+[[nodiscard]] auto WriteFile(std::filesystem::path const& path,
+                             std::string const& content) -> bool {
+    std::ofstream file{path, std::ios::binary};
+    file << content;
+    file.close();
+    return file.good();
+}
+
+[[nodiscard]] auto CreateContent(std::size_t size) -> std::string {
+    std::string content(size, '\0');
+    for (std::size_t i{}; i < size; ++i) {
+        content[i] = static_cast<char>('a' + (i * 7 % 26));
+    }
+    return content;
+}
+}  // namespace
+
 TEST_CASE("Hash Function", "[crypto]") {
     std::string bytes{"test"};
 
@@ -40,6 +74,18 @@ TEST_CASE("Hash Function", "[crypto]") {
         hasher.Update(bytes);
         CHECK(std::move(hasher).Finalize().HexString() ==  // NOLINT
               "a94a8fe5ccb19ba61c4c0873d391e987982fbbd3");
+
+        // feed blob and tree content in chunks
+        auto blob_hasher = hash_function.MakeBlobHasher(bytes.size());
+        blob_hasher.Update(bytes.substr(0, 2));
+        blob_hasher.Update(bytes.substr(2));
+        CHECK(std::move(blob_hasher).Finalize().HexString() ==  // NOLINT
+              "30d74d258442c7c65512eafab474568dd706c430");
+        auto tree_hasher = hash_function.MakeTreeHasher(bytes.size());
+        tree_hasher.Update(bytes.substr(0, 2));
+        tree_hasher.Update(bytes.substr(2));
+        CHECK(std::move(tree_hasher).Finalize().HexString() ==  // NOLINT
+              "5f0ecc1a989593005e80f457446133250fcc43cc");
     }
 
     SECTION("PlainSHA256") {
@@ -61,5 +107,109 @@ TEST_CASE("Hash Function", "[crypto]") {
         CHECK(
             std::move(hasher).Finalize().HexString() ==  // NOLINT
             "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08");
+
+        auto blob_hasher = hash_function.MakeBlobHasher(bytes.size());
+        blob_hasher.Update(bytes);
+        CHECK(
+            std::move(blob_hasher).Finalize().HexString() ==  // NOLINT
+            "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08");
+    }
+}
+
+TEST_CASE("Hash Function: files", "[crypto]") {
+    for (auto const type :
+         {HashFunction::Type::GitSHA1, HashFunction::Type::PlainSHA256}) {
+        HashFunction const hash_function{type};
+        auto const dir = GetTestDir() / ToString(type);
+        std::filesystem::create_directories(dir);
+
+        // sizes around the internal buffer size of 512 KiB
+        for (std::size_t const size :
+             {0UL, 1UL, 4048UL, 524287UL, 524288UL, 524289UL, 3000000UL}) {
+            auto const content = CreateContent(size);
+            auto const path = dir / fmt::format("file_{}", size);
+            REQUIRE(WriteFile(path, content));
+
+            auto const blob = hash_function.HashBlobFile(path);
+            REQUIRE(blob);
+            CHECK(blob->first.HexString() ==
+                  hash_function.HashBlobData(content).HexString());
+            CHECK(blob->second == size);
+
+            auto const tree = hash_function.HashTreeFile(path);
+            REQUIRE(tree);
+            CHECK(tree->first.HexString() ==
+                  hash_function.HashTreeData(content).HexString());
+        }
+        CHECK_FALSE(hash_function.HashBlobFile(dir / "missing"));
+    }
+}
+
+TEST_CASE("Hash Function: batches", "[crypto]") {
+    // large enough to be hashed in parallel
+    std::vector<std::string> blobs{};
+    for (std::size_t i{}; i < 3000; ++i) {
+        blobs.emplace_back(CreateContent(i));
+    }
+    std::vector<std::string_view> const views{blobs.begin(), blobs.end()};
+
+    for (auto const type :
+         {HashFunction::Type::GitSHA1, HashFunction::Type::PlainSHA256}) {
+        HashFunction const hash_function{type};
+        for (std::size_t const jobs : {0UL, 1UL, 4UL, 64UL}) {
+            auto const digests = hash_function.HashBlobsData(views, jobs);
+            REQUIRE(digests.size() == blobs.size());
+            for (std::size_t i{}; i < blobs.size(); ++i) {
+                CHECK(digests[i].HexString() ==
+                      hash_function.HashBlobData(blobs[i]).HexString());
+            }
+        }
+        CHECK(hash_function.HashBlobsData({}, 4).empty());
+    }
+}
+
+TEST_CASE("Hash Function: throughput", "[crypto][.benchmark]") {
+    HashFunction const hash_function{HashFunction::Type::GitSHA1};
+    auto const dir = GetTestDir() / "throughput";
+    std::filesystem::create_directories(dir);
+
+    auto const report = [](std::string const& name,
+                           std::size_t bytes,
+                           auto const& hash) {
+        constexpr double kGiga = 1e9;
+        auto const start = std::chrono::steady_clock::now();
+        hash();
+        std::chrono::duration<double> const duration =
+            std::chrono::steady_clock::now() - start;
+        WARN(fmt::format("{}: {:.3f} GB/s",
+                         name,
+                         static_cast<double>(bytes) / kGiga /
+                             duration.count()));
+    };
+
+    // hash about 1 GiB in total for every blob size
+    constexpr std::size_t kTotal = std::size_t{1} << 30U;
+    for (std::size_t size = std::size_t{1} << 10U; size <= kTotal;
+         size <<= 4U) {
+        auto const content = CreateContent(size);
+        auto const count = kTotal / size;
+        report(fmt::format("data, {} x {} bytes", count, size), kTotal, [&]() {
+            for (std::size_t i{}; i < count; ++i) {
+                CHECK(hash_function.HashBlobData(content).Length() > 0);
+            }
+        });
+
+        auto const path = dir / fmt::format("blob_{}", size);
+        REQUIRE(WriteFile(path, content));
+        report(fmt::format("file, {} x {} bytes", count, size), kTotal, [&]() {
+            for (std::size_t i{}; i < count; ++i) {
+                CHECK(hash_function.HashBlobFile(path));
+            }
+        });
+
+        std::vector<std::string_view> const batch(count, content);
+        report(fmt::format("batch, {} x {} bytes", count, size), kTotal, [&]() {
+            CHECK(hash_function.HashBlobsData(batch, 8).size() == count);
+        });
     }
 }
@@ -95,11 +95,11 @@ TEST_CASE("Bazel network: write/read blobs", "[execution_api]") {
 
     // Check order maintained
     REQUIRE(blobs.size() == 5);
-    CHECK(*blobs[0].data == content_foo);
-    CHECK(*blobs[1].data == content_bar);
-    CHECK(*blobs[2].data == content_baz);
-    CHECK(*blobs[3].data == content_bar);
-    CHECK(*blobs[4].data == content_foo);
+    CHECK(*blobs[0].ReadContent() == content_foo);
+    CHECK(*blobs[1].ReadContent() == content_bar);
+    CHECK(*blobs[2].ReadContent() == content_baz);
+    CHECK(*blobs[3].ReadContent() == content_bar);
+    CHECK(*blobs[4].ReadContent() == content_foo);
 }
 
 TEST_CASE("Bazel network: read blobs with unknown size", "[execution_api]") {
@@ -157,6 +157,6 @@ TEST_CASE("Bazel network: read blobs with unknown size", "[execution_api]") {
 
     // Check order maintained
     REQUIRE(blobs.size() == 2);
-    CHECK(*blobs[0].data == content_foo);
-    CHECK(*blobs[1].data == content_bar);
+    CHECK(*blobs[0].ReadContent() == content_foo);
+    CHECK(*blobs[1].ReadContent() == content_bar);
 }
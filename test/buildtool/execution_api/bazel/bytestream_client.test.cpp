@@ -15,8 +15,11 @@
 #include "src/buildtool/execution_api/remote/bazel/bytestream_client.hpp"
 
 #include <cstddef>
+#include <filesystem>
+#include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
 #include <grpc/grpc.h>
 
@@ -28,7 +31,9 @@
 #include "src/buildtool/execution_api/common/bytestream_utils.hpp"
 #include "src/buildtool/execution_api/common/execution_common.hpp"
 #include "src/buildtool/execution_api/remote/config.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
+#include "src/utils/cpp/chunked_reader.hpp"
 #include "test/utils/hermeticity/test_hash_function_type.hpp"
 #include "test/utils/remote_execution/test_auth_config.hpp"
 #include "test/utils/remote_execution/test_remote_config.hpp"
@@ -58,7 +63,7 @@ TEST_CASE("ByteStream Client: Transfer single blob", "[execution_api]") {
 
         CHECK(stream.Write(
             ByteStreamUtils::WriteRequest{instance_name, uuid, digest},
-            content));
+            std::make_shared<std::string const>(content)));
 
         SECTION("Download small blob") {
             auto const data = stream.Read(
@@ -79,7 +84,7 @@ TEST_CASE("ByteStream Client: Transfer single blob", "[execution_api]") {
 
         CHECK(not stream.Write(
             ByteStreamUtils::WriteRequest{instance_name, uuid, digest},
-            content));
+            std::make_shared<std::string const>(content)));
     }
 
     SECTION("Upload large blob") {
@@ -98,7 +103,7 @@ TEST_CASE("ByteStream Client: Transfer single blob", "[execution_api]") {
 
         CHECK(stream.Write(
             ByteStreamUtils::WriteRequest{instance_name, uuid, digest},
-            content));
+            std::make_shared<std::string const>(content)));
 
         SECTION("Download large blob") {
             auto const data = stream.Read(
@@ -122,4 +127,31 @@ TEST_CASE("ByteStream Client: Transfer single blob", "[execution_api]") {
             CHECK(data == content);
         }
     }
+
+    SECTION("Upload large blob from file") {
+        static constexpr std::size_t kLargeSize =
+            GRPC_DEFAULT_MAX_RECV_MESSAGE_LENGTH + 1;
+        std::string instance_name{"remote-execution"};
+
+        std::string content(kLargeSize, '\0');
+        for (std::size_t i{}; i < content.size(); ++i) {
+            content[i] = uuid[i % uuid.size()];
+        }
+        auto const file = std::filesystem::path{"large_blob_from_file"};
+        REQUIRE(FileSystemManager::WriteFile(content, file));
+
+        auto digest = BazelDigestFactory::HashDataAs<ObjectType::File>(
+            hash_function, content);
+
+        auto reader =
+            ChunkedReader::FromFile(ByteStreamUtils::kChunkSize, file);
+        REQUIRE(reader);
+        CHECK(stream.Write(
+            ByteStreamUtils::WriteRequest{instance_name, uuid, digest},
+            *std::move(reader)));
+
+        auto const data =
+            stream.Read(ByteStreamUtils::ReadRequest{instance_name, digest});
+        CHECK(data == content);
+    }
 }
@@ -59,3 +59,57 @@ TEST_CASE("WriteRequest", "[common]") {
     CHECK(parsed->GetUUID() == uuid);
     CHECK(std::equal_to<bazel_re::Digest>{}(parsed->GetDigest(), digest));
 }
+
+TEST_CASE("Compressed requests", "[common]") {
+    static constexpr auto* kInstanceName = "instance_name";
+    HashFunction const hash_function{TestHashType::ReadFromEnvironment()};
+
+    auto const digest = BazelDigestFactory::HashDataAs<ObjectType::File>(
+        hash_function, "test_string");
+
+    SECTION("ReadRequest") {
+        std::string const request =
+            ByteStreamUtils::ReadRequest{
+                kInstanceName, digest, ByteStreamUtils::Compressor::Deflate}
+                .ToString();
+        CHECK(request.find("/compressed-blobs/deflate/") != std::string::npos);
+        auto const parsed = ByteStreamUtils::ReadRequest::FromString(request);
+        REQUIRE(parsed);
+        CHECK(parsed->GetInstanceName() == kInstanceName);
+        CHECK(parsed->GetCompressor() == ByteStreamUtils::Compressor::Deflate);
+        CHECK(std::equal_to<bazel_re::Digest>{}(parsed->GetDigest(), digest));
+
+        auto const plain = ByteStreamUtils::ReadRequest::FromString(
+            ByteStreamUtils::ReadRequest{kInstanceName, digest}.ToString());
+        REQUIRE(plain);
+        CHECK(plain->GetCompressor() == ByteStreamUtils::Compressor::Identity);
+    }
+
+    SECTION("WriteRequest") {
+        auto id = CreateProcessUniqueId();
+        REQUIRE(id);
+        std::string const uuid = CreateUUIDVersion4(*id);
+
+        std::string const request =
+            ByteStreamUtils::WriteRequest{kInstanceName,
+                                          uuid,
+                                          digest,
+                                          ByteStreamUtils::Compressor::Deflate}
+                .ToString();
+        auto const parsed = ByteStreamUtils::WriteRequest::FromString(request);
+        REQUIRE(parsed);
+        CHECK(parsed->GetInstanceName() == kInstanceName);
+        CHECK(parsed->GetUUID() == uuid);
+        CHECK(parsed->GetCompressor() == ByteStreamUtils::Compressor::Deflate);
+        CHECK(std::equal_to<bazel_re::Digest>{}(parsed->GetDigest(), digest));
+    }
+
+    SECTION("Unknown compressor") {
+        CHECK_FALSE(ByteStreamUtils::ReadRequest::FromString(
+            "instance_name/compressed-blobs/unknown/abc/3"));
+        CHECK_FALSE(ByteStreamUtils::WriteRequest::FromString(
+            "instance_name/uploads/uuid/compressed-blobs/unknown/abc/3"));
+        CHECK_FALSE(ByteStreamUtils::ReadRequest::FromString(
+            "instance_name/blobs/deflate/abc/3"));
+    }
+}
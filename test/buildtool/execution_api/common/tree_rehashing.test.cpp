@@ -18,6 +18,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "catch2/catch_test_macros.hpp"
@@ -261,9 +262,9 @@ namespace {
     -> std::optional<ArtifactDigest> {
     auto const& cas = storage.CAS();
 
-    auto store_blob = [&cas](std::filesystem::path const& path,
-                             auto is_exec) -> std::optional<ArtifactDigest> {
-        return cas.StoreBlob</*kOwner=*/true>(path, is_exec);
+    auto store_blobs = [&cas](auto const& files)
+        -> std::optional<std::vector<ArtifactDigest>> {
+        return cas.StoreBlobs</*kOwner=*/true>(files);
     };
     auto store_tree =
         [&cas](std::string const& content) -> std::optional<ArtifactDigest> {
@@ -276,20 +277,27 @@ namespace {
 
     return ProtocolTraits::IsNative(cas.GetHashFunction().GetType())
                ? BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
-                     path, store_blob, store_tree, store_symlink)
+                     path, store_blobs, store_tree, store_symlink)
                : BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
-                     path, store_blob, store_tree, store_symlink);
+                     path, store_blobs, store_tree, store_symlink);
 }
 
 [[nodiscard]] auto HashTree(HashFunction::Type hash_type,
                             std::filesystem::path const& path) noexcept
     -> std::optional<ArtifactDigest> {
     HashFunction const hash_function{hash_type};
-    auto hash_blob = [hash_function](
-                         std::filesystem::path const& path,
-                         auto /*is_exec*/) -> std::optional<ArtifactDigest> {
-        return ArtifactDigestFactory::HashFileAs<ObjectType::File>(
-            hash_function, path);
+    auto hash_blobs = [hash_function](auto const& files)
+        -> std::optional<std::vector<ArtifactDigest>> {
+        std::vector<ArtifactDigest> digests{};
+        for (auto const& [path, is_exec] : files) {
+            auto digest = ArtifactDigestFactory::HashFileAs<ObjectType::File>(
+                hash_function, path);
+            if (not digest) {
+                return std::nullopt;
+            }
+            digests.emplace_back(*std::move(digest));
+        }
+        return digests;
     };
     auto hash_tree =
         [hash_function](
@@ -305,8 +313,8 @@ namespace {
     };
     return ProtocolTraits::IsNative(hash_type)
                ? BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
-                     path, hash_blob, hash_tree, hash_symlink)
+                     path, hash_blobs, hash_tree, hash_symlink)
                : BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
-                     path, hash_blob, hash_tree, hash_symlink);
+                     path, hash_blobs, hash_tree, hash_symlink);
 }
 }  // namespace
@@ -0,0 +1,79 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/execution_api/execution_service/bytestream_server.hpp"
+
+#include <cstdint>
+#include <string>
+
+#include <grpcpp/support/status.h>
+
+#include "catch2/catch_test_macros.hpp"
+#include "src/buildtool/common/bazel_digest_factory.hpp"
+#include "src/buildtool/common/bazel_types.hpp"
+#include "src/buildtool/crypto/hash_function.hpp"
+#include "src/buildtool/execution_api/common/bytestream_utils.hpp"
+#include "src/buildtool/execution_api/local/config.hpp"
+#include "src/buildtool/execution_api/local/context.hpp"
+#include "src/buildtool/file_system/object_type.hpp"
+#include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/storage.hpp"
+#include "test/utils/hermeticity/test_storage_config.hpp"
+
+TEST_CASE("ByteStream Service: query write status", "[execution_service]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    LocalExecutionConfig const local_exec_config{};
+
+    // pack the local context instances to be passed
+    LocalContext const local_context{.exec_config = &local_exec_config,
+                                     .storage_config = &storage_config.Get(),
+                                     .storage = &storage};
+
+    auto bytestream_server = BytestreamServiceImpl{&local_context};
+    auto const instance_name = std::string{"remote-execution"};
+    auto const uuid = std::string{"c4f03510-7d56-4490-8934-01bce1b1288e"};
+
+    auto const content = std::string{"content"};
+    auto const digest = BazelDigestFactory::HashDataAs<ObjectType::File>(
+        storage_config.Get().hash_function, content);
+
+    auto request = google::bytestream::QueryWriteStatusRequest{};
+    request.set_resource_name(
+        ByteStreamUtils::WriteRequest{instance_name, uuid, digest}.ToString());
+    auto response = google::bytestream::QueryWriteStatusResponse{};
+
+    SECTION("Unknown upload") {
+        auto status =
+            bytestream_server.QueryWriteStatus(nullptr, &request, &response);
+        CHECK(status.error_code() == grpc::StatusCode::NOT_FOUND);
+    }
+
+    SECTION("Finished upload") {
+        REQUIRE(storage.CAS().StoreBlob(content, /*is_executable=*/false));
+        auto status =
+            bytestream_server.QueryWriteStatus(nullptr, &request, &response);
+        REQUIRE(status.ok());
+        CHECK(response.complete());
+        CHECK(response.committed_size() ==
+              static_cast<std::int64_t>(content.size()));
+    }
+
+    SECTION("Malformed resource name") {
+        request.set_resource_name("malformed");
+        auto status =
+            bytestream_server.QueryWriteStatus(nullptr, &request, &response);
+        CHECK(status.error_code() == grpc::StatusCode::INVALID_ARGUMENT);
+    }
+}
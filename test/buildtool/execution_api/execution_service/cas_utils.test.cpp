@@ -0,0 +1,89 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/execution_api/execution_service/cas_utils.hpp"
+
+#include <string>
+#include <utility>
+
+#include <grpcpp/support/status.h>
+
+#include "catch2/catch_test_macros.hpp"
+#include "src/buildtool/common/artifact_digest.hpp"
+#include "src/buildtool/common/artifact_digest_factory.hpp"
+#include "src/buildtool/file_system/object_type.hpp"
+#include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/storage.hpp"
+#include "test/utils/hermeticity/test_storage_config.hpp"
+
+TEST_CASE("CASContentWriter", "[execution_service]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const hash_function = storage_config.Get().hash_function;
+
+    auto const tmp_dir = storage_config.Get().CreateTypedTmpDir("test");
+    REQUIRE(tmp_dir);
+    auto const file = tmp_dir->GetPath() / "upload";
+
+    std::string const content{"just some content"};
+    auto const digest =
+        ArtifactDigestFactory::HashDataAs<ObjectType::File>(hash_function,
+                                                            content);
+    auto const split = content.size() / 2;
+
+    SECTION("Write content in chunks") {
+        auto writer = CASContentWriter::Create(hash_function, digest, file, 0);
+        REQUIRE(writer);
+        auto content_writer = *std::move(writer);
+        REQUIRE(content_writer.Write(content.substr(0, split)));
+        REQUIRE(content_writer.Write(content.substr(split)));
+        CHECK(content_writer.GetOffset() == content.size());
+
+        auto const status = std::move(content_writer).Finish(storage);
+        REQUIRE(status.ok());
+        CHECK(storage.CAS().BlobPath(digest, /*is_executable=*/false));
+    }
+
+    SECTION("Continue partially written content") {
+        {
+            // write the first half followed by garbage
+            auto writer =
+                CASContentWriter::Create(hash_function, digest, file, 0);
+            REQUIRE(writer);
+            auto content_writer = *std::move(writer);
+            REQUIRE(content_writer.Write(content.substr(0, split)));
+            REQUIRE(content_writer.Write("garbage"));
+        }
+        auto writer =
+            CASContentWriter::Create(hash_function, digest, file, split);
+        REQUIRE(writer);
+        auto content_writer = *std::move(writer);
+        REQUIRE(content_writer.Write(content.substr(split)));
+
+        auto const status = std::move(content_writer).Finish(storage);
+        REQUIRE(status.ok());
+        CHECK(storage.CAS().BlobPath(digest, /*is_executable=*/false));
+    }
+
+    SECTION("Reject content not matching the digest") {
+        auto writer = CASContentWriter::Create(hash_function, digest, file, 0);
+        REQUIRE(writer);
+        auto content_writer = *std::move(writer);
+        REQUIRE(content_writer.Write(std::string(content.size(), 'x')));
+
+        auto const status = std::move(content_writer).Finish(storage);
+        CHECK(status.error_code() == grpc::StatusCode::INVALID_ARGUMENT);
+        CHECK_FALSE(storage.CAS().BlobPath(digest, /*is_executable=*/false));
+    }
+}
@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstddef>
 #include <cstdlib>
+#include <deque>
 #include <filesystem>
 #include <map>
 #include <memory>
@@ -22,6 +24,9 @@
 #include <utility>
 #include <vector>
 
+#include <unistd.h>
+
+#include "catch2/benchmark/catch_benchmark.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "fmt/core.h"
 #include "gsl/gsl"
@@ -42,6 +47,7 @@
 #include "src/buildtool/logging/log_level.hpp"
 #include "src/buildtool/logging/logger.hpp"
 #include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/garbage_collector.hpp"
 #include "src/buildtool/storage/storage.hpp"
 #include "src/utils/cpp/expected.hpp"
 #include "test/utils/hermeticity/test_storage_config.hpp"
@@ -57,8 +63,8 @@ namespace {
            "test/buildtool/execution_api/local";
 }
 
-[[nodiscard]] inline auto CreateLocalExecConfig() noexcept
-    -> LocalExecutionConfig {
+[[nodiscard]] inline auto CreateLocalExecConfig(
+    bool tree_cache = false) noexcept -> LocalExecutionConfig {
     std::vector<std::string> launcher{"env"};
     auto* env_path = std::getenv("PATH");
     if (env_path != nullptr) {
@@ -68,7 +74,9 @@ namespace {
         launcher.emplace_back("PATH=/bin:/usr/bin");
     }
     LocalExecutionConfig::Builder builder;
-    if (auto config = builder.SetLauncher(std::move(launcher)).Build()) {
+    if (auto config = builder.SetLauncher(std::move(launcher))
+                          .SetTreeCache(tree_cache)
+                          .Build()) {
         return *std::move(config);
     }
     Logger::Log(LogLevel::Error, "Failure setting the local launcher.");
@@ -383,3 +391,272 @@ TEST_CASE("LocalExecution: Cache failed action's result", "[execution_api]") {
 
     CHECK(FileSystemManager::RemoveFile(flag));
 }
+
+namespace {
+
+constexpr std::size_t kNumSyntheticBlobs = 64;
+
+/// \brief Upload a synthetic input tree of files spread over two levels of
+/// directories with at most 100 files each, sharing a few distinct blobs.
+[[nodiscard]] auto UploadSyntheticTree(LocalApi const& api,
+                                       HashFunction hash_function,
+                                       std::size_t num_files)
+    -> std::optional<ArtifactDigest> {
+    std::vector<ArtifactDigest> digests{};
+    ArtifactBlobContainer blobs{};
+    for (std::size_t i{}; i < kNumSyntheticBlobs; ++i) {
+        auto content = fmt::format("content {}", i);
+        auto digest = ArtifactDigestFactory::HashDataAs<ObjectType::File>(
+            hash_function, content);
+        digests.emplace_back(digest);
+        blobs.Emplace(
+            ArtifactBlob{digest, std::move(content), /*is_exec=*/false});
+    }
+    if (not api.Upload(std::move(blobs), /*skip_find_missing=*/false)) {
+        return std::nullopt;
+    }
+
+    std::deque<DependencyGraph::ArtifactNode> nodes{};
+    std::vector<DependencyGraph::NamedArtifactNodePtr> artifacts{};
+    artifacts.reserve(num_files);
+    for (std::size_t i{}; i < num_files; ++i) {
+        auto& node = nodes.emplace_back(
+            ArtifactDescription::CreateKnown(digests[i % kNumSyntheticBlobs],
+                                             ObjectType::File)
+                .ToArtifact());
+        artifacts.emplace_back(
+            fmt::format("d{}/d{}/f{}", i / 1000, (i / 100) % 10, i), &node);
+    }
+    return api.UploadTree(artifacts);
+}
+
+}  // namespace
+
+TEST_CASE("LocalExecution: Stage large input tree", "[execution_api]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const local_exec_config = CreateLocalExecConfig();
+
+    // pack the local context instances to be passed to LocalApi
+    LocalContext const local_context{.exec_config = &local_exec_config,
+                                     .storage_config = &storage_config.Get(),
+                                     .storage = &storage};
+
+    RepositoryConfig repo_config{};
+
+    auto api = LocalApi(&local_context, &repo_config);
+
+    // large enough to be staged in parallel
+    std::size_t const num_files = 5000;
+    auto const root = UploadSyntheticTree(
+        api, storage_config.Get().hash_function, num_files);
+    REQUIRE(root);
+
+    std::vector<std::string> const cmdline = {
+        "sh", "-c", "find . -type f | wc -l; cat d4/d9/f4999"};
+    auto action = api.CreateAction(*root, cmdline, "", {}, {}, {}, {});
+    REQUIRE(action);
+    action->SetCacheFlag(IExecutionAction::CacheFlag::DoNotCacheOutput);
+
+    auto output = action->Execute(nullptr);
+    REQUIRE(output);
+    CHECK(output->ExitCode() == 0);
+    CHECK(output->StdOut() ==
+          fmt::format("{}\ncontent {}",
+                      num_files,
+                      (num_files - 1) % kNumSyntheticBlobs));
+}
+
+TEST_CASE("LocalExecution: Collect large output directory",
+          "[execution_api]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const local_exec_config = CreateLocalExecConfig();
+
+    // pack the local context instances to be passed to LocalApi
+    LocalContext const local_context{.exec_config = &local_exec_config,
+                                     .storage_config = &storage_config.Get(),
+                                     .storage = &storage};
+
+    RepositoryConfig repo_config{};
+
+    auto api = LocalApi(&local_context, &repo_config);
+
+    // large enough to be stored in parallel
+    auto const root = UploadSyntheticTree(
+        api, storage_config.Get().hash_function, /*num_files=*/5000);
+    REQUIRE(root);
+
+    // copying the entire input yields an output tree identical to the input
+    std::string const output_path{"out"};
+    std::vector<std::string> const cmdline = {
+        "cp", "-R", "d0", "d1", "d2", "d3", "d4", output_path};
+    auto action =
+        api.CreateAction(*root, cmdline, "", {}, {output_path}, {}, {});
+    REQUIRE(action);
+    action->SetCacheFlag(IExecutionAction::CacheFlag::DoNotCacheOutput);
+
+    auto output = action->Execute(nullptr);
+    REQUIRE(output);
+    CHECK(output->ExitCode() == 0);
+    auto const artifacts = output->Artifacts();
+    REQUIRE(artifacts.has_value());
+    REQUIRE(artifacts.value()->contains(output_path));
+    CHECK(artifacts.value()->at(output_path).digest == *root);
+}
+
+TEST_CASE("LocalExecution: Stage input trees from tree cache",
+          "[execution_api]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const local_exec_config = CreateLocalExecConfig(/*tree_cache=*/true);
+
+    // pack the local context instances to be passed to LocalApi
+    LocalContext const local_context{.exec_config = &local_exec_config,
+                                     .storage_config = &storage_config.Get(),
+                                     .storage = &storage};
+
+    RepositoryConfig repo_config{};
+
+    auto api = LocalApi(&local_context, &repo_config);
+
+    // five subtrees d0, ..., d4 of 1000 files each
+    auto const root = UploadSyntheticTree(
+        api, storage_config.Get().hash_function, /*num_files=*/5000);
+    REQUIRE(root);
+
+    // the subtree containing an output is staged file by file
+    std::string const output_path{"d3/out"};
+    std::vector<std::string> const cmdline = {
+        "sh",
+        "-c",
+        fmt::format("test -L d4 && test ! -L d3 && cat d4/d9/f4999 > {}",
+                    output_path)};
+    auto action =
+        api.CreateAction(*root, cmdline, "", {output_path}, {}, {}, {});
+    REQUIRE(action);
+    action->SetCacheFlag(IExecutionAction::CacheFlag::DoNotCacheOutput);
+
+    auto const expected = ArtifactDigestFactory::HashDataAs<ObjectType::File>(
+        storage_config.Get().hash_function,
+        fmt::format("content {}", 4999 % kNumSyntheticBlobs));
+
+    // the second execution reuses the materialised trees
+    for (int i = 0; i < 2; ++i) {
+        auto output = action->Execute(nullptr);
+        REQUIRE(output);
+        CHECK(output->ExitCode() == 0);
+        auto const artifacts = output->Artifacts();
+        REQUIRE(artifacts.has_value());
+        REQUIRE(artifacts.value()->contains(output_path));
+        CHECK(artifacts.value()->at(output_path).digest == expected);
+    }
+}
+
+TEST_CASE("LocalExecution: Materialised input trees are read-only",
+          "[execution_api]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const local_exec_config = CreateLocalExecConfig(/*tree_cache=*/true);
+
+    // pack the local context instances to be passed to LocalApi
+    LocalContext const local_context{.exec_config = &local_exec_config,
+                                     .storage_config = &storage_config.Get(),
+                                     .storage = &storage};
+
+    RepositoryConfig repo_config{};
+
+    auto api = LocalApi(&local_context, &repo_config);
+
+    // five subtrees d0, ..., d4 of 1000 files each
+    auto const root = UploadSyntheticTree(
+        api, storage_config.Get().hash_function, /*num_files=*/5000);
+    REQUIRE(root);
+
+    // the action tries to write next to its inputs, as, e.g., python does
+    std::vector<std::string> const cmdline = {
+        "sh",
+        "-c",
+        "test -L d4 || exit 1; touch d4/lock; mkdir d4/d0/__pycache__; "
+        "touch d4/d0/f0; exit 0"};
+    auto action = api.CreateAction(*root, cmdline, "", {}, {}, {}, {});
+    REQUIRE(action);
+    action->SetCacheFlag(IExecutionAction::CacheFlag::DoNotCacheOutput);
+    auto output = action->Execute(nullptr);
+    REQUIRE(output);
+    CHECK(output->ExitCode() == 0);
+
+    auto const trees_dir =
+        storage_config.Get().CreateGenerationConfig(0).materialised_trees;
+    std::size_t num_dirs{};
+    for (auto const& entry :
+         std::filesystem::recursive_directory_iterator{trees_dir}) {
+        if (entry.is_directory()) {
+            ++num_dirs;
+            CHECK((entry.status().permissions() &
+                   std::filesystem::perms::owner_write) ==
+                  std::filesystem::perms::none);
+        }
+    }
+    CHECK(num_dirs > 0);
+
+    // the cached trees are unchanged for later actions (root ignores the
+    // permissions, though)
+    if (::geteuid() != 0) {
+        auto check = api.CreateAction(
+            *root,
+            {"sh",
+             "-c",
+             "test ! -e d4/lock && test ! -e d4/d0/__pycache__ && "
+             "test ! -e d4/d0/f0"},
+            "",
+            {},
+            {},
+            {},
+            {});
+        REQUIRE(check);
+        check->SetCacheFlag(IExecutionAction::CacheFlag::DoNotCacheOutput);
+        auto result = check->Execute(nullptr);
+        REQUIRE(result);
+        CHECK(result->ExitCode() == 0);
+    }
+
+    // rotating the generations removes the read-only trees again
+    for (std::size_t i{}; i < storage_config.Get().num_generations; ++i) {
+        REQUIRE(GarbageCollector::TriggerGarbageCollection(
+            storage_config.Get()));
+    }
+    for (std::size_t i{}; i < storage_config.Get().num_generations; ++i) {
+        CHECK_FALSE(FileSystemManager::IsDirectory(
+            storage_config.Get().GenerationCacheRoot(i)));
+    }
+}
+
+TEST_CASE("LocalExecution: Staging synthetic input trees",
+          "[execution_api][.benchmark]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const local_exec_config = CreateLocalExecConfig();
+
+    // pack the local context instances to be passed to LocalApi
+    LocalContext const local_context{.exec_config = &local_exec_config,
+                                     .storage_config = &storage_config.Get(),
+                                     .storage = &storage};
+
+    RepositoryConfig repo_config{};
+
+    auto api = LocalApi(&local_context, &repo_config);
+
+    for (std::size_t const num_files : {1000U, 10000U, 100000U}) {
+        auto const root = UploadSyntheticTree(
+            api, storage_config.Get().hash_function, num_files);
+        REQUIRE(root);
+        auto action = api.CreateAction(*root, {"true"}, "", {}, {}, {}, {});
+        REQUIRE(action);
+        action->SetCacheFlag(IExecutionAction::CacheFlag::DoNotCacheOutput);
+
+        BENCHMARK(fmt::format("Stage {} files", num_files)) {
+            return action->Execute(nullptr);
+        };
+    }
+}
@@ -226,7 +226,7 @@ class TestApi : public IExecutionApi {
         return std::all_of(
             blob_range.begin(), blob_range.end(), [this](auto const& blob) {
                 // for local artifacts
-                auto it1 = config_.artifacts.find(*blob.data);
+                auto it1 = config_.artifacts.find(*blob.ReadContent());
                 if (it1 != config_.artifacts.end() and it1->second.uploads) {
                     return true;
                 }
@@ -38,6 +38,7 @@
 #include "src/buildtool/common/artifact_description.hpp"
 #include "src/buildtool/common/identifier.hpp"
 #include "src/buildtool/execution_engine/dag/dag.hpp"
+#include "src/buildtool/execution_engine/traverser/critical_path.hpp"
 #include "test/utils/container_matchers.hpp"
 #include "test/utils/hermeticity/test_hash_function_type.hpp"
 
@@ -71,6 +72,11 @@ class TestBuildInfo {
 
     [[nodiscard]] auto Name() const noexcept -> std::string { return name_; }
 
+    [[nodiscard]] auto ActionsStarted() const noexcept
+        -> std::vector<ActionIdentifier> {
+        return actions_started_;
+    }
+
     void SetName(std::string const& name) noexcept {
         std::lock_guard lock{mutex_};
         name_ = name;
@@ -106,11 +112,17 @@ class TestBuildInfo {
         return true;
     }
 
+    void InsertActionStarted(ActionIdentifier const& action_id) {
+        std::lock_guard lock{mutex_};
+        actions_started_.push_back(action_id);
+    }
+
   private:
     std::unordered_set<ArtifactIdentifier> correctly_built_;
     std::unordered_set<ArtifactIdentifier> incorrectly_built_;
     std::unordered_set<ArtifactIdentifier> artifacts_uploaded_;
     std::unordered_set<ArtifactIdentifier> uploaded_more_than_once_;
+    std::vector<ActionIdentifier> actions_started_;
     std::string name_;
     std::mutex mutex_;
 };
@@ -125,6 +137,7 @@ class TestExecutor {
         const noexcept -> bool {
         try {
             build_info_->SetName(name_);
+            build_info_->InsertActionStarted(action->Content().Id());
             bool const all_deps_available = AllAvailable(action->Children());
             if (all_deps_available) {
                 return std::all_of(
@@ -899,3 +912,124 @@ TEST_CASE("lib2 depends on lib1, executable depends on lib1 and lib2") {
         CHECK(build_info.Name() == name);
     }
 }
+
+TEST_CASE("Critical-path priorities", "[traverser]") {
+    TestProject p;
+    CHECK(p.AddOutputInputPair(
+        "make_exe",
+        {"executable"},
+        {ArtifactDescription::CreateLocal("main.cpp", "repo").ToJson(),
+         ArtifactDescription::CreateAction("make_lib", "library").ToJson()}));
+    CHECK(p.AddOutputInputPair(
+        "make_lib",
+        {"library"},
+        {ArtifactDescription::CreateLocal("library.cpp", "repo").ToJson()}));
+    CHECK(p.AddOutputInputPair(
+        "make_doc",
+        {"doc"},
+        {ArtifactDescription::CreateLocal("doc.md", "repo").ToJson()}));
+    DependencyGraph g;
+    CHECK(p.FillGraph(&g));
+
+    auto const exec_id =
+        ArtifactDescription::CreateAction("make_exe", "executable").Id();
+    auto const lib_id =
+        ArtifactDescription::CreateAction("make_lib", "library").Id();
+    auto const doc_id =
+        ArtifactDescription::CreateAction("make_doc", "doc").Id();
+    auto const* make_exe = g.ActionNodeWithId("make_exe");
+    auto const* make_lib = g.ActionNodeWithId("make_lib");
+    auto const* make_doc = g.ActionNodeWithId("make_doc");
+    REQUIRE(make_exe != nullptr);
+    REQUIRE(make_lib != nullptr);
+    REQUIRE(make_doc != nullptr);
+
+    SECTION("Unit weights") {
+        auto priorities = ComputeCriticalPathPriorities(
+            {g.ArtifactNodeWithId(exec_id), g.ArtifactNodeWithId(doc_id)},
+            [](auto const& /*unused*/) { return 1.0; });
+        CHECK(priorities.size() == 3);
+        CHECK(priorities[make_exe] == 1.0);
+        CHECK(priorities[make_lib] == 2.0);
+        CHECK(priorities[make_doc] == 1.0);
+    }
+    SECTION("Heavy leaf action") {
+        auto priorities = ComputeCriticalPathPriorities(
+            {g.ArtifactNodeWithId(exec_id), g.ArtifactNodeWithId(doc_id)},
+            [make_doc](auto const& action) {
+                return &action == make_doc ? 10.0 : 1.0;
+            });
+        CHECK(priorities[make_lib] == 2.0);
+        CHECK(priorities[make_doc] == 10.0);
+    }
+    SECTION("Consumers not needed are ignored") {
+        auto priorities = ComputeCriticalPathPriorities(
+            {g.ArtifactNodeWithId(lib_id)},
+            [](auto const& /*unused*/) { return 1.0; });
+        CHECK(priorities.size() == 1);
+        CHECK(priorities[make_lib] == 1.0);
+    }
+}
+
+TEST_CASE("Traverse ready actions in critical-path order", "[traverser]") {
+    TestProject p;
+    CHECK(p.AddOutputInputPair(
+        "make_gen",
+        {"generated"},
+        {ArtifactDescription::CreateLocal("gen.in", "repo").ToJson()}));
+    for (auto const* name : {"a", "b", "c", "d"}) {
+        CHECK(p.AddOutputInputPair(
+            std::string{"make_"} + name,
+            {name},
+            {ArtifactDescription::CreateAction("make_gen", "generated")
+                 .ToJson()}));
+    }
+    CHECK(p.AddOutputInputPair(
+        "make_all",
+        {"all"},
+        {ArtifactDescription::CreateAction("make_a", "a").ToJson(),
+         ArtifactDescription::CreateAction("make_b", "b").ToJson(),
+         ArtifactDescription::CreateAction("make_c", "c").ToJson(),
+         ArtifactDescription::CreateAction("make_d", "d").ToJson()}));
+    DependencyGraph g;
+    CHECK(p.FillGraph(&g));
+
+    // Distinct priorities: make_b > make_d > make_c > make_a.
+    std::map<ActionIdentifier, double> const weights{
+        {"make_a", 1.0}, {"make_b", 4.0}, {"make_c", 2.0}, {"make_d", 3.0}};
+    auto const weight = [&weights](DependencyGraph::ActionNode const& action) {
+        auto it = weights.find(action.Content().Id());
+        return it != weights.end() ? it->second : 1.0;
+    };
+
+    // With a single job, nodes are visited depth first, so the consumers of
+    // make_gen would be discovered and become ready one after the other. Mark
+    // them as required in advance, as if discovered by concurrent visits, so
+    // that all of them become ready at once when make_gen is done.
+    for (auto const* id : {"make_a", "make_b", "make_c", "make_d"}) {
+        auto const* action = g.ActionNodeWithId(id);
+        REQUIRE(action != nullptr);
+        action->TraversalState()->MarkRequired();
+    }
+
+    TestBuildInfo build_info;
+    std::atomic<bool> failed{};
+    {
+        TestExecutor runner{&build_info};
+        Traverser traverser(runner, g, /*jobs=*/1, &failed, weight);
+        CHECK(traverser.Traverse());
+    }
+    CHECK_FALSE(failed);
+    CHECK_THAT(
+        build_info.CorrectlyBuilt(),
+        HasSameUniqueElementsAs<std::unordered_set<ArtifactIdentifier>>(
+            p.ArtifactsToBeBuilt()));
+    CHECK(build_info.IncorrectlyBuilt().empty());
+    CHECK(build_info.ActionsStarted() ==
+          std::vector<ActionIdentifier>{"make_gen",
+                                        "make_b",
+                                        "make_d",
+                                        "make_c",
+                                        "make_a",
+                                        "make_all"});
+}
@@ -0,0 +1,142 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/multithreading/concurrent_async_map.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "catch2/benchmark/catch_benchmark.hpp"
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/generators/catch_generators_all.hpp"
+#include "src/buildtool/multithreading/async_map.hpp"
+#include "src/buildtool/multithreading/task_system.hpp"
+
+namespace {
+
+// Let `num_threads` tasks request nodes for `num_keys` keys, each task
+// starting at a different offset, such that both hits and misses happen
+// concurrently.
+template <typename Map>
+void RequestAllKeys(Map* map, std::size_t num_threads, std::size_t num_keys) {
+    TaskSystem ts{num_threads};
+    for (std::size_t t{}; t < num_threads; ++t) {
+        ts.QueueTask([map, t, num_threads, num_keys]() {
+            auto const offset = t * num_keys / num_threads;
+            for (std::size_t i{}; i < num_keys; ++i) {
+                auto key = (i + offset) % num_keys;
+                static_cast<void>(map->GetOrCreateNode(key));
+            }
+        });
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Single-threaded: nodes only created once",
+          "[concurrent_async_map]") {
+    ConcurrentAsyncMap<std::string, int> map;
+    auto* key_node = map.GetOrCreateNode("key");
+    CHECK(key_node != nullptr);
+
+    auto* other_node = map.GetOrCreateNode("otherkey");
+    CHECK(other_node != nullptr);
+
+    auto* should_be_key_node = map.GetOrCreateNode("key");
+    CHECK(should_be_key_node != nullptr);
+
+    CHECK(key_node != other_node);
+    CHECK(key_node == should_be_key_node);
+    CHECK(key_node->GetKey() == "key");
+    CHECK(other_node->GetKey() == "otherkey");
+}
+
+TEST_CASE("Nodes are stable while the map grows", "[concurrent_async_map]") {
+    std::size_t const num_keys = 100000;
+    ConcurrentAsyncMap<std::size_t, int> map{1};
+    std::vector<ConcurrentAsyncMap<std::size_t, int>::NodePtr> nodes{};
+    nodes.reserve(num_keys);
+    for (std::size_t i{}; i < num_keys; ++i) {
+        nodes.emplace_back(map.GetOrCreateNode(i));
+    }
+    for (std::size_t i{}; i < num_keys; ++i) {
+        auto* node = map.GetOrCreateNode(i);
+        REQUIRE(node == nodes[i]);
+        REQUIRE(node->GetKey() == i);
+    }
+    CHECK(map.GetPendingKeys().size() == num_keys);
+}
+
+TEST_CASE("Multi-threaded: nodes only created once",
+          "[concurrent_async_map]") {
+    std::size_t const num_threads = GENERATE(1U, 4U, 16U);
+    std::size_t const num_keys = 20000;
+
+    ConcurrentAsyncMap<std::size_t, int> map{1};
+    std::vector<std::atomic<ConcurrentAsyncMap<std::size_t, int>::NodePtr>>
+        nodes(num_keys);
+    std::atomic<bool> mismatch{false};
+    {
+        TaskSystem ts{num_threads};
+        for (std::size_t t{}; t < num_threads; ++t) {
+            ts.QueueTask([&, t]() {
+                for (std::size_t i{}; i < num_keys; ++i) {
+                    auto key = (i * (t + 1)) % num_keys;
+                    auto* node = map.GetOrCreateNode(key);
+                    ConcurrentAsyncMap<std::size_t, int>::NodePtr expected{
+                        nullptr};
+                    if (node->GetKey() != key or
+                        (not nodes[key].compare_exchange_strong(expected,
+                                                                node) and
+                         expected != node)) {
+                        mismatch = true;
+                    }
+                }
+            });
+        }
+    }
+    CHECK_FALSE(mismatch);
+    CHECK(map.GetPendingKeys().size() == num_keys);
+}
+
+TEST_CASE("Clear removes all nodes", "[concurrent_async_map]") {
+    ConcurrentAsyncMap<std::string, int> map;
+    static_cast<void>(map.GetOrCreateNode("key"));
+    static_cast<void>(map.GetOrCreateNode("otherkey"));
+    CHECK(map.GetPendingKeys().size() == 2);
+    {
+        TaskSystem ts;
+        map.Clear(&ts);
+    }
+    CHECK(map.GetPendingKeys().empty());
+    CHECK(map.GetOrCreateNode("key") != nullptr);
+    CHECK(map.GetPendingKeys().size() == 1);
+}
+
+TEST_CASE("Map contention", "[concurrent_async_map][.benchmark]") {
+    std::size_t const num_keys = 100000;
+    for (std::size_t num_threads : {8U, 32U, 128U}) {
+        auto const suffix = std::to_string(num_threads) + " threads";
+        BENCHMARK("AsyncMap, " + suffix) {
+            AsyncMap<std::size_t, int> map{num_threads};
+            RequestAllKeys(&map, num_threads, num_keys);
+        };
+        BENCHMARK("ConcurrentAsyncMap, " + suffix) {
+            ConcurrentAsyncMap<std::size_t, int> map{num_threads};
+            RequestAllKeys(&map, num_threads, num_keys);
+        };
+    }
+}
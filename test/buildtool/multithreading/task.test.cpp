@@ -14,7 +14,9 @@
 
 #include "src/buildtool/multithreading/task.hpp"
 
+#include <array>
 #include <functional>
+#include <memory>
 #include <utility>  // std::move
 
 #include "catch2/catch_test_macros.hpp"
@@ -376,3 +378,54 @@ TEST_CASE("Task moving from named object can be executed", "[task]") {
         }
     }
 }
+
+TEST_CASE("Task can hold move-only callables", "[task]") {
+    int num = 0;
+    auto value = std::make_unique<int>(kDummyValue);
+    Task t{[&num, value = std::move(value)]() { num = *value; }};
+    CHECK(t);
+    t();
+    CHECK(num == kDummyValue);
+}
+
+TEST_CASE("Moving a task moves its callable", "[task]") {
+    SECTION("Small callable (stored inline)") {
+        int num = 0;
+        Task t{[&num]() { num += 3; }};
+        Task moved{std::move(t)};
+        CHECK(not t);  // NOLINT(bugprone-use-after-move)
+        CHECK(moved);
+        moved();
+        CHECK(num == 3);
+
+        Task assigned{};
+        assigned = std::move(moved);
+        CHECK(not moved);  // NOLINT(bugprone-use-after-move)
+        assigned();
+        CHECK(num == 6);
+    }
+    SECTION("Large callable (stored on heap)") {
+        int num = 0;
+        std::array<int, 2 * Task::kInlineSize> data{};
+        data.back() = kDummyValue;
+        Task t{[&num, data]() { num += data.back(); }};
+        Task moved{std::move(t)};
+        CHECK(not t);  // NOLINT(bugprone-use-after-move)
+        moved();
+        CHECK(num == kDummyValue);
+
+        Task assigned{[]() {}};
+        assigned = std::move(moved);
+        assigned();
+        CHECK(num == 2 * kDummyValue);
+    }
+}
+
+TEST_CASE("Destroying a task destroys its callable", "[task]") {
+    auto value = std::make_shared<int>(kDummyValue);
+    {
+        Task t{[value]() { static_cast<void>(value); }};
+        CHECK(value.use_count() == 2);
+    }
+    CHECK(value.use_count() == 1);
+}
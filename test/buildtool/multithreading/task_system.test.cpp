@@ -31,6 +31,7 @@
 #include <utility>
 #include <vector>
 
+#include "catch2/benchmark/catch_benchmark.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/generators/catch_generators_all.hpp"
 #include "catch2/matchers/catch_matchers_all.hpp"
@@ -41,6 +42,35 @@ namespace {
 
 enum class CallStatus : std::uint8_t { kNotExecuted, kExecuted };
 
+// Recursively queue `fanout` tasks per level, up to `depth`, mimicking the
+// way dependencies are discovered during analysis (each task queues its
+// dependencies from within a worker thread).
+void QueueTree(TaskSystem* ts,
+               std::atomic<std::size_t>* count,
+               std::size_t fanout,
+               std::size_t depth) {
+    ++(*count);
+    if (depth == 0) {
+        return;
+    }
+    for (std::size_t i{}; i < fanout; ++i) {
+        ts->QueueTask([ts, count, fanout, depth]() {
+            QueueTree(ts, count, fanout, depth - 1);
+        });
+    }
+}
+
+[[nodiscard]] auto TreeSize(std::size_t fanout, std::size_t depth)
+    -> std::size_t {
+    std::size_t size{1};
+    std::size_t level{1};
+    for (std::size_t i{}; i < depth; ++i) {
+        level *= fanout;
+        size += level;
+    }
+    return size;
+}
+
 }  // namespace
 
 TEST_CASE("Basic", "[task_system]") {
@@ -321,3 +351,58 @@ TEST_CASE("Shut down a running task system", "[task_system]") {
     CHECK(count > 0);
     CHECK(finished);
 }
+
+TEST_CASE("Tasks queued from within tasks are executed", "[task_system]") {
+    std::size_t const fanout = GENERATE(1U, 2U, 8U);
+    std::size_t const depth = GENERATE(1U, 4U);
+    std::size_t const num_threads = GENERATE(1U, 4U);
+
+    std::atomic<std::size_t> count{};
+    {
+        TaskSystem ts{num_threads};
+        ts.QueueTask([&ts, &count, fanout, depth]() {
+            QueueTree(&ts, &count, fanout, depth);
+        });
+    }
+    CHECK(count == TreeSize(fanout, depth));
+}
+
+TEST_CASE("Task system on analysis-shaped task graphs",
+          "[task_system][.benchmark]") {
+    static auto const kNumThreads = std::thread::hardware_concurrency();
+
+    // Deep fan-out: every task queues its dependencies from inside a worker.
+    BENCHMARK("Recursive fan-out (6^7 tasks)") {
+        std::atomic<std::size_t> count{};
+        {
+            TaskSystem ts{kNumThreads};
+            ts.QueueTask([&ts, &count]() { QueueTree(&ts, &count, 6, 7); });
+        }
+        return count.load();
+    };
+
+    // Many independent roots queued from outside, each with a small subtree.
+    BENCHMARK("External roots (10000 x 4^3 tasks)") {
+        std::atomic<std::size_t> count{};
+        {
+            TaskSystem ts{kNumThreads};
+            for (std::size_t i{}; i < 10000; ++i) {
+                ts.QueueTask([&ts, &count]() { QueueTree(&ts, &count, 4, 3); });
+            }
+        }
+        return count.load();
+    };
+
+    // Narrow chains: little parallelism, dominated by queue latency.
+    BENCHMARK("Chains (64 x 2000 tasks)") {
+        std::atomic<std::size_t> count{};
+        {
+            TaskSystem ts{kNumThreads};
+            for (std::size_t i{}; i < 64; ++i) {
+                ts.QueueTask(
+                    [&ts, &count]() { QueueTree(&ts, &count, 1, 2000); });
+            }
+        }
+        return count.load();
+    };
+}
@@ -0,0 +1,104 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This test replaces the global operator new for the whole binary, so it must
+// not share its binary with other tests.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/generators/catch_generators_all.hpp"
+#include "src/buildtool/multithreading/task_system.hpp"
+
+namespace {
+
+std::atomic<std::size_t> number_of_allocations{};
+
+}  // namespace
+
+// Count heap allocations, to check the per-task allocation cost.
+auto operator new(std::size_t size) -> void* {
+    ++number_of_allocations;
+    if (void* ptr = std::malloc(size)) {  // NOLINT
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);  // NOLINT
+}
+
+void operator delete(void* ptr, std::size_t /*unused*/) noexcept {
+    std::free(ptr);  // NOLINT
+}
+
+namespace {
+
+// Recursively queue `fanout` tasks per level, up to `depth`, each from within
+// a worker thread.
+void QueueTree(TaskSystem* ts,
+               std::atomic<std::size_t>* count,
+               std::size_t fanout,
+               std::size_t depth) {
+    ++(*count);
+    if (depth == 0) {
+        return;
+    }
+    for (std::size_t i{}; i < fanout; ++i) {
+        ts->QueueTask([ts, count, fanout, depth]() {
+            QueueTree(ts, count, fanout, depth - 1);
+        });
+    }
+}
+
+[[nodiscard]] auto TreeSize(std::size_t fanout, std::size_t depth)
+    -> std::size_t {
+    std::size_t size{1};
+    std::size_t level{1};
+    for (std::size_t i{}; i < depth; ++i) {
+        level *= fanout;
+        size += level;
+    }
+    return size;
+}
+
+}  // namespace
+
+TEST_CASE("Queueing small tasks from within tasks does not allocate",
+          "[task_system]") {
+    std::size_t const num_threads = GENERATE(1U, 4U);
+    std::size_t const fanout = 4;
+    std::size_t const depth = 7;
+
+    std::atomic<std::size_t> count{};
+    TaskSystem ts{num_threads};
+    ts.Finish();
+
+    auto const before = number_of_allocations.load();
+    ts.QueueTask([&ts, &count]() { QueueTree(&ts, &count, fanout, depth); });
+    ts.Finish();
+    auto const allocations = number_of_allocations.load() - before;
+
+    REQUIRE(count == TreeSize(fanout, depth));
+    // Task nodes are recycled; only a few allocations are expected for the
+    // initial filling of the node caches and growing the deques.
+    auto const allocations_per_task =
+        static_cast<double>(allocations) / static_cast<double>(count);
+    INFO("allocations per task: " << allocations_per_task);
+    CHECK(allocations_per_task < 0.1);
+}
@@ -0,0 +1,81 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/profile/profile.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "nlohmann/json.hpp"
+#include "src/buildtool/build_engine/base_maps/entity_name_data.hpp"
+#include "src/buildtool/build_engine/expression/configuration.hpp"
+#include "src/buildtool/build_engine/target_map/configured_target.hpp"
+#include "src/buildtool/progress_reporting/progress.hpp"
+
+TEST_CASE("Profile records analysis and actions", "[profile]") {
+    std::filesystem::path const file{"profile.json"};
+    auto const target = BuildMaps::Target::ConfiguredTarget{
+        .target = BuildMaps::Base::EntityName{"", "module", "name"},
+        .config = Configuration{}};
+    std::string const action_id{"0123456789abcdef"};
+
+    Progress progress{};
+    progress.OriginMap()[action_id] =
+        std::vector<std::pair<BuildMaps::Target::ConfiguredTarget,
+                              std::size_t>>{{target, 1}};
+
+    Profile profile{file};
+    profile.NoteAnalysisStart(target);
+    profile.NoteAnalysisEnd(target);
+    profile.NoteActionQueued(action_id);
+    profile.NoteActionStarted(action_id);
+    profile.NoteActionPhase(
+        action_id, Profile::ActionPhase::kStaging, Profile::Clock::now());
+    profile.NoteActionPhase(
+        action_id, Profile::ActionPhase::kExecution, Profile::Clock::now());
+    profile.NoteActionCompleted(action_id,
+                                /*cached=*/true,
+                                /*exit_code=*/0,
+                                {{"out.txt", 42}});
+    profile.Write(&progress);
+
+    std::ifstream is{file};
+    auto const json = nlohmann::json::parse(is);
+
+    REQUIRE(json["analysis"].size() == 1);
+    auto const& analysis = json["analysis"][0];
+    CHECK(analysis["target"] == target.target.ToJson());
+    CHECK(analysis["config"] == target.config.ToJson());
+    CHECK(analysis["duration"].get<double>() >= 0.0);
+
+    REQUIRE(json["actions"].contains(action_id));
+    auto const& action = json["actions"][action_id];
+    REQUIRE(action["origins"].size() == 1);
+    CHECK(action["origins"][0]["target"] == target.target.ToJson());
+    CHECK(action["origins"][0]["subtask"] == 1);
+    CHECK(action["cached"] == true);
+    CHECK(action["exit code"] == 0);
+    CHECK(action["output sizes"]["out.txt"] == 42);
+    CHECK(action["durations"].contains("queue"));
+    CHECK(action["durations"].contains("staging"));
+    CHECK(action["durations"].contains("execution"));
+    CHECK_FALSE(action["durations"].contains("upload"));
+
+    CHECK(json["wall time"].get<double>() >= 0.0);
+    CHECK(json.contains("cpu time"));
+}
@@ -0,0 +1,214 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/storage/file_chunker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "catch2/catch_test_macros.hpp"
+#include "fmt/core.h"
+
+namespace {
+
+[[nodiscard]] auto GetTestDir() -> std::filesystem::path {
+    auto* tmp_dir = std::getenv("TEST_TMPDIR");
+    if (tmp_dir != nullptr) {
+        return tmp_dir;
+    }
+    return std::filesystem::current_path() / "test/buildtool/storage";
+}
+
+[[nodiscard]] auto WriteFile(std::filesystem::path const& path,
+                             std::string const& content) -> bool {
+    std::ofstream file{path, std::ios::binary};
+    file << content;
+    file.close();
+    return file.good();
+}
+
+[[nodiscard]] auto RandomContent(std::size_t size, std::uint64_t seed)
+    -> std::string {
+    std::mt19937_64 gen{seed};
+    std::string content(size, '\0');
+    for (auto& c : content) {
+        c = static_cast<char>(gen());
+    }
+    return content;
+}
+
+/// \brief Chunk content in memory byte by byte, like FileChunker initialized
+/// with the default seed did before its boundary scan was optimized. Chunk
+/// boundaries must never change, as they determine the parts of large
+/// objects already split in local build roots.
+[[nodiscard]] auto ReferenceChunks(std::string const& content)
+    -> std::vector<std::string> {
+    constexpr std::uint64_t kMaskS{0x4444d9f003530000ULL};
+    constexpr std::uint64_t kMaskL{0x4444d90003530000ULL};
+    constexpr std::size_t kAverage{1024 * 128};
+    constexpr std::size_t kMin{kAverage >> 2U};
+    constexpr std::size_t kMax{kAverage << 3U};
+
+    std::array<std::uint64_t, 256> gear{};
+    std::mt19937_64 gen64{0};
+    for (auto& item : gear) {
+        item = gen64();
+    }
+
+    std::vector<std::string> chunks{};
+    std::size_t pos = 0;
+    while (pos < content.size()) {
+        auto n = content.size() - pos;
+        auto normal = kAverage;
+        std::size_t boundary = n;
+        if (n > kMin) {
+            n = std::min(n, kMax);
+            normal = std::min(normal, n);
+            std::uint64_t fp = 0;
+            std::size_t i = kMin;
+            for (; i < normal; ++i) {
+                fp = (fp << 1U) +
+                     gear.at(static_cast<std::uint8_t>(content[pos + i]));
+                if ((fp & kMaskS) == 0) {
+                    break;
+                }
+            }
+            if (i == normal) {
+                for (; i < n; ++i) {
+                    fp = (fp << 1U) +
+                         gear.at(static_cast<std::uint8_t>(content[pos + i]));
+                    if ((fp & kMaskL) == 0) {
+                        break;
+                    }
+                }
+            }
+            boundary = i;
+        }
+        chunks.emplace_back(content.substr(pos, boundary));
+        pos += boundary;
+    }
+    return chunks;
+}
+
+[[nodiscard]] auto Chunks(std::filesystem::path const& path)
+    -> std::vector<std::string> {
+    std::vector<std::string> chunks{};
+    FileChunker chunker{path};
+    REQUIRE(chunker.IsOpen());
+    while (auto chunk = chunker.NextChunk()) {
+        chunks.emplace_back(*chunk);
+    }
+    CHECK(chunker.Finished());
+    return chunks;
+}
+
+}  // namespace
+
+TEST_CASE("FileChunker: boundaries", "[storage]") {
+    auto const dir = GetTestDir() / "file_chunker";
+    std::filesystem::create_directories(dir);
+
+    // sizes around the minimal and maximal chunk sizes and the read buffer,
+    // random, constant and periodic content
+    std::string periodic{};
+    for (std::size_t i = 0; periodic.size() < (std::size_t{3} << 20U); ++i) {
+        periodic += fmt::format("line {}\n", i % 5000);
+    }
+    std::vector<std::string> const contents{
+        std::string{},
+        std::string(1, 'x'),
+        RandomContent(32 * 1024, 1),
+        RandomContent(32 * 1024 + 1, 2),
+        RandomContent(200 * 1024, 3),
+        std::string(std::size_t{5} << 20U, '\0'),
+        periodic,
+        RandomContent((std::size_t{21} << 20U) + 123, 4)};
+
+    for (std::size_t i = 0; i < contents.size(); ++i) {
+        auto const path = dir / fmt::format("content_{}", i);
+        REQUIRE(WriteFile(path, contents[i]));
+        auto const chunks = Chunks(path);
+        CHECK(chunks == ReferenceChunks(contents[i]));
+    }
+}
+
+TEST_CASE("FileChunker: chunking profiles", "[storage]") {
+    auto const dir = GetTestDir() / "file_chunker_profiles";
+    std::filesystem::create_directories(dir);
+
+    auto const content = RandomContent(std::size_t{24} << 20U, 5);
+    auto const path = dir / "random";
+    REQUIRE(WriteFile(path, content));
+
+    // average chunk sizes of the profiles
+    std::vector<std::pair<ChunkingProfile, std::size_t>> const profiles{
+        {ChunkingProfile::Small, 1024 * 16},
+        {ChunkingProfile::Default, 1024 * 128},
+        {ChunkingProfile::Large, 1024 * 1024}};
+
+    std::size_t previous_count = 0;
+    for (auto const& [profile, average] : profiles) {
+        CHECK(ChunkingProfileFromString(ToString(profile)) == profile);
+
+        FileChunker chunker{path, profile};
+        REQUIRE(chunker.IsOpen());
+        std::string joined{};
+        std::size_t count = 0;
+        while (auto chunk = chunker.NextChunk()) {
+            CHECK(chunk->size() <= average * 8);
+            joined += *chunk;
+            ++count;
+        }
+        CHECK(chunker.Finished());
+        CHECK(joined == content);
+        if (previous_count != 0) {
+            CHECK(count < previous_count);
+        }
+        previous_count = count;
+    }
+    CHECK_FALSE(ChunkingProfileFromString("unknown"));
+}
+
+TEST_CASE("FileChunker: throughput", "[storage][.benchmark]") {
+    auto const dir = GetTestDir() / "file_chunker_throughput";
+    std::filesystem::create_directories(dir);
+
+    constexpr std::size_t kSize = std::size_t{512} << 20U;
+    auto const path = dir / "random";
+    REQUIRE(WriteFile(path, RandomContent(kSize, 0)));
+
+    constexpr double kGiga = 1e9;
+    auto const start = std::chrono::steady_clock::now();
+    std::size_t total = 0;
+    FileChunker chunker{path};
+    while (auto chunk = chunker.NextChunk()) {
+        total += chunk->size();
+    }
+    std::chrono::duration<double> const duration =
+        std::chrono::steady_clock::now() - start;
+    CHECK(chunker.Finished());
+    CHECK(total == kSize);
+    WARN(fmt::format("chunking: {:.3f} GB/s",
+                     static_cast<double>(total) / kGiga / duration.count()));
+}
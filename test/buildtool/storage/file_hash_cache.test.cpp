@@ -0,0 +1,97 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/buildtool/storage/file_hash_cache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "catch2/catch_test_macros.hpp"
+#include "src/buildtool/common/artifact_digest_factory.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/buildtool/file_system/object_type.hpp"
+#include "src/buildtool/storage/config.hpp"
+#include "test/utils/hermeticity/test_storage_config.hpp"
+
+TEST_CASE("FileHashCache: digests of files", "[storage]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const& hash_function = storage_config.Get().hash_function;
+
+    auto const dir = storage_config.Get().build_root / "file_hash_cache_test";
+    REQUIRE(FileSystemManager::CreateDirectory(dir));
+    auto const file = dir / "file";
+    REQUIRE(FileSystemManager::WriteFile("content", file));
+
+    auto const expected = ArtifactDigestFactory::HashFileAs<ObjectType::File>(
+        hash_function, file);
+    REQUIRE(expected);
+
+    SECTION("Hash files") {
+        FileHashCache cache{&storage_config.Get()};
+        CHECK(cache.HashFile(file) == expected);
+        CHECK(cache.HashFile(file) == expected);
+        CHECK_FALSE(cache.HashFile(dir));
+        CHECK_FALSE(cache.HashFile(dir / "missing"));
+    }
+
+    SECTION("Changed files are hashed again") {
+        FileHashCache cache{&storage_config.Get()};
+        CHECK(cache.HashFile(file) == expected);
+
+        // same size, different content
+        REQUIRE(FileSystemManager::WriteFile("CONTENT", file));
+        auto const changed =
+            ArtifactDigestFactory::HashFileAs<ObjectType::File>(hash_function,
+                                                                file);
+        REQUIRE(changed);
+        CHECK(cache.HashFile(file) == changed);
+    }
+
+    SECTION("Persist digests") {
+        // recently changed files are not cached
+        {
+            FileHashCache cache{&storage_config.Get()};
+            CHECK(cache.HashFile(file) == expected);
+            CHECK(cache.Save());
+        }
+        CHECK_FALSE(FileSystemManager::IsFile(
+            storage_config.Get().FileHashCacheFile()));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{2500});
+        {
+            FileHashCache cache{&storage_config.Get()};
+            CHECK(cache.HashFile(file) == expected);
+            CHECK(cache.Save());
+        }
+        auto const saved = FileSystemManager::ReadFile(
+            storage_config.Get().FileHashCacheFile());
+        REQUIRE(saved);
+        CHECK(saved->find(expected->hash()) != std::string::npos);
+        CHECK(saved->find(file.string()) != std::string::npos);
+
+        FileHashCache cache{&storage_config.Get()};
+        CHECK(cache.HashFile(file) == expected);
+
+        // cached digests are invalidated by changes
+        REQUIRE(FileSystemManager::WriteFile("CONTENT", file));
+        auto const changed =
+            ArtifactDigestFactory::HashFileAs<ObjectType::File>(hash_function,
+                                                                file);
+        REQUIRE(changed);
+        CHECK(cache.HashFile(file) == changed);
+    }
+}
@@ -27,13 +27,16 @@
 
 #include "catch2/catch_test_macros.hpp"
 #include "src/buildtool/common/artifact_digest.hpp"
+#include "src/buildtool/common/artifact_digest_factory.hpp"
 #include "src/buildtool/common/protocol_traits.hpp"
 #include "src/buildtool/crypto/hash_function.hpp"
 #include "src/buildtool/execution_api/bazel_msg/bazel_msg_factory.hpp"
 #include "src/buildtool/execution_api/common/execution_common.hpp"
+#include "src/buildtool/file_system/file_storage.hpp"
 #include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/file_chunker.hpp"
 #include "src/buildtool/storage/garbage_collector.hpp"
 #include "src/buildtool/storage/local_cas.hpp"
 #include "src/buildtool/storage/storage.hpp"
@@ -526,6 +529,111 @@ TEST_CASE("LocalCAS: Split-Splice", "[storage]") {
     }
 }
 
+// Large objects are split by multiple threads, which must neither change the
+// chunks nor their order.
+TEST_CASE("LargeObjectCAS: split in order of chunks", "[storage]") {
+    auto const config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&config.Get());
+    auto const& cas = storage.CAS();
+
+    auto object = LargeTestUtils::File::Create(
+        cas, LargeTestUtils::File::kLargeId, LargeTestUtils::File::kLargeSize);
+    REQUIRE(object);
+    auto const& [digest, path] = *object;
+
+    std::vector<ArtifactDigest> expected;
+    FileChunker chunker{path};
+    REQUIRE(chunker.IsOpen());
+    while (auto chunk = chunker.NextChunk()) {
+        expected.emplace_back(
+            ArtifactDigestFactory::HashDataAs<ObjectType::File>(
+                config.Get().hash_function, std::string{*chunk}));
+    }
+    REQUIRE(chunker.Finished());
+    REQUIRE(expected.size() > 1);
+
+    auto parts = cas.SplitBlob(digest);
+    REQUIRE(parts);
+    CHECK(*parts == expected);
+    for (auto const& part : *parts) {
+        CHECK(cas.BlobPath(part, /*is_executable=*/false));
+    }
+}
+
+// Objects are split with the chunking profile of the storage configuration,
+// which is recorded in the large entry. Entries of any profile are spliced and
+// reused by configurations with other profiles.
+TEST_CASE("LargeObjectCAS: chunking profiles", "[storage]") {
+    auto const config = TestStorageConfig::Create();
+    auto small_config =
+        StorageConfig::Builder{}
+            .SetBuildRoot(config.Get().build_root)
+            .SetHashType(config.Get().hash_function.GetType())
+            .SetChunkingProfile(ChunkingProfile::Small)
+            .Build();
+    REQUIRE(small_config);
+    REQUIRE(small_config->chunking_profile == ChunkingProfile::Small);
+
+    auto const storage = Storage::Create(&config.Get());
+    auto const small_storage = Storage::Create(&*small_config);
+
+    auto object = LargeTestUtils::File::Create(
+        storage.CAS(),
+        LargeTestUtils::File::kLargeId,
+        LargeTestUtils::File::kLargeSize);
+    REQUIRE(object);
+    auto const& [digest, path] = *object;
+
+    // Split with the small profile and check the profile is recorded:
+    auto small_parts = small_storage.CAS().SplitBlob(digest);
+    REQUIRE(small_parts);
+    auto const entry_path =
+        small_storage.CAS().StorageRoot(ObjectType::File, /*large=*/true) /
+        digest.hash().substr(0, FileStorageData::kDirectoryNameLength) /
+        digest.hash().substr(FileStorageData::kDirectoryNameLength);
+    auto const content = FileSystemManager::ReadFile(entry_path);
+    REQUIRE(content);
+    auto const entry = LargeObjectEntry::Parse(
+        *content, config.Get().hash_function.GetType());
+    REQUIRE(entry);
+    CHECK(entry->profile == ChunkingProfile::Small);
+    CHECK(entry->parts == *small_parts);
+
+    // Chunks of the small profile are smaller than chunks of the default one:
+    std::vector<ArtifactDigest> default_parts;
+    FileChunker chunker{path};
+    REQUIRE(chunker.IsOpen());
+    while (auto chunk = chunker.NextChunk()) {
+        default_parts.emplace_back(
+            ArtifactDigestFactory::HashDataAs<ObjectType::File>(
+                config.Get().hash_function, std::string{*chunk}));
+    }
+    CHECK(small_parts->size() > default_parts.size());
+
+    // The entry is reused and spliced by the default configuration:
+    REQUIRE(FileSystemManager::RemoveFile(path));
+    auto parts = storage.CAS().SplitBlob(digest);
+    REQUIRE(parts);
+    CHECK(*parts == *small_parts);
+    auto spliced = storage.CAS().BlobPath(digest, /*is_executable=*/false);
+    REQUIRE(spliced);
+    CHECK(ArtifactDigestFactory::HashFileAs<ObjectType::File>(
+              config.Get().hash_function, *spliced) == digest);
+
+    // Entries of the default profile keep the plain list of parts:
+    auto const default_entry =
+        LargeObjectEntry{.profile = ChunkingProfile::Default,
+                         .parts = default_parts}
+            .ToString();
+    REQUIRE(default_entry);
+    CHECK(default_entry->front() == '[');
+    auto const parsed = LargeObjectEntry::Parse(
+        *default_entry, config.Get().hash_function.GetType());
+    REQUIRE(parsed);
+    CHECK(parsed->profile == ChunkingProfile::Default);
+    CHECK(parsed->parts == default_parts);
+}
+
 // Test uplinking of nested large objects:
 // A large tree depends on a number of nested objects:
 //
@@ -711,9 +819,9 @@ auto Tree::StoreRaw(LocalCAS<kDefaultDoGlobalUplink> const& cas,
         return std::nullopt;
     }
 
-    auto store_blob = [&cas](std::filesystem::path const& path,
-                             auto is_exec) -> std::optional<ArtifactDigest> {
-        return cas.StoreBlob</*kOwner=*/true>(path, is_exec);
+    auto store_blobs = [&cas](auto const& files)
+        -> std::optional<std::vector<ArtifactDigest>> {
+        return cas.StoreBlobs</*kOwner=*/true>(files);
     };
     auto store_tree =
         [&cas](std::string const& content) -> std::optional<ArtifactDigest> {
@@ -726,9 +834,9 @@ auto Tree::StoreRaw(LocalCAS<kDefaultDoGlobalUplink> const& cas,
 
     return ProtocolTraits::IsNative(cas.GetHashFunction().GetType())
                ? BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
-                     directory, store_blob, store_tree, store_symlink)
+                     directory, store_blobs, store_tree, store_symlink)
                : BazelMsgFactory::CreateDirectoryDigestFromLocalTree(
-                     directory, store_blob, store_tree, store_symlink);
+                     directory, store_blobs, store_tree, store_symlink);
 }
 }  // namespace LargeTestUtils
 
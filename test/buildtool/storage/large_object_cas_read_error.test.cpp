@@ -0,0 +1,121 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// This test replaces read(2) for the whole binary, so it must not share its
+// binary with other tests.
+
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+#include "catch2/catch_test_macros.hpp"
+#include "src/buildtool/common/artifact_digest.hpp"
+#include "src/buildtool/file_system/file_storage.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
+#include "src/buildtool/file_system/object_type.hpp"
+#include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/large_object_cas.hpp"
+#include "src/buildtool/storage/storage.hpp"
+#include "src/utils/cpp/tmp_dir.hpp"
+#include "test/utils/hermeticity/test_storage_config.hpp"
+#include "test/utils/large_objects/large_object_utils.hpp"
+
+namespace {
+// Reads of the file with this inode fail once the offset reaches the limit.
+std::atomic<ino_t> failing_inode{0};
+std::atomic<off_t> failing_offset{-1};
+
+class ReadFailure final {
+  public:
+    ReadFailure(std::filesystem::path const& path, off_t offset) noexcept {
+        struct stat st{};
+        if (::stat(path.c_str(), &st) == 0) {
+            failing_inode = st.st_ino;
+            failing_offset = offset;
+        }
+    }
+    ReadFailure(ReadFailure const&) = delete;
+    ReadFailure(ReadFailure&&) = delete;
+    auto operator=(ReadFailure const&) -> ReadFailure& = delete;
+    auto operator=(ReadFailure&&) -> ReadFailure& = delete;
+    ~ReadFailure() noexcept { failing_offset = -1; }
+
+    [[nodiscard]] static auto Armed() noexcept -> bool {
+        return failing_offset >= 0;
+    }
+};
+}  // namespace
+
+extern "C" auto read(int fd, void* buf, std::size_t count) -> ssize_t {
+    auto const limit = failing_offset.load();
+    struct stat st{};
+    if (limit >= 0 and ::fstat(fd, &st) == 0 and
+        st.st_ino == failing_inode.load()) {
+        auto const pos = ::lseek(fd, 0, SEEK_CUR);
+        if (pos >= limit) {
+            errno = EIO;
+            return -1;
+        }
+        count = std::min(count, static_cast<std::size_t>(limit - pos));
+    }
+    return ::syscall(SYS_read, fd, buf, count);
+}
+
+TEST_CASE("LargeObjectCAS: split with failing read", "[storage]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const& cas = storage.CAS();
+
+    // Create a large file that is split into several chunks:
+    static constexpr std::uintmax_t kSize = 8UL * 1024 * 1024;
+    auto const tmp = storage_config.Get().CreateTypedTmpDir("test");
+    REQUIRE(tmp);
+    auto const file = tmp->GetPath() / "large_blob";
+    REQUIRE(LargeObjectUtils::GenerateFile(file, kSize));
+    auto const digest = cas.StoreBlob(file, /*is_executable=*/false);
+    REQUIRE(digest);
+    auto const path = cas.BlobPath(*digest, /*is_executable=*/false);
+    REQUIRE(path);
+
+    auto const hash = digest->hash();
+    auto const large_entry =
+        cas.StorageRoot(ObjectType::File, /*large=*/true) /
+        hash.substr(0, FileStorageData::kDirectoryNameLength) /
+        hash.substr(FileStorageData::kDirectoryNameLength);
+
+    {
+        // Fail reading behind the first buffer, so that some chunks get
+        // stored before the error is hit:
+        ReadFailure const failure{*path, static_cast<off_t>(kSize * 3 / 4)};
+        REQUIRE(ReadFailure::Armed());
+
+        auto split = cas.SplitBlob(*digest);
+        CHECK_FALSE(split);
+        CHECK_FALSE(FileSystemManager::IsFile(large_entry));
+    }
+
+    // Once reading succeeds, splitting records the large entry:
+    auto split = cas.SplitBlob(*digest);
+    REQUIRE(split);
+    CHECK(split->size() > 1);
+    CHECK(FileSystemManager::IsFile(large_entry));
+}
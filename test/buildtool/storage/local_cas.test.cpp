@@ -12,9 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
+#include <cstddef>
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "catch2/catch_test_macros.hpp"
 #include "src/buildtool/common/artifact_digest_factory.hpp"
@@ -22,6 +27,7 @@
 #include "src/buildtool/file_system/file_system_manager.hpp"
 #include "src/buildtool/file_system/object_type.hpp"
 #include "src/buildtool/storage/config.hpp"
+#include "src/buildtool/storage/garbage_collector.hpp"
 #include "src/buildtool/storage/storage.hpp"
 #include "test/utils/hermeticity/test_storage_config.hpp"
 
@@ -176,3 +182,121 @@ TEST_CASE("LocalCAS: Add blob to storage from executable file", "[storage]") {
         CHECK(not FileSystemManager::IsExecutable(*file_path));
     }
 }
+
+TEST_CASE("LocalCAS: Add many blobs to storage from files", "[storage]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const& cas = storage.CAS();
+
+    auto const tmp = storage_config.Get().CreateTypedTmpDir("blobs");
+    REQUIRE(tmp);
+
+    // many small files, stored together, and a large one, stored on its own
+    std::vector<std::pair<std::filesystem::path, bool>> files{};
+    for (std::size_t i{}; i < 1000; ++i) {
+        auto path = tmp->GetPath() / std::to_string(i);
+        auto const size = i == 500 ? std::size_t{1} << 20U : i * 50;
+        REQUIRE(FileSystemManager::WriteFile(
+            std::string(size, static_cast<char>('a' + (i % 26))), path));
+        files.emplace_back(std::move(path), i % 3 == 0);
+    }
+
+    auto const digests = cas.StoreBlobs(files);
+    REQUIRE(digests);
+    REQUIRE(digests->size() == files.size());
+    for (std::size_t i{}; i < files.size(); ++i) {
+        auto const& [path, is_executable] = files[i];
+        auto const expected =
+            ArtifactDigestFactory::HashFileAs<ObjectType::File>(
+                storage_config.Get().hash_function, path);
+        REQUIRE(expected);
+        CHECK((*digests)[i] == *expected);
+        CHECK((*digests)[i].size() == expected->size());
+        CHECK(cas.BlobPathNoSync(*expected, is_executable));
+    }
+
+    // files that cannot be read fail the whole batch
+    files.emplace_back(tmp->GetPath() / "missing", false);
+    CHECK_FALSE(cas.StoreBlobs(files));
+}
+
+TEST_CASE("LocalCAS: Evict cold objects", "[storage]") {
+    auto const storage_config = TestStorageConfig::Create();
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const& cas = storage.CAS();
+
+    // Store objects in order; after rotation, the first ones are the coldest.
+    constexpr std::size_t kSize = 64 * 1024;
+    auto const cold = cas.StoreBlob(std::string(kSize, 'a'), false);
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    auto const warm = cas.StoreBlob(std::string(kSize, 'b'), false);
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    auto const hot = cas.StoreBlob(std::string(kSize, 'c'), false);
+    REQUIRE(cold);
+    REQUIRE(warm);
+    REQUIRE(hot);
+    REQUIRE(GarbageCollector::TriggerGarbageCollection(storage_config.Get()));
+
+    // Use the hot object, uplinking it to the youngest generation:
+    REQUIRE(cas.BlobPath(*hot, false));
+
+    // The cache is within its budget, nothing is evicted:
+    CHECK(GarbageCollector::TriggerGarbageCollection(
+        storage_config.Get(),
+        /*no_rotation=*/true,
+        CacheSizeLimits{.max_size = 4 * kSize, .target_size = 4 * kSize}));
+
+    // Evict only as much as needed, least recently used objects first:
+    CHECK(GarbageCollector::TriggerGarbageCollection(
+        storage_config.Get(),
+        /*no_rotation=*/true,
+        CacheSizeLimits{.max_size = 2 * kSize, .target_size = 2 * kSize}));
+    CHECK_FALSE(cas.BlobPath(*cold, false));
+    CHECK(cas.BlobPath(*warm, false));
+    CHECK(cas.BlobPath(*hot, false));
+
+    // Objects used since the last rotation are never evicted:
+    CHECK(GarbageCollector::TriggerGarbageCollection(
+        storage_config.Get(),
+        /*no_rotation=*/true,
+        CacheSizeLimits{.max_size = 0, .target_size = 0}));
+    CHECK(cas.BlobPath(*warm, false));
+    CHECK(cas.BlobPath(*hot, false));
+}
+
+TEST_CASE("LocalCAS: Evict cold objects when rotating", "[storage]") {
+    auto const storage_config = TestStorageConfig::Create();
+    REQUIRE(storage_config.Get().num_generations == 2);
+    auto const storage = Storage::Create(&storage_config.Get());
+    auto const& cas = storage.CAS();
+
+    // All objects are in the youngest generation, which becomes the only
+    // generation kept by the rotation.
+    constexpr std::size_t kSize = 64 * 1024;
+    auto const cold = cas.StoreBlob(std::string(kSize, 'a'), false);
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    auto const warm = cas.StoreBlob(std::string(kSize, 'b'), false);
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    auto const hot = cas.StoreBlob(std::string(kSize, 'c'), false);
+    REQUIRE(cold);
+    REQUIRE(warm);
+    REQUIRE(hot);
+
+    // Evict least recently used objects of the youngest generation:
+    CHECK(GarbageCollector::TriggerGarbageCollection(
+        storage_config.Get(),
+        /*no_rotation=*/false,
+        CacheSizeLimits{.max_size = 2 * kSize, .target_size = 2 * kSize}));
+    CHECK_FALSE(cas.BlobPath(*cold, false));
+    CHECK(cas.BlobPath(*warm, false));
+    CHECK(cas.BlobPath(*hot, false));
+
+    // Both remaining objects were uplinked again; the next rotation drops the
+    // older generation, and evicts from the youngest:
+    CHECK(GarbageCollector::TriggerGarbageCollection(
+        storage_config.Get(),
+        /*no_rotation=*/false,
+        CacheSizeLimits{.max_size = 0, .target_size = 0}));
+    CHECK_FALSE(cas.BlobPath(*warm, false));
+    CHECK_FALSE(cas.BlobPath(*hot, false));
+}
@@ -14,17 +14,21 @@
 
 #include "src/buildtool/system/system_command.hpp"
 
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <map>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "catch2/benchmark/catch_benchmark.hpp"
 #include "catch2/catch_test_macros.hpp"
 #include "catch2/matchers/catch_matchers_all.hpp"
+#include "fmt/core.h"
 #include "src/buildtool/file_system/file_system_manager.hpp"
 
 namespace {
@@ -131,4 +135,99 @@ TEST_CASE("SystemCommand", "[filesystem]") {
         CHECK(*FileSystemManager::ReadFile(tmpdir / "stdout") == stdout + '\n');
         CHECK(*FileSystemManager::ReadFile(tmpdir / "stderr") == stderr + '\n');
     }
+
+    SECTION("stdin is empty") {
+        auto tmpdir = testdir / "stdin";
+        REQUIRE(FileSystemManager::CreateDirectoryExclusive(tmpdir));
+        auto output = system.Execute(
+            {"cat"}, {}, FileSystemManager::GetCurrentDirectory(), tmpdir);
+        REQUIRE(output.has_value());
+        CHECK(*output == 0);
+        CHECK(FileSystemManager::ReadFile(tmpdir / "stdout")->empty());
+    }
+
+    SECTION("failure to execute is reported") {
+        auto tmpdir = testdir / "missing_command";
+        REQUIRE(FileSystemManager::CreateDirectoryExclusive(tmpdir));
+        auto output =
+            system.Execute({"/nonexistent/command"},
+                           {},
+                           FileSystemManager::GetCurrentDirectory(),
+                           tmpdir);
+        REQUIRE(output.has_value());
+        CHECK(*output != 0);
+        CHECK_THAT(*FileSystemManager::ReadFile(tmpdir / "stderr"),
+                   StartsWith("Failed to execute '/nonexistent/command'"));
+
+        tmpdir = testdir / "missing_cwd";
+        REQUIRE(FileSystemManager::CreateDirectoryExclusive(tmpdir));
+        output = system.Execute({"echo", "unexpected"},
+                                {},
+                                tmpdir / "nonexistent",
+                                tmpdir);
+        REQUIRE(output.has_value());
+        CHECK(*output != 0);
+        CHECK(FileSystemManager::ReadFile(tmpdir / "stdout")->empty());
+    }
+
+    SECTION("command exceeding its timeout is killed with its descendants") {
+        auto tmpdir = testdir / "timeout";
+        REQUIRE(FileSystemManager::CreateDirectoryExclusive(tmpdir));
+        auto const flag = tmpdir / "flag";
+        auto const start = std::chrono::steady_clock::now();
+        auto result = system.Run(
+            {"/bin/sh",
+             "-c",
+             fmt::format("(sleep 2; touch '{}') & sleep 10", flag.string())},
+            {},
+            FileSystemManager::GetCurrentDirectory(),
+            tmpdir,
+            std::chrono::milliseconds{200});
+        auto const duration = std::chrono::steady_clock::now() - start;
+        REQUIRE(result.has_value());
+        CHECK(result->timed_out);
+        CHECK(result->exit_code != 0);
+        CHECK(duration < std::chrono::seconds{2});
+
+        // the background process got killed as well
+        std::this_thread::sleep_for(std::chrono::milliseconds{2500});
+        CHECK_FALSE(FileSystemManager::IsFile(flag));
+    }
+
+    SECTION("resource usage is reported") {
+        auto tmpdir = testdir / "usage";
+        REQUIRE(FileSystemManager::CreateDirectoryExclusive(tmpdir));
+        auto result = system.Run(
+            {"/bin/sh", "-c", "for i in 1 2 3; do echo $i; done"},
+            {},
+            FileSystemManager::GetCurrentDirectory(),
+            tmpdir,
+            std::chrono::milliseconds{60000});
+        REQUIRE(result.has_value());
+        CHECK_FALSE(result->timed_out);
+        CHECK(result->exit_code == 0);
+        CHECK(result->usage.ru_maxrss > 0);
+        CHECK(result->spawn_time.count() > 0);
+    }
+}
+
+TEST_CASE("SystemCommand: spawn latency", "[filesystem][.benchmark]") {
+    SystemCommand system{"SpawnBenchmark"};
+    auto const tmpdir = GetTestDir() / "spawn_benchmark";
+    REQUIRE(FileSystemManager::CreateDirectoryExclusive(tmpdir));
+    auto const cwd = FileSystemManager::GetCurrentDirectory();
+
+    // occupy 1 GiB of memory, as the cost of forking grows with the size of
+    // the parent
+    auto const ballast = std::string(std::size_t{1} << 30U, 'x');
+
+    int run = 0;
+    BENCHMARK("Spawn /bin/true") {
+        auto const outdir = tmpdir / std::to_string(run++);
+        if (not FileSystemManager::CreateDirectoryExclusive(outdir)) {
+            return std::optional<SystemCommand::Result>{};
+        }
+        return system.Run({"/bin/true"}, {}, cwd, outdir, std::nullopt);
+    };
+    CHECK(ballast.size() > 0);
 }
@@ -159,10 +159,10 @@ TEST_CASE("compute", "[tree_structure]") {
 namespace {
 [[nodiscard]] auto CreateDirectory(std::filesystem::path const& directory,
                                    Storage const& storage) {
-    BazelMsgFactory::FileStoreFunc store_file =
-        [&storage](std::filesystem::path const& path,
-                   bool is_exec) -> std::optional<ArtifactDigest> {
-        return storage.CAS().StoreBlob(path, is_exec);
+    BazelMsgFactory::FilesStoreFunc store_files =
+        [&storage](auto const& files)
+        -> std::optional<std::vector<ArtifactDigest>> {
+        return storage.CAS().StoreBlobs(files);
     };
 
     BazelMsgFactory::TreeStoreFunc store_tree =
@@ -178,7 +178,7 @@ namespace {
     };
 
     return BazelMsgFactory::CreateGitTreeDigestFromLocalTree(
-        directory, store_file, store_tree, store_symlink);
+        directory, store_files, store_tree, store_symlink);
 }
 
 [[nodiscard]] auto CreateFlatTestDirectory(StorageConfig const& storage_config,
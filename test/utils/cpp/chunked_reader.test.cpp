@@ -0,0 +1,86 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/cpp/chunked_reader.hpp"
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "catch2/catch_test_macros.hpp"
+#include "src/buildtool/file_system/file_system_manager.hpp"
+
+namespace {
+[[nodiscard]] auto GetTestDir() noexcept -> std::filesystem::path {
+    auto* tmp_dir = std::getenv("TEST_TMPDIR");
+    if (tmp_dir != nullptr) {
+        return tmp_dir;
+    }
+    return FileSystemManager::GetCurrentDirectory() / "test/utils";
+}
+
+/// \brief Read all chunks and concatenate them.
+[[nodiscard]] auto ReadAll(ChunkedReader* reader) -> std::string {
+    std::string result{};
+    while (true) {
+        auto chunk = reader->ReadChunk(result.size());
+        REQUIRE(chunk);
+        if (chunk->empty()) {
+            return result;
+        }
+        result.append(*chunk);
+    }
+}
+}  // namespace
+
+TEST_CASE("Read chunks", "[chunked_reader]") {
+    std::string const content{"0123456789abcdef0123456789"};
+    constexpr std::size_t kChunkSize = 7;
+
+    auto const file = GetTestDir() / "chunked_reader_content";
+    REQUIRE(FileSystemManager::WriteFile(content, file));
+
+    auto from_memory = ChunkedReader::FromMemory(
+        kChunkSize, std::make_shared<std::string const>(content));
+    REQUIRE(from_memory);
+    auto memory_reader = *std::move(from_memory);
+
+    auto from_file = ChunkedReader::FromFile(kChunkSize, file);
+    REQUIRE(from_file);
+    auto file_reader = *std::move(from_file);
+
+    for (auto* reader : {&memory_reader, &file_reader}) {
+        CHECK(reader->GetContentSize() == content.size());
+        CHECK(ReadAll(reader) == content);
+
+        // chunks may be read at arbitrary offsets, e.g., to resume an upload
+        auto chunk = reader->ReadChunk(3);
+        REQUIRE(chunk);
+        CHECK(*chunk == content.substr(3, kChunkSize));
+
+        chunk = reader->ReadChunk(content.size() - 2);
+        REQUIRE(chunk);
+        CHECK(*chunk == content.substr(content.size() - 2));
+
+        chunk = reader->ReadChunk(content.size() + 1);
+        REQUIRE(chunk);
+        CHECK(chunk->empty());
+    }
+
+    CHECK(not ChunkedReader::FromFile(kChunkSize, GetTestDir() / "missing"));
+    CHECK(not ChunkedReader::FromFile(0, file));
+}
@@ -0,0 +1,103 @@
+// Copyright 2024 Huawei Cloud Computing Technology Co., Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/cpp/deflate.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "catch2/catch_test_macros.hpp"
+
+namespace {
+[[nodiscard]] auto Compress(std::string const& data,
+                            std::size_t chunk_size,
+                            int level) -> std::string {
+    auto compressor = DeflateCompressor::Create(level);
+    REQUIRE(compressor);
+    auto deflate = *std::move(compressor);
+    std::string result{};
+    for (std::size_t pos = 0; pos < data.size(); pos += chunk_size) {
+        auto out = deflate.Compress(
+            std::string_view{data}.substr(pos, chunk_size), /*finish=*/false);
+        REQUIRE(out);
+        result += *out;
+    }
+    auto out = deflate.Compress({}, /*finish=*/true);
+    REQUIRE(out);
+    return result + *out;
+}
+
+[[nodiscard]] auto Decompress(std::string const& data,
+                              std::size_t chunk_size) -> std::string {
+    auto decompressor = DeflateDecompressor::Create(/*chunk_size=*/1000);
+    REQUIRE(decompressor);
+    auto inflate = *std::move(decompressor);
+    std::string result{};
+    auto sink = [&result](std::string const& chunk) {
+        CHECK(chunk.size() <= 1000);
+        result += chunk;
+        return true;
+    };
+    for (std::size_t pos = 0; pos < data.size(); pos += chunk_size) {
+        auto err = inflate.Decompress(
+            std::string_view{data}.substr(pos, chunk_size), sink);
+        REQUIRE_FALSE(err);
+    }
+    CHECK(inflate.IsFinished());
+    return result;
+}
+}  // namespace
+
+TEST_CASE("Deflate round trip", "[deflate]") {
+    std::string data{};
+    for (std::size_t i = 0; i < 100000; ++i) {
+        data += std::to_string(i % 1234);
+    }
+
+    SECTION("Single chunk") {
+        auto const compressed = Compress(data, data.size(), 6);
+        CHECK(compressed.size() < data.size() / 3);
+        CHECK(Decompress(compressed, compressed.size()) == data);
+    }
+
+    SECTION("Many chunks") {
+        for (int level : {DeflateCompressor::kMinLevel,
+                          DeflateCompressor::kMaxLevel}) {
+            auto const compressed = Compress(data, 4096, level);
+            CHECK(Decompress(compressed, 17) == data);
+        }
+    }
+
+    SECTION("Empty input") {
+        auto const compressed = Compress("", 1, 6);
+        CHECK_FALSE(compressed.empty());
+        CHECK(Decompress(compressed, 1).empty());
+    }
+}
+
+TEST_CASE("Deflate errors", "[deflate]") {
+    CHECK_FALSE(DeflateCompressor::Create(0));
+    CHECK_FALSE(DeflateCompressor::Create(10));
+    CHECK_FALSE(DeflateDecompressor::Create(0));
+
+    auto decompressor = DeflateDecompressor::Create();
+    REQUIRE(decompressor);
+    auto inflate = *std::move(decompressor);
+    auto sink = [](std::string const& /*unused*/) { return true; };
+    CHECK(inflate.Decompress(std::string(100, '\xff'), sink));
+    CHECK_FALSE(inflate.IsFinished());
+}